@@ -1,3 +1,6 @@
 C:/VulkanSDK/1.3.268.0/Bin/glslc.exe shader.vert -o vertex.spv
 C:/VulkanSDK/1.3.268.0/Bin/glslc.exe shader.frag -o fragment.spv
+C:/VulkanSDK/1.3.268.0/Bin/glslc.exe instanced.vert -o instanced_vertex.spv
+C:/VulkanSDK/1.3.268.0/Bin/glslc.exe cull.comp -o cull.spv
+C:/VulkanSDK/1.3.268.0/Bin/glslc.exe mipmaps.comp -o mipmaps.spv
 pause
\ No newline at end of file
@@ -0,0 +1,25 @@
+#version 450
+
+layout(location = 0) in vec3 vertexPosition;
+layout(location = 1) in vec3 vertexNormal;
+layout(location = 2) in vec2 vertexTexcoord;
+layout(location = 3) in vec3 vertexColor;
+
+layout(std430, set = 0, binding = 0) readonly buffer storageBuffer {
+	mat4 model[];
+} ObjectData;
+
+layout(std430, set = 0, binding = 1) readonly buffer materialBuffer {
+	uint material[];
+} ObjectMaterials;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexcoord;
+layout(location = 2) flat out uint fragMaterial;
+
+void main() {
+	gl_Position = ObjectData.model[gl_InstanceIndex] * vec4(vertexPosition, 1.0);
+	fragColor = vertexColor;
+	fragTexcoord = vertexTexcoord;
+	fragMaterial = ObjectMaterials.material[gl_InstanceIndex];
+}
\ No newline at end of file
@@ -1,9 +1,35 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+const uint NO_TEXTURE = 0xFFFFFFFF;
+
+struct Material {
+	vec4 baseColor;
+	uint baseColorTexture;
+	uint padding0;
+	uint padding1;
+	uint padding2;
+};
+
+//the bindless table, bound once for every draw
+layout(set = 1, binding = 0) uniform sampler textureSampler;
+layout(set = 1, binding = 1) uniform texture2D textures[];
+layout(std430, set = 1, binding = 2) readonly buffer materialBuffer {
+	Material materials[];
+} MaterialData;
 
 layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragTexcoord;
+layout(location = 2) flat in uint fragMaterial;
 
 layout(location = 0) out vec4 outColor;
 
 void main() {
-	outColor = vec4(fragColor, 1.0);
+	Material material = MaterialData.materials[fragMaterial];
+	outColor = vec4(fragColor, 1.0) * material.baseColor;
+
+	//instances in one draw can have different materials, so the index may diverge
+	if (material.baseColorTexture != NO_TEXTURE) {
+		outColor *= texture(sampler2D(textures[nonuniformEXT(material.baseColorTexture)], textureSampler), fragTexcoord);
+	}
 }
\ No newline at end of file
@@ -1,24 +1,23 @@
 #version 450
 
-vec2 positions[3] = vec2[](
-	vec2(0.0, -0.05),
-	vec2(0.05, 0.05),
-	vec2(-0.05, 0.05)
-);
+layout(location = 0) in vec3 vertexPosition;
+layout(location = 1) in vec3 vertexNormal;
+layout(location = 2) in vec2 vertexTexcoord;
+layout(location = 3) in vec3 vertexColor;
 
-vec3 colors[3] = vec3[](
-	vec3(1.0, 0.0, 0.0),
-	vec3(0.0, 1.0, 0.0),
-	vec3(0.0, 0.0, 1.0)
-);
-
-layout(push_constant) uniform constants {
+//one draw's data, picked out of the frame's arena by a dynamic offset
+layout(std140, set = 2, binding = 0) uniform objectBuffer {
 	mat4 model;
+	uint material;
 } ObjectData;
 
 layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragTexcoord;
+layout(location = 2) flat out uint fragMaterial;
 
 void main() {
-	gl_Position = ObjectData.model * vec4(positions[gl_VertexIndex], 0.0, 1.0);
-	fragColor = colors[gl_VertexIndex];
+	gl_Position = ObjectData.model * vec4(vertexPosition, 1.0);
+	fragColor = vertexColor;
+	fragTexcoord = vertexTexcoord;
+	fragMaterial = ObjectData.material;
 }
\ No newline at end of file
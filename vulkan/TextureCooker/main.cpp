@@ -0,0 +1,38 @@
+#include "pch.h"
+#include "Vulkan/cooked_texture.h"
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image/stb_image.h"
+#include <thread>
+
+/**
+	Encodes an image and its mip chain into the cooked texture format, offline, so the
+	engine only has to map the file and copy the blocks into an image.
+
+	texture_cooker bc1|bc3|bc7 input output [threads]
+*/
+int main(int argc, char** argv) {
+
+	if (argc < 4) {
+		std::cout << "Usage: " << argv[0] << " bc1|bc3|bc7 input output [threads]\n";
+		return 1;
+	}
+
+	BlockFormat format = BlockFormat::BC7;
+	if (strcmp(argv[1], "bc1") == 0) {
+		format = BlockFormat::BC1;
+	}
+	else if (strcmp(argv[1], "bc3") == 0) {
+		format = BlockFormat::BC3;
+	}
+	else if (strcmp(argv[1], "bc7") != 0) {
+		std::cout << "Unknown block format " << argv[1] << ", expected bc1, bc3 or bc7\n";
+		return 1;
+	}
+
+	int threadCount = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+	if (argc > 4) {
+		threadCount = std::max(1, atoi(argv[4]));
+	}
+
+	return vkUtil::cook_texture(argv[2], argv[3], format, threadCount, true) ? 0 : 1;
+}
@@ -0,0 +1,132 @@
+#include "pch.h"
+#include "bindless.h"
+#include "descriptors.h"
+#include "cpu_profiler.h"
+
+vkUtil::BindlessTable::BindlessTable(vk::Device device, vk::PhysicalDevice physicalDevice, MemoryAllocator& allocator,
+	DescriptorLayoutCache& layouts, bool debug)
+	: device(device), allocator(allocator), debugMode(debug) {
+
+	PROFILE_FUNCTION();
+
+	//update after bind descriptors have limits of their own, often far above the regular ones
+	auto properties = physicalDevice.getProperties2<vk::PhysicalDeviceProperties2, vk::PhysicalDeviceVulkan12Properties>();
+	const vk::PhysicalDeviceVulkan12Properties& limits = properties.get<vk::PhysicalDeviceVulkan12Properties>();
+	textureCapacity = std::min({
+		maxTextures,
+		limits.maxPerStageDescriptorUpdateAfterBindSampledImages,
+		limits.maxDescriptorSetUpdateAfterBindSampledImages
+	});
+
+	vk::SamplerCreateInfo samplerInfo;
+	samplerInfo.magFilter = vk::Filter::eLinear;
+	samplerInfo.minFilter = vk::Filter::eLinear;
+	samplerInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
+	samplerInfo.addressModeU = vk::SamplerAddressMode::eRepeat;
+	samplerInfo.addressModeV = vk::SamplerAddressMode::eRepeat;
+	samplerInfo.addressModeW = vk::SamplerAddressMode::eRepeat;
+	samplerInfo.minLod = 0.0f;
+	samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+	sampler = device.createSampler(samplerInfo);
+
+	//only the texture array changes once the set is in use
+	vkInit::descriptorSetLayoutData bindings;
+	bindings.count = 3;
+	bindings.indices = { 0, 1, 2 };
+	bindings.types = { vk::DescriptorType::eSampler, vk::DescriptorType::eSampledImage, vk::DescriptorType::eStorageBuffer };
+	bindings.counts = { 1, static_cast<int>(textureCapacity), 1 };
+	bindings.stages = { vk::ShaderStageFlagBits::eFragment, vk::ShaderStageFlagBits::eFragment, vk::ShaderStageFlagBits::eFragment };
+	bindings.bindingFlags = {
+		vk::DescriptorBindingFlags(),
+		vk::DescriptorBindingFlagBits::ePartiallyBound | vk::DescriptorBindingFlagBits::eUpdateAfterBind
+			| vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending,
+		vk::DescriptorBindingFlags()
+	};
+	bindings.flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool;
+
+	descriptorSetLayout = layouts.get(bindings);
+	descriptorPool = vkInit::make_descriptor_pool(device, 1, bindings, debugMode);
+	descriptorSet = vkInit::allocate_descriptor_set(device, descriptorPool, descriptorSetLayout, debugMode);
+
+	//small and written a material at a time by the host, so it's read straight from host memory
+	BufferInputChunk input;
+	input.size = maxMaterials * sizeof(Material);
+	input.usage = vk::BufferUsageFlagBits::eStorageBuffer;
+	input.memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+	materialBuffer = allocator.create_buffer(input);
+	materials = static_cast<Material*>(materialBuffer.allocation.mapped);
+
+	vk::DescriptorImageInfo samplerDescriptor;
+	samplerDescriptor.sampler = sampler;
+	vk::DescriptorBufferInfo materialDescriptor(materialBuffer.buffer, 0, VK_WHOLE_SIZE);
+
+	std::array<vk::WriteDescriptorSet, 2> writes;
+	writes[0].dstSet = descriptorSet;
+	writes[0].dstBinding = 0;
+	writes[0].descriptorCount = 1;
+	writes[0].descriptorType = vk::DescriptorType::eSampler;
+	writes[0].pImageInfo = &samplerDescriptor;
+	writes[1].dstSet = descriptorSet;
+	writes[1].dstBinding = 2;
+	writes[1].descriptorCount = 1;
+	writes[1].descriptorType = vk::DescriptorType::eStorageBuffer;
+	writes[1].pBufferInfo = &materialDescriptor;
+	device.updateDescriptorSets(writes, nullptr);
+
+	if (debugMode) {
+		std::cout << "Made a bindless table of " << textureCapacity << " textures and "
+			<< maxMaterials << " materials" << std::endl;
+	}
+}
+
+vkUtil::BindlessTable::~BindlessTable() {
+
+	allocator.destroy_buffer(materialBuffer);
+	device.destroyDescriptorPool(descriptorPool);
+	device.destroySampler(sampler);
+}
+
+bool vkUtil::BindlessTable::write_texture(uint32_t index, vk::ImageView view) {
+
+	if (index >= textureCapacity) {
+		if (debugMode) {
+			std::cout << "Texture " << index << " doesn't fit in the bindless table" << std::endl;
+		}
+		return false;
+	}
+
+	vk::DescriptorImageInfo imageDescriptor;
+	imageDescriptor.imageView = view;
+	imageDescriptor.imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+
+	vk::WriteDescriptorSet write;
+	write.dstSet = descriptorSet;
+	write.dstBinding = 1;
+	write.dstArrayElement = index;
+	write.descriptorCount = 1;
+	write.descriptorType = vk::DescriptorType::eSampledImage;
+	write.pImageInfo = &imageDescriptor;
+	device.updateDescriptorSets(write, nullptr);
+
+	return true;
+}
+
+uint32_t vkUtil::BindlessTable::add_material(const Material& material) {
+
+	if (materialCount == maxMaterials) {
+		if (debugMode) {
+			std::cout << "The bindless table is out of materials" << std::endl;
+		}
+		return 0;
+	}
+
+	//the slot is new, so nothing in flight reads it
+	materials[materialCount] = material;
+	return materialCount++;
+}
+
+void vkUtil::BindlessTable::bind(vk::CommandBuffer commandBuffer, vk::PipelineBindPoint bindPoint,
+	vk::PipelineLayout pipelineLayout, uint32_t set) const {
+
+	commandBuffer.bindDescriptorSets(bindPoint, pipelineLayout, set, descriptorSet, nullptr);
+}
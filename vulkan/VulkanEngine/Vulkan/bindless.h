@@ -0,0 +1,88 @@
+#pragma once
+#include "vulkan/vulkan.hpp"
+#include "memory.h"
+#include "render_structs.h"
+#include "descriptor_allocator.h"
+
+namespace vkUtil
+{
+	/**
+		Every texture and material the shaders can reach, in a single descriptor set
+		which is bound once per command buffer. Draws pass a material index instead
+		of binding descriptors, so changing material never splits a batch.
+
+		binding 0	a linear sampler
+		binding 1	a partially bound, update after bind array of sampled images
+		binding 2	a storage buffer of materials
+
+		Texture slots which no pending command buffer uses can be written at any time,
+		materials are appended to a persistently mapped buffer and never move.
+	*/
+	class BindlessTable
+	{
+	public:
+		/**
+			\param device the logical device
+			\param physicalDevice the physical device, whose limits cap the number of textures
+			\param allocator the device memory allocator
+			\param layouts the cache which owns the table's layout
+			\param debug whether the system is running in debug mode
+		*/
+		BindlessTable(vk::Device device, vk::PhysicalDevice physicalDevice, MemoryAllocator& allocator,
+			DescriptorLayoutCache& layouts, bool debug);
+		~BindlessTable();
+
+		BindlessTable(const BindlessTable&) = delete;
+		BindlessTable& operator=(const BindlessTable&) = delete;
+
+		static constexpr uint32_t maxTextures = 4096;
+		static constexpr uint32_t maxMaterials = 4096;
+
+		vk::DescriptorSetLayout get_layout() const { return descriptorSetLayout; }
+		uint32_t get_texture_capacity() const { return textureCapacity; }
+		uint32_t get_material_count() const { return materialCount; }
+
+		/**
+			Point a texture slot at an image. Nothing in flight may be sampling the slot.
+
+			\param index the slot, below the texture capacity
+			\param view the image view, in the shader read only layout whenever it's sampled
+			\returns whether the slot exists
+		*/
+		bool write_texture(uint32_t index, vk::ImageView view);
+
+		/**
+			Add a material, which shaders can use from the next command buffer recorded.
+
+			\param material the material, whose texture must already be written
+			\returns the material's index, or 0 if the table is full
+		*/
+		uint32_t add_material(const Material& material);
+
+		/**
+			Bind the table, the pipeline layout must have it at the given set.
+
+			\param commandBuffer the command buffer being recorded
+			\param bindPoint the pipelines which use it
+			\param pipelineLayout the layout of those pipelines
+			\param set the table's set number in the layout
+		*/
+		void bind(vk::CommandBuffer commandBuffer, vk::PipelineBindPoint bindPoint,
+			vk::PipelineLayout pipelineLayout, uint32_t set) const;
+
+	private:
+		vk::Device device;
+		MemoryAllocator& allocator;
+		bool debugMode;
+
+		uint32_t textureCapacity;
+		vk::Sampler sampler;
+		vk::DescriptorSetLayout descriptorSetLayout;
+		vk::DescriptorPool descriptorPool;
+		vk::DescriptorSet descriptorSet;
+
+		Buffer materialBuffer;
+		Material* materials{ nullptr };
+		uint32_t materialCount{ 0 };
+	};
+}
@@ -0,0 +1,117 @@
+#include "pch.h"
+#include "buddy_allocator.h"
+
+vkUtil::BuddyAllocator::BuddyAllocator(uint64_t size, uint64_t minBlockSize) {
+
+	assert(size > 0 && (size & (size - 1)) == 0);
+	assert(minBlockSize > 0 && (minBlockSize & (minBlockSize - 1)) == 0);
+
+	this->size = size;
+	this->minBlockSize = std::min(minBlockSize, size);
+
+	orderCount = 1;
+	while ((this->minBlockSize << (orderCount - 1)) < size) {
+		++orderCount;
+	}
+
+	//initially the whole range is one free block of the highest order
+	freeBlocks.resize(orderCount);
+	freeBlocks[orderCount - 1].insert(0);
+}
+
+uint32_t vkUtil::BuddyAllocator::order_for(uint64_t size) const {
+
+	uint32_t order = 0;
+	while ((minBlockSize << order) < size) {
+		++order;
+	}
+	return order;
+}
+
+uint64_t vkUtil::BuddyAllocator::allocate(uint64_t size, uint64_t alignment) {
+
+	//blocks are aligned to their own size, so a large enough block is always aligned
+	uint64_t needed = std::max<uint64_t>(std::max<uint64_t>(size, alignment), 1);
+	if (needed > this->size) {
+		return invalidOffset;
+	}
+	uint32_t order = order_for(needed);
+
+	//find the smallest free block which is big enough
+	uint32_t available = order;
+	while (available < orderCount && freeBlocks[available].empty()) {
+		++available;
+	}
+	if (available == orderCount) {
+		return invalidOffset;
+	}
+
+	uint64_t offset = *freeBlocks[available].begin();
+	freeBlocks[available].erase(freeBlocks[available].begin());
+
+	//split it down, freeing the upper half each time
+	while (available > order) {
+		--available;
+		freeBlocks[available].insert(offset + (minBlockSize << available));
+	}
+
+	allocatedBlocks[offset] = { order, size };
+	reservedBytes += minBlockSize << order;
+	requestedBytes += size;
+
+	return offset;
+}
+
+void vkUtil::BuddyAllocator::free(uint64_t offset) {
+
+	auto allocation = allocatedBlocks.find(offset);
+	if (allocation == allocatedBlocks.end()) {
+		return;
+	}
+
+	uint32_t order = allocation->second.order;
+	reservedBytes -= minBlockSize << order;
+	requestedBytes -= allocation->second.requestedSize;
+	allocatedBlocks.erase(allocation);
+
+	//merge with the buddy for as long as it's also free
+	while (order + 1 < orderCount) {
+		uint64_t buddy = offset ^ (minBlockSize << order);
+		if (freeBlocks[order].erase(buddy) == 0) {
+			break;
+		}
+		offset = std::min(offset, buddy);
+		++order;
+	}
+
+	freeBlocks[order].insert(offset);
+}
+
+std::vector<std::pair<uint64_t, uint64_t>> vkUtil::BuddyAllocator::allocations() const {
+
+	std::vector<std::pair<uint64_t, uint64_t>> result;
+	result.reserve(allocatedBlocks.size());
+	for (const auto& [offset, block] : allocatedBlocks) {
+		result.push_back({ offset, block.requestedSize });
+	}
+	return result;
+}
+
+uint64_t vkUtil::BuddyAllocator::largest_free_block() const {
+
+	for (uint32_t order = orderCount; order > 0; --order) {
+		if (!freeBlocks[order - 1].empty()) {
+			return minBlockSize << (order - 1);
+		}
+	}
+	return 0;
+}
+
+float vkUtil::BuddyAllocator::fragmentation() const {
+
+	uint64_t freeSpace = free_bytes();
+	if (freeSpace == 0) {
+		return 0.0f;
+	}
+	return 1.0f - static_cast<float>(largest_free_block()) / static_cast<float>(freeSpace);
+}
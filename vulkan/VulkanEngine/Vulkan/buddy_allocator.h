@@ -0,0 +1,73 @@
+#pragma once
+
+namespace vkUtil
+{
+	/**
+		Hands out power of two sized, naturally aligned ranges of a larger block.
+		Only does the bookkeeping, it never touches memory itself, so it can manage
+		device memory as easily as host memory.
+	*/
+	class BuddyAllocator
+	{
+	public:
+		static constexpr uint64_t invalidOffset = ~0ull;
+
+		/**
+			\param size the size of the managed range, must be a power of two
+			\param minBlockSize the smallest range which will be handed out, must be a power of two
+		*/
+		BuddyAllocator(uint64_t size, uint64_t minBlockSize);
+
+		/**
+			Reserve a range.
+
+			\param size the number of bytes needed
+			\param alignment the required alignment of the offset, must be a power of two
+			\returns the offset of the range, or invalidOffset if there is no room
+		*/
+		uint64_t allocate(uint64_t size, uint64_t alignment);
+
+		/**
+			Release a range which was returned by allocate.
+		*/
+		void free(uint64_t offset);
+
+		//the offset and requested size of every live allocation
+		std::vector<std::pair<uint64_t, uint64_t>> allocations() const;
+
+		uint64_t get_size() const { return size; }
+		//bytes taken up by allocated blocks, including the padding to a power of two
+		uint64_t reserved_bytes() const { return reservedBytes; }
+		//bytes actually asked for
+		uint64_t requested_bytes() const { return requestedBytes; }
+		uint64_t free_bytes() const { return size - reservedBytes; }
+		uint64_t largest_free_block() const;
+		size_t allocation_count() const { return allocatedBlocks.size(); }
+		bool empty() const { return allocatedBlocks.empty(); }
+
+		/**
+			How broken up the free space is, 0 when all of it is one block,
+			approaching 1 as it gets split into many small blocks.
+		*/
+		float fragmentation() const;
+
+	private:
+		struct AllocatedBlock {
+			uint32_t order;
+			uint64_t requestedSize;
+		};
+
+		uint64_t size;
+		uint64_t minBlockSize;
+		uint32_t orderCount;
+
+		//free block offsets for each order, block size = minBlockSize << order
+		std::vector<std::set<uint64_t>> freeBlocks;
+		std::unordered_map<uint64_t, AllocatedBlock> allocatedBlocks;
+
+		uint64_t reservedBytes = 0;
+		uint64_t requestedBytes = 0;
+
+		uint32_t order_for(uint64_t size) const;
+	};
+}
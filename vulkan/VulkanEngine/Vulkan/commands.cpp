@@ -1,9 +1,12 @@
 #include "pch.h"
 #include "commands.h"
+#include "cpu_profiler.h"
 
 vk::CommandPool vkInit::make_command_pool(
 	vk::Device device, vk::PhysicalDevice physicalDevice, vk::SurfaceKHR surface, bool debug) {
 
+	PROFILE_FUNCTION();
+
 	vkUtil::QueueFamilyIndices queueFamilyIndices = vkUtil::findQueueFamilies(physicalDevice, surface, debug);
 
 	vk::CommandPoolCreateInfo poolInfo;
@@ -24,7 +27,7 @@ vk::CommandPool vkInit::make_command_pool(
 }
 
 /**
-	Make a command buffer for each swapchain frame and return a main command buffer.
+	Make a main command buffer.
 
 	\param inputChunk the required input info
 	\param debug whether the system is running in debug mode
@@ -32,6 +35,8 @@ vk::CommandPool vkInit::make_command_pool(
 */
 vk::CommandBuffer vkInit::make_command_buffer(commandBufferInputChunk inputChunk, bool debug) {
 
+	PROFILE_FUNCTION();
+
 	vk::CommandBufferAllocateInfo allocInfo = {};
 	allocInfo.commandPool = inputChunk.commandPool;
 	allocInfo.level = vk::CommandBufferLevel::ePrimary;
@@ -59,21 +64,29 @@ vk::CommandBuffer vkInit::make_command_buffer(commandBufferInputChunk inputChunk
 }
 
 /**
-* Make a command buffer for each frame
+* Make a command pool and buffer for each frame
 *
 * @param	inputChunk the various fields
 * @param	debug whether to print extra information
 */
-void vkInit::make_frame_command_buffers(commandBufferInputChunk inputChunk, bool debug) {
+void vkInit::make_frame_command_buffers(frameCommandInputChunk inputChunk, bool debug) {
+
+	PROFILE_FUNCTION();
+
+	//the pool is reset as a whole every frame, so buffers don't need individual resets
+	vk::CommandPoolCreateInfo poolInfo;
+	poolInfo.flags = vk::CommandPoolCreateFlags() | vk::CommandPoolCreateFlagBits::eTransient;
+	poolInfo.queueFamilyIndex = inputChunk.queueFamilyIndex;
 
 	vk::CommandBufferAllocateInfo allocInfo = {};
-	allocInfo.commandPool = inputChunk.commandPool;
 	allocInfo.level = vk::CommandBufferLevel::ePrimary;
 	allocInfo.commandBufferCount = 1;
 
 	//Make a command buffer for each frame
 	for (int i = 0; i < inputChunk.frames.size(); ++i) {
 		try {
+			inputChunk.frames[i].commandPool = inputChunk.device.createCommandPool(poolInfo);
+			allocInfo.commandPool = inputChunk.frames[i].commandPool;
 			inputChunk.frames[i].commandBuffer = inputChunk.device.allocateCommandBuffers(allocInfo)[0];
 
 			if (debug) {
@@ -89,5 +102,96 @@ void vkInit::make_frame_command_buffers(commandBufferInputChunk inputChunk, bool
 	}
 }
 
+void vkInit::make_frame_compute_commands(frameCommandInputChunk inputChunk, bool debug) {
+
+	PROFILE_FUNCTION();
+
+	vk::CommandPoolCreateInfo poolInfo;
+	poolInfo.flags = vk::CommandPoolCreateFlags() | vk::CommandPoolCreateFlagBits::eTransient;
+	poolInfo.queueFamilyIndex = inputChunk.queueFamilyIndex;
+
+	vk::CommandBufferAllocateInfo allocInfo = {};
+	allocInfo.level = vk::CommandBufferLevel::ePrimary;
+	allocInfo.commandBufferCount = 1;
+
+	for (int i = 0; i < inputChunk.frames.size(); ++i) {
+		try {
+			inputChunk.frames[i].computeCommandPool = inputChunk.device.createCommandPool(poolInfo);
+			allocInfo.commandPool = inputChunk.frames[i].computeCommandPool;
+			inputChunk.frames[i].computeCommandBuffer = inputChunk.device.allocateCommandBuffers(allocInfo)[0];
+
+			if (debug) {
+				std::cout << "Allocated compute command buffer for frame " << i << std::endl;
+			}
+		}
+		catch (vk::SystemError err) {
+
+			if (debug) {
+				std::cout << "Failed to allocate compute command buffer for frame " << i << std::endl;
+			}
+		}
+	}
+}
+
+void vkInit::make_frame_worker_commands(workerCommandInputChunk inputChunk, bool debug) {
 
-	
\ No newline at end of file
+	PROFILE_FUNCTION();
+
+	//pools are reset as a whole every frame, so buffers don't need individual resets
+	vk::CommandPoolCreateInfo poolInfo;
+	poolInfo.flags = vk::CommandPoolCreateFlags() | vk::CommandPoolCreateFlagBits::eTransient;
+	poolInfo.queueFamilyIndex = inputChunk.queueFamilyIndex;
+
+	vk::CommandBufferAllocateInfo allocInfo = {};
+	allocInfo.level = vk::CommandBufferLevel::eSecondary;
+	allocInfo.commandBufferCount = 1;
+
+	for (int i = 0; i < inputChunk.frames.size(); ++i) {
+
+		vkUtil::FrameContext& frame = inputChunk.frames[i];
+
+		for (int worker = 0; worker < inputChunk.workerCount; ++worker) {
+			try {
+				vk::CommandPool commandPool = inputChunk.device.createCommandPool(poolInfo);
+				allocInfo.commandPool = commandPool;
+				frame.workerCommandPools.push_back(commandPool);
+				frame.workerCommandBuffers.push_back(inputChunk.device.allocateCommandBuffers(allocInfo)[0]);
+			}
+			catch (vk::SystemError err) {
+
+				if (debug) {
+					std::cout << "Failed to allocate worker " << worker << " command buffer for frame " << i << std::endl;
+				}
+			}
+		}
+
+		if (debug) {
+			std::cout << "Allocated " << frame.workerCommandBuffers.size() << " worker command buffers for frame " << i << std::endl;
+		}
+	}
+}
+
+void vkInit::destroy_frame_command_buffers(vk::Device device, std::vector<vkUtil::FrameContext>& frames) {
+
+	for (vkUtil::FrameContext& frame : frames) {
+		device.destroyCommandPool(frame.commandPool);
+		frame.commandPool = nullptr;
+		frame.commandBuffer = nullptr;
+		device.destroyCommandPool(frame.computeCommandPool);
+		frame.computeCommandPool = nullptr;
+		frame.computeCommandBuffer = nullptr;
+	}
+}
+
+void vkInit::destroy_frame_worker_commands(vk::Device device, std::vector<vkUtil::FrameContext>& frames) {
+
+	for (vkUtil::FrameContext& frame : frames) {
+
+		//destroying a pool frees its command buffers
+		for (vk::CommandPool commandPool : frame.workerCommandPools) {
+			device.destroyCommandPool(commandPool);
+		}
+		frame.workerCommandPools.clear();
+		frame.workerCommandBuffers.clear();
+	}
+}
@@ -7,10 +7,49 @@ namespace vkInit
 	struct commandBufferInputChunk {
 		vk::Device device;
 		vk::CommandPool commandPool;
-		std::vector<vkUtil::SwapChainFrame>& frames;
+	};
+
+	struct frameCommandInputChunk {
+		vk::Device device;
+		uint32_t queueFamilyIndex;
+		std::vector<vkUtil::FrameContext>& frames;
+	};
+
+	struct workerCommandInputChunk {
+		vk::Device device;
+		uint32_t queueFamilyIndex;
+		int workerCount;
+		std::vector<vkUtil::FrameContext>& frames;
 	};
 	
 	vk::CommandPool make_command_pool(vk::Device device, vk::PhysicalDevice physicaldevice, vk::SurfaceKHR surface, bool debug);
 	vk::CommandBuffer make_command_buffer(vkInit::commandBufferInputChunk inputChunk, bool debug);
-	void make_frame_command_buffers(commandBufferInputChunk inputChunk, bool debug);
+
+	/**
+		Give each frame in flight its own command pool and primary command buffer.
+
+		\param inputChunk the various fields
+		\param debug whether to print extra information
+	*/
+	void make_frame_command_buffers(frameCommandInputChunk inputChunk, bool debug);
+
+	/**
+		Give each frame in flight a command pool and primary command buffer for async compute.
+
+		\param inputChunk the various fields, queueFamilyIndex being the compute family
+		\param debug whether to print extra information
+	*/
+	void make_frame_compute_commands(frameCommandInputChunk inputChunk, bool debug);
+
+	void destroy_frame_command_buffers(vk::Device device, std::vector<vkUtil::FrameContext>& frames);
+
+	/**
+		Give each frame one command pool and secondary command buffer per recording worker.
+
+		\param inputChunk the various fields
+		\param debug whether to print extra information
+	*/
+	void make_frame_worker_commands(workerCommandInputChunk inputChunk, bool debug);
+
+	void destroy_frame_worker_commands(vk::Device device, std::vector<vkUtil::FrameContext>& frames);
 }
\ No newline at end of file
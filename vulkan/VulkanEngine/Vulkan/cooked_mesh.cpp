@@ -0,0 +1,259 @@
+#include "pch.h"
+#include "cooked_mesh.h"
+#include "cpu_profiler.h"
+
+namespace {
+
+	uint64_t align_up(uint64_t value) {
+		return (value + vkUtil::cookedMeshAlignment - 1) & ~(vkUtil::cookedMeshAlignment - 1);
+	}
+
+	/**
+		Write a blob at the next aligned offset, recording where it went.
+	*/
+	void write_blob(std::ofstream& file, uint64_t& offset, const void* data, uint64_t size, vkUtil::CookedBlob& blob) {
+
+		uint64_t start = align_up(offset);
+		const char padding[vkUtil::cookedMeshAlignment] = {};
+		file.write(padding, static_cast<std::streamsize>(start - offset));
+		file.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+
+		blob.offset = start;
+		blob.size = size;
+		offset = start + size;
+	}
+}
+
+vkUtil::MeshData vkUtil::simplify_mesh(const MeshData& mesh, int gridSize) {
+
+	if (mesh.vertices.empty()) {
+		return mesh;
+	}
+
+	glm::vec3 lowest = mesh.vertices[0].position;
+	glm::vec3 highest = lowest;
+	for (const Vertex& vertex : mesh.vertices) {
+		lowest = glm::min(lowest, vertex.position);
+		highest = glm::max(highest, vertex.position);
+	}
+	glm::vec3 cellScale = static_cast<float>(gridSize) / glm::max(highest - lowest, glm::vec3(1e-6f));
+
+	//each occupied cell becomes one vertex, the average of those in it
+	std::unordered_map<uint64_t, uint32_t> cells;
+	std::vector<Vertex> sums;
+	std::vector<uint32_t> counts;
+	std::vector<uint32_t> remap(mesh.vertices.size());
+	for (size_t i = 0; i < mesh.vertices.size(); ++i) {
+
+		const Vertex& vertex = mesh.vertices[i];
+		glm::ivec3 cell = glm::clamp(glm::ivec3((vertex.position - lowest) * cellScale), glm::ivec3(0), glm::ivec3(gridSize - 1));
+		uint64_t key = (static_cast<uint64_t>(cell.x) * gridSize + cell.y) * gridSize + cell.z;
+
+		auto [entry, inserted] = cells.try_emplace(key, static_cast<uint32_t>(sums.size()));
+		if (inserted) {
+			sums.push_back({ glm::vec3(0.0f), glm::vec3(0.0f), glm::vec2(0.0f), glm::vec3(0.0f) });
+			counts.push_back(0);
+		}
+		Vertex& sum = sums[entry->second];
+		sum.position += vertex.position;
+		sum.normal += vertex.normal;
+		sum.texcoord += vertex.texcoord;
+		sum.color += vertex.color;
+		++counts[entry->second];
+		remap[i] = entry->second;
+	}
+
+	//triangles with two corners in one cell have collapsed, the survivors pick which cells are kept
+	MeshData simplified;
+	std::vector<uint32_t> kept(sums.size(), UINT32_MAX);
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+
+		uint32_t corners[3] = { remap[mesh.indices[i]], remap[mesh.indices[i + 1]], remap[mesh.indices[i + 2]] };
+		if (corners[0] == corners[1] || corners[1] == corners[2] || corners[0] == corners[2]) {
+			continue;
+		}
+
+		for (uint32_t corner : corners) {
+			if (kept[corner] == UINT32_MAX) {
+				kept[corner] = static_cast<uint32_t>(simplified.vertices.size());
+				float weight = 1.0f / counts[corner];
+				Vertex vertex = sums[corner];
+				vertex.position *= weight;
+				vertex.texcoord *= weight;
+				vertex.color *= weight;
+				float normalLength = glm::length(vertex.normal);
+				vertex.normal = normalLength > 0.0f ? vertex.normal / normalLength : glm::vec3(0.0f);
+				simplified.vertices.push_back(vertex);
+			}
+			simplified.indices.push_back(kept[corner]);
+		}
+	}
+
+	return simplified;
+}
+
+bool vkUtil::cook_meshes(const std::vector<MeshData>& meshes, const std::string& filename, bool debug) {
+
+	PROFILE_FUNCTION();
+
+	//coarser grids for each further level, a level is only kept if it's a real saving
+	const int gridSizes[] = { 64, 32, 16, 8 };
+
+	std::vector<Vertex> vertices;
+	std::vector<uint32_t> indices;
+	std::vector<CookedMesh> cookedMeshes;
+	std::vector<MeshRange> lods;
+	std::vector<Meshlet> meshlets;
+
+	for (const MeshData& mesh : meshes) {
+
+		CookedMesh cookedMesh;
+		cookedMesh.firstLod = static_cast<uint32_t>(lods.size());
+		cookedMesh.lodCount = 0;
+		float radius = bounding_radius(mesh.vertices);
+
+		MeshData lod = mesh;
+		size_t nextGrid = 0;
+		while (true) {
+
+			std::vector<Meshlet> lodMeshlets = build_meshlets(lod);
+
+			MeshRange range;
+			range.firstIndex = static_cast<uint32_t>(indices.size());
+			range.indexCount = static_cast<uint32_t>(lod.indices.size());
+			range.vertexOffset = static_cast<int32_t>(vertices.size());
+			range.vertexCount = static_cast<uint32_t>(lod.vertices.size());
+			range.boundingRadius = radius;
+			range.firstMeshlet = static_cast<uint32_t>(meshlets.size());
+			range.meshletCount = static_cast<uint32_t>(lodMeshlets.size());
+			lods.push_back(range);
+			++cookedMesh.lodCount;
+
+			vertices.insert(vertices.end(), lod.vertices.begin(), lod.vertices.end());
+			indices.insert(indices.end(), lod.indices.begin(), lod.indices.end());
+			meshlets.insert(meshlets.end(), lodMeshlets.begin(), lodMeshlets.end());
+
+			//always simplified from the full mesh, so errors don't compound
+			bool found = false;
+			for (; nextGrid < std::size(gridSizes) && !found; ++nextGrid) {
+				MeshData simplified = simplify_mesh(mesh, gridSizes[nextGrid]);
+				if (!simplified.indices.empty() && 4 * simplified.indices.size() <= 3 * lod.indices.size()) {
+					lod = std::move(simplified);
+					found = true;
+				}
+			}
+			if (!found) {
+				break;
+			}
+		}
+
+		cookedMeshes.push_back(cookedMesh);
+	}
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) {
+		if (debug) {
+			std::cout << "Failed to open " << filename << " for writing" << std::endl;
+		}
+		return false;
+	}
+
+	CookedMeshHeader header = {};
+	header.magic = cookedMeshMagic;
+	header.version = cookedMeshVersion;
+	header.vertexStride = sizeof(Vertex);
+	header.meshCount = static_cast<uint32_t>(cookedMeshes.size());
+
+	//the header is rewritten once the blobs' offsets are known
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	uint64_t offset = sizeof(header);
+	write_blob(file, offset, vertices.data(), vertices.size() * sizeof(Vertex), header.vertices);
+	write_blob(file, offset, indices.data(), indices.size() * sizeof(uint32_t), header.indices);
+	write_blob(file, offset, cookedMeshes.data(), cookedMeshes.size() * sizeof(CookedMesh), header.meshes);
+	write_blob(file, offset, lods.data(), lods.size() * sizeof(MeshRange), header.lods);
+	write_blob(file, offset, meshlets.data(), meshlets.size() * sizeof(Meshlet), header.meshlets);
+	file.seekp(0);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+	if (!file) {
+		if (debug) {
+			std::cout << "Failed to write " << filename << std::endl;
+		}
+		return false;
+	}
+
+	if (debug) {
+		std::cout << "Cooked " << cookedMeshes.size() << " meshes into " << filename << ": " << lods.size() << " lods, "
+			<< meshlets.size() << " meshlets, " << vertices.size() << " vertices, " << indices.size() << " indices" << std::endl;
+	}
+	return true;
+}
+
+bool vkUtil::CookedMeshFile::is_cooked(const std::string& filename) {
+
+	std::ifstream file(filename, std::ios::binary);
+	uint32_t magic = 0;
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	return file && magic == cookedMeshMagic;
+}
+
+bool vkUtil::CookedMeshFile::open(const std::string& filename, bool debug) {
+
+	PROFILE_FUNCTION();
+
+	if (!file.open(filename)) {
+		if (debug) {
+			std::cout << "Failed to map " << filename << std::endl;
+		}
+		return false;
+	}
+
+	//only the header and tables are checked, the vertices and indices are never read on the cpu
+	auto fail = [this, &filename, debug](const char* reason) {
+		if (debug) {
+			std::cout << filename << " is not a usable cooked mesh: " << reason << std::endl;
+		}
+		file.close();
+		return false;
+	};
+
+	if (file.size() < sizeof(CookedMeshHeader)) {
+		return fail("too small");
+	}
+	const CookedMeshHeader& header = get_header();
+	if (header.magic != cookedMeshMagic) {
+		return fail("bad magic number");
+	}
+	if (header.version != cookedMeshVersion || header.vertexStride != sizeof(Vertex)) {
+		return fail("cooked by another version, recook it");
+	}
+
+	for (const CookedBlob* blob : { &header.vertices, &header.indices, &header.meshes, &header.lods, &header.meshlets }) {
+		if (blob->offset % cookedMeshAlignment != 0 || blob->offset > file.size() || blob->size > file.size() - blob->offset) {
+			return fail("blob out of bounds");
+		}
+	}
+	if (header.meshes.size != header.meshCount * sizeof(CookedMesh) || header.lods.size % sizeof(MeshRange) != 0
+		|| header.meshlets.size % sizeof(Meshlet) != 0) {
+		return fail("bad table size");
+	}
+
+	uint64_t vertexCount = header.vertices.size / sizeof(Vertex);
+	uint64_t indexCount = header.indices.size / sizeof(uint32_t);
+	for (uint32_t i = 0; i < header.meshCount; ++i) {
+		const CookedMesh& mesh = get_meshes()[i];
+		if (mesh.lodCount == 0 || static_cast<uint64_t>(mesh.firstLod) + mesh.lodCount > get_lod_count()) {
+			return fail("mesh out of bounds");
+		}
+	}
+	for (uint32_t i = 0; i < get_lod_count(); ++i) {
+		const MeshRange& lod = get_lods()[i];
+		if (static_cast<uint64_t>(lod.firstIndex) + lod.indexCount > indexCount
+			|| lod.vertexOffset < 0 || static_cast<uint64_t>(lod.vertexOffset) + lod.vertexCount > vertexCount
+			|| static_cast<uint64_t>(lod.firstMeshlet) + lod.meshletCount > get_meshlet_count()) {
+			return fail("lod out of bounds");
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include "mesh.h"
+#include "mapped_file.h"
+
+namespace vkUtil
+{
+	/**
+		The cooked mesh format. Every blob is aligned so it can be staged straight
+		from the mapped file, and is laid out exactly as the gpu or the mesh library uses it.
+
+		header
+		vertices	Vertex[], each lod's vertices after the previous lod's
+		indices		uint32_t[], each lod's indices start from zero
+		meshes		CookedMesh[]
+		lods		MeshRange[], indexing the vertex, index and meshlet blobs
+		meshlets	Meshlet[]
+	*/
+	constexpr uint32_t cookedMeshMagic = 0x48534d56; //"VMSH"
+	//bump whenever the layout, Vertex or Meshlet changes
+	constexpr uint32_t cookedMeshVersion = 1;
+	constexpr uint64_t cookedMeshAlignment = 256;
+
+	struct CookedBlob {
+		uint64_t offset;
+		uint64_t size;
+	};
+
+	struct CookedMeshHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint32_t vertexStride;
+		uint32_t meshCount;
+		CookedBlob vertices;
+		CookedBlob indices;
+		CookedBlob meshes;
+		CookedBlob lods;
+		CookedBlob meshlets;
+	};
+
+	struct CookedMesh {
+		uint32_t firstLod;
+		uint32_t lodCount;
+	};
+
+	/**
+		Cook meshes, generating levels of detail and meshlets for each.
+
+		\param meshes the full detail meshes
+		\param filename the path to write to
+		\param debug whether to print extra information
+		\returns whether the file was written
+	*/
+	bool cook_meshes(const std::vector<MeshData>& meshes, const std::string& filename, bool debug);
+
+	/**
+		Simplify a mesh by merging every vertex within a cell of a grid over its bounds,
+		dropping the triangles which collapse.
+
+		\param mesh the mesh to simplify
+		\param gridSize the number of cells along each side of the grid
+		\returns the simplified mesh
+	*/
+	MeshData simplify_mesh(const MeshData& mesh, int gridSize);
+
+	/**
+		A cooked mesh file, mapped into memory. Opening only checks the header,
+		the blobs are used in place.
+	*/
+	class CookedMeshFile
+	{
+	public:
+		/**
+			\param filename the path to the cooked file
+			\param debug whether to print extra information
+			\returns whether the file was mapped and its header is valid
+		*/
+		bool open(const std::string& filename, bool debug);
+
+		/**
+			\returns whether the file starts with the cooked mesh magic number, whatever its version
+		*/
+		static bool is_cooked(const std::string& filename);
+
+		const CookedMeshHeader& get_header() const { return *reinterpret_cast<const CookedMeshHeader*>(file.data()); }
+		const uint8_t* get_blob(const CookedBlob& blob) const { return file.data() + blob.offset; }
+
+		const CookedMesh* get_meshes() const { return reinterpret_cast<const CookedMesh*>(get_blob(get_header().meshes)); }
+		const MeshRange* get_lods() const { return reinterpret_cast<const MeshRange*>(get_blob(get_header().lods)); }
+		const Meshlet* get_meshlets() const { return reinterpret_cast<const Meshlet*>(get_blob(get_header().meshlets)); }
+		uint32_t get_lod_count() const { return static_cast<uint32_t>(get_header().lods.size / sizeof(MeshRange)); }
+		uint32_t get_meshlet_count() const { return static_cast<uint32_t>(get_header().meshlets.size / sizeof(Meshlet)); }
+
+	private:
+		MappedFile file;
+	};
+}
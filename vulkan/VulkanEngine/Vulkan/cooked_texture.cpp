@@ -0,0 +1,259 @@
+#include "pch.h"
+#include "cooked_texture.h"
+#include "thread_pool.h"
+#include "cpu_profiler.h"
+#include "stb_image/stb_image.h"
+
+namespace {
+
+	uint64_t align_up(uint64_t value) {
+		return (value + vkUtil::cookedTextureAlignment - 1) & ~(vkUtil::cookedTextureAlignment - 1);
+	}
+
+	//0 for formats the cooker doesn't write
+	uint64_t get_block_bytes(vk::Format format) {
+		switch (format) {
+		case vk::Format::eBc1RgbSrgbBlock:
+			return 8;
+		case vk::Format::eBc3SrgbBlock:
+		case vk::Format::eBc7SrgbBlock:
+			return 16;
+		default:
+			return 0;
+		}
+	}
+
+	uint64_t get_level_bytes(vk::Format format, uint32_t width, uint32_t height, uint32_t level) {
+		uint64_t blocksX = (std::max(width >> level, 1u) + 3) / 4;
+		uint64_t blocksY = (std::max(height >> level, 1u) + 3) / 4;
+		return blocksX * blocksY * get_block_bytes(format);
+	}
+
+	float srgb_to_linear(uint8_t value) {
+		float color = value / 255.0f;
+		return color <= 0.04045f ? color / 12.92f : std::pow((color + 0.055f) / 1.055f, 2.4f);
+	}
+
+	uint8_t linear_to_srgb(float color) {
+		color = color <= 0.0031308f ? color * 12.92f : 1.055f * std::pow(color, 1.0f / 2.4f) - 0.055f;
+		return static_cast<uint8_t>(std::clamp(color * 255.0f + 0.5f, 0.0f, 255.0f));
+	}
+
+	/**
+		Halve an sRGB image with a box filter, averaging colour in linear space.
+		Odd rows and columns repeat the last, as the gpu's mip generation does.
+	*/
+	std::vector<uint8_t> downsample(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height) {
+
+		static const std::array<float, 256> toLinear = []() {
+			std::array<float, 256> table;
+			for (int i = 0; i < 256; ++i) {
+				table[i] = srgb_to_linear(static_cast<uint8_t>(i));
+			}
+			return table;
+		}();
+
+		uint32_t nextWidth = std::max(width / 2, 1u);
+		uint32_t nextHeight = std::max(height / 2, 1u);
+		std::vector<uint8_t> next(static_cast<size_t>(nextWidth) * nextHeight * 4);
+		for (uint32_t y = 0; y < nextHeight; ++y) {
+			for (uint32_t x = 0; x < nextWidth; ++x) {
+
+				const uint8_t* corners[4];
+				for (uint32_t i = 0; i < 4; ++i) {
+					uint32_t sourceX = std::min(2 * x + i % 2, width - 1);
+					uint32_t sourceY = std::min(2 * y + i / 2, height - 1);
+					corners[i] = pixels.data() + 4 * (static_cast<size_t>(sourceY) * width + sourceX);
+				}
+
+				uint8_t* texel = next.data() + 4 * (static_cast<size_t>(y) * nextWidth + x);
+				for (int c = 0; c < 3; ++c) {
+					float sum = toLinear[corners[0][c]] + toLinear[corners[1][c]] + toLinear[corners[2][c]] + toLinear[corners[3][c]];
+					texel[c] = linear_to_srgb(0.25f * sum);
+				}
+				texel[3] = static_cast<uint8_t>((corners[0][3] + corners[1][3] + corners[2][3] + corners[3][3] + 2) / 4);
+			}
+		}
+		return next;
+	}
+}
+
+uint32_t vkUtil::mip_level_count(vk::Extent2D extent) {
+
+	uint32_t levels = 1;
+	for (uint32_t size = std::max(extent.width, extent.height); size > 1; size /= 2) {
+		++levels;
+	}
+	return levels;
+}
+
+vk::Format vkUtil::get_block_format(BlockFormat format) {
+
+	switch (format) {
+	case BlockFormat::BC1:
+		return vk::Format::eBc1RgbSrgbBlock;
+	case BlockFormat::BC3:
+		return vk::Format::eBc3SrgbBlock;
+	default:
+		return vk::Format::eBc7SrgbBlock;
+	}
+}
+
+bool vkUtil::cook_texture(const std::string& input, const std::string& output, BlockFormat format, int threadCount,
+	bool debug, TextureCookStats* stats) {
+
+	PROFILE_FUNCTION();
+
+	int width, height, channels;
+	stbi_uc* decoded = stbi_load(input.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+	if (!decoded) {
+		if (debug) {
+			std::cout << "Failed to decode " << input << std::endl;
+		}
+		return false;
+	}
+	std::vector<uint8_t> pixels(decoded, decoded + static_cast<size_t>(width) * height * 4);
+	stbi_image_free(decoded);
+
+	TextureCookStats cookStats;
+	cookStats.width = static_cast<uint32_t>(width);
+	cookStats.height = static_cast<uint32_t>(height);
+	cookStats.levelCount = std::min(mip_level_count(vk::Extent2D(cookStats.width, cookStats.height)), maxCookedTextureLevels);
+	cookStats.threadCount = std::max(threadCount, 1);
+	std::unique_ptr<ThreadPool> pool;
+	if (threadCount > 1) {
+		pool = std::make_unique<ThreadPool>(threadCount);
+	}
+
+	//every level is filtered from the full quality one above it, never from blocks
+	std::vector<std::vector<uint8_t>> levels;
+	uint32_t levelWidth = cookStats.width;
+	uint32_t levelHeight = cookStats.height;
+	for (uint32_t level = 0; level < cookStats.levelCount; ++level) {
+
+		auto start = std::chrono::high_resolution_clock::now();
+		levels.push_back(encode_image(format, pixels.data(), levelWidth, levelHeight, pool.get()));
+		auto end = std::chrono::high_resolution_clock::now();
+		cookStats.encodeSeconds += std::chrono::duration<double>(end - start).count();
+		cookStats.sourceBytes += pixels.size();
+		cookStats.cookedBytes += levels.back().size();
+
+		if (level == 0) {
+			std::vector<uint8_t> roundTrip = decode_image(format, levels.back().data(), levelWidth, levelHeight);
+			cookStats.psnr = compute_psnr(pixels.data(), roundTrip.data(), pixels.size() / 4, format != BlockFormat::BC1);
+		}
+		if (level + 1 < cookStats.levelCount) {
+			pixels = downsample(pixels, levelWidth, levelHeight);
+			levelWidth = std::max(levelWidth / 2, 1u);
+			levelHeight = std::max(levelHeight / 2, 1u);
+		}
+	}
+
+	std::ofstream file(output, std::ios::binary);
+	if (!file) {
+		if (debug) {
+			std::cout << "Failed to open " << output << " for writing" << std::endl;
+		}
+		return false;
+	}
+
+	CookedTextureHeader header = {};
+	header.magic = cookedTextureMagic;
+	header.version = cookedTextureVersion;
+	header.format = static_cast<uint32_t>(get_block_format(format));
+	header.width = cookStats.width;
+	header.height = cookStats.height;
+	header.levelCount = cookStats.levelCount;
+
+	uint64_t offset = align_up(sizeof(header));
+	for (uint32_t level = 0; level < header.levelCount; ++level) {
+		header.levels[level].offset = offset;
+		header.levels[level].size = levels[level].size();
+		offset = align_up(offset + levels[level].size());
+	}
+
+	const char padding[cookedTextureAlignment] = {};
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	uint64_t written = sizeof(header);
+	for (uint32_t level = 0; level < header.levelCount; ++level) {
+		file.write(padding, static_cast<std::streamsize>(header.levels[level].offset - written));
+		file.write(reinterpret_cast<const char*>(levels[level].data()), static_cast<std::streamsize>(levels[level].size()));
+		written = header.levels[level].offset + levels[level].size();
+	}
+
+	if (!file) {
+		if (debug) {
+			std::cout << "Failed to write " << output << std::endl;
+		}
+		return false;
+	}
+
+	if (debug) {
+		std::cout << "Cooked " << input << " into " << output << ": " << header.levelCount << " levels, "
+			<< cookStats.cookedBytes << " bytes from " << cookStats.sourceBytes << ", PSNR " << cookStats.psnr << " dB, "
+			<< cookStats.megapixels_per_second() << " MP/s on " << cookStats.threadCount << " threads" << std::endl;
+	}
+	if (stats) {
+		*stats = cookStats;
+	}
+	return true;
+}
+
+bool vkUtil::CookedTextureFile::is_cooked(const std::string& filename) {
+
+	std::ifstream file(filename, std::ios::binary);
+	uint32_t magic = 0;
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	return file && magic == cookedTextureMagic;
+}
+
+bool vkUtil::CookedTextureFile::open(const std::string& filename, bool debug) {
+
+	if (!file.open(filename)) {
+		if (debug) {
+			std::cout << "Failed to map " << filename << std::endl;
+		}
+		return false;
+	}
+
+	auto fail = [this, &filename, debug](const char* reason) {
+		if (debug) {
+			std::cout << filename << " is not a usable cooked texture: " << reason << std::endl;
+		}
+		file.close();
+		return false;
+	};
+
+	if (file.size() < sizeof(CookedTextureHeader)) {
+		return fail("too small");
+	}
+	const CookedTextureHeader& header = get_header();
+	if (header.magic != cookedTextureMagic) {
+		return fail("bad magic number");
+	}
+	if (header.version != cookedTextureVersion) {
+		return fail("cooked by another version, recook it");
+	}
+	if (get_block_bytes(get_format()) == 0) {
+		return fail("unknown format");
+	}
+	if (header.width == 0 || header.height == 0 || header.levelCount == 0
+		|| header.levelCount > std::min(mip_level_count(vk::Extent2D(header.width, header.height)), maxCookedTextureLevels)) {
+		return fail("bad size");
+	}
+
+	for (uint32_t level = 0; level < header.levelCount; ++level) {
+		const CookedBlob& blob = header.levels[level];
+		if (blob.offset % cookedTextureAlignment != 0 || blob.offset > file.size() || blob.size > file.size() - blob.offset) {
+			return fail("level out of bounds");
+		}
+		if (blob.size != get_level_bytes(get_format(), header.width, header.height, level)) {
+			return fail("bad level size");
+		}
+		if (level > 0 && blob.offset < header.levels[level - 1].offset) {
+			return fail("levels out of order");
+		}
+	}
+
+	return true;
+}
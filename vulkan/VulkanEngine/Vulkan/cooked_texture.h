@@ -0,0 +1,102 @@
+#pragma once
+#include "vulkan/vulkan.hpp"
+#include "cooked_mesh.h"
+#include "bc_encoder.h"
+
+namespace vkUtil
+{
+	/**
+		The cooked texture format, a block compressed mip chain ready to be copied into an image.
+
+		header
+		levels		each mip level's blocks, row by row, largest first
+	*/
+	constexpr uint32_t cookedTextureMagic = 0x58455456; //"VTEX"
+	//bump whenever the layout changes
+	constexpr uint32_t cookedTextureVersion = 1;
+	//a multiple of every block size, which copies from a buffer need
+	constexpr uint64_t cookedTextureAlignment = 16;
+	//enough for a 32768x32768 chain
+	constexpr uint32_t maxCookedTextureLevels = 16;
+
+	struct CookedTextureHeader {
+		uint32_t magic;
+		uint32_t version;
+		//a VkFormat, one of the block compressed sRGB formats
+		uint32_t format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t levelCount;
+		CookedBlob levels[maxCookedTextureLevels];
+	};
+
+	/**
+		How a texture was cooked.
+	*/
+	struct TextureCookStats {
+		uint32_t width{ 0 };
+		uint32_t height{ 0 };
+		uint32_t levelCount{ 0 };
+		int threadCount{ 1 };
+		//every level as RGBA8, and as blocks
+		size_t sourceBytes{ 0 };
+		size_t cookedBytes{ 0 };
+		//time spent encoding blocks, not decoding the source or filtering the levels
+		double encodeSeconds{ 0.0 };
+		//of the top level, over the channels the format keeps
+		double psnr{ 0.0 };
+
+		double megapixels_per_second() const { return encodeSeconds > 0.0 ? sourceBytes / 4.0 / 1000000.0 / encodeSeconds : 0.0; }
+	};
+
+	/**
+		\returns the number of levels in a full mip chain, down to 1x1
+	*/
+	uint32_t mip_level_count(vk::Extent2D extent);
+
+	/**
+		\returns the sRGB Vulkan format holding a block format
+	*/
+	vk::Format get_block_format(BlockFormat format);
+
+	/**
+		Decode an image, build its mip chain and write every level out block compressed.
+
+		\param input the path to the image, in any format stb_image reads
+		\param output the path to write to
+		\param format the block format to encode to
+		\param threadCount how many threads encode, 1 encodes on the calling thread
+		\param debug whether to print extra information
+		\param stats if not null, filled in with how the texture was cooked
+		\returns whether the file was written
+	*/
+	bool cook_texture(const std::string& input, const std::string& output, BlockFormat format, int threadCount,
+		bool debug, TextureCookStats* stats = nullptr);
+
+	/**
+		A cooked texture file, mapped into memory. Opening checks the header,
+		the levels are used in place.
+	*/
+	class CookedTextureFile
+	{
+	public:
+		/**
+			\param filename the path to the cooked file
+			\param debug whether to print extra information
+			\returns whether the file was mapped and its header is valid
+		*/
+		bool open(const std::string& filename, bool debug);
+
+		/**
+			\returns whether the file starts with the cooked texture magic number, whatever its version
+		*/
+		static bool is_cooked(const std::string& filename);
+
+		const CookedTextureHeader& get_header() const { return *reinterpret_cast<const CookedTextureHeader*>(file.data()); }
+		const uint8_t* get_blob(const CookedBlob& blob) const { return file.data() + blob.offset; }
+		vk::Format get_format() const { return static_cast<vk::Format>(get_header().format); }
+
+	private:
+		MappedFile file;
+	};
+}
@@ -0,0 +1,182 @@
+#include "pch.h"
+#include "descriptor_allocator.h"
+#include "cpu_profiler.h"
+
+namespace {
+
+	void hash_combine(size_t& seed, size_t value) {
+		seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+	}
+}
+
+vkUtil::DescriptorLayoutCache::DescriptorLayoutCache(vk::Device device, bool debug)
+	: device(device), debugMode(debug) {
+}
+
+vkUtil::DescriptorLayoutCache::~DescriptorLayoutCache() {
+
+	if (debugMode) {
+		std::cout << "Descriptor layout cache made " << layouts.size() << " layouts for "
+			<< requestCount << " requests" << std::endl;
+	}
+
+	for (auto& [key, layout] : layouts) {
+		device.destroyDescriptorSetLayout(layout);
+	}
+}
+
+vk::DescriptorSetLayout vkUtil::DescriptorLayoutCache::get(const vkInit::descriptorSetLayoutData& bindings) {
+
+	++requestCount;
+
+	LayoutKey key;
+	key.flags = bindings.flags;
+	std::vector<size_t> order;
+	for (int i = 0; i < bindings.count; ++i) {
+		order.push_back(i);
+	}
+	std::sort(order.begin(), order.end(), [&bindings](size_t a, size_t b) {
+		return bindings.indices[a] < bindings.indices[b];
+	});
+	for (size_t i : order) {
+		key.bindings.push_back(vk::DescriptorSetLayoutBinding(
+			bindings.indices[i], bindings.types[i], bindings.counts[i], bindings.stages[i]
+		));
+		if (!bindings.bindingFlags.empty()) {
+			key.bindingFlags.push_back(bindings.bindingFlags[i]);
+		}
+	}
+
+	auto cached = layouts.find(key);
+	if (cached != layouts.end()) {
+		return cached->second;
+	}
+
+	vk::DescriptorSetLayout layout = vkInit::make_descriptor_set_layout(device, bindings, debugMode);
+	if (layout) {
+		layouts.emplace(std::move(key), layout);
+	}
+	return layout;
+}
+
+bool vkUtil::DescriptorLayoutCache::LayoutKey::operator==(const LayoutKey& other) const {
+
+	return flags == other.flags && bindings == other.bindings && bindingFlags == other.bindingFlags;
+}
+
+size_t vkUtil::DescriptorLayoutCache::LayoutKeyHash::operator()(const LayoutKey& key) const {
+
+	size_t seed = std::hash<uint32_t>()(static_cast<VkDescriptorSetLayoutCreateFlags>(key.flags));
+	for (const vk::DescriptorSetLayoutBinding& binding : key.bindings) {
+		hash_combine(seed, binding.binding);
+		hash_combine(seed, static_cast<size_t>(binding.descriptorType));
+		hash_combine(seed, binding.descriptorCount);
+		hash_combine(seed, static_cast<VkShaderStageFlags>(binding.stageFlags));
+	}
+	for (vk::DescriptorBindingFlags flags : key.bindingFlags) {
+		hash_combine(seed, static_cast<VkDescriptorBindingFlags>(flags));
+	}
+	return seed;
+}
+
+vkUtil::DescriptorAllocator::DescriptorAllocator(vk::Device device, const std::vector<PoolSizeRatio>& ratios,
+	uint32_t initialSets, bool debug)
+	: device(device), ratios(ratios), setsPerPool(std::max(initialSets, 1u)), debugMode(debug) {
+
+	usedPools.push_back(make_pool());
+}
+
+vkUtil::DescriptorAllocator::~DescriptorAllocator() {
+
+	for (vk::DescriptorPool pool : usedPools) {
+		device.destroyDescriptorPool(pool);
+	}
+	for (vk::DescriptorPool pool : freePools) {
+		device.destroyDescriptorPool(pool);
+	}
+}
+
+vk::DescriptorPool vkUtil::DescriptorAllocator::make_pool() {
+
+	PROFILE_FUNCTION();
+
+	std::vector<vk::DescriptorPoolSize> poolSizes;
+	for (const PoolSizeRatio& ratio : ratios) {
+		poolSizes.push_back(vk::DescriptorPoolSize(
+			ratio.type, static_cast<uint32_t>(std::ceil(ratio.ratio * setsPerPool))
+		));
+	}
+
+	vk::DescriptorPoolCreateInfo poolInfo;
+	poolInfo.flags = vk::DescriptorPoolCreateFlags();
+	poolInfo.maxSets = setsPerPool;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+
+	//each pool is larger than the last, so a busy frame soon stops adding them
+	setsPerPool = std::min(2 * setsPerPool, maxSetsPerPool);
+
+	try {
+		return device.createDescriptorPool(poolInfo);
+	}
+	catch (vk::SystemError err) {
+		if (debugMode) {
+			std::cout << "Failed to make descriptor pool" << std::endl;
+		}
+		return nullptr;
+	}
+}
+
+vk::DescriptorPool vkUtil::DescriptorAllocator::next_pool() {
+
+	if (!freePools.empty()) {
+		vk::DescriptorPool pool = freePools.back();
+		freePools.pop_back();
+		return pool;
+	}
+	return make_pool();
+}
+
+vk::DescriptorSet vkUtil::DescriptorAllocator::allocate(vk::DescriptorSetLayout layout) {
+
+	vk::DescriptorSetAllocateInfo allocationInfo;
+	allocationInfo.descriptorSetCount = 1;
+	allocationInfo.pSetLayouts = &layout;
+
+	//the current pool first, then a fresh one if it's out of room
+	for (int attempt = 0; attempt < 2; ++attempt) {
+
+		allocationInfo.descriptorPool = usedPools.back();
+		if (allocationInfo.descriptorPool) {
+			vk::DescriptorSet descriptorSet;
+			vk::Result result = device.allocateDescriptorSets(&allocationInfo, &descriptorSet);
+			if (result == vk::Result::eSuccess) {
+				return descriptorSet;
+			}
+			if (result != vk::Result::eErrorOutOfPoolMemory && result != vk::Result::eErrorFragmentedPool) {
+				break;
+			}
+		}
+
+		if (attempt == 0) {
+			usedPools.push_back(next_pool());
+		}
+	}
+
+	if (debugMode) {
+		std::cout << "Failed to allocate descriptor set" << std::endl;
+	}
+	return nullptr;
+}
+
+void vkUtil::DescriptorAllocator::reset() {
+
+	for (vk::DescriptorPool pool : usedPools) {
+		if (pool) {
+			device.resetDescriptorPool(pool);
+			freePools.push_back(pool);
+		}
+	}
+	usedPools.clear();
+	usedPools.push_back(next_pool());
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include "vulkan/vulkan.hpp"
+#include "descriptors.h"
+
+namespace vkUtil
+{
+	/**
+		Makes each distinct descriptor set layout once, however many pipelines and
+		systems ask for it. Layouts are looked up by a hash of their bindings and
+		live as long as the cache.
+	*/
+	class DescriptorLayoutCache
+	{
+	public:
+		/**
+			\param device the logical device
+			\param debug whether the system is running in debug mode
+		*/
+		DescriptorLayoutCache(vk::Device device, bool debug);
+		~DescriptorLayoutCache();
+
+		DescriptorLayoutCache(const DescriptorLayoutCache&) = delete;
+		DescriptorLayoutCache& operator=(const DescriptorLayoutCache&) = delete;
+
+		/**
+			\param bindings the layout's bindings, in any order
+			\returns the layout, made if no identical one has been asked for before
+		*/
+		vk::DescriptorSetLayout get(const vkInit::descriptorSetLayoutData& bindings);
+
+	private:
+		//bindings sorted by index, so the order they were described in doesn't matter
+		struct LayoutKey {
+			std::vector<vk::DescriptorSetLayoutBinding> bindings;
+			std::vector<vk::DescriptorBindingFlags> bindingFlags;
+			vk::DescriptorSetLayoutCreateFlags flags;
+
+			bool operator==(const LayoutKey& other) const;
+		};
+
+		struct LayoutKeyHash {
+			size_t operator()(const LayoutKey& key) const;
+		};
+
+		vk::Device device;
+		bool debugMode;
+
+		std::unordered_map<LayoutKey, vk::DescriptorSetLayout, LayoutKeyHash> layouts;
+		size_t requestCount{ 0 };
+	};
+
+	/**
+		How many descriptors of a type a pool holds per set.
+	*/
+	struct PoolSizeRatio {
+		vk::DescriptorType type;
+		float ratio;
+	};
+
+	/**
+		Hands out short lived descriptor sets, for one frame in flight or one batch of work.
+
+		Sets come from a list of pools, and a new pool, twice the size of the last, is
+		added whenever they run out. Sets are never freed one at a time, reset returns
+		every pool at once and keeps them for reuse.
+	*/
+	class DescriptorAllocator
+	{
+	public:
+		/**
+			\param device the logical device
+			\param ratios the descriptors each pool holds per set
+			\param initialSets the number of sets in the first pool
+			\param debug whether the system is running in debug mode
+		*/
+		DescriptorAllocator(vk::Device device, const std::vector<PoolSizeRatio>& ratios, uint32_t initialSets, bool debug);
+		~DescriptorAllocator();
+
+		DescriptorAllocator(const DescriptorAllocator&) = delete;
+		DescriptorAllocator& operator=(const DescriptorAllocator&) = delete;
+
+		/**
+			\param layout the layout the set must conform to
+			\returns a set which is valid until the next reset, or null if even a new pool couldn't hold it
+		*/
+		vk::DescriptorSet allocate(vk::DescriptorSetLayout layout);
+
+		/**
+			Reset every pool, invalidating every set allocated from them. Nothing which
+			uses the sets may still be pending.
+		*/
+		void reset();
+
+		size_t get_pool_count() const { return usedPools.size() + freePools.size(); }
+
+	private:
+		static constexpr uint32_t maxSetsPerPool = 4096;
+
+		vk::Device device;
+		std::vector<PoolSizeRatio> ratios;
+		uint32_t setsPerPool;
+		bool debugMode;
+
+		//allocations come from the back of usedPools
+		std::vector<vk::DescriptorPool> usedPools;
+		std::vector<vk::DescriptorPool> freePools;
+
+		vk::DescriptorPool make_pool();
+		//the pool to allocate from once the current one is exhausted
+		vk::DescriptorPool next_pool();
+	};
+}
@@ -0,0 +1,105 @@
+#include "pch.h"
+#include "descriptors.h"
+#include "cpu_profiler.h"
+
+vk::DescriptorSetLayout vkInit::make_descriptor_set_layout(vk::Device device, const descriptorSetLayoutData& bindings, bool debug) {
+
+	PROFILE_FUNCTION();
+
+	/*
+	* typedef struct VkDescriptorSetLayoutBinding {
+		uint32_t              binding;
+		VkDescriptorType      descriptorType;
+		uint32_t              descriptorCount;
+		VkShaderStageFlags    stageFlags;
+		const VkSampler*      pImmutableSamplers;
+	} VkDescriptorSetLayoutBinding;
+	*/
+	std::vector<vk::DescriptorSetLayoutBinding> layoutBindings;
+	layoutBindings.reserve(bindings.count);
+
+	for (int i = 0; i < bindings.count; i++) {
+
+		vk::DescriptorSetLayoutBinding layoutBinding;
+		layoutBinding.binding = bindings.indices[i];
+		layoutBinding.descriptorType = bindings.types[i];
+		layoutBinding.descriptorCount = bindings.counts[i];
+		layoutBinding.stageFlags = bindings.stages[i];
+		layoutBindings.push_back(layoutBinding);
+	}
+
+	vk::DescriptorSetLayoutCreateInfo layoutInfo;
+	layoutInfo.flags = bindings.flags;
+	layoutInfo.bindingCount = bindings.count;
+	layoutInfo.pBindings = layoutBindings.data();
+
+	//descriptor indexing flags, such as partially bound or update after bind arrays
+	vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo;
+	if (!bindings.bindingFlags.empty()) {
+		bindingFlagsInfo.bindingCount = static_cast<uint32_t>(bindings.bindingFlags.size());
+		bindingFlagsInfo.pBindingFlags = bindings.bindingFlags.data();
+		layoutInfo.pNext = &bindingFlagsInfo;
+	}
+
+	try {
+		return device.createDescriptorSetLayout(layoutInfo);
+	}
+	catch (vk::SystemError err) {
+		if (debug) {
+			std::cout << "Failed to create Descriptor Set Layout" << std::endl;
+		}
+		return nullptr;
+	}
+}
+
+vk::DescriptorPool vkInit::make_descriptor_pool(vk::Device device, uint32_t size, const descriptorSetLayoutData& bindings, bool debug) {
+
+	PROFILE_FUNCTION();
+
+	std::vector<vk::DescriptorPoolSize> poolSizes;
+
+	for (int i = 0; i < bindings.count; i++) {
+
+		vk::DescriptorPoolSize poolSize;
+		poolSize.type = bindings.types[i];
+		poolSize.descriptorCount = size * bindings.counts[i];
+		poolSizes.push_back(poolSize);
+	}
+
+	vk::DescriptorPoolCreateInfo poolInfo;
+	poolInfo.flags = vk::DescriptorPoolCreateFlags();
+	if (bindings.flags & vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool) {
+		poolInfo.flags |= vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind;
+	}
+	poolInfo.maxSets = size;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolInfo.pPoolSizes = poolSizes.data();
+
+	try {
+		return device.createDescriptorPool(poolInfo);
+	}
+	catch (vk::SystemError err) {
+		if (debug) {
+			std::cout << "Failed to make descriptor pool" << std::endl;
+		}
+		return nullptr;
+	}
+}
+
+vk::DescriptorSet vkInit::allocate_descriptor_set(vk::Device device, vk::DescriptorPool descriptorPool, vk::DescriptorSetLayout layout, bool debug) {
+
+	vk::DescriptorSetAllocateInfo allocationInfo;
+	allocationInfo.descriptorPool = descriptorPool;
+	allocationInfo.descriptorSetCount = 1;
+	allocationInfo.pSetLayouts = &layout;
+
+	try {
+		return device.allocateDescriptorSets(allocationInfo)[0];
+	}
+	catch (vk::SystemError err) {
+		if (debug) {
+			std::cout << "Failed to allocate descriptor set from pool" << std::endl;
+		}
+		return nullptr;
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+namespace vkInit
+{
+	/**
+		Describes the bindings of a descriptor set layout.
+	*/
+	struct descriptorSetLayoutData {
+		int count;
+		std::vector<int> indices;
+		std::vector<vk::DescriptorType> types;
+		std::vector<int> counts;
+		std::vector<vk::ShaderStageFlags> stages;
+		//one per binding, or empty if no binding has any
+		std::vector<vk::DescriptorBindingFlags> bindingFlags;
+		vk::DescriptorSetLayoutCreateFlags flags;
+	};
+
+	/**
+		Make a descriptor set layout from a set of bindings.
+
+		\param device the logical device
+		\param bindings a struct describing the bindings used in the shader
+		\param debug whether the system is running in debug mode
+		\returns the created descriptor set layout
+	*/
+	vk::DescriptorSetLayout make_descriptor_set_layout(vk::Device device, const descriptorSetLayoutData& bindings, bool debug);
+
+	/**
+		Make a descriptor pool. If the layout is update after bind, so is the pool.
+
+		\param device the logical device
+		\param size the number of descriptor sets to allocate from the pool
+		\param bindings used to get the descriptor types
+		\param debug whether the system is running in debug mode
+		\returns the created descriptor pool
+	*/
+	vk::DescriptorPool make_descriptor_pool(vk::Device device, uint32_t size, const descriptorSetLayoutData& bindings, bool debug);
+
+	/**
+		Allocate a descriptor set from a pool.
+
+		\param device the logical device
+		\param descriptorPool the pool to allocate from
+		\param layout the descriptor set layout which the set must conform to
+		\param debug whether the system is running in debug mode
+		\returns the allocated descriptor set
+	*/
+	vk::DescriptorSet allocate_descriptor_set(vk::Device device, vk::DescriptorPool descriptorPool, vk::DescriptorSetLayout layout, bool debug);
+}
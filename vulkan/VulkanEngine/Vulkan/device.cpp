@@ -1,12 +1,13 @@
 #include "pch.h"
 #include "device.h"
 #include "queue_families.h"
+#include "cpu_profiler.h"
 
 
-vk::PhysicalDevice vkInit::choose_physical_device(vk::Instance& instance, bool debug)
+vk::PhysicalDevice vkInit::choose_physical_device(vk::Instance& instance, bool headless, bool debug)
 {
+	PROFILE_FUNCTION();
 
-	
 	if (debug)
 	{
 		std::cout << "Choosing physical device..." << std::endl;
@@ -38,7 +39,7 @@ vk::PhysicalDevice vkInit::choose_physical_device(vk::Instance& instance, bool d
 		if (debug) {
 			log_device_properties(device);
 		}
-		if (isSuitable(device, debug)) {
+		if (isSuitable(device, headless, debug)) {
 			return device;
 		}
 	}
@@ -139,10 +140,11 @@ bool vkInit::checkDeviceExtensionSupport(
 	Check whether the given physical device is suitable for the system.
 
 	\param device the physical device to check.
+	\param headless whether the device will render without presenting.
 	\debug whether the system is running in debug mode.
 	\returns whether the device is suitable.
 */
-bool vkInit::isSuitable(const vk::PhysicalDevice& device, const bool debug) {
+bool vkInit::isSuitable(const vk::PhysicalDevice& device, bool headless, const bool debug) {
 
 	if (debug) {
 		std::cout << "Checking if device is suitable\n";
@@ -150,11 +152,12 @@ bool vkInit::isSuitable(const vk::PhysicalDevice& device, const bool debug) {
 
 	/*
 	* A device is suitable if it can present to the screen, ie support
-	* the swapchain extension
+	* the swapchain extension. Headless rendering doesn't present.
 	*/
-	const std::vector<const char*> requestedExtensions = {
-		VK_KHR_SWAPCHAIN_EXTENSION_NAME
-	};
+	std::vector<const char*> requestedExtensions;
+	if (!headless) {
+		requestedExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+	}
 
 	if (debug) {
 		std::cout << "We are requesting device extensions:\n";
@@ -179,14 +182,72 @@ bool vkInit::isSuitable(const vk::PhysicalDevice& device, const bool debug) {
 
 		return false;
 	}
+
+	//frame pacing and deferred deletion are built on timeline semaphores
+	auto features = device.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+	if (!features.get<vk::PhysicalDeviceVulkan12Features>().timelineSemaphore) {
+
+		if (debug) {
+			std::cout << "Device can't support timeline semaphores!\n";
+		}
+
+		return false;
+	}
+
+	//every draw samples textures through the bindless table
+	const vk::PhysicalDeviceVulkan12Features& vulkan12Features = features.get<vk::PhysicalDeviceVulkan12Features>();
+	if (!vulkan12Features.runtimeDescriptorArray || !vulkan12Features.descriptorBindingPartiallyBound
+		|| !vulkan12Features.descriptorBindingSampledImageUpdateAfterBind || !vulkan12Features.descriptorBindingUpdateUnusedWhilePending
+		|| !vulkan12Features.shaderSampledImageArrayNonUniformIndexing) {
+
+		if (debug) {
+			std::cout << "Device can't support descriptor indexing!\n";
+		}
+
+		return false;
+	}
+
 	return true;
 }
 
+vkInit::DeviceFeatureSupport vkInit::query_feature_support(vk::PhysicalDevice physicalDevice, bool debug) {
+
+	auto features = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceVulkan12Features>();
+	const vk::PhysicalDeviceFeatures& coreFeatures = features.get<vk::PhysicalDeviceFeatures2>().features;
+	const vk::PhysicalDeviceVulkan12Features& vulkan12Features = features.get<vk::PhysicalDeviceVulkan12Features>();
+
+	DeviceFeatureSupport support;
+	support.multiDrawIndirect = coreFeatures.multiDrawIndirect;
+	support.drawIndirectFirstInstance = coreFeatures.drawIndirectFirstInstance;
+	support.drawIndirectCount = vulkan12Features.drawIndirectCount;
+	support.pipelineStatisticsQuery = coreFeatures.pipelineStatisticsQuery;
+	support.shaderStorageImageArrayDynamicIndexing = coreFeatures.shaderStorageImageArrayDynamicIndexing;
+	support.textureCompressionBC = coreFeatures.textureCompressionBC;
+
+	//the extension's feature struct may only be queried once the extension is known to exist
+	if (checkDeviceExtensionSupport(physicalDevice, { VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME }, false)) {
+		auto dynamicFeatures = physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2, vk::PhysicalDeviceDynamicRenderingFeaturesKHR>();
+		support.dynamicRendering = dynamicFeatures.get<vk::PhysicalDeviceDynamicRenderingFeaturesKHR>().dynamicRendering;
+	}
 
+	if (debug) {
+		std::cout << "Optional feature support:\n";
+		std::cout << "\tmultiDrawIndirect: " << support.multiDrawIndirect << '\n';
+		std::cout << "\tdrawIndirectFirstInstance: " << support.drawIndirectFirstInstance << '\n';
+		std::cout << "\tdrawIndirectCount: " << support.drawIndirectCount << '\n';
+		std::cout << "\tpipelineStatisticsQuery: " << support.pipelineStatisticsQuery << '\n';
+		std::cout << "\tshaderStorageImageArrayDynamicIndexing: " << support.shaderStorageImageArrayDynamicIndexing << '\n';
+		std::cout << "\ttextureCompressionBC: " << support.textureCompressionBC << '\n';
+		std::cout << "\tdynamicRendering: " << support.dynamicRendering << '\n';
+	}
 
+	return support;
+}
 
 vk::Device vkInit::create_logical_device(vk::PhysicalDevice physicalDevice, vk::SurfaceKHR surface, bool debug)
 {
+	PROFILE_FUNCTION();
+
 	vkUtil::QueueFamilyIndices indices = vkUtil::findQueueFamilies(physicalDevice, surface, debug);
 	std::vector<uint32_t> uniqueIndices;
 	uniqueIndices.push_back(indices.graphicsFamily.value());
@@ -194,6 +255,13 @@ vk::Device vkInit::create_logical_device(vk::PhysicalDevice physicalDevice, vk::
 	{
 		uniqueIndices.push_back(indices.presentFamily.value());
 	}
+	for (uint32_t queueFamilyIndex : { indices.transferFamily.value(), indices.computeFamily.value() })
+	{
+		if (std::find(uniqueIndices.begin(), uniqueIndices.end(), queueFamilyIndex) == uniqueIndices.end())
+		{
+			uniqueIndices.push_back(queueFamilyIndex);
+		}
+	}
 	float queuePriority = 1.0f;
 	
 	std::vector<vk::DeviceQueueCreateInfo> queueCreateInfo;
@@ -206,21 +274,53 @@ vk::Device vkInit::create_logical_device(vk::PhysicalDevice physicalDevice, vk::
 
 	}
 
-	std::vector<const char*> deviceExtensions = {
-		VK_KHR_SWAPCHAIN_EXTENSION_NAME
-	};
+	//without a surface there's nothing to present to
+	std::vector<const char*> deviceExtensions;
+	if (surface) {
+		deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+	}
+
 
+	//enable whichever optional features are available, the engine falls back when they're missing
+	DeviceFeatureSupport support = query_feature_support(physicalDevice, debug);
+
+	vk::PhysicalDeviceVulkan12Features vulkan12Features = vk::PhysicalDeviceVulkan12Features();
+	vulkan12Features.drawIndirectCount = support.drawIndirectCount;
+	//checked when choosing the physical device
+	vulkan12Features.timelineSemaphore = VK_TRUE;
+	vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+	vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+	vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+
+	vk::PhysicalDeviceFeatures2 deviceFeatures = vk::PhysicalDeviceFeatures2();
+	deviceFeatures.features.multiDrawIndirect = support.multiDrawIndirect;
+	deviceFeatures.features.drawIndirectFirstInstance = support.drawIndirectFirstInstance;
+	deviceFeatures.features.pipelineStatisticsQuery = support.pipelineStatisticsQuery;
+	deviceFeatures.features.shaderStorageImageArrayDynamicIndexing = support.shaderStorageImageArrayDynamicIndexing;
+	deviceFeatures.features.textureCompressionBC = support.textureCompressionBC;
+	deviceFeatures.pNext = &vulkan12Features;
+
+	//its dependencies, create_renderpass2 and depth_stencil_resolve, are core in 1.2
+	vk::PhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures;
+	dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+	if (support.dynamicRendering) {
+		deviceExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+		vulkan12Features.pNext = &dynamicRenderingFeatures;
+	}
 
-	vk::PhysicalDeviceFeatures deviceFeatures = vk::PhysicalDeviceFeatures();
 	std::vector<const char*> enabledLayers;
 	if (debug)
 	{
 		enabledLayers.push_back("VK_LAYER_KHRONOS_validation");
 	}
+	//features are passed through the pNext chain, so pEnabledFeatures must be null
 	vk::DeviceCreateInfo deviceInfo = vk::DeviceCreateInfo(
 		vk::DeviceCreateFlags(), queueCreateInfo.size(),queueCreateInfo.data(), enabledLayers.size(), enabledLayers.data(),
-		deviceExtensions.size(), deviceExtensions.data(), &deviceFeatures
+		deviceExtensions.size(), deviceExtensions.data(), nullptr
 	);
+	deviceInfo.pNext = &deviceFeatures;
 
 	try {
 		vk::Device device = physicalDevice.createDevice(deviceInfo);
@@ -240,11 +340,13 @@ vk::Device vkInit::create_logical_device(vk::PhysicalDevice physicalDevice, vk::
 	return nullptr;
 }
 
-std::array<vk::Queue, 2> vkInit::get_queue(vk::PhysicalDevice physicalDevice, vk::Device device, vk::SurfaceKHR surface, bool debug)
+std::array<vk::Queue, 4> vkInit::get_queue(vk::PhysicalDevice physicalDevice, vk::Device device, vk::SurfaceKHR surface, bool debug)
 {
 	vkUtil::QueueFamilyIndices indices = vkUtil::findQueueFamilies(physicalDevice, surface, debug);
 
 	return {{device.getQueue(indices.graphicsFamily.value(), 0),
-			 device.getQueue(indices.presentFamily.value(),  0)}};
+			 device.getQueue(indices.presentFamily.value(),  0),
+			 device.getQueue(indices.transferFamily.value(), 0),
+			 device.getQueue(indices.computeFamily.value(), 0)}};
 }
 
@@ -3,20 +3,42 @@
 
 namespace vkInit
 {
-
-
-
-
-
-	vk::PhysicalDevice choose_physical_device(vk::Instance& instance, bool debug);
+	/**
+		Optional device features the engine can take advantage of,
+		each one is enabled on the logical device if supported.
+	*/
+	struct DeviceFeatureSupport {
+		bool multiDrawIndirect = false;
+		bool drawIndirectFirstInstance = false;
+		bool drawIndirectCount = false;
+		bool pipelineStatisticsQuery = false;
+		bool shaderStorageImageArrayDynamicIndexing = false;
+		bool textureCompressionBC = false;
+		//VK_KHR_dynamic_rendering, core from 1.3 but an extension on the 1.2 devices the engine targets
+		bool dynamicRendering = false;
+	};
+
+	vk::PhysicalDevice choose_physical_device(vk::Instance& instance, bool headless, bool debug);
 	void log_device_properties(const vk::PhysicalDevice& device);
 	bool checkDeviceExtensionSupport(const vk::PhysicalDevice& device, const std::vector<const char*>& requestedExtensions, const bool& debug);
-	bool isSuitable(const vk::PhysicalDevice& device, const bool debug);
+	bool isSuitable(const vk::PhysicalDevice& device, bool headless, const bool debug);
+
+	/**
+		Check which of the optional features the physical device supports.
+
+		\param physicalDevice the physical device
+		\param debug whether the system is running in debug mode
+		\returns the supported optional features
+	*/
+	DeviceFeatureSupport query_feature_support(vk::PhysicalDevice physicalDevice, bool debug);
 
 	
 
 	vk::Device create_logical_device(vk::PhysicalDevice physicalDevice, vk::SurfaceKHR surface, bool debug);
-	std::array<vk::Queue,2> get_queue(vk::PhysicalDevice physicalDevice, vk::Device device, vk::SurfaceKHR surface, bool debug);
+	/**
+		\returns the graphics, present, transfer and compute queues, which may be the same queue
+	*/
+	std::array<vk::Queue,4> get_queue(vk::PhysicalDevice physicalDevice, vk::Device device, vk::SurfaceKHR surface, bool debug);
 
 	
 
@@ -9,12 +9,21 @@
 #include "commands.h"
 #include "sync.h"
 #include "render_structs.h"
+#include "descriptors.h"
+#include "queue_families.h"
+#include "pipeline_cache.h"
+#include "offscreen.h"
+#include "cpu_profiler.h"
 
 Engine::Engine(int width, int height, GLFWwindow* window, bool debug) {
 
+	PROFILE_FUNCTION();
+
 	this->width = width;
 	this->height = height;
 	this->window = window;
+	//without a window, frames are rendered offscreen
+	headless = window == nullptr;
 	debugMode = debug;
 
 	if (debugMode) {
@@ -25,6 +34,8 @@ Engine::Engine(int width, int height, GLFWwindow* window, bool debug) {
 
 	make_device();
 
+	make_descriptor_set_layouts();
+
 	make_pipeline();
 
 	finalize_setup();
@@ -32,11 +43,14 @@ Engine::Engine(int width, int height, GLFWwindow* window, bool debug) {
 
 void Engine::make_instance() {
 
-	instance = vkInit::make_instance(debugMode, "ID Tech 12");
+	instance = vkInit::make_instance(debugMode, "ID Tech 12", headless);
 	dldi = vk::DispatchLoaderDynamic(instance, vkGetInstanceProcAddr);
 	if (debugMode) {
 		debugMessenger = vkInit::make_debug_messenger(instance, dldi);
 	}
+	if (headless) {
+		return;
+	}
 	VkSurfaceKHR c_style_surface;
 	if (glfwCreateWindowSurface(instance, window, nullptr, &c_style_surface) != VK_SUCCESS) {
 		if (debugMode) {
@@ -52,26 +66,53 @@ void Engine::make_instance() {
 
 void Engine::make_device() {
 
-	physicalDevice = vkInit::choose_physical_device(instance, debugMode);
+	physicalDevice = vkInit::choose_physical_device(instance, headless, debugMode);
 	device = vkInit::create_logical_device(physicalDevice, surface, debugMode);
-	std::array<vk::Queue, 2> queues = vkInit::get_queue(physicalDevice, device, surface, debugMode);
+	featureSupport = vkInit::query_feature_support(physicalDevice, false);
+	//extension commands, like vkCmdBeginRenderingKHR, aren't exported by the loader
+	dldi.init(device);
+	dynamicRendering = featureSupport.dynamicRendering;
+
+	//64MB blocks, larger resources get dedicated allocations
+	allocator = std::make_unique<vkUtil::MemoryAllocator>(device, physicalDevice, 64 * 1024 * 1024, debugMode);
+	timeline = std::make_unique<vkUtil::Timeline>(device, debugMode);
+	std::array<vk::Queue, 4> queues = vkInit::get_queue(physicalDevice, device, surface, debugMode);
 	graphicsQueue = queues[0];
 	presentQueue = queues[1];
-	make_swapchain();
+	transferQueue = queues[2];
+	computeQueue = queues[3];
+
+	vkUtil::QueueFamilyIndices indices = vkUtil::findQueueFamilies(physicalDevice, surface, false);
+	graphicsFamilyIndex = indices.graphicsFamily.value();
+	computeFamilyIndex = indices.computeFamily.value();
+	uploads = std::make_unique<vkUtil::UploadManager>(
+		device, *allocator, transferQueue,
+		indices.transferFamily.value(), indices.graphicsFamily.value(),
+		16 * 1024 * 1024, debugMode
+	);
+	make_swapchain(nullptr);
 	frameNumber = 0;
 }
 
 /**
-* Make a swapchain
+* Make a swapchain, optionally replacing an old one
 */
-void Engine::make_swapchain() {
+void Engine::make_swapchain(vk::SwapchainKHR oldSwapchain) {
 
-	vkInit::SwapChainBundle bundle = vkInit::create_swapchain(device, physicalDevice, surface, width, height, debugMode);
+	vkInit::SwapChainBundle bundle;
+	if (headless) {
+		//one image per possible frame in flight, each frame context only ever renders to its own
+		bundle = vkInit::create_offscreen_targets(
+			device, *allocator, vk::Extent2D(width, height), vk::Format::eR8G8B8A8Unorm, 3, debugMode
+		);
+	}
+	else {
+		bundle = vkInit::create_swapchain(device, physicalDevice, surface, width, height, oldSwapchain, debugMode);
+	}
 	swapchain = bundle.swapchain;
 	swapchainFrames = bundle.frames;
 	swapchainFormat = bundle.format;
 	swapchainExtent = bundle.extent;
-	maxFramesInFlight = static_cast<int>(swapchainFrames.size());
 
 }
 
@@ -80,6 +121,8 @@ void Engine::make_swapchain() {
 */
 void Engine::recreate_swapchain() {
 
+	PROFILE_FUNCTION();
+
 	width = 0;
 	height = 0;
 	while (width == 0 || height == 0) {
@@ -87,25 +130,138 @@ void Engine::recreate_swapchain() {
 		glfwWaitEvents();
 	}
 
-	device.waitIdle();
+	auto start = std::chrono::high_resolution_clock::now();
 
-	cleanup_swapchain();
-	make_swapchain();
+	if (blockingRecreation) {
+		device.waitIdle();
+	}
+
+	vk::SwapchainKHR oldSwapchain = swapchain;
+	std::vector<vkUtil::SwapChainFrame> oldFrames = std::move(swapchainFrames);
+
+	//frame contexts don't depend on the swapchain, only its images need replacing
+	make_swapchain(oldSwapchain);
 	make_framebuffers();
-	make_frame_sync_objects();
-	vkInit::commandBufferInputChunk commandBufferInput = { device, commandPool, swapchainFrames };
-	vkInit::make_frame_command_buffers(commandBufferInput, debugMode);
+	make_swapchain_sync_objects();
+
+	//frames still in flight may be using the old images. Presentation has no completion signal,
+	//so wait for a frame submitted after the last present to the old swapchain as well.
+	deletionQueue.push(timeline->last_submitted() + 1, [this, oldFrames, oldSwapchain]() mutable {
+		destroy_swapchain_frames(oldFrames, oldSwapchain);
+	});
+
+	if (blockingRecreation) {
+		deletionQueue.flush_all();
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	swapchainRecreateTime = std::chrono::duration<double, std::milli>(end - start).count();
+	++swapchainRecreateCount;
+
+}
+
+/**
+* Make the descriptor set layouts used by the pipelines
+*/
+void Engine::make_descriptor_set_layouts() {
+
+	descriptorLayouts = std::make_unique<vkUtil::DescriptorLayoutCache>(device, debugMode);
+
+	//binding 0: per-object transforms, binding 1: per-object materials, indexed by instance in the vertex shader
+	vkInit::descriptorSetLayoutData bindings;
+	bindings.count = 2;
+	for (int i = 0; i < bindings.count; ++i) {
+		bindings.indices.push_back(i);
+		bindings.types.push_back(vk::DescriptorType::eStorageBuffer);
+		bindings.counts.push_back(1);
+		bindings.stages.push_back(vk::ShaderStageFlagBits::eVertex);
+	}
 
+	descriptorSetLayout = descriptorLayouts->get(bindings);
+
+	//material 0 is plain white, for objects which don't pick one
+	bindless = std::make_unique<vkUtil::BindlessTable>(device, physicalDevice, *allocator, *descriptorLayouts, debugMode);
+	bindless->add_material(vkUtil::Material());
+
+	//binding 0: transforms, binding 1: draw commands, binding 2: draw count
+	vkInit::descriptorSetLayoutData cullBindings;
+	cullBindings.count = 3;
+	for (int i = 0; i < cullBindings.count; ++i) {
+		cullBindings.indices.push_back(i);
+		cullBindings.types.push_back(vk::DescriptorType::eStorageBuffer);
+		cullBindings.counts.push_back(1);
+		cullBindings.stages.push_back(vk::ShaderStageFlagBits::eCompute);
+	}
+
+	cullDescriptorSetLayout = descriptorLayouts->get(cullBindings);
+
+	//binding 0: one draw's ObjectData, at a dynamic offset into the frame's arena
+	vkInit::descriptorSetLayoutData objectBindings;
+	objectBindings.count = 1;
+	objectBindings.indices.push_back(0);
+	objectBindings.types.push_back(vk::DescriptorType::eUniformBufferDynamic);
+	objectBindings.counts.push_back(1);
+	objectBindings.stages.push_back(vk::ShaderStageFlagBits::eVertex);
+
+	objectDescriptorSetLayout = descriptorLayouts->get(objectBindings);
+
+	vk::DeviceSize alignment = physicalDevice.getProperties().limits.minUniformBufferOffsetAlignment;
+	objectDataStride = (sizeof(vkUtil::ObjectData) + alignment - 1) & ~(alignment - 1);
 }
 
 void Engine::make_pipeline() {
 
+	auto start = std::chrono::high_resolution_clock::now();
+
+	pipelineCache = vkInit::make_pipeline_cache(device, physicalDevice, "pipeline_cache.bin", debugMode, pipelineCacheWarm);
+
+	make_graphics_pipelines();
+
+	vkInit::ComputePipelineInBundle cullSpecification = {};
+	cullSpecification.device = device;
+	cullSpecification.computeFilepath = "shaders/cull.spv";
+	cullSpecification.descriptorSetLayout = cullDescriptorSetLayout;
+	cullSpecification.pushConstantSize = sizeof(vkUtil::CullData);
+	cullSpecification.pipelineCache = pipelineCache;
+
+	vkInit::ComputePipelineOutBundle cullOutput = vkInit::create_compute_pipeline(cullSpecification, debugMode);
+	cullPipelineLayout = cullOutput.layout;
+	cullPipeline = cullOutput.pipeline;
+
+	mipGenerator = std::make_unique<vkUtil::MipGenerator>(
+		device, physicalDevice, *allocator, graphicsFamilyIndex, pipelineCache, *descriptorLayouts,
+		featureSupport.shaderStorageImageArrayDynamicIndexing, debugMode
+	);
+	set_mip_mode(mipMode);
+
+	auto end = std::chrono::high_resolution_clock::now();
+	pipelineCreationTime = std::chrono::duration<double, std::milli>(end - start).count();
+	if (debugMode) {
+		std::cout << "Made pipelines in " << pipelineCreationTime << " ms with a "
+			<< (pipelineCacheWarm ? "warm" : "cold") << " pipeline cache\n";
+	}
+
+}
+
+/**
+* Make the graphics pipelines, against a renderpass or for dynamic rendering.
+* The pipeline layout doesn't depend on either, so it's kept once made
+*/
+void Engine::make_graphics_pipelines() {
+
 	vkInit::GraphicsPipelineInBundle specification = {};
 	specification.device = device;
 	specification.vertexFilepath = "shaders/vertex.spv";
 	specification.fragmentFilepath = "shaders/fragment.spv";
-	specification.swapchainExtent = swapchainExtent;
 	specification.swapchainImageFormat = swapchainFormat;
+	//offscreen images are copied from rather than presented
+	specification.finalLayout = headless ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR;
+	//set 0: instanced transforms, set 1: the bindless table, set 2: per-object draw data
+	specification.descriptorSetLayouts = { descriptorSetLayout, bindless->get_layout(), objectDescriptorSetLayout };
+	specification.pipelineCache = pipelineCache;
+
+	specification.layout = pipelineLayout;
+	specification.dynamicRendering = dynamicRendering;
 
 	vkInit::GraphicsPipelineOutBundle output = vkInit::create_graphics_pipeline(
 		specification, debugMode
@@ -115,6 +271,47 @@ void Engine::make_pipeline() {
 	renderpass = output.renderpass;
 	pipeline = output.pipeline;
 
+	//the instanced pipeline only differs in its vertex shader
+	specification.vertexFilepath = "shaders/instanced_vertex.spv";
+	specification.layout = pipelineLayout;
+	specification.renderpass = renderpass;
+	output = vkInit::create_graphics_pipeline(specification, debugMode);
+	instancedPipeline = output.pipeline;
+}
+
+void Engine::destroy_graphics_pipelines() {
+
+	device.destroyPipeline(pipeline);
+	device.destroyPipeline(instancedPipeline);
+	device.destroyRenderPass(renderpass);
+	pipeline = nullptr;
+	instancedPipeline = nullptr;
+	renderpass = nullptr;
+}
+
+void Engine::set_dynamic_rendering(bool enabled) {
+
+	if (enabled && !featureSupport.dynamicRendering) {
+		if (debugMode) {
+			std::cout << "Device can't support dynamic rendering, falling back to a renderpass\n";
+		}
+		enabled = false;
+	}
+	if (enabled == dynamicRendering) {
+		return;
+	}
+
+	//frames in flight may still be using the pipelines and framebuffers
+	device.waitIdle();
+	dynamicRendering = enabled;
+
+	for (vkUtil::SwapChainFrame& frame : swapchainFrames) {
+		device.destroyFramebuffer(frame.framebuffer);
+		frame.framebuffer = nullptr;
+	}
+	destroy_graphics_pipelines();
+	make_graphics_pipelines();
+	make_framebuffers();
 }
 
 /**
@@ -122,6 +319,11 @@ void Engine::make_pipeline() {
 */
 void Engine::make_framebuffers() {
 
+	//dynamic rendering names the image view as each frame is recorded, so there's nothing to make
+	if (dynamicRendering) {
+		return;
+	}
+
 	vkInit::framebufferInput frameBufferInput;
 	frameBufferInput.device = device;
 	frameBufferInput.renderpass = renderpass;
@@ -131,75 +333,795 @@ void Engine::make_framebuffers() {
 }
 
 /**
-* Make synchronization objects for each frame
+* Make a render finished semaphore for each swapchain image
 */
-void Engine::make_frame_sync_objects() {
+void Engine::make_swapchain_sync_objects() {
 
 	for (vkUtil::SwapChainFrame& frame : swapchainFrames) {
-		frame.imageAvailable = vkInit::make_semaphore(device, debugMode);
 		frame.renderFinished = vkInit::make_semaphore(device, debugMode);
-		frame.inFlight = vkInit::make_fence(device, debugMode);
 	}
 
 }
 
+/**
+* Make each frame in flight's commands, synchronization objects and descriptor sets
+*/
+void Engine::make_frame_contexts() {
+
+	frames.resize(framesInFlight);
+	frameNumber = static_cast<int>(timeline->last_submitted() % framesInFlight);
+
+	vkUtil::QueueFamilyIndices indices = vkUtil::findQueueFamilies(physicalDevice, surface, false);
+	vkInit::frameCommandInputChunk commandInput = { device, indices.graphicsFamily.value(), frames };
+	vkInit::make_frame_command_buffers(commandInput, debugMode);
+	if (is_async_compute_supported()) {
+		vkInit::frameCommandInputChunk computeInput = { device, computeFamilyIndex, frames };
+		vkInit::make_frame_compute_commands(computeInput, debugMode);
+	}
+
+
+	for (vkUtil::FrameContext& frame : frames) {
+		frame.imageAvailable = vkInit::make_semaphore(device, debugMode);
+		if (is_async_compute_supported()) {
+			frame.computeFinished = vkInit::make_semaphore(device, debugMode);
+		}
+		//two sets a frame: the vertex shader's and the culling shader's, five storage buffers between them,
+		//or a single dynamic uniform buffer for per-object draws
+		frame.descriptors = std::make_unique<vkUtil::DescriptorAllocator>(
+			device,
+			std::vector<vkUtil::PoolSizeRatio>{
+				{ vk::DescriptorType::eStorageBuffer, 2.5f },
+				{ vk::DescriptorType::eUniformBufferDynamic, 0.5f }
+			},
+			2, debugMode
+		);
+		frame.arena = std::make_unique<vkUtil::LinearArena>(
+			*allocator, 1024 * 1024,
+			vk::BufferUsageFlagBits::eUniformBuffer | vk::BufferUsageFlagBits::eStorageBuffer
+		);
+		frame.graph = std::make_unique<vkUtil::RenderGraph>(device, allocator.get(), debugMode);
+	}
+
+	make_worker_commands();
+
+}
+
+/**
+* Destroy the frame contexts, none of them may be in flight
+*/
+void Engine::destroy_frame_contexts() {
+
+	vkInit::destroy_frame_worker_commands(device, frames);
+	vkInit::destroy_frame_command_buffers(device, frames);
+
+	for (vkUtil::FrameContext& frame : frames) {
+		frame.destroy_descriptor_resources(*allocator);
+		frame.graph.reset();
+		device.destroySemaphore(frame.imageAvailable);
+		device.destroySemaphore(frame.computeFinished);
+	}
+	frames.clear();
+
+}
+
 void Engine::finalize_setup() {
 
 	make_framebuffers();
 
 	commandPool = vkInit::make_command_pool(device, physicalDevice, surface, debugMode);
 
-	vkInit::commandBufferInputChunk commandBufferInput = { device, commandPool, swapchainFrames };
+	vkInit::commandBufferInputChunk commandBufferInput = { device, commandPool };
 	mainCommandBuffer = vkInit::make_command_buffer(commandBufferInput, debugMode);
-	vkInit::make_frame_command_buffers(commandBufferInput, debugMode);
 
-	make_frame_sync_objects();
+	//one slot per frame that can be in flight
+	vkUtil::QueueFamilyIndices indices = vkUtil::findQueueFamilies(physicalDevice, surface, false);
+	gpuProfiler = std::make_unique<vkUtil::GpuProfiler>(
+		device, physicalDevice, indices.graphicsFamily.value(), 3, featureSupport.pipelineStatisticsQuery
+	);
+	gpuProfiler->calibrate(graphicsQueue, mainCommandBuffer);
+
+	make_swapchain_sync_objects();
+
+	make_frame_contexts();
+
+	make_assets();
 
 }
 
-void Engine::record_draw_commands(vk::CommandBuffer commandBuffer, uint32_t imageIndex, Scene* scene) {
+/**
+* Make the built in meshes, which scenes use until a model is loaded
+*/
+void Engine::make_assets() {
+
+	vkUtil::MeshData triangle;
+	triangle.vertices = {
+		{ glm::vec3(0.0f, -0.05f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec2(0.5f, 0.0f), glm::vec3(1.0f, 0.0f, 0.0f) },
+		{ glm::vec3(0.05f, 0.05f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec2(1.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f) },
+		{ glm::vec3(-0.05f, 0.05f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec2(0.0f, 1.0f), glm::vec3(0.0f, 0.0f, 1.0f) }
+	};
+	triangle.indices = { 0, 1, 2 };
+	meshes.add(triangle);
+
+	//the first frame picks the upload up and waits for it
+	meshes.upload(*allocator, *uploads, debugMode);
+}
+
+std::vector<uint32_t> Engine::load_model(const std::string& filename) {
+
+	std::vector<uint32_t> loaded = meshes.load(filename, debugMode);
+	if (loaded.empty()) {
+		return loaded;
+	}
+
+	//frames in flight may still be drawing from the old buffers
+	std::array<vkUtil::Buffer, 2> oldBuffers = meshes.take_buffers();
+	deletionQueue.push(timeline->last_submitted(), [this, oldBuffers]() mutable {
+		for (vkUtil::Buffer& buffer : oldBuffers) {
+			allocator->destroy_buffer(buffer);
+		}
+	});
+	meshes.upload(*allocator, *uploads, debugMode);
+
+	return loaded;
+}
+
+std::vector<uint32_t> Engine::load_textures(const std::vector<std::string>& filenames, int threadCount) {
+
+	vkUtil::TextureLoader loader(
+		device, *allocator, *uploads, threadCount, mipMode, featureSupport.textureCompressionBC, debugMode
+	);
+	std::vector<vkUtil::Texture> loaded = loader.load(filenames);
+	textureLoadStats = loader.get_stats();
+	generate_mips(loaded);
+
+	//a texture's index is also its slot in the bindless table, files without one get noTexture
+	std::vector<uint32_t> indices;
+	for (size_t i = 0; i < loaded.size(); ++i) {
+		vkUtil::Texture& texture = loaded[i];
+		if (!texture.image.image) {
+			indices.push_back(vkUtil::noTexture);
+			continue;
+		}
+		uint32_t index = static_cast<uint32_t>(textures.size());
+		if (!bindless->write_texture(index, texture.view)) {
+			std::cout << "Bindless table is full, dropped texture " << filenames[i] << std::endl;
+			device.destroyImageView(texture.view);
+			allocator->destroy_image(texture.image);
+			indices.push_back(vkUtil::noTexture);
+			continue;
+		}
+		indices.push_back(index);
+		textures.push_back(texture);
+	}
+	return indices;
+}
+
+uint32_t Engine::add_material(const vkUtil::Material& material) {
+
+	return bindless->add_material(material);
+}
+
+void Engine::set_mip_mode(vkUtil::MipMode mode) {
+
+	if (mode == vkUtil::MipMode::Compute && !mipGenerator->is_compute_supported()) {
+		mode = vkUtil::MipMode::Blit;
+	}
+	mipMode = mode;
+}
+
+/**
+* Acquire the textures' uploads on the graphics queue and fill in their mip chains,
+* waiting for it to finish so the timings can be read back
+*/
+void Engine::generate_mips(const std::vector<vkUtil::Texture>& loaded) {
+
+	mipStats = vkUtil::MipStats();
+	if (mipMode == vkUtil::MipMode::None) {
+		return;
+	}
 
 	vk::CommandBufferBeginInfo beginInfo = {};
+	beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+	mainCommandBuffer.begin(beginInfo);
+	vkUtil::UploadWait uploadWait = uploads->record_acquires(mainCommandBuffer);
+	mipGenerator->record(mainCommandBuffer, loaded, mipMode);
+	mainCommandBuffer.end();
+
+	//the mips are read and written by transfers and compute, not just the stages the uploads were made for
+	vk::Semaphore waitSemaphore = uploads->get_semaphore();
+	vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eAllCommands;
+	vk::TimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.waitSemaphoreValueCount = 1;
+	timelineInfo.pWaitSemaphoreValues = &uploadWait.value;
+
+	vk::SubmitInfo submitInfo = {};
+	submitInfo.waitSemaphoreCount = uploadWait.value > 0 ? 1 : 0;
+	submitInfo.pWaitSemaphores = &waitSemaphore;
+	submitInfo.pWaitDstStageMask = &waitStage;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &mainCommandBuffer;
+	submitInfo.pNext = uploadWait.value > 0 ? &timelineInfo : nullptr;
 
 	try {
-		commandBuffer.begin(beginInfo);
+		graphicsQueue.submit(submitInfo, nullptr);
 	}
 	catch (vk::SystemError err) {
 		if (debugMode) {
-			std::cout << "Failed to begin recording command buffer!" << std::endl;
+			std::cout << "failed to submit mip generation!" << std::endl;
+		}
+	}
+	graphicsQueue.waitIdle();
+	mipStats = mipGenerator->finish();
+}
+
+void Engine::unload_textures() {
+
+	device.waitIdle();
+	for (vkUtil::Texture& texture : textures) {
+		if (texture.image.image) {
+			device.destroyImageView(texture.view);
+			allocator->destroy_image(texture.image);
 		}
 	}
+	textures.clear();
+}
+
+/**
+* Make each frame's per-worker command pools, if recording is multithreaded
+*/
+void Engine::make_worker_commands() {
+
+	if (recordingThreads <= 1) {
+		return;
+	}
+
+	vkUtil::QueueFamilyIndices indices = vkUtil::findQueueFamilies(physicalDevice, surface, false);
+	vkInit::workerCommandInputChunk workerInput = {
+		device, indices.graphicsFamily.value(), recordingThreads, frames
+	};
+	vkInit::make_frame_worker_commands(workerInput, debugMode);
+}
+
+void Engine::set_recording_threads(int threadCount) {
+
+	threadCount = std::max(1, threadCount);
+	if (threadCount == recordingThreads) {
+		return;
+	}
+
+	//the worker pools may still be in use by frames in flight
+	device.waitIdle();
+	vkInit::destroy_frame_worker_commands(device, frames);
+	recordingPool.reset();
+
+	recordingThreads = threadCount;
+	if (recordingThreads > 1) {
+		recordingPool = std::make_unique<ThreadPool>(recordingThreads);
+	}
+	make_worker_commands();
+}
+
+void Engine::set_frames_in_flight(int count) {
+
+	count = std::clamp(count, 1, 3);
+	if (count == framesInFlight) {
+		return;
+	}
+
+	device.waitIdle();
+	deletionQueue.flush_all();
+	destroy_frame_contexts();
+
+	framesInFlight = count;
+	make_frame_contexts();
+}
+
+size_t Engine::get_render_graph_compile_count() const {
+
+	size_t count = 0;
+	for (const vkUtil::FrameContext& frame : frames) {
+		count += frame.graph->get_stats().compileCount;
+	}
+	return count;
+}
+
+void Engine::set_render_mode(RenderMode mode) {
+
+	//gpu driven draws store the object index in firstInstance and need more than one draw per call
+	if (mode == RenderMode::GpuDriven
+		&& !(featureSupport.drawIndirectFirstInstance && featureSupport.multiDrawIndirect)) {
+		if (debugMode) {
+			std::cout << "Device can't support gpu driven rendering, falling back to instanced rendering\n";
+		}
+		mode = RenderMode::Instanced;
+	}
+
+	renderMode = mode;
+}
+
+/**
+* Upload this frame's per-object data, the frame's previous submission must already be complete
+*/
+void Engine::prepare_frame(Scene* scene) {
+
+	vkUtil::FrameContext& frame = frames[frameNumber];
+	size_t objectCount = scene->get_object_count();
+
+	//per-object data is written while recording, but the arena can only grow before then.
+	//each recording thread may leave the end of its last chunk unused.
+	if (renderMode == RenderMode::PerObject) {
+		size_t threadCount = std::max<size_t>(frame.workerCommandBuffers.size(), 1);
+		frame.arena->reserve((objectCount + threadCount * objectsPerChunk) * objectDataStride);
+		frame.write_object_descriptor_set(device, objectDescriptorSetLayout, sizeof(vkUtil::ObjectData));
+		return;
+	}
+
+	std::vector<uint32_t> queueFamilies = { graphicsFamilyIndex };
+	if (is_async_compute_supported()) {
+		queueFamilies.push_back(computeFamilyIndex);
+	}
+	frame.make_descriptor_resources(*allocator, objectCount, queueFamilies);
+	frame.write_descriptor_set(device, descriptorSetLayout, cullDescriptorSetLayout);
+
+	//scene transforms are static, so in gpu driven mode they're only uploaded when the scene changes,
+	//after which the cpu cost of a frame no longer depends on the number of objects
+	if (renderMode == RenderMode::GpuDriven && frame.uploadedSceneGeneration == scene->get_generation()) {
+		return;
+	}
+
+	glm::mat4* models = static_cast<glm::mat4*>(frame.modelBufferWriteLocation);
+	for (size_t i = 0; i < objectCount; ++i) {
+		models[i] = glm::translate(glm::mat4(1.0f), scene->get_positions()[i]);
+		frame.objectMaterialWriteLocation[i] = scene->get_material(i);
+	}
+	frame.uploadedSceneGeneration = scene->get_generation();
+}
+
+void Engine::record_per_object_draws(vk::CommandBuffer commandBuffer, Scene* scene, size_t first, size_t last) {
+
+	vkUtil::FrameContext& frame = frames[frameNumber];
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+	meshes.bind(commandBuffer);
+	const vkUtil::MeshRange& mesh = meshes.get_range(scene->get_mesh());
+
+	//this thread's own run of the arena, so objects are written back to back without contention
+	vkUtil::ArenaChunk chunk(*frame.arena, objectsPerChunk * objectDataStride, objectDataStride);
+
+	for (size_t i = first; i < last; ++i) {
+
+		vkUtil::LinearArena::Slice slice = chunk.allocate(sizeof(vkUtil::ObjectData));
+		if (!slice.data) {
+			break;
+		}
+		vkUtil::ObjectData* objectData = static_cast<vkUtil::ObjectData*>(slice.data);
+		objectData->model = glm::translate(glm::mat4(1.0f), scene->get_positions()[i]);
+		objectData->material = scene->get_material(i);
+
+		uint32_t dynamicOffset = static_cast<uint32_t>(slice.offset);
+		commandBuffer.bindDescriptorSets(
+			vk::PipelineBindPoint::eGraphics, pipelineLayout,
+			2, frame.objectDescriptorSet, dynamicOffset
+		);
+
+		commandBuffer.drawIndexed(mesh.indexCount, 1, mesh.firstIndex, mesh.vertexOffset, 0);
+
+	}
+}
+
+/**
+* Split the scene's objects across the recording workers, each records its share into a
+* secondary command buffer which the primary buffer then executes
+*/
+void Engine::record_parallel_draws(vk::CommandBuffer commandBuffer, uint32_t imageIndex, Scene* scene) {
+
+	PROFILE_FUNCTION();
+
+	vkUtil::FrameContext& frame = frames[frameNumber];
+	size_t objectCount = scene->get_object_count();
+	size_t workerCount = frame.workerCommandBuffers.size();
+
+	for (size_t worker = 0; worker < workerCount; ++worker) {
+
+		size_t first = objectCount * worker / workerCount;
+		size_t last = objectCount * (worker + 1) / workerCount;
+
+		recordingPool->submit([this, &frame, worker, first, last, imageIndex, scene]() {
+
+			PROFILE_SCOPE("record secondary");
+
+			//the pool is only touched by this job during the frame, so no locking is needed
+			device.resetCommandPool(frame.workerCommandPools[worker]);
+			vk::CommandBuffer secondary = frame.workerCommandBuffers[worker];
+
+			//dynamic rendering has no renderpass to inherit, only the attachments' formats
+			vk::CommandBufferInheritanceRenderingInfoKHR renderingInheritance;
+			renderingInheritance.colorAttachmentCount = 1;
+			renderingInheritance.pColorAttachmentFormats = &swapchainFormat;
+			renderingInheritance.rasterizationSamples = vk::SampleCountFlagBits::e1;
+
+			vk::CommandBufferInheritanceInfo inheritanceInfo = {};
+			if (dynamicRendering) {
+				inheritanceInfo.pNext = &renderingInheritance;
+			}
+			else {
+				inheritanceInfo.renderPass = renderpass;
+				inheritanceInfo.subpass = 0;
+				inheritanceInfo.framebuffer = swapchainFrames[imageIndex].framebuffer;
+			}
+
+			vk::CommandBufferBeginInfo beginInfo = {};
+			beginInfo.flags = vk::CommandBufferUsageFlagBits::eRenderPassContinue | vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+			beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+			try {
+				secondary.begin(beginInfo);
+				//neither dynamic state nor descriptor sets are inherited from the primary buffer
+				record_viewport(secondary);
+				bindless->bind(secondary, vk::PipelineBindPoint::eGraphics, pipelineLayout, 1);
+				record_per_object_draws(secondary, scene, first, last);
+				secondary.end();
+			}
+			catch (vk::SystemError err) {
+				if (debugMode) {
+					std::cout << "Failed to record worker command buffer!" << std::endl;
+				}
+			}
+		});
+	}
+
+	recordingPool->wait();
+
+	commandBuffer.executeCommands(frame.workerCommandBuffers);
+}
+
+void Engine::record_instanced_draws(vk::CommandBuffer commandBuffer, Scene* scene) {
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, instancedPipeline);
+
+	commandBuffer.bindDescriptorSets(
+		vk::PipelineBindPoint::eGraphics, pipelineLayout,
+		0, frames[frameNumber].descriptorSet, nullptr
+	);
+
+	meshes.bind(commandBuffer);
+	const vkUtil::MeshRange& mesh = meshes.get_range(scene->get_mesh());
+	commandBuffer.drawIndexed(
+		mesh.indexCount, static_cast<uint32_t>(scene->get_object_count()),
+		mesh.firstIndex, mesh.vertexOffset, 0
+	);
+}
+
+/**
+* Frustum cull the scene on the gpu, writing one indirect draw per visible object.
+* The draw count must already be cleared
+*/
+void Engine::record_culling(vk::CommandBuffer commandBuffer, Scene* scene) {
+
+	vkUtil::FrameContext& frame = frames[frameNumber];
+	uint32_t objectCount = static_cast<uint32_t>(scene->get_object_count());
+
+	vkUtil::CullData cullData;
+	//there's no camera yet, so objects are already in clip space
+	vkUtil::extract_frustum_planes(glm::mat4(1.0f), cullData.frustumPlanes);
+	cullData.objectCount = objectCount;
+	const vkUtil::MeshRange& mesh = meshes.get_range(scene->get_mesh());
+	cullData.indexCount = mesh.indexCount;
+	cullData.firstIndex = mesh.firstIndex;
+	cullData.vertexOffset = mesh.vertexOffset;
+	cullData.boundingRadius = mesh.boundingRadius;
+	cullData.compact = featureSupport.drawIndirectCount ? 1 : 0;
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, cullPipeline);
+	commandBuffer.bindDescriptorSets(
+		vk::PipelineBindPoint::eCompute, cullPipelineLayout,
+		0, frame.cullDescriptorSet, nullptr
+	);
+	commandBuffer.pushConstants(
+		cullPipelineLayout, vk::ShaderStageFlagBits::eCompute,
+		0, sizeof(cullData), &cullData
+	);
+	commandBuffer.dispatch((objectCount + 63) / 64, 1, 1);
+}
+
+/**
+* Record the frame's culling pass into its compute command buffer, then release
+* the draw buffers to the graphics queue, which acquires them with acquire_culling_results
+*/
+void Engine::record_async_culling(Scene* scene) {
+
+	vkUtil::FrameContext& frame = frames[frameNumber];
+	device.resetCommandPool(frame.computeCommandPool);
+
+	vk::CommandBufferBeginInfo beginInfo = {};
+	beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+	try {
+		frame.computeCommandBuffer.begin(beginInfo);
+
+		//reset the draw count before the culling shader starts appending to it
+		frame.computeCommandBuffer.fillBuffer(frame.drawCountBuffer.buffer, 0, sizeof(uint32_t), 0);
+
+		vk::BufferMemoryBarrier clearBarrier;
+		clearBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+		clearBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+		clearBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		clearBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		clearBarrier.buffer = frame.drawCountBuffer.buffer;
+		clearBarrier.offset = 0;
+		clearBarrier.size = VK_WHOLE_SIZE;
+		frame.computeCommandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader,
+			vk::DependencyFlags(), nullptr, clearBarrier, nullptr
+		);
+
+		record_culling(frame.computeCommandBuffer, scene);
+
+		//the draw buffers are overwritten, so there's nothing to acquire back from the graphics queue
+		std::array<vk::BufferMemoryBarrier, 2> releaseBarriers;
+		releaseBarriers[0] = clearBarrier;
+		releaseBarriers[0].srcAccessMask = vk::AccessFlagBits::eShaderWrite;
+		releaseBarriers[0].dstAccessMask = vk::AccessFlags();
+		releaseBarriers[0].srcQueueFamilyIndex = computeFamilyIndex;
+		releaseBarriers[0].dstQueueFamilyIndex = graphicsFamilyIndex;
+		releaseBarriers[1] = releaseBarriers[0];
+		releaseBarriers[1].buffer = frame.drawCommandBuffer.buffer;
+		frame.computeCommandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eBottomOfPipe,
+			vk::DependencyFlags(), nullptr, releaseBarriers, nullptr
+		);
+
+		frame.computeCommandBuffer.end();
+	}
+	catch (vk::SystemError err) {
+		if (debugMode) {
+			std::cout << "Failed to record compute command buffer!" << std::endl;
+		}
+	}
+}
+
+/**
+* Acquire the draw buffers released by the compute queue, the submission waits on computeFinished
+*/
+void Engine::acquire_culling_results(vk::CommandBuffer commandBuffer) {
+
+	vkUtil::FrameContext& frame = frames[frameNumber];
+
+	std::array<vk::BufferMemoryBarrier, 2> acquireBarriers;
+	acquireBarriers[0].dstAccessMask = vk::AccessFlagBits::eIndirectCommandRead;
+	acquireBarriers[0].srcQueueFamilyIndex = computeFamilyIndex;
+	acquireBarriers[0].dstQueueFamilyIndex = graphicsFamilyIndex;
+	acquireBarriers[0].buffer = frame.drawCountBuffer.buffer;
+	acquireBarriers[0].offset = 0;
+	acquireBarriers[0].size = VK_WHOLE_SIZE;
+	acquireBarriers[1] = acquireBarriers[0];
+	acquireBarriers[1].buffer = frame.drawCommandBuffer.buffer;
+
+	commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eDrawIndirect, vk::PipelineStageFlagBits::eDrawIndirect,
+		vk::DependencyFlags(), nullptr, acquireBarriers, nullptr
+	);
+}
+
+void Engine::record_indirect_draws(vk::CommandBuffer commandBuffer, Scene* scene) {
+
+	vkUtil::FrameContext& frame = frames[frameNumber];
+	uint32_t objectCount = static_cast<uint32_t>(scene->get_object_count());
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, instancedPipeline);
+	commandBuffer.bindDescriptorSets(
+		vk::PipelineBindPoint::eGraphics, pipelineLayout,
+		0, frame.descriptorSet, nullptr
+	);
+	meshes.bind(commandBuffer);
+
+	if (featureSupport.drawIndirectCount) {
+		commandBuffer.drawIndexedIndirectCount(
+			frame.drawCommandBuffer.buffer, 0,
+			frame.drawCountBuffer.buffer, 0,
+			objectCount, sizeof(vk::DrawIndexedIndirectCommand)
+		);
+	}
+	else {
+		//culled objects were written with an instance count of zero
+		commandBuffer.drawIndexedIndirect(
+			frame.drawCommandBuffer.buffer, 0,
+			objectCount, sizeof(vk::DrawIndexedIndirectCommand)
+		);
+	}
+}
+
+/**
+* Cover the whole swapchain image, the pipelines take their viewport and scissor as dynamic state
+*/
+void Engine::record_viewport(vk::CommandBuffer commandBuffer) {
+
+	vk::Viewport viewport = {};
+	viewport.x = 0.0f;
+	viewport.y = 0.0f;
+	viewport.width = static_cast<float>(swapchainExtent.width);
+	viewport.height = static_cast<float>(swapchainExtent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	commandBuffer.setViewport(0, viewport);
+
+	vk::Rect2D scissor = {};
+	scissor.offset.x = 0;
+	scissor.offset.y = 0;
+	scissor.extent = swapchainExtent;
+	commandBuffer.setScissor(0, scissor);
+}
+
+/**
+* Start drawing into a swapchain image, clearing it, through the renderpass or with dynamic rendering
+*/
+void Engine::begin_rendering(vk::CommandBuffer commandBuffer, uint32_t imageIndex, bool secondaryCommandBuffers) {
+
+	vk::ClearValue clearColor = { std::array<float, 4>{1.0f, 0.5f, 0.25f, 1.0f} };
+
+	vk::Rect2D renderArea;
+	renderArea.offset.x = 0;
+	renderArea.offset.y = 0;
+	renderArea.extent = swapchainExtent;
+
+	if (dynamicRendering) {
+		//the render graph has already moved the image into the attachment layout
+		vk::RenderingAttachmentInfoKHR colorAttachment;
+		colorAttachment.imageView = swapchainFrames[imageIndex].imageView;
+		colorAttachment.imageLayout = vk::ImageLayout::eColorAttachmentOptimal;
+		colorAttachment.loadOp = vk::AttachmentLoadOp::eClear;
+		colorAttachment.storeOp = vk::AttachmentStoreOp::eStore;
+		colorAttachment.clearValue = clearColor;
+
+		vk::RenderingInfoKHR renderingInfo;
+		if (secondaryCommandBuffers) {
+			renderingInfo.flags = vk::RenderingFlagBitsKHR::eContentsSecondaryCommandBuffers;
+		}
+		renderingInfo.renderArea = renderArea;
+		renderingInfo.layerCount = 1;
+		renderingInfo.colorAttachmentCount = 1;
+		renderingInfo.pColorAttachments = &colorAttachment;
+		commandBuffer.beginRenderingKHR(renderingInfo, dldi);
+		return;
+	}
 
 	vk::RenderPassBeginInfo renderPassInfo = {};
 	renderPassInfo.renderPass = renderpass;
 	renderPassInfo.framebuffer = swapchainFrames[imageIndex].framebuffer;
-	renderPassInfo.renderArea.offset.x = 0;
-	renderPassInfo.renderArea.offset.y = 0;
-	renderPassInfo.renderArea.extent = swapchainExtent;
-
-	vk::ClearValue clearColor = { std::array<float, 4>{1.0f, 0.5f, 0.25f, 1.0f} };
+	renderPassInfo.renderArea = renderArea;
 	renderPassInfo.clearValueCount = 1;
 	renderPassInfo.pClearValues = &clearColor;
 
-	commandBuffer.beginRenderPass(&renderPassInfo, vk::SubpassContents::eInline);
+	commandBuffer.beginRenderPass(&renderPassInfo,
+		secondaryCommandBuffers ? vk::SubpassContents::eSecondaryCommandBuffers : vk::SubpassContents::eInline);
+}
 
-	commandBuffer.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+void Engine::end_rendering(vk::CommandBuffer commandBuffer) {
 
-	for (glm::vec3 position : scene->trianglePositions) {
+	if (dynamicRendering) {
+		commandBuffer.endRenderingKHR(dldi);
+	}
+	else {
+		commandBuffer.endRenderPass();
+	}
+}
 
-		glm::mat4 model = glm::translate(glm::mat4(1.0f), position);
-		vkUtil::ObjectData objectData;
-		objectData.model = model;
-		commandBuffer.pushConstants(
-			pipelineLayout, vk::ShaderStageFlagBits::eVertex,
-			0, sizeof(objectData), &objectData
-		);
+/**
+* Draw the scene into a swapchain image, in whichever way the render mode asks for
+*/
+void Engine::record_draw_pass(vk::CommandBuffer commandBuffer, uint32_t imageIndex, Scene* scene) {
+
+	//per-object draws can be spread over several threads, the other modes are a single draw call
+	if (renderMode == RenderMode::PerObject && recordingPool) {
+		//secondary buffers would have to inherit the statistics query, so only time them
+		uint32_t drawScope = gpuProfiler->begin_scope(commandBuffer, "draws");
+		begin_rendering(commandBuffer, imageIndex, true);
+		record_parallel_draws(commandBuffer, imageIndex, scene);
+		end_rendering(commandBuffer);
+		gpuProfiler->end_scope(commandBuffer, drawScope);
+	}
+	else {
+		uint32_t drawScope = gpuProfiler->begin_scope(commandBuffer, "draws", true);
+		begin_rendering(commandBuffer, imageIndex, false);
+		record_viewport(commandBuffer);
+		//every mode's draws index the one table, whatever their materials
+		bindless->bind(commandBuffer, vk::PipelineBindPoint::eGraphics, pipelineLayout, 1);
+
+		switch (renderMode) {
+		case RenderMode::GpuDriven:
+			record_indirect_draws(commandBuffer, scene);
+			break;
+		case RenderMode::Instanced:
+			record_instanced_draws(commandBuffer, scene);
+			break;
+		default:
+			record_per_object_draws(commandBuffer, scene, 0, scene->get_object_count());
+		}
 
-		commandBuffer.draw(3, 1, 0, 0);
+		end_rendering(commandBuffer);
+		gpuProfiler->end_scope(commandBuffer, drawScope);
+	}
+}
+
+void Engine::record_draw_commands(vk::CommandBuffer commandBuffer, uint32_t imageIndex, Scene* scene) {
+
+	PROFILE_FUNCTION();
+
+	vk::CommandBufferBeginInfo beginInfo = {};
+
+	try {
+		commandBuffer.begin(beginInfo);
+	}
+	catch (vk::SystemError err) {
+		if (debugMode) {
+			std::cout << "Failed to begin recording command buffer!" << std::endl;
+		}
+	}
+
+	//submitted uploads are handed over to the graphics queue before anything uses them
+	frames[frameNumber].uploadWait = uploads->record_acquires(commandBuffer);
+
+	gpuProfiler->begin_frame(commandBuffer, static_cast<uint32_t>(frameNumber));
+
+	vkUtil::FrameContext& frame = frames[frameNumber];
+	vkUtil::RenderGraph& graph = *frame.graph;
+	graph.begin();
 
+	//the profiler's queries belong to the graphics queue, so only inline culling is timed
+	frame.asyncCompute = renderMode == RenderMode::GpuDriven && asyncComputeEnabled && is_async_compute_supported();
+	if (frame.asyncCompute) {
+		record_async_culling(scene);
+		acquire_culling_results(commandBuffer);
 	}
 
-	commandBuffer.endRenderPass();
+	vkUtil::RenderResource drawCommands = 0;
+	vkUtil::RenderResource drawCount = 0;
+	if (renderMode == RenderMode::GpuDriven) {
+		drawCommands = graph.import_buffer("draw commands", frame.drawCommandBuffer.buffer);
+		drawCount = graph.import_buffer("draw count", frame.drawCountBuffer.buffer);
+	}
+
+	if (renderMode == RenderMode::GpuDriven && !frame.asyncCompute) {
+		//reset the draw count before the culling shader starts appending to it
+		uint32_t clear = graph.add_pass("clear draw count",
+			[drawCount](vk::CommandBuffer commandBuffer, const vkUtil::RenderGraph& resources) {
+				commandBuffer.fillBuffer(resources.get_buffer(drawCount), 0, sizeof(uint32_t), 0);
+			});
+		graph.use(clear, drawCount, vkUtil::RenderAccess::TransferWrite);
+
+		uint32_t cull = graph.add_pass("culling",
+			[this, scene](vk::CommandBuffer commandBuffer, const vkUtil::RenderGraph&) {
+				uint32_t cullScope = gpuProfiler->begin_scope(commandBuffer, "culling");
+				record_culling(commandBuffer, scene);
+				gpuProfiler->end_scope(commandBuffer, cullScope);
+			});
+		graph.use(cull, drawCount, vkUtil::RenderAccess::StorageWrite);
+		graph.use(cull, drawCommands, vkUtil::RenderAccess::StorageWrite);
+	}
+
+	//a renderpass transitions the swapchain image itself, so the graph can't see what the draws write.
+	//with dynamic rendering the graph moves the image into the attachment layout and back out.
+	uint32_t draws = graph.add_pass("draws",
+		[this, imageIndex, scene](vk::CommandBuffer commandBuffer, const vkUtil::RenderGraph&) {
+			record_draw_pass(commandBuffer, imageIndex, scene);
+		}, !dynamicRendering);
+	if (dynamicRendering) {
+		//offscreen images are copied from rather than presented
+		vkUtil::RenderResource target = graph.import_image(
+			"swapchain image", swapchainFrames[imageIndex].image, swapchainFrames[imageIndex].imageView,
+			vk::ImageLayout::eUndefined, headless ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::ePresentSrcKHR
+		);
+		graph.use(draws, target, vkUtil::RenderAccess::ColorAttachment);
+	}
+	if (renderMode == RenderMode::GpuDriven) {
+		graph.use(draws, drawCommands, vkUtil::RenderAccess::IndirectRead);
+		graph.use(draws, drawCount, vkUtil::RenderAccess::IndirectRead);
+	}
+
+	//the topology only changes with the render mode or backend, so this is almost always a no-op
+	graph.compile();
+	graph.execute(commandBuffer);
+
+	gpuProfiler->end_frame(commandBuffer);
 
 	try {
 		commandBuffer.end();
@@ -214,55 +1136,134 @@ void Engine::record_draw_commands(vk::CommandBuffer commandBuffer, uint32_t imag
 
 void Engine::render(Scene* scene) {
 
-	device.waitForFences(1, &(swapchainFrames[frameNumber].inFlight), VK_TRUE, UINT64_MAX);
-	device.resetFences(1, &(swapchainFrames[frameNumber].inFlight));
+	PROFILE_FUNCTION();
 
-	//acquireNextImageKHR(vk::SwapChainKHR, timeout, semaphore_to_signal, fence)
-	uint32_t imageIndex;
-	try {
-		vk::ResultValue acquire = device.acquireNextImageKHR(
-			swapchain, UINT64_MAX,
-			swapchainFrames[frameNumber].imageAvailable, nullptr
-		);
-		imageIndex = acquire.value;
+	vkUtil::FrameContext& frame = frames[frameNumber];
+
+	//the context's last frame must be done before its command pool and buffers are reused
+	{
+		PROFILE_SCOPE("wait for frame");
+		timeline->wait(frame.timelineValue);
 	}
-	catch (vk::OutOfDateKHRError error) {
-		std::cout << "Recreate" << std::endl;
-		recreate_swapchain();
-		return;
+
+	if (frame.submitTime) {
+		auto completed = std::chrono::high_resolution_clock::now();
+		frameLatency = std::chrono::duration<double, std::milli>(completed - frame.submitTime.value()).count();
+		gpuProfiler->collect(static_cast<uint32_t>(frameNumber), frame.timelineValue);
 	}
-	catch (vk::IncompatibleDisplayKHRError error) {
-		std::cout << "Recreate" << std::endl;
-		recreate_swapchain();
-		return;
+
+	deletionQueue.flush(timeline->completed_value());
+
+	uint32_t imageIndex = 0;
+	if (headless) {
+		//no swapchain, each frame context has an offscreen image to itself
+		imageIndex = static_cast<uint32_t>(frameNumber);
 	}
-	catch (vk::SystemError error) {
-		std::cout << "Failed to acquire swapchain image!" << std::endl;
+	else {
+		//acquireNextImageKHR(vk::SwapChainKHR, timeout, semaphore_to_signal, fence)
+		try {
+			vk::ResultValue acquire = device.acquireNextImageKHR(
+				swapchain, UINT64_MAX,
+				frame.imageAvailable, nullptr
+			);
+			imageIndex = acquire.value;
+		}
+		catch (vk::OutOfDateKHRError error) {
+			std::cout << "Recreate" << std::endl;
+			recreate_swapchain();
+			return;
+		}
+		catch (vk::IncompatibleDisplayKHRError error) {
+			std::cout << "Recreate" << std::endl;
+			recreate_swapchain();
+			return;
+		}
+		catch (vk::SystemError error) {
+			std::cout << "Failed to acquire swapchain image!" << std::endl;
+		}
 	}
 
-	vk::CommandBuffer commandBuffer = swapchainFrames[frameNumber].commandBuffer;
+	auto frameStart = std::chrono::high_resolution_clock::now();
 
-	commandBuffer.reset();
+	device.resetCommandPool(frame.commandPool);
+	frame.arena->reset();
+	frame.descriptors->reset();
+	vk::CommandBuffer commandBuffer = frame.commandBuffer;
 
-	record_draw_commands(commandBuffer, imageIndex, scene);
+	{
+		PROFILE_SCOPE("record commands");
+		auto recordStart = std::chrono::high_resolution_clock::now();
+		prepare_frame(scene);
+		record_draw_commands(commandBuffer, imageIndex, scene);
+		auto recordEnd = std::chrono::high_resolution_clock::now();
+		recordTime = std::chrono::duration<double, std::milli>(recordEnd - recordStart).count();
+	}
+
+	frame.timelineValue = timeline->next_value();
+
+	//culling goes first, the graphics submission waits for it
+	if (frame.asyncCompute) {
+		vk::SubmitInfo computeSubmitInfo = {};
+		computeSubmitInfo.commandBufferCount = 1;
+		computeSubmitInfo.pCommandBuffers = &frame.computeCommandBuffer;
+		computeSubmitInfo.signalSemaphoreCount = 1;
+		computeSubmitInfo.pSignalSemaphores = &frame.computeFinished;
+		try {
+			computeQueue.submit(computeSubmitInfo, nullptr);
+		}
+		catch (vk::SystemError err) {
+			if (debugMode) {
+				std::cout << "failed to submit compute command buffer!" << std::endl;
+			}
+		}
+	}
 
 	vk::SubmitInfo submitInfo = {};
 
-	vk::Semaphore waitSemaphores[] = { swapchainFrames[frameNumber].imageAvailable };
-	vk::PipelineStageFlags waitStages[] = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = waitSemaphores;
-	submitInfo.pWaitDstStageMask = waitStages;
+	//headless frames have no image to wait for and nothing to present
+	uint32_t firstSemaphore = headless ? 1 : 0;
+
+	//binary semaphores ignore their values.
+	//new uploads and culling results are waited for only by the stages which use them
+	std::array<vk::Semaphore, 3> waitSemaphores;
+	std::array<vk::PipelineStageFlags, 3> waitStages;
+	std::array<uint64_t, 3> waitValues = {};
+	uint32_t waitCount = 0;
+	if (!headless) {
+		waitSemaphores[waitCount] = frame.imageAvailable;
+		waitStages[waitCount++] = vk::PipelineStageFlagBits::eColorAttachmentOutput;
+	}
+	if (frame.uploadWait.value > 0) {
+		waitSemaphores[waitCount] = uploads->get_semaphore();
+		waitStages[waitCount] = frame.uploadWait.stages;
+		waitValues[waitCount++] = frame.uploadWait.value;
+	}
+	if (frame.asyncCompute) {
+		waitSemaphores[waitCount] = frame.computeFinished;
+		waitStages[waitCount++] = vk::PipelineStageFlagBits::eDrawIndirect;
+	}
+	submitInfo.waitSemaphoreCount = waitCount;
+	submitInfo.pWaitSemaphores = waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = waitStages.data();
 
 	submitInfo.commandBufferCount = 1;
 	submitInfo.pCommandBuffers = &commandBuffer;
 
-	vk::Semaphore signalSemaphores[] = { swapchainFrames[frameNumber].renderFinished };
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = signalSemaphores;
+	//indexed by image, the semaphore can't be reused until that image is presented again
+	vk::Semaphore signalSemaphores[] = { swapchainFrames[imageIndex].renderFinished, timeline->get_semaphore() };
+	submitInfo.signalSemaphoreCount = 2 - firstSemaphore;
+	submitInfo.pSignalSemaphores = signalSemaphores + firstSemaphore;
+
+	uint64_t signalValues[] = { 0, frame.timelineValue };
+	vk::TimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.waitSemaphoreValueCount = submitInfo.waitSemaphoreCount;
+	timelineInfo.pWaitSemaphoreValues = waitValues.data();
+	timelineInfo.signalSemaphoreValueCount = submitInfo.signalSemaphoreCount;
+	timelineInfo.pSignalSemaphoreValues = signalValues + firstSemaphore;
+	submitInfo.pNext = &timelineInfo;
 
 	try {
-		graphicsQueue.submit(submitInfo, swapchainFrames[frameNumber].inFlight);
+		graphicsQueue.submit(submitInfo, nullptr);
 	}
 	catch (vk::SystemError err) {
 
@@ -270,10 +1271,17 @@ void Engine::render(Scene* scene) {
 			std::cout << "failed to submit draw command buffer!" << std::endl;
 		}
 	}
+	frame.submitTime = frameStart;
+	frameNumber = static_cast<int>(timeline->last_submitted() % framesInFlight);
+	lastImageIndex = imageIndex;
+
+	if (headless) {
+		return;
+	}
 
 	vk::PresentInfoKHR presentInfo = {};
 	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = signalSemaphores;
+	presentInfo.pWaitSemaphores = &swapchainFrames[imageIndex].renderFinished;
 
 	vk::SwapchainKHR swapChains[] = { swapchain };
 	presentInfo.swapchainCount = 1;
@@ -284,6 +1292,7 @@ void Engine::render(Scene* scene) {
 	vk::Result present;
 
 	try {
+		PROFILE_SCOPE("present");
 		present = presentQueue.presentKHR(presentInfo);
 	}
 	catch (vk::OutOfDateKHRError error) {
@@ -296,8 +1305,73 @@ void Engine::render(Scene* scene) {
 		return;
 	}
 
-	frameNumber = (frameNumber + 1) % maxFramesInFlight;
+}
+
+void Engine::set_profiling(bool capture, bool pipelineStatistics) {
+
+	CpuProfiler::get().set_capture(capture);
+	gpuProfiler->set_capture(capture);
+	gpuProfiler->set_pipeline_statistics(pipelineStatistics);
+}
+
+bool Engine::save_trace(const std::string& filename) {
+
+	//the frames still in flight haven't been collected yet, gather them oldest first
+	timeline->wait(timeline->last_submitted());
+	std::vector<int> pending;
+	for (int i = 0; i < framesInFlight; ++i) {
+		if (frames[i].timelineValue > gpuProfiler->get_frame_index()) {
+			pending.push_back(i);
+		}
+	}
+	std::sort(pending.begin(), pending.end(), [this](int a, int b) {
+		return frames[a].timelineValue < frames[b].timelineValue;
+	});
+	for (int i : pending) {
+		gpuProfiler->collect(static_cast<uint32_t>(i), frames[i].timelineValue);
+	}
+
+	//the cpu profiler's scopes, which are only recorded in builds with ENABLE_PROFILING, share the file
+	std::vector<vkUtil::TraceEvent> events = CpuProfiler::get().take_captured_events();
+	std::vector<vkUtil::TraceEvent> gpuEvents = gpuProfiler->take_captured_events();
+	events.insert(events.end(), std::make_move_iterator(gpuEvents.begin()), std::make_move_iterator(gpuEvents.end()));
+
+	std::vector<std::string> threadNames(vkUtil::gpuTraceThreadId + 1);
+	threadNames[vkUtil::gpuTraceThreadId] = "gpu";
+	for (auto& [threadId, name] : CpuProfiler::get().get_thread_names()) {
+		threadNames.resize(std::max<size_t>(threadNames.size(), threadId + 1));
+		threadNames[threadId] = std::move(name);
+	}
 
+	bool saved = vkUtil::write_chrome_trace(filename, events, threadNames);
+	if (debugMode) {
+		std::cout << (saved ? "Saved trace to " : "Failed to save trace to ") << filename << '\n';
+	}
+	return saved;
+}
+
+bool Engine::save_frame(const std::string& filename) {
+
+	if (!headless) {
+		if (debugMode) {
+			std::cout << "Only headless frames can be saved\n";
+		}
+		return false;
+	}
+
+	timeline->wait(timeline->last_submitted());
+
+	vkUtil::ReadbackInput readbackInput = {
+		device, graphicsQueue, mainCommandBuffer, *allocator,
+		swapchainFrames[lastImageIndex].image, swapchainExtent
+	};
+	std::vector<uint8_t> pixels = vkUtil::read_back_image(readbackInput);
+
+	bool saved = vkUtil::write_ppm(filename, pixels, swapchainExtent.width, swapchainExtent.height);
+	if (debugMode) {
+		std::cout << (saved ? "Saved frame to " : "Failed to save frame to ") << filename << '\n';
+	}
+	return saved;
 }
 
 /**
@@ -305,14 +1379,19 @@ void Engine::render(Scene* scene) {
 */
 void Engine::cleanup_swapchain() {
 
-	for (vkUtil::SwapChainFrame frame : swapchainFrames) {
+	destroy_swapchain_frames(swapchainFrames, swapchain);
+
+}
+
+void Engine::destroy_swapchain_frames(std::vector<vkUtil::SwapChainFrame>& oldFrames, vk::SwapchainKHR oldSwapchain) {
+
+	for (vkUtil::SwapChainFrame& frame : oldFrames) {
 		device.destroyImageView(frame.imageView);
 		device.destroyFramebuffer(frame.framebuffer);
-		device.destroyFence(frame.inFlight);
-		device.destroySemaphore(frame.imageAvailable);
 		device.destroySemaphore(frame.renderFinished);
+		allocator->destroy_image(frame.offscreenImage);
 	}
-	device.destroySwapchainKHR(swapchain);
+	device.destroySwapchainKHR(oldSwapchain);
 
 }
 
@@ -324,17 +1403,36 @@ Engine::~Engine() {
 		std::cout << "Goodbye see you!\n";
 	}
 
-	device.destroyCommandPool(commandPool);
+	vkUtil::save_pipeline_cache(device, physicalDevice, pipelineCache, "pipeline_cache.bin", debugMode);
+	device.destroyPipelineCache(pipelineCache);
 
-	device.destroyPipeline(pipeline);
+	destroy_graphics_pipelines();
 	device.destroyPipelineLayout(pipelineLayout);
-	device.destroyRenderPass(renderpass);
+	device.destroyPipeline(cullPipeline);
+	device.destroyPipelineLayout(cullPipelineLayout);
+	mipGenerator.reset();
 
+	gpuProfiler.reset();
+
+	deletionQueue.flush_all();
 	cleanup_swapchain();
+	destroy_frame_contexts();
+
+	device.destroyCommandPool(commandPool);
+
+	meshes.destroy(*allocator);
+	unload_textures();
+	bindless.reset();
+	descriptorLayouts.reset();
+	uploads.reset();
+	allocator.reset();
+	timeline.reset();
 
 	device.destroy();
 
-	instance.destroySurfaceKHR(surface);
+	if (!headless) {
+		instance.destroySurfaceKHR(surface);
+	}
 	if (debugMode) {
 		instance.destroyDebugUtilsMessengerEXT(debugMessenger, nullptr, dldi);
 	}
@@ -1,7 +1,16 @@
 #pragma once
 #include "vulkan/vulkan.hpp"
 #include "frame.h"
+#include "timeline.h"
+#include "gpu_profiler.h"
+#include "upload.h"
+#include "mesh.h"
+#include "texture.h"
+#include "mipmaps.h"
+#include "bindless.h"
+#include "device.h"
 #include "scene.h"
+#include "thread_pool.h"
 /*
 * including the prebuilt header from the lunarg sdk will load
 * most functions, but not all.
@@ -21,6 +30,18 @@
 	We will look at this later, once we've created an instance and device.
 */
 
+/**
+	How the scene's objects are submitted to the gpu.
+*/
+enum class RenderMode {
+	//one dynamic uniform offset + draw call per object
+	PerObject,
+	//transforms are written to a storage buffer, one draw call for the whole scene
+	Instanced,
+	//a compute pass culls the scene and writes the indirect draws
+	GpuDriven
+};
+
 class Engine {
 
 public:
@@ -31,10 +52,143 @@ public:
 
 	void render(Scene* scene);
 
+	void set_render_mode(RenderMode mode);
+	RenderMode get_render_mode() const { return renderMode; }
+
+	//time spent recording the last frame's command buffer, in milliseconds
+	double get_record_time() const { return recordTime; }
+
+	/**
+		Import a model's meshes into the mesh library, re-uploading the library.
+		Mesh 0 is a built in triangle.
+
+		\param filename the path to the model
+		\returns the indices of the imported meshes, for Scene::mesh
+	*/
+	std::vector<uint32_t> load_model(const std::string& filename);
+
+	/**
+		Decode images in parallel and upload them as textures, then generate their
+		mip chains on the graphics queue, waiting for it to finish.
+
+		\param filenames the paths to the images
+		\param threadCount how many threads decode
+		\returns the index of each file's texture, in order, for Material::baseColorTexture.
+			Files which failed to load or didn't fit in the bindless table get vkUtil::noTexture
+	*/
+	std::vector<uint32_t> load_textures(const std::vector<std::string>& filenames, int threadCount);
+	const vkUtil::TextureLoadStats& get_texture_load_stats() const { return textureLoadStats; }
+	/**
+		Set how textures loaded from now on get their mip chains. The compute mode
+		falls back to blitting if the device can't run it.
+	*/
+	void set_mip_mode(vkUtil::MipMode mode);
+	vkUtil::MipMode get_mip_mode() const { return mipMode; }
+	//gpu timings of the last load_textures call's mip generation
+	const vkUtil::MipStats& get_mip_stats() const { return mipStats; }
+	//wait for the device, then destroy every texture. Materials using them mustn't be drawn again.
+	void unload_textures();
+
+	/**
+		Add a material to the bindless table. Scenes pick materials per object
+		without affecting how their draws are batched.
+
+		\param material the material, its texture index from load_textures
+		\returns the index of the material, for Scene::materials
+	*/
+	uint32_t add_material(const vkUtil::Material& material);
+
+	/**
+		Split per-object recording across worker threads, each recording a
+		secondary command buffer. One thread records inline into the primary buffer.
+	*/
+	void set_recording_threads(int threadCount);
+	int get_recording_threads() const { return recordingThreads; }
+
+	//time taken to build the pipelines at startup, in milliseconds
+	double get_pipeline_creation_time() const { return pipelineCreationTime; }
+	//whether a valid pipeline cache was loaded from disk at startup
+	bool is_pipeline_cache_warm() const { return pipelineCacheWarm; }
+
+	/**
+		Render with VK_KHR_dynamic_rendering, naming the swapchain image as each frame is recorded,
+		instead of through a renderpass and a framebuffer per image. Resizing then makes no
+		framebuffers, and pipelines only depend on the attachment formats. On by default where
+		supported, changing it waits for the device and remakes the graphics pipelines.
+	*/
+	void set_dynamic_rendering(bool enabled);
+	bool is_dynamic_rendering() const { return dynamicRendering; }
+	bool is_dynamic_rendering_supported() const { return featureSupport.dynamicRendering; }
+
+	/**
+		Wait for the device to go idle before recreating the swapchain, rather than
+		handing the old swapchain over and retiring its frames as they complete.
+	*/
+	void set_blocking_swapchain_recreation(bool blocking) { blockingRecreation = blocking; }
+	/**
+		Set how many frames the cpu may record ahead of the gpu. More frames
+		trade latency for throughput.
+	*/
+	void set_frames_in_flight(int count);
+	int get_frames_in_flight() const { return framesInFlight; }
+	/**
+		Run gpu driven culling on the async compute queue, overlapping it with the
+		graphics queue. Has no effect unless the device has a separate compute family.
+	*/
+	void set_async_compute(bool enabled) { asyncComputeEnabled = enabled; }
+	bool is_async_compute_supported() const { return computeFamilyIndex != graphicsFamilyIndex; }
+	/**
+		Time from the cpu starting a frame until the gpu was seen to finish it, in milliseconds.
+		This is only checked when the frame context comes round again, so it is exact
+		when gpu bound and an upper bound otherwise.
+	*/
+	double get_frame_latency() const { return frameLatency; }
+	//times the frame contexts' render graphs have been compiled, which should only follow a change of passes
+	size_t get_render_graph_compile_count() const;
+
+	//frames submitted so far, which is also the index of the last one
+	uint64_t get_frame_index() const { return timeline->last_submitted(); }
+	//gpu time of the last frame whose timestamps have been read back, in milliseconds
+	double get_gpu_frame_time() const { return gpuProfiler->get_frame_time(); }
+	//which frame get_gpu_frame_time refers to, counting from 1. Zero if there are no timestamps yet.
+	uint64_t get_gpu_frame_index() const { return gpuProfiler->get_frame_index(); }
+
+	/**
+		Start or stop capturing a trace of cpu and gpu scopes.
+
+		\param capture whether to keep every frame's scopes
+		\param pipelineStatistics whether to count shader invocations in the draw scope
+	*/
+	void set_profiling(bool capture, bool pipelineStatistics);
+
+	/**
+		Wait for the submitted frames, then write everything captured so far,
+		the gpu scopes and the cpu profiler's, to one Chrome trace JSON file.
+
+		\param filename the path to write to
+		\returns whether the trace was written
+	*/
+	bool save_trace(const std::string& filename);
+
+	/**
+		Wait for the last frame to finish, then write it to a PPM file.
+		Only available when rendering headless.
+
+		\param filename the path to write to
+		\returns whether the frame was saved
+	*/
+	bool save_frame(const std::string& filename);
+
+	//time taken by the last swapchain recreation, in milliseconds
+	double get_swapchain_recreate_time() const { return swapchainRecreateTime; }
+	int get_swapchain_recreate_count() const { return swapchainRecreateCount; }
+
 private:
 
 	//whether to print debug messages in functions
 	bool debugMode = true;
+	//no window, surface or swapchain, frames are rendered to offscreen images
+	bool headless = false;
 
 	//glfw window parameters
 	int width;
@@ -52,23 +206,83 @@ private:
 	vk::Device device{nullptr};
 	vk::Queue graphicsQueue{nullptr};
 	vk::Queue presentQueue{nullptr};
+	vk::Queue transferQueue{nullptr};
+	vk::Queue computeQueue{nullptr};
+	uint32_t graphicsFamilyIndex = 0;
+	uint32_t computeFamilyIndex = 0;
+	vkInit::DeviceFeatureSupport featureSupport;
+	std::unique_ptr<vkUtil::MemoryAllocator> allocator;
+	//copies data into device local resources on the transfer queue
+	std::unique_ptr<vkUtil::UploadManager> uploads;
+	//signalled with the frame's number by each frame's submission
+	std::unique_ptr<vkUtil::Timeline> timeline;
+	//objects destroyed once the frames that may use them complete
+	vkUtil::DeletionQueue deletionQueue;
 	vk::SwapchainKHR swapchain;
 	std::vector<vkUtil::SwapChainFrame> swapchainFrames;
+	std::vector<vkUtil::FrameContext> frames;
 	vk::Format swapchainFormat;
 	vk::Extent2D swapchainExtent;
 
+	bool blockingRecreation = false;
+	double swapchainRecreateTime = 0.0;
+	int swapchainRecreateCount = 0;
 
 	//pipeline-related variables
+	vk::PipelineCache pipelineCache;
+	bool pipelineCacheWarm = false;
+	double pipelineCreationTime = 0.0;
 	vk::PipelineLayout pipelineLayout;
+	//null with dynamic rendering, as are the swapchain frames' framebuffers
 	vk::RenderPass renderpass;
+	bool dynamicRendering = false;
 	vk::Pipeline pipeline;
+	vk::Pipeline instancedPipeline;
+	vk::PipelineLayout cullPipelineLayout;
+	vk::Pipeline cullPipeline;
+	std::unique_ptr<vkUtil::MipGenerator> mipGenerator;
+
+	//descriptor-related variables, every layout is owned by the cache
+	std::unique_ptr<vkUtil::DescriptorLayoutCache> descriptorLayouts;
+	vk::DescriptorSetLayout descriptorSetLayout;
+	//every texture and material, set 1 of the graphics pipelines
+	std::unique_ptr<vkUtil::BindlessTable> bindless;
+	vk::DescriptorSetLayout cullDescriptorSetLayout;
+	//per-object draws read their ObjectData from the frame's arena, at this stride
+	vk::DescriptorSetLayout objectDescriptorSetLayout;
+	vk::DeviceSize objectDataStride = 0;
+	//how many objects' data a recording thread claims from the arena at once
+	static constexpr size_t objectsPerChunk = 512;
+
+	//asset related variables, every mesh is in one vertex and one index buffer
+	vkUtil::MeshLibrary meshes;
+	std::vector<vkUtil::Texture> textures;
+	vkUtil::TextureLoadStats textureLoadStats;
+	vkUtil::MipMode mipMode = vkUtil::MipMode::Compute;
+	vkUtil::MipStats mipStats;
+
+	RenderMode renderMode = RenderMode::Instanced;
+	double recordTime = 0.0;
+	bool asyncComputeEnabled = true;
+
+	//multithreaded recording
+	int recordingThreads = 1;
+	std::unique_ptr<ThreadPool> recordingPool;
 
 
 	//command related variables
 	vk::CommandPool commandPool;
 	vk::CommandBuffer mainCommandBuffer;
 
-	int maxFramesInFlight, frameNumber;
+	int framesInFlight = 2;
+	int frameNumber;
+	//the image the last submitted frame rendered to
+	uint32_t lastImageIndex = 0;
+
+	double frameLatency = 0.0;
+
+	//profiling
+	std::unique_ptr<vkUtil::GpuProfiler> gpuProfiler;
 
 
 
@@ -77,15 +291,36 @@ private:
 	/*void make_debug_messenger();*/
 
 	void make_device();
-	void make_swapchain();
+	void make_swapchain(vk::SwapchainKHR oldSwapchain);
 	void recreate_swapchain();
 	
+	void make_descriptor_set_layouts();
 	void make_pipeline();
+	void make_graphics_pipelines();
+	void destroy_graphics_pipelines();
 
 	void finalize_setup();
+	void make_assets();
+	void generate_mips(const std::vector<vkUtil::Texture>& loaded);
 	void record_draw_commands(vk::CommandBuffer commandBuffer, uint32_t imageIndex, Scene* scene);
+	void record_draw_pass(vk::CommandBuffer commandBuffer, uint32_t imageIndex, Scene* scene);
+	void begin_rendering(vk::CommandBuffer commandBuffer, uint32_t imageIndex, bool secondaryCommandBuffers);
+	void end_rendering(vk::CommandBuffer commandBuffer);
+	void record_viewport(vk::CommandBuffer commandBuffer);
 	void make_framebuffers();
-	void make_frame_sync_objects();
+	void make_swapchain_sync_objects();
+	void make_frame_contexts();
+	void destroy_frame_contexts();
+	void prepare_frame(Scene* scene);
+	void make_worker_commands();
+	void record_per_object_draws(vk::CommandBuffer commandBuffer, Scene* scene, size_t first, size_t last);
+	void record_parallel_draws(vk::CommandBuffer commandBuffer, uint32_t imageIndex, Scene* scene);
+	void record_instanced_draws(vk::CommandBuffer commandBuffer, Scene* scene);
+	void record_culling(vk::CommandBuffer commandBuffer, Scene* scene);
+	void record_async_culling(Scene* scene);
+	void acquire_culling_results(vk::CommandBuffer commandBuffer);
+	void record_indirect_draws(vk::CommandBuffer commandBuffer, Scene* scene);
 
+	void destroy_swapchain_frames(std::vector<vkUtil::SwapChainFrame>& oldFrames, vk::SwapchainKHR oldSwapchain);
 	void cleanup_swapchain();
 };
\ No newline at end of file
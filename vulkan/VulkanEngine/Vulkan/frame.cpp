@@ -0,0 +1,134 @@
+#include "pch.h"
+#include "frame.h"
+
+bool vkUtil::FrameContext::make_descriptor_resources(MemoryAllocator& allocator, size_t objectCount,
+	const std::vector<uint32_t>& queueFamilies) {
+
+	if (objectCount <= modelBufferCapacity && modelBuffer.buffer) {
+		return false;
+	}
+
+	//grow geometrically so a slowly growing scene doesn't reallocate every frame
+	size_t capacity = std::max<size_t>(objectCount, 2 * modelBufferCapacity);
+	capacity = std::max<size_t>(capacity, 1);
+
+	destroy_descriptor_resources(allocator);
+
+	BufferInputChunk input;
+	input.memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+	input.size = capacity * sizeof(glm::mat4);
+	input.usage = vk::BufferUsageFlagBits::eStorageBuffer;
+	//rewritten by the host every frame, so it's shared rather than passed between queues
+	input.queueFamilies = queueFamilies;
+	modelBuffer = allocator.create_buffer(input);
+
+	//persistently mapped, the frame's timeline value guards writes
+	modelBufferWriteLocation = modelBuffer.allocation.mapped;
+	modelBufferCapacity = capacity;
+
+	modelBufferDescriptor.buffer = modelBuffer.buffer;
+	modelBufferDescriptor.offset = 0;
+	modelBufferDescriptor.range = input.size;
+
+	//only the graphics queue reads materials
+	input.queueFamilies.clear();
+	input.size = capacity * sizeof(uint32_t);
+	objectMaterialBuffer = allocator.create_buffer(input);
+	objectMaterialWriteLocation = static_cast<uint32_t*>(objectMaterialBuffer.allocation.mapped);
+
+	//written by the culling shader, read as indirect draws
+	input.memoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
+	input.size = capacity * sizeof(vk::DrawIndexedIndirectCommand);
+	input.usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer;
+	drawCommandBuffer = allocator.create_buffer(input);
+
+	input.size = sizeof(uint32_t);
+	input.usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eIndirectBuffer | vk::BufferUsageFlagBits::eTransferDst;
+	drawCountBuffer = allocator.create_buffer(input);
+
+	uploadedSceneGeneration = 0;
+
+	return true;
+}
+
+void vkUtil::FrameContext::write_descriptor_set(vk::Device logicalDevice, vk::DescriptorSetLayout layout,
+	vk::DescriptorSetLayout cullLayout) {
+
+	descriptorSet = descriptors->allocate(layout);
+	cullDescriptorSet = descriptors->allocate(cullLayout);
+	if (!descriptorSet || !cullDescriptorSet) {
+		return;
+	}
+
+	//binding 0: transforms, binding 1: material indices
+	vk::DescriptorBufferInfo bufferInfo[2];
+	bufferInfo[0] = modelBufferDescriptor;
+	bufferInfo[1] = vk::DescriptorBufferInfo(objectMaterialBuffer.buffer, 0, VK_WHOLE_SIZE);
+
+	std::array<vk::WriteDescriptorSet, 2> writes;
+	for (uint32_t i = 0; i < 2; ++i) {
+		writes[i].dstSet = descriptorSet;
+		writes[i].dstBinding = i;
+		writes[i].dstArrayElement = 0;
+		writes[i].descriptorCount = 1;
+		writes[i].descriptorType = vk::DescriptorType::eStorageBuffer;
+		writes[i].pBufferInfo = &bufferInfo[i];
+	}
+
+	logicalDevice.updateDescriptorSets(writes, nullptr);
+
+	//binding 0: transforms, binding 1: draw commands, binding 2: draw count
+	vk::DescriptorBufferInfo cullBufferInfo[3];
+	cullBufferInfo[0] = modelBufferDescriptor;
+	cullBufferInfo[1] = vk::DescriptorBufferInfo(drawCommandBuffer.buffer, 0, VK_WHOLE_SIZE);
+	cullBufferInfo[2] = vk::DescriptorBufferInfo(drawCountBuffer.buffer, 0, VK_WHOLE_SIZE);
+
+	std::array<vk::WriteDescriptorSet, 3> cullWrites;
+	for (uint32_t i = 0; i < 3; ++i) {
+		cullWrites[i].dstSet = cullDescriptorSet;
+		cullWrites[i].dstBinding = i;
+		cullWrites[i].dstArrayElement = 0;
+		cullWrites[i].descriptorCount = 1;
+		cullWrites[i].descriptorType = vk::DescriptorType::eStorageBuffer;
+		cullWrites[i].pBufferInfo = &cullBufferInfo[i];
+	}
+
+	logicalDevice.updateDescriptorSets(cullWrites, nullptr);
+}
+
+void vkUtil::FrameContext::write_object_descriptor_set(vk::Device logicalDevice, vk::DescriptorSetLayout layout,
+	vk::DeviceSize range) {
+
+	objectDescriptorSet = descriptors->allocate(layout);
+	if (!objectDescriptorSet) {
+		return;
+	}
+
+	//each draw picks its data out of the arena with a dynamic offset
+	vk::DescriptorBufferInfo bufferInfo(arena->get_buffer(), 0, range);
+
+	vk::WriteDescriptorSet writeInfo;
+	writeInfo.dstSet = objectDescriptorSet;
+	writeInfo.dstBinding = 0;
+	writeInfo.dstArrayElement = 0;
+	writeInfo.descriptorCount = 1;
+	writeInfo.descriptorType = vk::DescriptorType::eUniformBufferDynamic;
+	writeInfo.pBufferInfo = &bufferInfo;
+
+	logicalDevice.updateDescriptorSets(writeInfo, nullptr);
+}
+
+void vkUtil::FrameContext::destroy_descriptor_resources(MemoryAllocator& allocator) {
+
+	if (!modelBuffer.buffer) {
+		return;
+	}
+
+	allocator.destroy_buffer(modelBuffer);
+	allocator.destroy_buffer(objectMaterialBuffer);
+	allocator.destroy_buffer(drawCommandBuffer);
+	allocator.destroy_buffer(drawCountBuffer);
+	modelBufferWriteLocation = nullptr;
+	objectMaterialWriteLocation = nullptr;
+	modelBufferCapacity = 0;
+}
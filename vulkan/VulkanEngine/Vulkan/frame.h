@@ -1,16 +1,114 @@
 #pragma once
 #include "vulkan/vulkan.hpp"
+#include "memory.h"
+#include "upload.h"
+#include "descriptor_allocator.h"
+#include "render_graph.h"
 
 namespace vkUtil
 {
+	/**
+		Everything tied to one swapchain image.
+	*/
 	struct SwapChainFrame
 	{
 		vk::Image image;
 		vk::ImageView imageView;
 		vk::Framebuffer framebuffer;
+		//signalled by the frame that rendered to this image, waited on by its presentation
+		vk::Semaphore renderFinished;
+		//headless rendering owns its images, swapchain images belong to the swapchain
+		Image offscreenImage;
+	};
+
+	/**
+		Everything a frame in flight needs while the cpu records it and the gpu renders it.
+		There can be more or fewer of these than swapchain images.
+	*/
+	struct FrameContext
+	{
+		//reset as a whole once the frame's timeline value is reached
+		vk::CommandPool commandPool;
 		vk::CommandBuffer commandBuffer;
-		vk::Semaphore imageAvailable, renderFinished;
-		vk::Fence inFlight;
+
+		//async compute, only made when there's a compute queue separate from graphics
+		vk::CommandPool computeCommandPool;
+		vk::CommandBuffer computeCommandBuffer;
+		//signalled by the compute submission, waited on by the graphics submission
+		vk::Semaphore computeFinished;
+		//whether the frame being recorded culls on the compute queue
+		bool asyncCompute{ false };
+
+		//one pool and secondary command buffer per recording worker
+		std::vector<vk::CommandPool> workerCommandPools;
+		std::vector<vk::CommandBuffer> workerCommandBuffers;
+
+		//acquire happens before the image index is known, so this can't be per image
+		vk::Semaphore imageAvailable;
+		//the timeline value signalled by the context's last submission
+		uint64_t timelineValue{ 0 };
+		//uploads the frame's submission waits for, filled in as it's recorded
+		UploadWait uploadWait;
+		//when the cpu started the frame last submitted with this context
+		std::optional<std::chrono::high_resolution_clock::time_point> submitTime;
+
+		//transient per-frame data, reset once the frame's timeline value is reached
+		std::unique_ptr<LinearArena> arena;
+		//the frame's descriptor sets, allocated as it's recorded and reset along with the arena
+		std::unique_ptr<DescriptorAllocator> descriptors;
+		//per-draw data in the arena, bound with a dynamic offset for each draw
+		vk::DescriptorSet objectDescriptorSet;
+		//the frame's passes, declared as it's recorded and only compiled again when they change
+		std::unique_ptr<RenderGraph> graph;
+
+		//per-object transforms, read by the instanced vertex shader
+		Buffer modelBuffer;
+		void* modelBufferWriteLocation{ nullptr };
+		size_t modelBufferCapacity{ 0 };
+		vk::DescriptorBufferInfo modelBufferDescriptor;
+		//per-object material indices, alongside the transforms
+		Buffer objectMaterialBuffer;
+		uint32_t* objectMaterialWriteLocation{ nullptr };
+		vk::DescriptorSet descriptorSet;
+
+		//gpu driven rendering: the culling pass fills these in
+		Buffer drawCommandBuffer;
+		Buffer drawCountBuffer;
+		vk::DescriptorSet cullDescriptorSet;
+
+		//the generation of the scene whose transforms and materials are currently in the buffers, zero if none
+		uint64_t uploadedSceneGeneration{ 0 };
+
+		/**
+			Make sure the model buffer can hold the given number of objects,
+			reallocating it if necessary.
+
+			\param allocator the device memory allocator
+			\param objectCount the number of transforms the buffer must hold
+			\param queueFamilies the families which read the transforms
+			\returns whether the buffer was reallocated
+		*/
+		bool make_descriptor_resources(MemoryAllocator& allocator, size_t objectCount, const std::vector<uint32_t>& queueFamilies);
+
+		/**
+			Allocate the frame's descriptor sets and point them at its buffers.
+
+			\param logicalDevice the logical device
+			\param layout the vertex shader's set layout
+			\param cullLayout the culling shader's set layout
+		*/
+		void write_descriptor_set(vk::Device logicalDevice, vk::DescriptorSetLayout layout, vk::DescriptorSetLayout cullLayout);
+
+		/**
+			Allocate the per-draw set and point it at the arena.
+
+			\param logicalDevice the logical device
+			\param layout the set's layout, a dynamic uniform buffer
+			\param range the size of one draw's data
+		*/
+		void write_object_descriptor_set(vk::Device logicalDevice, vk::DescriptorSetLayout layout, vk::DeviceSize range);
+
+		void destroy_descriptor_resources(MemoryAllocator& allocator);
 	};
 
 }
@@ -1,9 +1,12 @@
 #include "pch.h"
 #include "framebuffer.h"
+#include "cpu_profiler.h"
 
 void vkInit::make_framebuffers(framebufferInput inputChunk, std::vector<vkUtil::SwapChainFrame>& frames, bool debug)
 {
 
+	PROFILE_FUNCTION();
+
 	for (int i = 0; i < frames.size(); ++i) {
 
 		std::vector<vk::ImageView> attachments = {
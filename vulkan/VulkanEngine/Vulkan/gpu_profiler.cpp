@@ -0,0 +1,220 @@
+#include "pch.h"
+#include "gpu_profiler.h"
+
+vkUtil::GpuProfiler::GpuProfiler(vk::Device device, vk::PhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t slotCount, bool pipelineStatisticsSupported)
+	: device(device), statisticsSupported(pipelineStatisticsSupported) {
+
+	uint32_t validBits = physicalDevice.getQueueFamilyProperties()[queueFamilyIndex].timestampValidBits;
+	if (validBits == 0) {
+		return;
+	}
+	timestampPeriod = physicalDevice.getProperties().limits.timestampPeriod;
+	timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	slots.resize(slotCount);
+	for (Slot& slot : slots) {
+
+		vk::QueryPoolCreateInfo queryInfo = {};
+		queryInfo.queryType = vk::QueryType::eTimestamp;
+		queryInfo.queryCount = 2 * maxScopes;
+		slot.timestampPool = device.createQueryPool(queryInfo);
+
+		if (statisticsSupported) {
+			queryInfo.queryType = vk::QueryType::ePipelineStatistics;
+			queryInfo.queryCount = maxScopes;
+			queryInfo.pipelineStatistics = vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations
+				| vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations;
+			slot.statisticsPool = device.createQueryPool(queryInfo);
+		}
+	}
+}
+
+vkUtil::GpuProfiler::~GpuProfiler() {
+
+	for (Slot& slot : slots) {
+		device.destroyQueryPool(slot.timestampPool);
+		device.destroyQueryPool(slot.statisticsPool);
+	}
+}
+
+void vkUtil::GpuProfiler::calibrate(vk::Queue queue, vk::CommandBuffer commandBuffer) {
+
+	if (!is_supported()) {
+		return;
+	}
+
+	vk::CommandBufferBeginInfo beginInfo = {};
+	beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+	commandBuffer.begin(beginInfo);
+	commandBuffer.resetQueryPool(slots[0].timestampPool, 0, 1);
+	commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, slots[0].timestampPool, 0);
+	commandBuffer.end();
+
+	vk::SubmitInfo submitInfo = {};
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &commandBuffer;
+
+	//the timestamp was taken somewhere between submitting and idling, call it the midpoint
+	double before = trace_now();
+	queue.submit(submitInfo, nullptr);
+	queue.waitIdle();
+	double after = trace_now();
+
+	uint64_t ticks = 0;
+	vk::Result result = device.getQueryPoolResults(
+		slots[0].timestampPool, 0, 1, sizeof(ticks), &ticks, sizeof(uint64_t),
+		vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait
+	);
+	if (result == vk::Result::eSuccess) {
+		calibrationTicks = ticks & timestampMask;
+		calibrationTime = 0.5 * (before + after);
+	}
+}
+
+double vkUtil::GpuProfiler::to_trace_time(uint64_t ticks) const {
+
+	int64_t delta = static_cast<int64_t>((ticks & timestampMask) - calibrationTicks);
+	return calibrationTime + delta * static_cast<double>(timestampPeriod) / 1000.0;
+}
+
+void vkUtil::GpuProfiler::begin_frame(vk::CommandBuffer commandBuffer, uint32_t slot) {
+
+	if (!is_supported()) {
+		return;
+	}
+
+	recording = &slots[slot];
+	recording->scopes.clear();
+	recording->timestampCount = 0;
+	recording->statisticsCount = 0;
+	depth = 0;
+	statisticsActive = false;
+
+	commandBuffer.resetQueryPool(recording->timestampPool, 0, 2 * maxScopes);
+	if (recording->statisticsPool) {
+		commandBuffer.resetQueryPool(recording->statisticsPool, 0, maxScopes);
+	}
+
+	frameScope = begin_scope(commandBuffer, "frame");
+}
+
+void vkUtil::GpuProfiler::end_frame(vk::CommandBuffer commandBuffer) {
+
+	if (!recording) {
+		return;
+	}
+
+	end_scope(commandBuffer, frameScope);
+	recording = nullptr;
+}
+
+uint32_t vkUtil::GpuProfiler::begin_scope(vk::CommandBuffer commandBuffer, const char* name, bool statistics) {
+
+	if (!recording || recording->scopes.size() >= maxScopes) {
+		return ~0u;
+	}
+
+	ScopeRecord scope;
+	scope.name = name;
+	scope.depth = depth++;
+	scope.startQuery = recording->timestampCount++;
+	scope.endQuery = recording->timestampCount++;
+	scope.statisticsQuery = ~0u;
+
+	commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, recording->timestampPool, scope.startQuery);
+
+	//a query type can only have one active query at a time
+	if (statistics && statisticsEnabled && !statisticsActive) {
+		scope.statisticsQuery = recording->statisticsCount++;
+		commandBuffer.beginQuery(recording->statisticsPool, scope.statisticsQuery, vk::QueryControlFlags());
+		statisticsActive = true;
+	}
+
+	recording->scopes.push_back(scope);
+	return static_cast<uint32_t>(recording->scopes.size() - 1);
+}
+
+void vkUtil::GpuProfiler::end_scope(vk::CommandBuffer commandBuffer, uint32_t scope) {
+
+	if (!recording || scope >= recording->scopes.size()) {
+		return;
+	}
+
+	const ScopeRecord& record = recording->scopes[scope];
+	if (record.statisticsQuery != ~0u) {
+		commandBuffer.endQuery(recording->statisticsPool, record.statisticsQuery);
+		statisticsActive = false;
+	}
+	commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, recording->timestampPool, record.endQuery);
+	--depth;
+}
+
+void vkUtil::GpuProfiler::collect(uint32_t slotIndex, uint64_t frameIndex) {
+
+	if (!is_supported()) {
+		return;
+	}
+
+	Slot& slot = slots[slotIndex];
+	if (slot.timestampCount == 0) {
+		return;
+	}
+
+	//the frame is complete, so the results are available and this doesn't wait
+	std::vector<uint64_t> timestamps(slot.timestampCount);
+	vk::Result result = device.getQueryPoolResults(
+		slot.timestampPool, 0, slot.timestampCount,
+		timestamps.size() * sizeof(uint64_t), timestamps.data(), sizeof(uint64_t),
+		vk::QueryResultFlagBits::e64
+	);
+	if (result != vk::Result::eSuccess) {
+		return;
+	}
+
+	//vertex then fragment invocations, in the order of their flag bits
+	std::vector<uint64_t> statistics(2 * slot.statisticsCount);
+	bool statisticsValid = slot.statisticsCount > 0 && device.getQueryPoolResults(
+		slot.statisticsPool, 0, slot.statisticsCount,
+		statistics.size() * sizeof(uint64_t), statistics.data(), 2 * sizeof(uint64_t),
+		vk::QueryResultFlagBits::e64
+	) == vk::Result::eSuccess;
+
+	lastFrame.clear();
+	for (const ScopeRecord& record : slot.scopes) {
+
+		GpuScope scope;
+		scope.name = record.name;
+		scope.depth = record.depth;
+		scope.start = to_trace_time(timestamps[record.startQuery]);
+		scope.duration = to_trace_time(timestamps[record.endQuery]) - scope.start;
+		scope.hasStatistics = statisticsValid && record.statisticsQuery != ~0u;
+		scope.vertexInvocations = scope.hasStatistics ? statistics[2 * record.statisticsQuery] : 0;
+		scope.fragmentInvocations = scope.hasStatistics ? statistics[2 * record.statisticsQuery + 1] : 0;
+		lastFrame.push_back(scope);
+
+		if (capturing) {
+			TraceEvent event;
+			event.name = scope.name;
+			event.category = "gpu";
+			event.threadId = gpuTraceThreadId;
+			event.start = scope.start;
+			event.duration = scope.duration;
+			event.args.emplace_back("frame", frameIndex);
+			if (scope.hasStatistics) {
+				event.args.emplace_back("vertex invocations", scope.vertexInvocations);
+				event.args.emplace_back("fragment invocations", scope.fragmentInvocations);
+			}
+			captured.push_back(std::move(event));
+		}
+	}
+
+	lastFrameIndex = frameIndex;
+	slot.timestampCount = 0;
+}
+
+std::vector<vkUtil::TraceEvent> vkUtil::GpuProfiler::take_captured_events() {
+
+	std::vector<TraceEvent> events = std::move(captured);
+	captured.clear();
+	return events;
+}
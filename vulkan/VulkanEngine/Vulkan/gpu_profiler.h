@@ -0,0 +1,146 @@
+#pragma once
+#include "vulkan/vulkan.hpp"
+#include "trace.h"
+
+namespace vkUtil
+{
+	/**
+		A named range of gpu work, as measured once its frame completed.
+	*/
+	struct GpuScope {
+		std::string name;
+		//nesting depth, the frame itself is depth 0
+		uint32_t depth;
+		//microseconds on the trace_now clock
+		double start;
+		double duration;
+		bool hasStatistics;
+		uint64_t vertexInvocations;
+		uint64_t fragmentInvocations;
+	};
+
+	/**
+		Times named scopes of each frame's command buffer with timestamp queries, and
+		optionally counts shader invocations with pipeline statistics queries.
+
+		Each frame in flight records into its own slot of query pools. A slot's results are
+		read once its frame is known to be complete, so reading back never stalls.
+	*/
+	class GpuProfiler
+	{
+	public:
+		static constexpr uint32_t maxScopes = 64;
+
+		/**
+			\param device the logical device
+			\param physicalDevice the physical device
+			\param queueFamilyIndex the family of the queue the profiled work is submitted to
+			\param slotCount the number of frames which may be in flight at once
+			\param pipelineStatisticsSupported whether the pipelineStatisticsQuery feature is enabled
+		*/
+		GpuProfiler(vk::Device device, vk::PhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t slotCount, bool pipelineStatisticsSupported);
+		~GpuProfiler();
+
+		GpuProfiler(const GpuProfiler&) = delete;
+		GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+		//whether the queue can write timestamps at all, if not every call is a no-op
+		bool is_supported() const { return timestampPeriod > 0.0f; }
+
+		/**
+			Line the gpu's clock up with the cpu's by timing a single timestamp write.
+			The queue must be idle.
+
+			\param queue the queue to submit to
+			\param commandBuffer a resettable primary command buffer
+		*/
+		void calibrate(vk::Queue queue, vk::CommandBuffer commandBuffer);
+
+		//count vertex and fragment invocations in scopes that ask for it
+		void set_pipeline_statistics(bool enabled) { statisticsEnabled = enabled && statisticsSupported; }
+
+		//keep every frame's scopes for the trace, rather than just the last
+		void set_capture(bool enabled) { capturing = enabled; }
+
+		/**
+			Start profiling a frame, resetting its slot's queries. Also opens the frame's
+			own scope, which is closed by end_frame.
+
+			\param commandBuffer the frame's primary command buffer, outside a renderpass
+			\param slot the frame in flight being recorded
+		*/
+		void begin_frame(vk::CommandBuffer commandBuffer, uint32_t slot);
+		void end_frame(vk::CommandBuffer commandBuffer);
+
+		/**
+			Open a scope in the frame being recorded.
+
+			\param commandBuffer the frame's primary command buffer
+			\param name the scope's name, shown in the trace
+			\param statistics whether to also count shader invocations. Only one scope
+				at a time can, and it must start and end outside a renderpass.
+			\returns the scope, to be passed to end_scope
+		*/
+		uint32_t begin_scope(vk::CommandBuffer commandBuffer, const char* name, bool statistics = false);
+		void end_scope(vk::CommandBuffer commandBuffer, uint32_t scope);
+
+		/**
+			Read back a slot's results. Call once the frame last recorded into it is complete.
+
+			\param slot the frame in flight
+			\param frameIndex which frame the slot holds, counting from 1
+		*/
+		void collect(uint32_t slot, uint64_t frameIndex);
+
+		//the scopes of the last collected frame
+		const std::vector<GpuScope>& get_last_frame() const { return lastFrame; }
+		//gpu time of the last collected frame, in milliseconds
+		double get_frame_time() const { return lastFrame.empty() ? 0.0 : lastFrame[0].duration / 1000.0; }
+		//which frame get_frame_time refers to, zero if none has been collected
+		uint64_t get_frame_index() const { return lastFrameIndex; }
+
+		//scopes captured since capture was enabled, emptying the capture
+		std::vector<TraceEvent> take_captured_events();
+
+	private:
+		struct ScopeRecord {
+			const char* name;
+			uint32_t depth;
+			uint32_t startQuery;
+			uint32_t endQuery;
+			//index into the statistics pool, or ~0u
+			uint32_t statisticsQuery;
+		};
+
+		struct Slot {
+			vk::QueryPool timestampPool;
+			vk::QueryPool statisticsPool;
+			std::vector<ScopeRecord> scopes;
+			uint32_t timestampCount{ 0 };
+			uint32_t statisticsCount{ 0 };
+		};
+
+		vk::Device device;
+		float timestampPeriod{ 0.0f };
+		uint64_t timestampMask{ ~0ull };
+		bool statisticsSupported;
+		bool statisticsEnabled{ false };
+		bool capturing{ false };
+
+		std::vector<Slot> slots;
+		Slot* recording{ nullptr };
+		uint32_t depth{ 0 };
+		bool statisticsActive{ false };
+		uint32_t frameScope{ 0 };
+
+		//a gpu timestamp and the cpu time it was taken at
+		uint64_t calibrationTicks{ 0 };
+		double calibrationTime{ 0.0 };
+
+		std::vector<GpuScope> lastFrame;
+		uint64_t lastFrameIndex{ 0 };
+		std::vector<TraceEvent> captured;
+
+		double to_trace_time(uint64_t ticks) const;
+	};
+}
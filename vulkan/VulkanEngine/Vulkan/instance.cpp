@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "instance.h"
+#include "cpu_profiler.h"
 
 /**
 	Check whether the requested extensions and layers are supported.
@@ -76,9 +77,12 @@ bool vkInit::supported(std::vector<const char*>& extensions, std::vector<const c
 
 	\param debug whether the system is being run in debug mode.
 	\param applicationName the name of the application.
+	\param headless whether the instance will be used without a window.
 	\returns the instance created.
 */
-vk::Instance vkInit::make_instance(bool debug, const char* applicationName) {
+vk::Instance vkInit::make_instance(bool debug, const char* applicationName, bool headless) {
+
+	PROFILE_FUNCTION();
 
 	if (debug) {
 		std::cout << "Making an instance...\n";
@@ -150,11 +154,15 @@ vk::Instance vkInit::make_instance(bool debug, const char* applicationName) {
 	* Everything with Vulkan is "opt-in", so we need to query which extensions glfw needs
 	* in order to interface with vulkan.
 	*/
-	uint32_t glfwExtensionCount = 0;
-	const char** glfwExtensions;
-	glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
-
-	std::vector<const char*> extensions(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	std::vector<const char*> extensions;
+	//headless rendering has no surface, so glfw isn't even initialized
+	if (!headless) {
+		uint32_t glfwExtensionCount = 0;
+		const char** glfwExtensions;
+		glfwExtensions = glfwGetRequiredInstanceExtensions(&glfwExtensionCount);
+
+		extensions.assign(glfwExtensions, glfwExtensions + glfwExtensionCount);
+	}
 
 	//In order to hook in a custom validation callback
 	if (debug) {
@@ -4,6 +4,6 @@ namespace vkInit{
 	
 	bool supported(std::vector<const char*>& extensions, std::vector<const char*>& layers, bool debug);
 
-	vk::Instance make_instance(bool debug, const char* applicationName);
+	vk::Instance make_instance(bool debug, const char* applicationName, bool headless);
 	
 }
\ No newline at end of file
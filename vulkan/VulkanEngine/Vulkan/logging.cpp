@@ -1,5 +1,6 @@
 #include "pch.h"
 #include "logging.h"
+#include "cpu_profiler.h"
 /*
 	* Debug call back:
 	*
@@ -64,6 +65,8 @@ VKAPI_ATTR VkBool32 VKAPI_CALL vkInit::debugCallback(
 */
 vk::DebugUtilsMessengerEXT vkInit::make_debug_messenger(vk::Instance& instance, vk::DispatchLoaderDynamic& dldi) {
 
+	PROFILE_FUNCTION();
+
 	/*
 	* DebugUtilsMessengerCreateInfoEXT( VULKAN_HPP_NAMESPACE::DebugUtilsMessengerCreateFlagsEXT flags_           = {},
 									VULKAN_HPP_NAMESPACE::DebugUtilsMessageSeverityFlagsEXT messageSeverity_ = {},
@@ -0,0 +1,442 @@
+#include "pch.h"
+#include "memory.h"
+
+uint32_t vkUtil::findMemoryTypeIndex(vk::PhysicalDevice physicalDevice, uint32_t supportedMemoryIndices, vk::MemoryPropertyFlags requestedProperties) {
+
+	/*
+	* typedef struct VkPhysicalDeviceMemoryProperties {
+		uint32_t        memoryTypeCount;
+		VkMemoryType    memoryTypes[VK_MAX_MEMORY_TYPES];
+		uint32_t        memoryHeapCount;
+		VkMemoryHeap    memoryHeaps[VK_MAX_MEMORY_HEAPS];
+	} VkPhysicalDeviceMemoryProperties;
+	*/
+	vk::PhysicalDeviceMemoryProperties memoryProperties = physicalDevice.getMemoryProperties();
+
+	for (uint32_t i = 0; i < memoryProperties.memoryTypeCount; i++) {
+
+		//bit i of supportedMemoryIndices is set if that memory type is supported by the device
+		bool supported{ static_cast<bool>(supportedMemoryIndices & (1 << i)) };
+
+		//propertyFlags holds all the memory properties supported by this memory type
+		bool sufficient{ (memoryProperties.memoryTypes[i].propertyFlags & requestedProperties) == requestedProperties };
+
+		if (supported && sufficient) {
+			return i;
+		}
+	}
+
+	return invalidMemoryTypeIndex;
+}
+
+vkUtil::MemoryAllocator::MemoryAllocator(vk::Device device, vk::PhysicalDevice physicalDevice, vk::DeviceSize blockSize, bool debug) {
+
+	this->device = device;
+	this->physicalDevice = physicalDevice;
+	this->blockSize = blockSize;
+	debugMode = debug;
+
+	memoryProperties = physicalDevice.getMemoryProperties();
+	maxAllocationCount = physicalDevice.getProperties().limits.maxMemoryAllocationCount;
+	pools.resize(2 * memoryProperties.memoryTypeCount);
+}
+
+vkUtil::MemoryAllocator::~MemoryAllocator() {
+
+	if (debugMode) {
+		log_stats();
+	}
+
+	for (MemoryPool& pool : pools) {
+		for (std::unique_ptr<MemoryBlock>& block : pool.blocks) {
+			if (block->mapped) {
+				device.unmapMemory(block->memory);
+			}
+			device.freeMemory(block->memory);
+		}
+	}
+}
+
+vkUtil::MemoryBlock* vkUtil::MemoryAllocator::make_block(uint32_t memoryTypeIndex, vk::DeviceSize size, bool subAllocated) {
+
+	if (deviceAllocationCount >= maxAllocationCount) {
+		if (debugMode) {
+			std::cout << "Reached maxMemoryAllocationCount (" << maxAllocationCount << ")" << std::endl;
+		}
+		return nullptr;
+	}
+
+	vk::MemoryAllocateInfo allocInfo;
+	allocInfo.allocationSize = size;
+	allocInfo.memoryTypeIndex = memoryTypeIndex;
+
+	std::unique_ptr<MemoryBlock> block = std::make_unique<MemoryBlock>();
+	try {
+		block->memory = device.allocateMemory(allocInfo);
+	}
+	catch (vk::SystemError err) {
+		if (debugMode) {
+			std::cout << "Failed to allocate memory block of " << size << " bytes" << std::endl;
+		}
+		return nullptr;
+	}
+	++deviceAllocationCount;
+
+	block->size = size;
+	block->memoryTypeIndex = memoryTypeIndex;
+	if (subAllocated) {
+		//anything smaller than this isn't worth tracking separately
+		block->allocator = std::make_unique<BuddyAllocator>(size, 256);
+	}
+	if (memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) {
+		block->mapped = device.mapMemory(block->memory, 0, size);
+	}
+
+	if (debugMode) {
+		std::cout << "Allocated " << (subAllocated ? "" : "dedicated ") << "memory block of "
+			<< size << " bytes from memory type " << memoryTypeIndex << std::endl;
+	}
+
+	return block.release();
+}
+
+void vkUtil::MemoryAllocator::release_block(MemoryPool& pool, MemoryBlock* block) {
+
+	if (block->mapped) {
+		device.unmapMemory(block->memory);
+	}
+	device.freeMemory(block->memory);
+	--deviceAllocationCount;
+
+	pool.blocks.erase(std::remove_if(pool.blocks.begin(), pool.blocks.end(),
+		[block](const std::unique_ptr<MemoryBlock>& candidate) { return candidate.get() == block; }),
+		pool.blocks.end());
+}
+
+vkUtil::Allocation vkUtil::MemoryAllocator::allocate_from_block(MemoryBlock* block, vk::DeviceSize size, vk::DeviceSize alignment) {
+
+	Allocation allocation;
+
+	uint64_t offset = block->allocator->allocate(size, alignment);
+	if (offset == BuddyAllocator::invalidOffset) {
+		return allocation;
+	}
+
+	allocation.memory = block->memory;
+	allocation.offset = offset;
+	allocation.size = size;
+	allocation.block = block;
+	if (block->mapped) {
+		allocation.mapped = static_cast<char*>(block->mapped) + offset;
+	}
+	return allocation;
+}
+
+vkUtil::Allocation vkUtil::MemoryAllocator::allocate(const vk::MemoryRequirements& requirements, vk::MemoryPropertyFlags properties, bool linear) {
+
+	uint32_t memoryTypeIndex = findMemoryTypeIndex(physicalDevice, requirements.memoryTypeBits, properties);
+	if (memoryTypeIndex == invalidMemoryTypeIndex) {
+		if (debugMode) {
+			std::cout << "No memory type has the requested properties" << std::endl;
+		}
+		return Allocation();
+	}
+	MemoryPool& pool = pools[2 * memoryTypeIndex + (linear ? 1 : 0)];
+
+	//big resources get their own block rather than eating most of a shared one
+	if (requirements.size > blockSize / 2) {
+
+		MemoryBlock* block = make_block(memoryTypeIndex, requirements.size, false);
+		if (!block) {
+			return Allocation();
+		}
+		pool.blocks.emplace_back(block);
+
+		Allocation allocation;
+		allocation.memory = block->memory;
+		allocation.offset = 0;
+		allocation.size = requirements.size;
+		allocation.mapped = block->mapped;
+		allocation.block = block;
+		return allocation;
+	}
+
+	for (std::unique_ptr<MemoryBlock>& block : pool.blocks) {
+		if (!block->allocator) {
+			continue;
+		}
+		Allocation allocation = allocate_from_block(block.get(), requirements.size, requirements.alignment);
+		if (allocation.memory) {
+			return allocation;
+		}
+	}
+
+	//no room in the existing blocks
+	MemoryBlock* block = make_block(memoryTypeIndex, blockSize, true);
+	if (!block) {
+		return Allocation();
+	}
+	pool.blocks.emplace_back(block);
+	return allocate_from_block(block, requirements.size, requirements.alignment);
+}
+
+void vkUtil::MemoryAllocator::free(Allocation& allocation) {
+
+	MemoryBlock* block = allocation.block;
+	if (!block) {
+		return;
+	}
+
+	//find the pool which owns the block
+	for (uint32_t linear = 0; linear < 2; ++linear) {
+
+		MemoryPool& pool = pools[2 * block->memoryTypeIndex + linear];
+		bool owned = std::any_of(pool.blocks.begin(), pool.blocks.end(),
+			[block](const std::unique_ptr<MemoryBlock>& candidate) { return candidate.get() == block; });
+		if (!owned) {
+			continue;
+		}
+
+		if (!block->allocator) {
+			release_block(pool, block);
+		}
+		else {
+			block->allocator->free(allocation.offset);
+
+			//keep one empty block around so alternating allocations don't thrash the driver
+			size_t subAllocatedBlocks = std::count_if(pool.blocks.begin(), pool.blocks.end(),
+				[](const std::unique_ptr<MemoryBlock>& candidate) { return candidate->allocator != nullptr; });
+			if (block->allocator->empty() && subAllocatedBlocks > 1) {
+				release_block(pool, block);
+			}
+		}
+		break;
+	}
+
+	allocation = Allocation();
+}
+
+vkUtil::Buffer vkUtil::MemoryAllocator::create_buffer(const BufferInputChunk& input) {
+
+	vk::BufferCreateInfo bufferInfo;
+	bufferInfo.flags = vk::BufferCreateFlags();
+	bufferInfo.size = input.size;
+	bufferInfo.usage = input.usage;
+	bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+	if (input.queueFamilies.size() > 1) {
+		bufferInfo.sharingMode = vk::SharingMode::eConcurrent;
+		bufferInfo.queueFamilyIndexCount = static_cast<uint32_t>(input.queueFamilies.size());
+		bufferInfo.pQueueFamilyIndices = input.queueFamilies.data();
+	}
+
+	Buffer buffer;
+	buffer.buffer = device.createBuffer(bufferInfo);
+
+	vk::MemoryRequirements memoryRequirements = device.getBufferMemoryRequirements(buffer.buffer);
+	buffer.allocation = allocate(memoryRequirements, input.memoryProperties, true);
+	if (!buffer.allocation.memory) {
+		device.destroyBuffer(buffer.buffer);
+		throw vk::OutOfDeviceMemoryError("Failed to allocate memory for buffer");
+	}
+	device.bindBufferMemory(buffer.buffer, buffer.allocation.memory, buffer.allocation.offset);
+
+	return buffer;
+}
+
+void vkUtil::MemoryAllocator::destroy_buffer(Buffer& buffer) {
+
+	if (!buffer.buffer) {
+		return;
+	}
+
+	device.destroyBuffer(buffer.buffer);
+	free(buffer.allocation);
+	buffer.buffer = nullptr;
+}
+
+vkUtil::Image vkUtil::MemoryAllocator::create_image(const vk::ImageCreateInfo& imageInfo, vk::MemoryPropertyFlags properties) {
+
+	Image image;
+	image.image = device.createImage(imageInfo);
+
+	vk::MemoryRequirements memoryRequirements = device.getImageMemoryRequirements(image.image);
+	image.allocation = allocate(memoryRequirements, properties, imageInfo.tiling == vk::ImageTiling::eLinear);
+	if (!image.allocation.memory) {
+		device.destroyImage(image.image);
+		throw vk::OutOfDeviceMemoryError("Failed to allocate memory for image");
+	}
+	device.bindImageMemory(image.image, image.allocation.memory, image.allocation.offset);
+
+	return image;
+}
+
+void vkUtil::MemoryAllocator::destroy_image(Image& image) {
+
+	if (!image.image) {
+		return;
+	}
+
+	device.destroyImage(image.image);
+	free(image.allocation);
+	image.image = nullptr;
+}
+
+uint32_t vkUtil::MemoryAllocator::defragment(const DefragmentationCallback& move, uint32_t maxMoves) {
+
+	uint32_t moves = 0;
+
+	for (MemoryPool& pool : pools) {
+
+		std::vector<MemoryBlock*> blocks;
+		for (std::unique_ptr<MemoryBlock>& block : pool.blocks) {
+			if (block->allocator) {
+				blocks.push_back(block.get());
+			}
+		}
+		if (blocks.size() < 2) {
+			continue;
+		}
+
+		//empty the least used block into the others
+		std::sort(blocks.begin(), blocks.end(), [](MemoryBlock* a, MemoryBlock* b) {
+			return a->allocator->requested_bytes() < b->allocator->requested_bytes();
+		});
+		MemoryBlock* source = blocks[0];
+
+		for (const auto& [offset, size] : source->allocator->allocations()) {
+
+			if (moves == maxMoves) {
+				return moves;
+			}
+
+			Allocation sourceAllocation;
+			sourceAllocation.memory = source->memory;
+			sourceAllocation.offset = offset;
+			sourceAllocation.size = size;
+			sourceAllocation.block = source;
+			if (source->mapped) {
+				sourceAllocation.mapped = static_cast<char*>(source->mapped) + offset;
+			}
+
+			//the original alignment isn't known, but the buddy block's own alignment satisfies it
+			vk::DeviceSize alignment = 1;
+			while (alignment < size) {
+				alignment <<= 1;
+			}
+
+			Allocation destination;
+			for (size_t i = 1; i < blocks.size() && !destination.memory; ++i) {
+				destination = allocate_from_block(blocks[i], size, alignment);
+			}
+			if (!destination.memory) {
+				break;
+			}
+
+			if (move(sourceAllocation, destination)) {
+				source->allocator->free(offset);
+				++moves;
+			}
+			else {
+				destination.block->allocator->free(destination.offset);
+			}
+		}
+
+		if (source->allocator->empty()) {
+			release_block(pool, source);
+		}
+	}
+
+	return moves;
+}
+
+vkUtil::MemoryStats vkUtil::MemoryAllocator::get_stats() const {
+
+	MemoryStats stats;
+	vk::DeviceSize freeBytes = 0;
+	vk::DeviceSize largestFreeBlock = 0;
+
+	for (const MemoryPool& pool : pools) {
+		for (const std::unique_ptr<MemoryBlock>& block : pool.blocks) {
+
+			stats.reservedBytes += block->size;
+			++stats.blockCount;
+
+			if (block->allocator) {
+				stats.usedBytes += block->allocator->requested_bytes();
+				stats.allocationCount += block->allocator->allocation_count();
+				freeBytes += block->allocator->free_bytes();
+				largestFreeBlock = std::max<vk::DeviceSize>(largestFreeBlock, block->allocator->largest_free_block());
+			}
+			else {
+				stats.usedBytes += block->size;
+				++stats.allocationCount;
+			}
+		}
+	}
+
+	if (freeBytes > 0) {
+		stats.fragmentation = 1.0f - static_cast<float>(largestFreeBlock) / static_cast<float>(freeBytes);
+	}
+
+	return stats;
+}
+
+void vkUtil::MemoryAllocator::log_stats() const {
+
+	MemoryStats stats = get_stats();
+	std::cout << "Device memory: " << stats.usedBytes << " bytes used of " << stats.reservedBytes
+		<< " reserved, in " << stats.allocationCount << " allocations across " << stats.blockCount
+		<< " blocks, fragmentation " << stats.fragmentation << std::endl;
+}
+
+vkUtil::LinearArena::LinearArena(MemoryAllocator& allocator, vk::DeviceSize size, vk::BufferUsageFlags usage)
+	: allocator(allocator), usage(usage) {
+
+	make_buffer(size);
+}
+
+void vkUtil::LinearArena::make_buffer(vk::DeviceSize size) {
+
+	//persistently mapped and written front to back, so it stays write combined friendly
+	BufferInputChunk input;
+	input.size = size;
+	input.usage = usage;
+	input.memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+	buffer = allocator.create_buffer(input);
+	this->size = size;
+}
+
+bool vkUtil::LinearArena::reserve(vk::DeviceSize size) {
+
+	if (size <= this->size) {
+		return false;
+	}
+
+	//grow geometrically so a slowly growing scene doesn't reallocate every frame
+	allocator.destroy_buffer(buffer);
+	make_buffer(std::max(size, 2 * this->size));
+	return true;
+}
+
+vkUtil::LinearArena::~LinearArena() {
+
+	allocator.destroy_buffer(buffer);
+}
+
+vkUtil::LinearArena::Slice vkUtil::LinearArena::allocate(vk::DeviceSize size, vk::DeviceSize alignment) {
+
+	Slice slice;
+	vk::DeviceSize current = head.load(std::memory_order_relaxed);
+	vk::DeviceSize offset;
+	do {
+		offset = (current + alignment - 1) & ~(alignment - 1);
+		if (offset + size > this->size) {
+			return slice;
+		}
+	} while (!head.compare_exchange_weak(current, offset + size, std::memory_order_relaxed));
+
+	slice.buffer = buffer.buffer;
+	slice.offset = offset;
+	slice.data = static_cast<char*>(buffer.allocation.mapped) + offset;
+	return slice;
+}
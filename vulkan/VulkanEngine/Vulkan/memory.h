@@ -0,0 +1,284 @@
+#pragma once
+#include <atomic>
+#include "buddy_allocator.h"
+
+namespace vkUtil
+{
+	/**
+		Holds the data needed to create a buffer.
+	*/
+	struct BufferInputChunk {
+		size_t size;
+		vk::BufferUsageFlags usage;
+		vk::MemoryPropertyFlags memoryProperties;
+		//the queue families which use the buffer, it's shared concurrently if there's more than one
+		std::vector<uint32_t> queueFamilies;
+	};
+
+	/**
+		A large piece of device memory, sub-allocated by the memory allocator.
+	*/
+	struct MemoryBlock {
+		vk::DeviceMemory memory;
+		vk::DeviceSize size;
+		uint32_t memoryTypeIndex;
+		//null for dedicated blocks, which hold a single allocation
+		std::unique_ptr<BuddyAllocator> allocator;
+		//persistently mapped if the memory is host visible
+		void* mapped{ nullptr };
+	};
+
+	/**
+		A range of device memory handed out by the memory allocator.
+	*/
+	struct Allocation {
+		vk::DeviceMemory memory;
+		vk::DeviceSize offset{ 0 };
+		vk::DeviceSize size{ 0 };
+		//points at offset within the block if the memory is host visible
+		void* mapped{ nullptr };
+		MemoryBlock* block{ nullptr };
+	};
+
+	/**
+		A buffer, along with its backing memory.
+	*/
+	struct Buffer {
+		vk::Buffer buffer;
+		Allocation allocation;
+	};
+
+	/**
+		An image, along with its backing memory.
+	*/
+	struct Image {
+		vk::Image image;
+		Allocation allocation;
+	};
+
+	struct MemoryStats {
+		//device memory taken from the driver
+		vk::DeviceSize reservedBytes{ 0 };
+		//bytes handed out to resources
+		vk::DeviceSize usedBytes{ 0 };
+		uint32_t blockCount{ 0 };
+		size_t allocationCount{ 0 };
+		//0 when the free space is contiguous, approaching 1 as it breaks up
+		float fragmentation{ 0.0f };
+	};
+
+	/**
+		Called by the defragmenter for each allocation it wants to move, the gpu must not be using it.
+		Resources can't be rebound in Vulkan, so it should create a new resource bound to the
+		destination, copy the contents across, destroy the old resource and hand the new one to
+		its owner along with the destination as its allocation. The old resource is destroyed
+		directly rather than through destroy_buffer/destroy_image, the allocator frees the source.
+
+		\returns whether the move happened, the source is only freed if it did, otherwise the
+			destination is
+	*/
+	using DefragmentationCallback = std::function<bool(const Allocation& source, const Allocation& destination)>;
+
+	constexpr uint32_t invalidMemoryTypeIndex = ~0u;
+
+	/**
+		Find a memory type which is allowed by the given mask and has the requested properties.
+
+		\param physicalDevice the physical device
+		\param supportedMemoryIndices a bitmask of memory types which may be used
+		\param requestedProperties the properties the memory type must have
+		\returns the index of the memory type, or invalidMemoryTypeIndex if none match
+	*/
+	uint32_t findMemoryTypeIndex(vk::PhysicalDevice physicalDevice, uint32_t supportedMemoryIndices, vk::MemoryPropertyFlags requestedProperties);
+
+	/**
+		Takes large blocks of device memory per memory type and sub-allocates
+		buffers and images from them, so the number of device allocations stays
+		well under maxMemoryAllocationCount.
+	*/
+	class MemoryAllocator {
+
+	public:
+
+		/**
+			\param device the logical device
+			\param physicalDevice the physical device
+			\param blockSize the size of each block, must be a power of two
+			\param debug whether the system is running in debug mode
+		*/
+		MemoryAllocator(vk::Device device, vk::PhysicalDevice physicalDevice, vk::DeviceSize blockSize, bool debug);
+		~MemoryAllocator();
+
+		/**
+			Allocate memory for a resource.
+
+			\param requirements the resource's memory requirements
+			\param properties the properties the memory must have
+			\param linear whether the resource is a buffer or linear image, these are kept in separate
+				blocks from optimal images so bufferImageGranularity never has to be considered
+			\returns the allocation, whose memory is null on failure
+		*/
+		Allocation allocate(const vk::MemoryRequirements& requirements, vk::MemoryPropertyFlags properties, bool linear);
+		void free(Allocation& allocation);
+
+		/**
+			Make a buffer and bind it to newly allocated memory.
+
+			\param input the buffer creation info
+			\returns the created buffer, throws vk::OutOfDeviceMemoryError if no memory could be allocated
+		*/
+		Buffer create_buffer(const BufferInputChunk& input);
+		void destroy_buffer(Buffer& buffer);
+
+		/**
+			Make an image and bind it to newly allocated memory.
+
+			\param imageInfo the image creation info
+			\param properties the properties the memory must have
+			\returns the created image, throws vk::OutOfDeviceMemoryError if no memory could be allocated
+		*/
+		Image create_image(const vk::ImageCreateInfo& imageInfo, vk::MemoryPropertyFlags properties);
+		void destroy_image(Image& image);
+
+		/**
+			Try to empty the least used block of each memory type by moving its
+			allocations into the other blocks, releasing it if that succeeds.
+
+			\param move called for each move, see DefragmentationCallback
+			\param maxMoves the most allocations to move in this call
+			\returns the number of allocations moved
+		*/
+		uint32_t defragment(const DefragmentationCallback& move, uint32_t maxMoves);
+
+		MemoryStats get_stats() const;
+		void log_stats() const;
+
+	private:
+
+		struct MemoryPool {
+			std::vector<std::unique_ptr<MemoryBlock>> blocks;
+		};
+
+		vk::Device device;
+		vk::PhysicalDevice physicalDevice;
+		vk::PhysicalDeviceMemoryProperties memoryProperties;
+		vk::DeviceSize blockSize;
+		uint32_t maxAllocationCount;
+		uint32_t deviceAllocationCount{ 0 };
+		bool debugMode;
+
+		//indexed by memory type * 2 + linear
+		std::vector<MemoryPool> pools;
+
+		MemoryBlock* make_block(uint32_t memoryTypeIndex, vk::DeviceSize size, bool subAllocated);
+		void release_block(MemoryPool& pool, MemoryBlock* block);
+		Allocation allocate_from_block(MemoryBlock* block, vk::DeviceSize size, vk::DeviceSize alignment);
+	};
+
+	/**
+		A buffer handed out front to back and reset all at once, for data which only
+		lives for a frame. Allocation is an atomic pointer bump, so recording threads
+		can share an arena, though each should claim chunks with an ArenaChunk.
+	*/
+	class LinearArena {
+
+	public:
+
+		struct Slice {
+			vk::Buffer buffer;
+			vk::DeviceSize offset{ 0 };
+			//null if the arena is full
+			void* data{ nullptr };
+		};
+
+		LinearArena(MemoryAllocator& allocator, vk::DeviceSize size, vk::BufferUsageFlags usage);
+		~LinearArena();
+
+		LinearArena(const LinearArena&) = delete;
+		LinearArena& operator=(const LinearArena&) = delete;
+
+		/**
+			Take the next range of the arena. Thread safe.
+
+			\param size the number of bytes needed
+			\param alignment the required alignment of the offset, must be a power of two
+			\returns the range, whose data is null if the arena is full
+		*/
+		Slice allocate(vk::DeviceSize size, vk::DeviceSize alignment);
+
+		/**
+			Make sure the arena can hold the given number of bytes, reallocating
+			its buffer if not. Only while it's empty, before anything is recorded.
+
+			\param size the number of bytes the frame will need
+			\returns whether the buffer was reallocated
+		*/
+		bool reserve(vk::DeviceSize size);
+
+		//free everything, only once the gpu is done with the frame
+		void reset() { head = 0; }
+
+		vk::DeviceSize used() const { return head; }
+		vk::DeviceSize capacity() const { return size; }
+		vk::Buffer get_buffer() const { return buffer.buffer; }
+
+	private:
+		MemoryAllocator& allocator;
+		Buffer buffer;
+		vk::BufferUsageFlags usage;
+		vk::DeviceSize size;
+		std::atomic<vk::DeviceSize> head{ 0 };
+
+		void make_buffer(vk::DeviceSize size);
+	};
+
+	/**
+		One thread's share of an arena. Chunks are claimed from the arena with a single
+		atomic bump, then handed out with no synchronization at all, so each thread writes
+		its data contiguously. Lives on the recording thread's stack for one pass.
+	*/
+	class ArenaChunk {
+
+	public:
+
+		/**
+			\param arena the arena to claim chunks from
+			\param chunkSize how much to claim at a time
+			\param alignment the alignment of every range handed out, must be a power of two
+		*/
+		ArenaChunk(LinearArena& arena, vk::DeviceSize chunkSize, vk::DeviceSize alignment)
+			: arena(arena), chunkSize(chunkSize), alignment(alignment) {}
+
+		/**
+			Take the next range of the chunk, claiming another if it's used up.
+
+			\param size the number of bytes needed, no more than the chunk size
+			\returns the range, whose data is null if the arena is full
+		*/
+		LinearArena::Slice allocate(vk::DeviceSize size) {
+
+			vk::DeviceSize offset = (head + alignment - 1) & ~(alignment - 1);
+			if (!chunk.data || offset + size > chunkSize) {
+				chunk = arena.allocate(chunkSize, alignment);
+				offset = 0;
+				if (!chunk.data) {
+					return chunk;
+				}
+			}
+
+			head = offset + size;
+			LinearArena::Slice slice;
+			slice.buffer = chunk.buffer;
+			slice.offset = chunk.offset + offset;
+			slice.data = static_cast<char*>(chunk.data) + offset;
+			return slice;
+		}
+
+	private:
+		LinearArena& arena;
+		vk::DeviceSize chunkSize;
+		vk::DeviceSize alignment;
+		LinearArena::Slice chunk;
+		vk::DeviceSize head{ 0 };
+	};
+}
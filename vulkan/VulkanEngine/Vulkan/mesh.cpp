@@ -0,0 +1,298 @@
+#include "pch.h"
+#include "mesh.h"
+#include "mesh_loader.h"
+#include "cooked_mesh.h"
+
+size_t vkUtil::VertexHash::operator()(const Vertex& vertex) const {
+
+	const float components[] = {
+		vertex.position.x, vertex.position.y, vertex.position.z,
+		vertex.normal.x, vertex.normal.y, vertex.normal.z,
+		vertex.texcoord.x, vertex.texcoord.y,
+		vertex.color.x, vertex.color.y, vertex.color.z
+	};
+
+	//FNV-1a over each component's bits, adding zero first so -0 hashes the same as 0
+	uint64_t hash = 14695981039346656037ull;
+	for (float component : components) {
+		component += 0.0f;
+		uint32_t bits;
+		memcpy(&bits, &component, sizeof(bits));
+		hash = (hash ^ bits) * 1099511628211ull;
+	}
+	return static_cast<size_t>(hash);
+}
+
+vk::VertexInputBindingDescription vkUtil::get_vertex_binding_description() {
+
+	vk::VertexInputBindingDescription bindingDescription;
+	bindingDescription.binding = 0;
+	bindingDescription.stride = sizeof(Vertex);
+	bindingDescription.inputRate = vk::VertexInputRate::eVertex;
+
+	return bindingDescription;
+}
+
+std::array<vk::VertexInputAttributeDescription, 4> vkUtil::get_vertex_attribute_descriptions() {
+
+	std::array<vk::VertexInputAttributeDescription, 4> attributes;
+
+	attributes[0].binding = 0;
+	attributes[0].location = 0;
+	attributes[0].format = vk::Format::eR32G32B32Sfloat;
+	attributes[0].offset = offsetof(Vertex, position);
+
+	attributes[1].binding = 0;
+	attributes[1].location = 1;
+	attributes[1].format = vk::Format::eR32G32B32Sfloat;
+	attributes[1].offset = offsetof(Vertex, normal);
+
+	attributes[2].binding = 0;
+	attributes[2].location = 2;
+	attributes[2].format = vk::Format::eR32G32Sfloat;
+	attributes[2].offset = offsetof(Vertex, texcoord);
+
+	attributes[3].binding = 0;
+	attributes[3].location = 3;
+	attributes[3].format = vk::Format::eR32G32B32Sfloat;
+	attributes[3].offset = offsetof(Vertex, color);
+
+	return attributes;
+}
+
+vkUtil::MeshData vkUtil::deduplicate_vertices(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices) {
+
+	size_t indexCount = indices.empty() ? vertices.size() : indices.size();
+
+	MeshData mesh;
+	mesh.indices.reserve(indexCount);
+	std::unordered_map<Vertex, uint32_t, VertexHash> uniqueVertices;
+	uniqueVertices.reserve(indexCount);
+
+	for (size_t i = 0; i < indexCount; ++i) {
+		const Vertex& vertex = vertices[indices.empty() ? i : indices[i]];
+		auto [entry, inserted] = uniqueVertices.try_emplace(vertex, static_cast<uint32_t>(mesh.vertices.size()));
+		if (inserted) {
+			mesh.vertices.push_back(vertex);
+		}
+		mesh.indices.push_back(entry->second);
+	}
+
+	return mesh;
+}
+
+std::vector<vkUtil::Meshlet> vkUtil::build_meshlets(const MeshData& mesh) {
+
+	const size_t maxVertices = 64;
+	const size_t maxTriangles = 124;
+
+	std::vector<Meshlet> meshlets;
+	std::vector<uint32_t> meshletVertices;
+	meshletVertices.reserve(maxVertices);
+	Meshlet meshlet = {};
+
+	auto finish = [&]() {
+		if (meshlet.triangleCount == 0) {
+			return;
+		}
+		glm::vec3 lowest = mesh.vertices[meshletVertices[0]].position;
+		glm::vec3 highest = lowest;
+		for (uint32_t index : meshletVertices) {
+			lowest = glm::min(lowest, mesh.vertices[index].position);
+			highest = glm::max(highest, mesh.vertices[index].position);
+		}
+		meshlet.center = 0.5f * (lowest + highest);
+		meshlet.radius = 0.0f;
+		for (uint32_t index : meshletVertices) {
+			meshlet.radius = std::max(meshlet.radius, glm::length(mesh.vertices[index].position - meshlet.center));
+		}
+		meshlets.push_back(meshlet);
+	};
+
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+
+		size_t newVertices = 0;
+		for (size_t corner = 0; corner < 3; ++corner) {
+			uint32_t index = mesh.indices[i + corner];
+			if (std::find(meshletVertices.begin(), meshletVertices.end(), index) == meshletVertices.end()) {
+				++newVertices;
+			}
+		}
+
+		if (meshletVertices.size() + newVertices > maxVertices || meshlet.triangleCount == maxTriangles) {
+			finish();
+			meshletVertices.clear();
+			meshlet = {};
+			meshlet.firstIndex = static_cast<uint32_t>(i);
+		}
+
+		for (size_t corner = 0; corner < 3; ++corner) {
+			uint32_t index = mesh.indices[i + corner];
+			if (std::find(meshletVertices.begin(), meshletVertices.end(), index) == meshletVertices.end()) {
+				meshletVertices.push_back(index);
+			}
+		}
+		++meshlet.triangleCount;
+	}
+	finish();
+
+	return meshlets;
+}
+
+float vkUtil::bounding_radius(const std::vector<Vertex>& vertices) {
+
+	float radius = 0.0f;
+	for (const Vertex& vertex : vertices) {
+		radius = std::max(radius, glm::length(vertex.position));
+	}
+	return radius;
+}
+
+uint32_t vkUtil::MeshLibrary::add(const MeshData& mesh) {
+
+	std::vector<Meshlet> meshMeshlets = build_meshlets(mesh);
+
+	MeshRange range;
+	range.firstIndex = indexCount;
+	range.indexCount = static_cast<uint32_t>(mesh.indices.size());
+	range.vertexOffset = static_cast<int32_t>(vertexCount);
+	range.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+	range.boundingRadius = bounding_radius(mesh.vertices);
+	range.firstMeshlet = static_cast<uint32_t>(meshlets.size());
+	range.meshletCount = static_cast<uint32_t>(meshMeshlets.size());
+
+	meshes.push_back({ static_cast<uint32_t>(lods.size()), 1 });
+	lods.push_back(range);
+	meshlets.insert(meshlets.end(), meshMeshlets.begin(), meshMeshlets.end());
+
+	Chunk chunk;
+	chunk.vertices = mesh.vertices;
+	chunk.indices = mesh.indices;
+	chunks.push_back(std::move(chunk));
+	vertexCount += range.vertexCount;
+	indexCount += range.indexCount;
+
+	return static_cast<uint32_t>(meshes.size() - 1);
+}
+
+std::vector<uint32_t> vkUtil::MeshLibrary::load(const std::string& filename, bool debug) {
+
+	std::vector<uint32_t> meshIndices;
+	if (!CookedMeshFile::is_cooked(filename)) {
+		for (const MeshData& mesh : load_model(filename, debug)) {
+			meshIndices.push_back(add(mesh));
+		}
+		return meshIndices;
+	}
+
+	std::shared_ptr<CookedMeshFile> file = std::make_shared<CookedMeshFile>();
+	if (!file->open(filename, debug)) {
+		return meshIndices;
+	}
+	const CookedMeshHeader& header = file->get_header();
+
+	//the tables are rebased onto the end of the library, the blobs are used as they are
+	uint32_t firstLod = static_cast<uint32_t>(lods.size());
+	uint32_t firstMeshlet = static_cast<uint32_t>(meshlets.size());
+	for (uint32_t i = 0; i < file->get_lod_count(); ++i) {
+		MeshRange range = file->get_lods()[i];
+		range.firstIndex += indexCount;
+		range.vertexOffset += static_cast<int32_t>(vertexCount);
+		range.firstMeshlet += firstMeshlet;
+		lods.push_back(range);
+	}
+	meshlets.insert(meshlets.end(), file->get_meshlets(), file->get_meshlets() + file->get_meshlet_count());
+	for (uint32_t i = 0; i < header.meshCount; ++i) {
+		const CookedMesh& mesh = file->get_meshes()[i];
+		meshes.push_back({ firstLod + mesh.firstLod, mesh.lodCount });
+		meshIndices.push_back(static_cast<uint32_t>(meshes.size() - 1));
+	}
+
+	vertexCount += static_cast<uint32_t>(header.vertices.size / sizeof(Vertex));
+	indexCount += static_cast<uint32_t>(header.indices.size / sizeof(uint32_t));
+	Chunk chunk;
+	chunk.file = file;
+	chunks.push_back(std::move(chunk));
+
+	if (debug) {
+		std::cout << "Mapped " << header.meshCount << " cooked meshes from " << filename << std::endl;
+	}
+	return meshIndices;
+}
+
+void vkUtil::MeshLibrary::upload(MemoryAllocator& allocator, UploadManager& uploads, bool debug) {
+
+	destroy(allocator);
+	if (vertexCount == 0 || indexCount == 0) {
+		return;
+	}
+
+	BufferInputChunk input;
+	input.memoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
+	input.size = vertexCount * sizeof(Vertex);
+	input.usage = vk::BufferUsageFlagBits::eVertexBuffer | vk::BufferUsageFlagBits::eTransferDst;
+	vertexBuffer = allocator.create_buffer(input);
+
+	input.size = indexCount * sizeof(uint32_t);
+	input.usage = vk::BufferUsageFlagBits::eIndexBuffer | vk::BufferUsageFlagBits::eTransferDst;
+	indexBuffer = allocator.create_buffer(input);
+
+	//cooked blobs go from the mapped file into the staging ring, with nothing in between
+	vk::DeviceSize vertexOffset = 0;
+	vk::DeviceSize indexOffset = 0;
+	for (const Chunk& chunk : chunks) {
+
+		const void* vertexData = chunk.vertices.data();
+		vk::DeviceSize vertexSize = chunk.vertices.size() * sizeof(Vertex);
+		const void* indexData = chunk.indices.data();
+		vk::DeviceSize indexSize = chunk.indices.size() * sizeof(uint32_t);
+		if (chunk.file) {
+			const CookedMeshHeader& header = chunk.file->get_header();
+			vertexData = chunk.file->get_blob(header.vertices);
+			vertexSize = header.vertices.size;
+			indexData = chunk.file->get_blob(header.indices);
+			indexSize = header.indices.size;
+		}
+
+		if (vertexSize > 0) {
+			uploads.upload_buffer(
+				vertexData, vertexSize, vertexBuffer.buffer, vertexOffset,
+				vk::PipelineStageFlagBits::eVertexInput, vk::AccessFlagBits::eVertexAttributeRead
+			);
+		}
+		if (indexSize > 0) {
+			uploads.upload_buffer(
+				indexData, indexSize, indexBuffer.buffer, indexOffset,
+				vk::PipelineStageFlagBits::eVertexInput, vk::AccessFlagBits::eIndexRead
+			);
+		}
+		vertexOffset += vertexSize;
+		indexOffset += indexSize;
+	}
+
+	if (debug) {
+		std::cout << "Uploaded " << meshes.size() << " meshes, " << vertexCount << " vertices and "
+			<< indexCount << " indices" << std::endl;
+	}
+}
+
+void vkUtil::MeshLibrary::bind(vk::CommandBuffer commandBuffer) const {
+
+	vk::DeviceSize offset = 0;
+	commandBuffer.bindVertexBuffers(0, vertexBuffer.buffer, offset);
+	commandBuffer.bindIndexBuffer(indexBuffer.buffer, 0, vk::IndexType::eUint32);
+}
+
+std::array<vkUtil::Buffer, 2> vkUtil::MeshLibrary::take_buffers() {
+
+	std::array<Buffer, 2> buffers = { vertexBuffer, indexBuffer };
+	vertexBuffer = Buffer();
+	indexBuffer = Buffer();
+	return buffers;
+}
+
+void vkUtil::MeshLibrary::destroy(MemoryAllocator& allocator) {
+
+	allocator.destroy_buffer(vertexBuffer);
+	allocator.destroy_buffer(indexBuffer);
+}
@@ -0,0 +1,174 @@
+#pragma once
+#include "vulkan/vulkan.hpp"
+#include "memory.h"
+#include "upload.h"
+
+namespace vkUtil
+{
+	class CookedMeshFile;
+
+	/**
+		The vertex format shared by every mesh, must match the vertex shaders' inputs.
+	*/
+	struct Vertex {
+		glm::vec3 position;
+		glm::vec3 normal;
+		glm::vec2 texcoord;
+		glm::vec3 color;
+
+		bool operator==(const Vertex& other) const {
+			return position == other.position && normal == other.normal
+				&& texcoord == other.texcoord && color == other.color;
+		}
+	};
+
+	/**
+		Hashes a vertex bit for bit, so identical vertices can be merged.
+	*/
+	struct VertexHash {
+		size_t operator()(const Vertex& vertex) const;
+	};
+
+	vk::VertexInputBindingDescription get_vertex_binding_description();
+	std::array<vk::VertexInputAttributeDescription, 4> get_vertex_attribute_descriptions();
+
+	/**
+		A mesh's geometry before it's packed into the mesh library.
+	*/
+	struct MeshData {
+		std::vector<Vertex> vertices;
+		std::vector<uint32_t> indices;
+	};
+
+	/**
+		A small cluster of a mesh's triangles, for finer grained culling.
+	*/
+	struct Meshlet {
+		//relative to the first index of the mesh it belongs to
+		uint32_t firstIndex;
+		uint32_t triangleCount;
+		glm::vec3 center;
+		float radius;
+	};
+
+	/**
+		Where a mesh, or one of its levels of detail, lives in the library's buffers,
+		in the terms drawIndexed takes.
+	*/
+	struct MeshRange {
+		uint32_t firstIndex;
+		uint32_t indexCount;
+		//added to each of the mesh's indices, which start from zero
+		int32_t vertexOffset;
+		uint32_t vertexCount;
+		//a sphere around the mesh's origin containing every vertex
+		float boundingRadius;
+		uint32_t firstMeshlet;
+		uint32_t meshletCount;
+	};
+
+	/**
+		Merge identical vertices, rewriting the indices to match.
+
+		\param vertices the vertices, three per triangle if they aren't indexed yet
+		\param indices the indices into vertices, or empty to use the vertices in order
+		\returns the unique vertices and indices into them
+	*/
+	MeshData deduplicate_vertices(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices);
+
+	/**
+		Split a mesh into meshlets of consecutive triangles, each touching at most
+		64 vertices and holding at most 124 triangles.
+	*/
+	std::vector<Meshlet> build_meshlets(const MeshData& mesh);
+
+	/**
+		\returns the radius of a sphere around the origin containing every vertex
+	*/
+	float bounding_radius(const std::vector<Vertex>& vertices);
+
+	/**
+		Packs every mesh into one device local vertex buffer and one index buffer,
+		so any number of meshes can be drawn with a single bind, by drawIndexed
+		with each mesh's offsets or by indirect draws.
+
+		Meshes are added on the cpu, or mapped in from cooked files, then upload copies
+		everything to the gpu at once. Cooked files stay mapped and their blobs are
+		staged straight from the mapping.
+	*/
+	class MeshLibrary
+	{
+	public:
+		/**
+			\param mesh the geometry to add, its indices starting from zero
+			\returns the mesh's index in the library
+		*/
+		uint32_t add(const MeshData& mesh);
+
+		/**
+			Import every mesh in a model file.
+
+			\param filename the path to the model, a cooked mesh file or any format assimp reads
+			\param debug whether to print extra information
+			\returns the indices of the imported meshes, empty if the file couldn't be read
+		*/
+		std::vector<uint32_t> load(const std::string& filename, bool debug);
+
+		/**
+			Make the vertex and index buffers and upload every mesh added so far.
+			Replaces any previous buffers, which the caller must keep alive until the gpu is done with them.
+
+			\param allocator the device memory allocator
+			\param uploads copies the meshes in, the buffers can be used once its acquires are recorded
+			\param debug whether to print extra information
+		*/
+		void upload(MemoryAllocator& allocator, UploadManager& uploads, bool debug);
+
+		/**
+			Bind the vertex and index buffers, every mesh can then be drawn by its range.
+		*/
+		void bind(vk::CommandBuffer commandBuffer) const;
+
+		//the full detail range
+		const MeshRange& get_range(uint32_t mesh) const { return lods[meshes[mesh].firstLod]; }
+		//lod 0 is the full detail mesh
+		const MeshRange& get_lod(uint32_t mesh, uint32_t lod) const { return lods[meshes[mesh].firstLod + lod]; }
+		uint32_t get_lod_count(uint32_t mesh) const { return meshes[mesh].lodCount; }
+		uint32_t get_mesh_count() const { return static_cast<uint32_t>(meshes.size()); }
+		//indexed by a range's firstMeshlet
+		const std::vector<Meshlet>& get_meshlets() const { return meshlets; }
+
+		/**
+			\returns the current buffers, leaving the library without any
+		*/
+		std::array<Buffer, 2> take_buffers();
+
+		void destroy(MemoryAllocator& allocator);
+
+	private:
+		struct MeshEntry {
+			uint32_t firstLod;
+			uint32_t lodCount;
+		};
+
+		/**
+			Vertices and indices copied to the buffers as a whole, either owned or
+			a view of a cooked file, which the chunk keeps mapped.
+		*/
+		struct Chunk {
+			std::vector<Vertex> vertices;
+			std::vector<uint32_t> indices;
+			std::shared_ptr<CookedMeshFile> file;
+		};
+
+		std::vector<Chunk> chunks;
+		uint32_t vertexCount{ 0 };
+		uint32_t indexCount{ 0 };
+		std::vector<MeshEntry> meshes;
+		std::vector<MeshRange> lods;
+		std::vector<Meshlet> meshlets;
+
+		Buffer vertexBuffer;
+		Buffer indexBuffer;
+	};
+}
@@ -0,0 +1,77 @@
+#include "pch.h"
+#include "mesh_loader.h"
+#include "cpu_profiler.h"
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+
+std::vector<vkUtil::MeshData> vkUtil::load_model(const std::string& filename, bool debug) {
+
+	PROFILE_FUNCTION();
+
+	//vertices are deduplicated by hand, so assimp's joining step is left out
+	Assimp::Importer importer;
+	const aiScene* scene = importer.ReadFile(filename,
+		aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_PreTransformVertices
+		| aiProcess_SortByPType | aiProcess_FlipUVs
+	);
+
+	std::vector<MeshData> meshes;
+	if (!scene || (scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE)) {
+		if (debug) {
+			std::cout << "Failed to load " << filename << ": " << importer.GetErrorString() << std::endl;
+		}
+		return meshes;
+	}
+
+	size_t importedVertices = 0;
+	for (unsigned int i = 0; i < scene->mNumMeshes; ++i) {
+
+		const aiMesh* mesh = scene->mMeshes[i];
+		if (!(mesh->mPrimitiveTypes & aiPrimitiveType_TRIANGLE)) {
+			continue;
+		}
+
+		//expanded to three vertices per triangle, then merged back down
+		std::vector<Vertex> vertices;
+		vertices.reserve(3 * static_cast<size_t>(mesh->mNumFaces));
+		for (unsigned int j = 0; j < mesh->mNumFaces; ++j) {
+
+			const aiFace& face = mesh->mFaces[j];
+			if (face.mNumIndices != 3) {
+				continue;
+			}
+
+			for (unsigned int k = 0; k < 3; ++k) {
+				unsigned int index = face.mIndices[k];
+				Vertex vertex = {};
+				vertex.position = glm::vec3(mesh->mVertices[index].x, mesh->mVertices[index].y, mesh->mVertices[index].z);
+				if (mesh->HasNormals()) {
+					vertex.normal = glm::vec3(mesh->mNormals[index].x, mesh->mNormals[index].y, mesh->mNormals[index].z);
+				}
+				if (mesh->HasTextureCoords(0)) {
+					vertex.texcoord = glm::vec2(mesh->mTextureCoords[0][index].x, mesh->mTextureCoords[0][index].y);
+				}
+				vertex.color = glm::vec3(1.0f);
+				if (mesh->HasVertexColors(0)) {
+					vertex.color = glm::vec3(mesh->mColors[0][index].r, mesh->mColors[0][index].g, mesh->mColors[0][index].b);
+				}
+				vertices.push_back(vertex);
+			}
+		}
+
+		importedVertices += vertices.size();
+		meshes.push_back(deduplicate_vertices(vertices, {}));
+	}
+
+	if (debug) {
+		size_t uniqueVertices = 0;
+		for (const MeshData& mesh : meshes) {
+			uniqueVertices += mesh.vertices.size();
+		}
+		std::cout << "Loaded " << meshes.size() << " meshes from " << filename << ", "
+			<< importedVertices << " vertices merged down to " << uniqueVertices << std::endl;
+	}
+
+	return meshes;
+}
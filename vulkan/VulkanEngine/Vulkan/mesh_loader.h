@@ -0,0 +1,15 @@
+#pragma once
+#include "mesh.h"
+
+namespace vkUtil
+{
+	/**
+		Import a model with assimp, triangulated, with its node transforms baked in
+		and its vertices deduplicated. Meshes of points or lines are skipped.
+
+		\param filename the path to the model
+		\param debug whether to print extra information
+		\returns one mesh per mesh in the file, empty if it couldn't be read
+	*/
+	std::vector<MeshData> load_model(const std::string& filename, bool debug);
+}
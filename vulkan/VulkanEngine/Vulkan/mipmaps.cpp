@@ -0,0 +1,358 @@
+#include "pch.h"
+#include "mipmaps.h"
+#include "descriptors.h"
+#include "pipeline.h"
+#include "cpu_profiler.h"
+
+namespace {
+
+	vkInit::descriptorSetLayoutData make_bindings() {
+
+		//binding 0: a storage view of every level, binding 1: the finished workgroup counter
+		vkInit::descriptorSetLayoutData bindings;
+		bindings.count = 2;
+		bindings.indices = { 0, 1 };
+		bindings.types = { vk::DescriptorType::eStorageImage, vk::DescriptorType::eStorageBuffer };
+		bindings.counts = { static_cast<int>(vkUtil::MipGenerator::maxComputeLevels), 1 };
+		bindings.stages = { vk::ShaderStageFlagBits::eCompute, vk::ShaderStageFlagBits::eCompute };
+		return bindings;
+	}
+
+	vk::Offset3D level_size(const vkUtil::Texture& texture, uint32_t level) {
+		return vk::Offset3D(
+			static_cast<int32_t>(std::max(texture.extent.width >> level, 1u)),
+			static_cast<int32_t>(std::max(texture.extent.height >> level, 1u)),
+			1
+		);
+	}
+
+	vk::ImageMemoryBarrier make_barrier(const vkUtil::Texture& texture, uint32_t firstLevel, uint32_t levelCount,
+		vk::ImageLayout oldLayout, vk::ImageLayout newLayout, vk::AccessFlags srcAccess, vk::AccessFlags dstAccess) {
+
+		vk::ImageMemoryBarrier barrier;
+		barrier.oldLayout = oldLayout;
+		barrier.newLayout = newLayout;
+		barrier.srcAccessMask = srcAccess;
+		barrier.dstAccessMask = dstAccess;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = texture.image.image;
+		barrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, firstLevel, levelCount, 0, 1);
+		return barrier;
+	}
+}
+
+vkUtil::MipGenerator::MipGenerator(vk::Device device, vk::PhysicalDevice physicalDevice, MemoryAllocator& allocator,
+	uint32_t queueFamilyIndex, vk::PipelineCache pipelineCache, DescriptorLayoutCache& layouts,
+	bool dynamicIndexing, bool debug)
+	: device(device), allocator(allocator), debugMode(debug) {
+
+	vk::PhysicalDeviceLimits limits = physicalDevice.getProperties().limits;
+	counterAlignment = std::max<vk::DeviceSize>(limits.minStorageBufferOffsetAlignment, sizeof(uint32_t));
+
+	uint32_t validBits = physicalDevice.getQueueFamilyProperties()[queueFamilyIndex].timestampValidBits;
+	if (validBits > 0) {
+		timestampPeriod = limits.timestampPeriod;
+		timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+		vk::QueryPoolCreateInfo queryInfo = {};
+		queryInfo.queryType = vk::QueryType::eTimestamp;
+		queryInfo.queryCount = 2;
+		queryPool = device.createQueryPool(queryInfo);
+	}
+
+	//the shader picks levels out of an array of storage images at runtime
+	if (!dynamicIndexing || limits.maxPerStageDescriptorStorageImages < maxComputeLevels) {
+		if (debugMode) {
+			std::cout << "Compute mip generation is unsupported, textures will be blitted" << std::endl;
+		}
+		return;
+	}
+
+	descriptorSetLayout = layouts.get(make_bindings());
+	//one set per texture, a batch of many textures just adds pools
+	descriptors = std::make_unique<DescriptorAllocator>(
+		device,
+		std::vector<PoolSizeRatio>{
+			{ vk::DescriptorType::eStorageImage, static_cast<float>(maxComputeLevels) },
+			{ vk::DescriptorType::eStorageBuffer, 1.0f }
+		},
+		64, debugMode
+	);
+
+	vkInit::ComputePipelineInBundle specification = {};
+	specification.device = device;
+	specification.computeFilepath = "shaders/mipmaps.spv";
+	specification.descriptorSetLayout = descriptorSetLayout;
+	specification.pushConstantSize = sizeof(MipData);
+	specification.pipelineCache = pipelineCache;
+
+	vkInit::ComputePipelineOutBundle output = vkInit::create_compute_pipeline(specification, debugMode);
+	pipelineLayout = output.layout;
+	pipeline = output.pipeline;
+}
+
+vkUtil::MipGenerator::~MipGenerator() {
+
+	finish();
+	device.destroyQueryPool(queryPool);
+	device.destroyPipeline(pipeline);
+	device.destroyPipelineLayout(pipelineLayout);
+}
+
+void vkUtil::MipGenerator::record(vk::CommandBuffer commandBuffer, const std::vector<Texture>& textures, MipMode mode) {
+
+	PROFILE_FUNCTION();
+
+	stats = MipStats();
+	stats.mode = mode;
+
+	std::vector<const Texture*> blitted;
+	std::vector<const Texture*> computed;
+	for (const Texture& texture : textures) {
+		if (!texture.image.image || !texture.mipsPending) {
+			continue;
+		}
+		if (mode == MipMode::Compute && is_compute_supported() && texture.mipLevels <= maxComputeLevels) {
+			computed.push_back(&texture);
+		}
+		else {
+			blitted.push_back(&texture);
+		}
+		++stats.textureCount;
+		stats.levelCount += texture.mipLevels - 1;
+	}
+
+	if (queryPool) {
+		commandBuffer.resetQueryPool(queryPool, 0, 2);
+		commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe, queryPool, 0);
+	}
+
+	record_blits(commandBuffer, blitted);
+	record_dispatches(commandBuffer, computed);
+
+	if (queryPool) {
+		commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe, queryPool, 1);
+	}
+	recorded = true;
+}
+
+/**
+* Blit every texture's chain one level at a time, so each level needs only one barrier
+*/
+void vkUtil::MipGenerator::record_blits(vk::CommandBuffer commandBuffer, const std::vector<const Texture*>& textures) {
+
+	if (textures.empty()) {
+		return;
+	}
+
+	uint32_t levelCount = 1;
+	std::vector<vk::ImageMemoryBarrier> barriers;
+	for (const Texture* texture : textures) {
+		levelCount = std::max(levelCount, texture->mipLevels);
+		barriers.push_back(make_barrier(
+			*texture, 0, 1, vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eTransferSrcOptimal,
+			vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eTransferRead
+		));
+		barriers.push_back(make_barrier(
+			*texture, 1, texture->mipLevels - 1, vk::ImageLayout::eUndefined, vk::ImageLayout::eTransferDstOptimal,
+			vk::AccessFlags(), vk::AccessFlagBits::eTransferWrite
+		));
+	}
+	commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eFragmentShader, vk::PipelineStageFlagBits::eTransfer,
+		vk::DependencyFlags(), nullptr, nullptr, barriers
+	);
+
+	for (uint32_t level = 1; level < levelCount; ++level) {
+
+		barriers.clear();
+		for (const Texture* texture : textures) {
+			if (level >= texture->mipLevels) {
+				continue;
+			}
+
+			//8 bit sRGB is required to support linear filtering, and blits average in linear space
+			vk::ImageBlit blit;
+			blit.srcSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level - 1, 0, 1);
+			blit.srcOffsets[1] = level_size(*texture, level - 1);
+			blit.dstSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level, 0, 1);
+			blit.dstOffsets[1] = level_size(*texture, level);
+			commandBuffer.blitImage(
+				texture->image.image, vk::ImageLayout::eTransferSrcOptimal,
+				texture->image.image, vk::ImageLayout::eTransferDstOptimal,
+				blit, vk::Filter::eLinear
+			);
+
+			barriers.push_back(make_barrier(
+				*texture, level, 1, vk::ImageLayout::eTransferDstOptimal, vk::ImageLayout::eTransferSrcOptimal,
+				vk::AccessFlagBits::eTransferWrite, vk::AccessFlagBits::eTransferRead
+			));
+		}
+		commandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eTransfer,
+			vk::DependencyFlags(), nullptr, nullptr, barriers
+		);
+	}
+
+	barriers.clear();
+	for (const Texture* texture : textures) {
+		barriers.push_back(make_barrier(
+			*texture, 0, texture->mipLevels, vk::ImageLayout::eTransferSrcOptimal, vk::ImageLayout::eShaderReadOnlyOptimal,
+			vk::AccessFlagBits::eTransferRead, vk::AccessFlagBits::eShaderRead
+		));
+	}
+	commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eFragmentShader,
+		vk::DependencyFlags(), nullptr, nullptr, barriers
+	);
+}
+
+/**
+* One dispatch per texture, none of which depend on each other
+*/
+void vkUtil::MipGenerator::record_dispatches(vk::CommandBuffer commandBuffer, const std::vector<const Texture*>& textures) {
+
+	if (textures.empty()) {
+		return;
+	}
+
+	//each texture counts its finished workgroups in a slot of its own
+	BufferInputChunk input;
+	input.size = static_cast<size_t>(textures.size() * counterAlignment);
+	input.usage = vk::BufferUsageFlagBits::eStorageBuffer | vk::BufferUsageFlagBits::eTransferDst;
+	input.memoryProperties = vk::MemoryPropertyFlagBits::eDeviceLocal;
+	counters = allocator.create_buffer(input);
+
+	std::vector<vk::ImageMemoryBarrier> barriers;
+	std::vector<vk::DescriptorSet> descriptorSets;
+	for (size_t i = 0; i < textures.size(); ++i) {
+
+		const Texture& texture = *textures[i];
+		barriers.push_back(make_barrier(
+			texture, 0, 1, vk::ImageLayout::eShaderReadOnlyOptimal, vk::ImageLayout::eGeneral,
+			vk::AccessFlagBits::eShaderRead, vk::AccessFlagBits::eShaderRead
+		));
+		barriers.push_back(make_barrier(
+			texture, 1, texture.mipLevels - 1, vk::ImageLayout::eUndefined, vk::ImageLayout::eGeneral,
+			vk::AccessFlags(), vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite
+		));
+
+		//sRGB images are written through unorm views, the shader does the conversion
+		vk::ImageViewCreateInfo viewInfo;
+		viewInfo.image = texture.image.image;
+		viewInfo.viewType = vk::ImageViewType::e2D;
+		viewInfo.format = texture.format == vk::Format::eR8G8B8A8Srgb ? vk::Format::eR8G8B8A8Unorm : texture.format;
+
+		//every array element must be valid, the ones past the last level repeat it
+		std::array<vk::DescriptorImageInfo, maxComputeLevels> imageInfos;
+		for (uint32_t level = 0; level < maxComputeLevels; ++level) {
+			if (level < texture.mipLevels) {
+				viewInfo.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, level, 1, 0, 1);
+				storageViews.push_back(device.createImageView(viewInfo));
+			}
+			imageInfos[level].imageView = storageViews.back();
+			imageInfos[level].imageLayout = vk::ImageLayout::eGeneral;
+		}
+
+		vk::DescriptorBufferInfo bufferInfo;
+		bufferInfo.buffer = counters.buffer;
+		bufferInfo.offset = i * counterAlignment;
+		bufferInfo.range = sizeof(uint32_t);
+
+		vk::DescriptorSet descriptorSet = descriptors->allocate(descriptorSetLayout);
+		std::array<vk::WriteDescriptorSet, 2> writes;
+		writes[0].dstSet = descriptorSet;
+		writes[0].dstBinding = 0;
+		writes[0].dstArrayElement = 0;
+		writes[0].descriptorCount = maxComputeLevels;
+		writes[0].descriptorType = vk::DescriptorType::eStorageImage;
+		writes[0].pImageInfo = imageInfos.data();
+		writes[1].dstSet = descriptorSet;
+		writes[1].dstBinding = 1;
+		writes[1].dstArrayElement = 0;
+		writes[1].descriptorCount = 1;
+		writes[1].descriptorType = vk::DescriptorType::eStorageBuffer;
+		writes[1].pBufferInfo = &bufferInfo;
+		device.updateDescriptorSets(writes, nullptr);
+		descriptorSets.push_back(descriptorSet);
+	}
+
+	commandBuffer.fillBuffer(counters.buffer, 0, VK_WHOLE_SIZE, 0);
+	vk::BufferMemoryBarrier counterBarrier;
+	counterBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	counterBarrier.dstAccessMask = vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+	counterBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	counterBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	counterBarrier.buffer = counters.buffer;
+	counterBarrier.offset = 0;
+	counterBarrier.size = VK_WHOLE_SIZE;
+	commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eFragmentShader | vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eComputeShader,
+		vk::DependencyFlags(), nullptr, counterBarrier, barriers
+	);
+
+	commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline);
+	for (size_t i = 0; i < textures.size(); ++i) {
+
+		const Texture& texture = *textures[i];
+		uint32_t groupsX = (texture.extent.width + 63) / 64;
+		uint32_t groupsY = (texture.extent.height + 63) / 64;
+
+		MipData mipData;
+		mipData.levelCount = texture.mipLevels;
+		mipData.workgroupCount = groupsX * groupsY;
+		mipData.srgb = texture.format == vk::Format::eR8G8B8A8Srgb ? 1 : 0;
+
+		commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute, pipelineLayout, 0, descriptorSets[i], nullptr);
+		commandBuffer.pushConstants(pipelineLayout, vk::ShaderStageFlagBits::eCompute, 0, sizeof(mipData), &mipData);
+		commandBuffer.dispatch(groupsX, groupsY, 1);
+	}
+
+	barriers.clear();
+	for (const Texture* texture : textures) {
+		barriers.push_back(make_barrier(
+			*texture, 0, texture->mipLevels, vk::ImageLayout::eGeneral, vk::ImageLayout::eShaderReadOnlyOptimal,
+			vk::AccessFlagBits::eShaderWrite, vk::AccessFlagBits::eShaderRead
+		));
+	}
+	commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eComputeShader, vk::PipelineStageFlagBits::eFragmentShader,
+		vk::DependencyFlags(), nullptr, nullptr, barriers
+	);
+}
+
+const vkUtil::MipStats& vkUtil::MipGenerator::finish() {
+
+	if (!recorded) {
+		return stats;
+	}
+	recorded = false;
+
+	if (queryPool) {
+		std::array<uint64_t, 2> timestamps = {};
+		vk::Result result = device.getQueryPoolResults(
+			queryPool, 0, 2, sizeof(timestamps), timestamps.data(), sizeof(uint64_t),
+			vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait
+		);
+		if (result == vk::Result::eSuccess) {
+			uint64_t ticks = (timestamps[1] - timestamps[0]) & timestampMask;
+			stats.milliseconds = ticks * static_cast<double>(timestampPeriod) / 1000000.0;
+		}
+	}
+
+	for (vk::ImageView view : storageViews) {
+		device.destroyImageView(view);
+	}
+	storageViews.clear();
+	if (descriptors) {
+		descriptors->reset();
+	}
+	allocator.destroy_buffer(counters);
+
+	if (debugMode && stats.textureCount > 0) {
+		std::cout << "Generated " << stats.levelCount << " mip levels for " << stats.textureCount << " textures by "
+			<< (stats.mode == MipMode::Compute ? "compute" : "blitting") << " in " << stats.milliseconds << " ms" << std::endl;
+	}
+	return stats;
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include "vulkan/vulkan.hpp"
+#include "memory.h"
+#include "texture.h"
+#include "descriptor_allocator.h"
+
+namespace vkUtil
+{
+	/**
+		The mip generation shader's push constants.
+	*/
+	struct MipData {
+		//including the top level
+		uint32_t levelCount;
+		//the last workgroup of this many to finish writes the levels past the sixth
+		uint32_t workgroupCount;
+		//whether texels are converted to linear before averaging
+		uint32_t srgb;
+	};
+
+	/**
+		Timings of the last batch of mip chains generated.
+	*/
+	struct MipStats {
+		MipMode mode{ MipMode::None };
+		size_t textureCount{ 0 };
+		//levels written, not counting the uploaded top levels
+		size_t levelCount{ 0 };
+		//gpu time for the whole batch, zero if the queue has no timestamps
+		double milliseconds{ 0.0 };
+	};
+
+	/**
+		Fills in textures' mip chains from their top levels on the graphics queue.
+
+		The blit mode halves each level into the next with blitImage, one level of every
+		texture at a time. The compute mode writes the whole chain in a single dispatch:
+		each workgroup reduces a 64x64 tile to one texel through shared memory, writing
+		six levels, and the last workgroup to finish reduces those texels for the next six.
+	*/
+	class MipGenerator
+	{
+	public:
+		//two reductions of 64x64, so the compute mode takes textures up to 4096x4096
+		static constexpr uint32_t maxComputeLevels = 13;
+
+		/**
+			\param device the logical device
+			\param physicalDevice the physical device
+			\param allocator the device memory allocator
+			\param queueFamilyIndex the family of the queue the commands are submitted to
+			\param pipelineCache the cache to build the compute pipeline with
+			\param layouts the cache which owns the compute pipeline's descriptor set layout
+			\param dynamicIndexing whether shaderStorageImageArrayDynamicIndexing is enabled, the compute mode needs it
+			\param debug whether the system is running in debug mode
+		*/
+		MipGenerator(vk::Device device, vk::PhysicalDevice physicalDevice, MemoryAllocator& allocator,
+			uint32_t queueFamilyIndex, vk::PipelineCache pipelineCache, DescriptorLayoutCache& layouts,
+			bool dynamicIndexing, bool debug);
+		~MipGenerator();
+
+		MipGenerator(const MipGenerator&) = delete;
+		MipGenerator& operator=(const MipGenerator&) = delete;
+
+		//if not, the compute mode blits instead
+		bool is_compute_supported() const { return static_cast<bool>(pipeline); }
+
+		/**
+			Record the generation of each texture's mip chain. The top levels must be in the
+			shader read only layout, visible to fragment shaders, and every level is left that way.
+			Only one batch may be recorded at a time.
+
+			\param commandBuffer a graphics command buffer, outside a renderpass
+			\param textures textures made by a TextureLoader for the same mode, those without pending mips are skipped
+			\param mode how to fill the levels, textures too large for the compute mode are blitted
+		*/
+		void record(vk::CommandBuffer commandBuffer, const std::vector<Texture>& textures, MipMode mode);
+
+		/**
+			Free what the recorded batch used and read back its timings. Its commands must have completed.
+
+			\returns the batch's timings
+		*/
+		const MipStats& finish();
+
+	private:
+		vk::Device device;
+		MemoryAllocator& allocator;
+		bool debugMode;
+
+		vk::DescriptorSetLayout descriptorSetLayout;
+		vk::PipelineLayout pipelineLayout;
+		vk::Pipeline pipeline;
+		vk::DeviceSize counterAlignment;
+
+		vk::QueryPool queryPool;
+		float timestampPeriod{ 0.0f };
+		uint64_t timestampMask{ 0 };
+
+		//reset by finish
+		std::unique_ptr<DescriptorAllocator> descriptors;
+		std::vector<vk::ImageView> storageViews;
+		Buffer counters;
+		bool recorded{ false };
+
+		MipStats stats;
+
+		void record_blits(vk::CommandBuffer commandBuffer, const std::vector<const Texture*>& textures);
+		void record_dispatches(vk::CommandBuffer commandBuffer, const std::vector<const Texture*>& textures);
+	};
+}
@@ -0,0 +1,146 @@
+#include "pch.h"
+#include "offscreen.h"
+#include "cpu_profiler.h"
+
+vkInit::SwapChainBundle vkInit::create_offscreen_targets(vk::Device device, vkUtil::MemoryAllocator& allocator, vk::Extent2D extent, vk::Format format, uint32_t imageCount, bool debug)
+{
+	PROFILE_FUNCTION();
+
+	SwapChainBundle bundle{};
+	bundle.swapchain = nullptr;
+	bundle.format = format;
+	bundle.extent = extent;
+	bundle.frames.resize(imageCount);
+
+	vk::ImageCreateInfo imageInfo = {};
+	imageInfo.imageType = vk::ImageType::e2D;
+	imageInfo.format = format;
+	imageInfo.extent = vk::Extent3D(extent.width, extent.height, 1);
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.samples = vk::SampleCountFlagBits::e1;
+	imageInfo.tiling = vk::ImageTiling::eOptimal;
+	//copied from to read the result back
+	imageInfo.usage = vk::ImageUsageFlagBits::eColorAttachment | vk::ImageUsageFlagBits::eTransferSrc;
+	imageInfo.sharingMode = vk::SharingMode::eExclusive;
+	imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+
+	for (uint32_t i = 0; i < imageCount; ++i) {
+
+		vkUtil::SwapChainFrame& frame = bundle.frames[i];
+		frame.offscreenImage = allocator.create_image(imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal);
+		frame.image = frame.offscreenImage.image;
+
+		vk::ImageViewCreateInfo viewInfo = {};
+		viewInfo.image = frame.image;
+		viewInfo.viewType = vk::ImageViewType::e2D;
+		viewInfo.format = format;
+		viewInfo.components.r = vk::ComponentSwizzle::eIdentity;
+		viewInfo.components.g = vk::ComponentSwizzle::eIdentity;
+		viewInfo.components.b = vk::ComponentSwizzle::eIdentity;
+		viewInfo.components.a = vk::ComponentSwizzle::eIdentity;
+		viewInfo.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+		viewInfo.subresourceRange.baseMipLevel = 0;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = 1;
+		frame.imageView = device.createImageView(viewInfo);
+	}
+
+	if (debug) {
+		std::cout << "Made " << imageCount << " offscreen render targets, width: "
+			<< extent.width << ", height: " << extent.height << '\n';
+	}
+
+	return bundle;
+}
+
+std::vector<uint8_t> vkUtil::read_back_image(ReadbackInput input) {
+
+	vk::DeviceSize size = static_cast<vk::DeviceSize>(input.extent.width) * input.extent.height * 4;
+
+	BufferInputChunk bufferInput;
+	bufferInput.size = size;
+	bufferInput.usage = vk::BufferUsageFlagBits::eTransferDst;
+	bufferInput.memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+	Buffer stagingBuffer = input.allocator.create_buffer(bufferInput);
+
+	vk::CommandBufferBeginInfo beginInfo = {};
+	beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+	input.commandBuffer.begin(beginInfo);
+
+	//the frame left the image in the transfer source layout, but its writes still need to be visible
+	vk::ImageMemoryBarrier barrier = {};
+	barrier.srcAccessMask = vk::AccessFlagBits::eColorAttachmentWrite;
+	barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+	barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+	barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = input.image;
+	barrier.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+	input.commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eColorAttachmentOutput, vk::PipelineStageFlagBits::eTransfer,
+		vk::DependencyFlags(), nullptr, nullptr, barrier
+	);
+
+	vk::BufferImageCopy copy = {};
+	copy.bufferOffset = 0;
+	copy.bufferRowLength = 0;
+	copy.bufferImageHeight = 0;
+	copy.imageSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+	copy.imageOffset = vk::Offset3D(0, 0, 0);
+	copy.imageExtent = vk::Extent3D(input.extent.width, input.extent.height, 1);
+	input.commandBuffer.copyImageToBuffer(input.image, vk::ImageLayout::eTransferSrcOptimal, stagingBuffer.buffer, copy);
+
+	vk::BufferMemoryBarrier hostBarrier = {};
+	hostBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	hostBarrier.dstAccessMask = vk::AccessFlagBits::eHostRead;
+	hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.buffer = stagingBuffer.buffer;
+	hostBarrier.offset = 0;
+	hostBarrier.size = VK_WHOLE_SIZE;
+	input.commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eHost,
+		vk::DependencyFlags(), nullptr, hostBarrier, nullptr
+	);
+
+	input.commandBuffer.end();
+
+	vk::SubmitInfo submitInfo = {};
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &input.commandBuffer;
+	input.queue.submit(submitInfo, nullptr);
+	input.queue.waitIdle();
+
+	std::vector<uint8_t> pixels(size);
+	memcpy(pixels.data(), stagingBuffer.allocation.mapped, size);
+
+	input.allocator.destroy_buffer(stagingBuffer);
+
+	return pixels;
+}
+
+bool vkUtil::write_ppm(const std::string& filename, const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height) {
+
+	std::ofstream file(filename, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	file << "P6\n" << width << ' ' << height << "\n255\n";
+
+	std::vector<uint8_t> row(static_cast<size_t>(width) * 3);
+	for (uint32_t y = 0; y < height; ++y) {
+		const uint8_t* pixel = pixels.data() + static_cast<size_t>(y) * width * 4;
+		for (uint32_t x = 0; x < width; ++x) {
+			row[3 * x + 0] = pixel[4 * x + 0];
+			row[3 * x + 1] = pixel[4 * x + 1];
+			row[3 * x + 2] = pixel[4 * x + 2];
+		}
+		file.write(reinterpret_cast<const char*>(row.data()), row.size());
+	}
+
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "swapchain.h"
+#include "memory.h"
+
+namespace vkInit
+{
+	/**
+		Make images to render into when there's no window to present to. They're
+		handed back in the same form as a swapchain's so the rest of the engine
+		doesn't need to tell the difference.
+
+		\param device the logical device
+		\param allocator the device memory allocator
+		\param extent the size of the images
+		\param format the images' format
+		\param imageCount how many images to make
+		\param debug whether the system is running in debug mode
+		\returns the frames, with a null swapchain
+	*/
+	SwapChainBundle create_offscreen_targets(vk::Device device, vkUtil::MemoryAllocator& allocator, vk::Extent2D extent, vk::Format format, uint32_t imageCount, bool debug);
+}
+
+namespace vkUtil
+{
+	struct ReadbackInput {
+		vk::Device device;
+		vk::Queue queue;
+		vk::CommandBuffer commandBuffer;
+		MemoryAllocator& allocator;
+		vk::Image image;
+		vk::Extent2D extent;
+	};
+
+	/**
+		Copy a 4 byte per pixel image, left in the transfer source layout, back to the cpu.
+		Blocks until the copy is complete.
+
+		\param input the image and the objects needed to copy it
+		\returns the image's pixels, tightly packed
+	*/
+	std::vector<uint8_t> read_back_image(ReadbackInput input);
+
+	/**
+		Write RGBA pixels to a binary PPM file, dropping alpha.
+
+		\param filename the path to write to
+		\param pixels the tightly packed pixels
+		\param width the image width
+		\param height the image height
+		\returns whether the file was written
+	*/
+	bool write_ppm(const std::string& filename, const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height);
+}
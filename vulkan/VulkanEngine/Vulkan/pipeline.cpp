@@ -2,18 +2,19 @@
 #include "pipeline.h"
 #include "shader.h"
 #include "render_structs.h"
+#include "mesh.h"
+#include "cpu_profiler.h"
 
-vk::PipelineLayout vkInit::make_pipeline_layout(vk::Device device, bool debug) {
+vk::PipelineLayout vkInit::make_pipeline_layout(vk::Device device, const std::vector<vk::DescriptorSetLayout>& descriptorSetLayouts, bool debug) {
+
+	PROFILE_FUNCTION();
 
 	vk::PipelineLayoutCreateInfo layoutInfo;
 	layoutInfo.flags = vk::PipelineLayoutCreateFlags();
-	layoutInfo.setLayoutCount = 0;
-	layoutInfo.pushConstantRangeCount = 1;
-	vk::PushConstantRange pushConstantInfo;
-	pushConstantInfo.offset = 0;
-	pushConstantInfo.size = sizeof(vkUtil::ObjectData);
-	pushConstantInfo.stageFlags = vk::ShaderStageFlagBits::eVertex;
-	layoutInfo.pPushConstantRanges = &pushConstantInfo;
+	layoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetLayouts.size());
+	layoutInfo.pSetLayouts = descriptorSetLayouts.data();
+	//per-draw data is read from uniform buffers at dynamic offsets, so there are no push constants
+	layoutInfo.pushConstantRangeCount = 0;
 	try {
 		return device.createPipelineLayout(layoutInfo);
 	}
@@ -29,10 +30,13 @@ vk::PipelineLayout vkInit::make_pipeline_layout(vk::Device device, bool debug) {
 
 	\param device the logical device
 	\param swapchainImageFormat the image format chosen for the swapchain images
+	\param finalLayout the layout to leave the color attachment in, ready to present or copy from
 	\param debug whether the system is running in debug mode
 	\returns the created renderpass
 */
-vk::RenderPass vkInit::make_renderpass(vk::Device device, vk::Format swapchainImageFormat, bool debug) {
+vk::RenderPass vkInit::make_renderpass(vk::Device device, vk::Format swapchainImageFormat, vk::ImageLayout finalLayout, bool debug) {
+
+	PROFILE_FUNCTION();
 
 	//Define a general attachment, with its load/store operations
 	vk::AttachmentDescription colorAttachment = {};
@@ -44,7 +48,7 @@ vk::RenderPass vkInit::make_renderpass(vk::Device device, vk::Format swapchainIm
 	colorAttachment.stencilLoadOp = vk::AttachmentLoadOp::eDontCare;
 	colorAttachment.stencilStoreOp = vk::AttachmentStoreOp::eDontCare;
 	colorAttachment.initialLayout = vk::ImageLayout::eUndefined;
-	colorAttachment.finalLayout = vk::ImageLayout::ePresentSrcKHR;
+	colorAttachment.finalLayout = finalLayout;
 
 	//Declare that attachment to be color buffer 0 of the framebuffer
 	vk::AttachmentReference colorAttachmentRef = {};
@@ -78,6 +82,8 @@ vk::RenderPass vkInit::make_renderpass(vk::Device device, vk::Format swapchainIm
 
 vkInit::GraphicsPipelineOutBundle vkInit::create_graphics_pipeline(GraphicsPipelineInBundle& specification, bool debug)
 {
+	PROFILE_FUNCTION();
+
 	/*
 	* Build and return a graphics pipeline based on the given info.
 	*/
@@ -89,11 +95,15 @@ vkInit::GraphicsPipelineOutBundle vkInit::create_graphics_pipeline(GraphicsPipel
 	//Shader stages, to be populated later
 	std::vector<vk::PipelineShaderStageCreateInfo> shaderStages;
 
-	//Vertex Input
+	//Vertex Input, every mesh shares one vertex format
+	vk::VertexInputBindingDescription bindingDescription = vkUtil::get_vertex_binding_description();
+	std::array<vk::VertexInputAttributeDescription, 4> attributeDescriptions = vkUtil::get_vertex_attribute_descriptions();
 	vk::PipelineVertexInputStateCreateInfo vertexInputInfo = {};
 	vertexInputInfo.flags = vk::PipelineVertexInputStateCreateFlags();
-	vertexInputInfo.vertexBindingDescriptionCount = 0;
-	vertexInputInfo.vertexAttributeDescriptionCount = 0;
+	vertexInputInfo.vertexBindingDescriptionCount = 1;
+	vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+	vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+	vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
 	pipelineInfo.pVertexInputState = &vertexInputInfo;
 
 	//Input Assembly
@@ -117,25 +127,22 @@ vkInit::GraphicsPipelineOutBundle vkInit::create_graphics_pipeline(GraphicsPipel
 	shaderStages.push_back(vertexShaderInfo);
 
 	//Viewport and Scissor
-	vk::Viewport viewport = {};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = (float)specification.swapchainExtent.width;
-	viewport.height = (float)specification.swapchainExtent.height;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-	vk::Rect2D scissor = {};
-	scissor.offset.x = 0.0f;
-	scissor.offset.y = 0.0f;
-	scissor.extent = specification.swapchainExtent;
+	//set while recording, so resizing the window doesn't mean rebuilding the pipeline
 	vk::PipelineViewportStateCreateInfo viewportState = {};
 	viewportState.flags = vk::PipelineViewportStateCreateFlags();
 	viewportState.viewportCount = 1;
-	viewportState.pViewports = &viewport;
+	viewportState.pViewports = nullptr;
 	viewportState.scissorCount = 1;
-	viewportState.pScissors = &scissor;
+	viewportState.pScissors = nullptr;
 	pipelineInfo.pViewportState = &viewportState;
 
+	std::array<vk::DynamicState, 2> dynamicStates = { vk::DynamicState::eViewport, vk::DynamicState::eScissor };
+	vk::PipelineDynamicStateCreateInfo dynamicState = {};
+	dynamicState.flags = vk::PipelineDynamicStateCreateFlags();
+	dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+	dynamicState.pDynamicStates = dynamicStates.data();
+	pipelineInfo.pDynamicState = &dynamicState;
+
 	//Rasterizer
 	vk::PipelineRasterizationStateCreateInfo rasterizer = {};
 	rasterizer.flags = vk::PipelineRasterizationStateCreateFlags();
@@ -192,16 +199,29 @@ vkInit::GraphicsPipelineOutBundle vkInit::create_graphics_pipeline(GraphicsPipel
 	if (debug) {
 		std::cout << "Create Pipeline Layout" << std::endl;
 	}
-	vk::PipelineLayout pipelineLayout = vkInit::make_pipeline_layout(specification.device, debug);
+	vk::PipelineLayout pipelineLayout = specification.layout;
+	if (!pipelineLayout) {
+		pipelineLayout = vkInit::make_pipeline_layout(specification.device, specification.descriptorSetLayouts, debug);
+	}
 	pipelineInfo.layout = pipelineLayout;
 
 	//Renderpass
 	if (debug) {
 		std::cout << "Create RenderPass" << std::endl;
 	}
-	vk::RenderPass renderpass = vkInit::make_renderpass(
-		specification.device, specification.swapchainImageFormat, debug
-	);
+	vk::RenderPass renderpass = specification.renderpass;
+	//with dynamic rendering the pipeline only has to agree with the attachments' formats
+	vk::PipelineRenderingCreateInfoKHR renderingInfo;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachmentFormats = &specification.swapchainImageFormat;
+	if (specification.dynamicRendering) {
+		pipelineInfo.pNext = &renderingInfo;
+	}
+	else if (!renderpass) {
+		renderpass = vkInit::make_renderpass(
+			specification.device, specification.swapchainImageFormat, specification.finalLayout, debug
+		);
+	}
 	pipelineInfo.renderPass = renderpass;
 	pipelineInfo.subpass = 0;
 
@@ -214,7 +234,7 @@ vkInit::GraphicsPipelineOutBundle vkInit::create_graphics_pipeline(GraphicsPipel
 	}
 	vk::Pipeline graphicsPipeline;
 	try {
-		graphicsPipeline = (specification.device.createGraphicsPipeline(nullptr, pipelineInfo)).value;
+		graphicsPipeline = (specification.device.createGraphicsPipeline(specification.pipelineCache, pipelineInfo)).value;
 	}
 	catch (vk::SystemError err) {
 		if (debug) {
@@ -234,6 +254,73 @@ vkInit::GraphicsPipelineOutBundle vkInit::create_graphics_pipeline(GraphicsPipel
 	return output;
 }
 
+vkInit::ComputePipelineOutBundle vkInit::create_compute_pipeline(ComputePipelineInBundle& specification, bool debug) {
+
+	PROFILE_FUNCTION();
+
+	ComputePipelineOutBundle output;
+
+	//Pipeline Layout
+	if (debug) {
+		std::cout << "Create Compute Pipeline Layout" << std::endl;
+	}
+	vk::PushConstantRange pushConstantInfo;
+	pushConstantInfo.offset = 0;
+	pushConstantInfo.size = specification.pushConstantSize;
+	pushConstantInfo.stageFlags = vk::ShaderStageFlagBits::eCompute;
+
+	vk::PipelineLayoutCreateInfo layoutInfo;
+	layoutInfo.flags = vk::PipelineLayoutCreateFlags();
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &specification.descriptorSetLayout;
+	layoutInfo.pushConstantRangeCount = specification.pushConstantSize > 0 ? 1 : 0;
+	layoutInfo.pPushConstantRanges = &pushConstantInfo;
+	try {
+		output.layout = specification.device.createPipelineLayout(layoutInfo);
+	}
+	catch (vk::SystemError err) {
+		if (debug) {
+			std::cout << "Failed to create compute pipeline layout!" << std::endl;
+		}
+	}
+
+	//Compute Shader
+	if (debug) {
+		std::cout << "Create compute shader module" << std::endl;
+	}
+	vk::ShaderModule computeShader = vkUtil::createModule(
+		specification.computeFilepath, specification.device, debug
+	);
+	vk::PipelineShaderStageCreateInfo computeShaderInfo = {};
+	computeShaderInfo.flags = vk::PipelineShaderStageCreateFlags();
+	computeShaderInfo.stage = vk::ShaderStageFlagBits::eCompute;
+	computeShaderInfo.module = computeShader;
+	computeShaderInfo.pName = "main";
+
+	vk::ComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.flags = vk::PipelineCreateFlags();
+	pipelineInfo.stage = computeShaderInfo;
+	pipelineInfo.layout = output.layout;
+	pipelineInfo.basePipelineHandle = nullptr;
+
+	//Make the Pipeline
+	if (debug) {
+		std::cout << "Create Compute Pipeline" << std::endl;
+	}
+	try {
+		output.pipeline = (specification.device.createComputePipeline(specification.pipelineCache, pipelineInfo)).value;
+	}
+	catch (vk::SystemError err) {
+		if (debug) {
+			std::cout << "Failed to create Compute Pipeline" << std::endl;
+		}
+	}
+
+	specification.device.destroyShaderModule(computeShader);
+
+	return output;
+}
+
 /**
 	Make a graphics pipeline, along with renderpass and pipeline layout
 
@@ -6,8 +6,18 @@ namespace vkInit
 		vk::Device device;
 		std::string vertexFilepath;
 		std::string fragmentFilepath;
-		vk::Extent2D swapchainExtent;
 		vk::Format swapchainImageFormat;
+		//the layout the color attachment is left in once the renderpass ends
+		vk::ImageLayout finalLayout = vk::ImageLayout::ePresentSrcKHR;
+		//describe the attachments by format alone, for VK_KHR_dynamic_rendering, instead of making a renderpass
+		bool dynamicRendering = false;
+		//in set order
+		std::vector<vk::DescriptorSetLayout> descriptorSetLayouts;
+		vk::PipelineCache pipelineCache;
+
+		//if set, these are shared with the new pipeline instead of being created
+		vk::PipelineLayout layout;
+		vk::RenderPass renderpass;
 	};
 
 	/**
@@ -16,11 +26,34 @@ namespace vkInit
 	*/
 	struct GraphicsPipelineOutBundle {
 		vk::PipelineLayout layout;
+		//null for dynamic rendering
 		vk::RenderPass renderpass;
 		vk::Pipeline pipeline;
 	};
 
-	vk::PipelineLayout make_pipeline_layout(vk::Device device, bool debug);
-	vk::RenderPass make_renderpass(vk::Device device, vk::Format swapchainImageFormat, bool debug);
+	struct ComputePipelineInBundle {
+		vk::Device device;
+		std::string computeFilepath;
+		vk::DescriptorSetLayout descriptorSetLayout;
+		uint32_t pushConstantSize;
+		vk::PipelineCache pipelineCache;
+	};
+
+	struct ComputePipelineOutBundle {
+		vk::PipelineLayout layout;
+		vk::Pipeline pipeline;
+	};
+
+	vk::PipelineLayout make_pipeline_layout(vk::Device device, const std::vector<vk::DescriptorSetLayout>& descriptorSetLayouts, bool debug);
+	vk::RenderPass make_renderpass(vk::Device device, vk::Format swapchainImageFormat, vk::ImageLayout finalLayout, bool debug);
 	GraphicsPipelineOutBundle create_graphics_pipeline(GraphicsPipelineInBundle& specification, bool debug);
+
+	/**
+		Make a compute pipeline, along with its pipeline layout
+
+		\param specification the compute shader and resources it uses
+		\param debug whether the system is running in debug mode
+		\returns the pipeline and its layout
+	*/
+	ComputePipelineOutBundle create_compute_pipeline(ComputePipelineInBundle& specification, bool debug);
 }
\ No newline at end of file
@@ -0,0 +1,187 @@
+#include "pch.h"
+#include "pipeline_cache.h"
+#include "cpu_profiler.h"
+
+namespace {
+
+	constexpr uint32_t cacheMagic = 0x43504B56; //"VKPC"
+	constexpr uint32_t cacheVersion = 1;
+
+	/*
+	* Written in front of the driver's cache data, laid out without padding so it can be hashed. The driver checks its own header too,
+	* but some drivers crash on corrupt data rather than rejecting it, so we check first.
+	*/
+	struct PipelineCacheFileHeader {
+		uint32_t magic;
+		uint32_t version;
+		uint64_t dataSize;
+		uint32_t vendorID;
+		uint32_t deviceID;
+		uint32_t driverVersion;
+		uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+		uint32_t dataChecksum;
+		//covers every field above
+		uint32_t headerChecksum;
+	};
+
+	//FNV-1a
+	uint32_t checksum(const void* data, size_t size) {
+
+		const uint8_t* bytes = static_cast<const uint8_t*>(data);
+		uint32_t hash = 2166136261u;
+		for (size_t i = 0; i < size; ++i) {
+			hash = (hash ^ bytes[i]) * 16777619u;
+		}
+		return hash;
+	}
+
+	uint32_t header_checksum(const PipelineCacheFileHeader& header) {
+
+		return checksum(&header, offsetof(PipelineCacheFileHeader, headerChecksum));
+	}
+
+	bool matches_device(const PipelineCacheFileHeader& header, const vk::PhysicalDeviceProperties& properties) {
+
+		return header.vendorID == properties.vendorID
+			&& header.deviceID == properties.deviceID
+			&& header.driverVersion == properties.driverVersion
+			&& memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+	}
+
+	/**
+		Read and validate a saved cache.
+
+		\returns the driver's cache data, empty if the file is missing or unusable
+	*/
+	std::vector<char> read_cache_file(const std::string& filename, const vk::PhysicalDeviceProperties& properties, bool debug) {
+
+		std::ifstream file(filename, std::ios::binary);
+		if (!file.is_open()) {
+			if (debug) {
+				std::cout << "No pipeline cache found at \"" << filename << "\"" << std::endl;
+			}
+			return {};
+		}
+
+		PipelineCacheFileHeader header = {};
+		if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))
+			|| header.magic != cacheMagic || header.version != cacheVersion
+			|| header.headerChecksum != header_checksum(header)) {
+			if (debug) {
+				std::cout << "Pipeline cache header is corrupt, ignoring it" << std::endl;
+			}
+			return {};
+		}
+
+		if (!matches_device(header, properties)) {
+			if (debug) {
+				std::cout << "Pipeline cache was made by a different device or driver, ignoring it" << std::endl;
+			}
+			return {};
+		}
+
+		std::vector<char> data(header.dataSize);
+		if (!file.read(data.data(), data.size()) || header.dataChecksum != checksum(data.data(), data.size())) {
+			if (debug) {
+				std::cout << "Pipeline cache data is corrupt, ignoring it" << std::endl;
+			}
+			return {};
+		}
+
+		return data;
+	}
+}
+
+vk::PipelineCache vkInit::make_pipeline_cache(vk::Device device, vk::PhysicalDevice physicalDevice, const std::string& filename, bool debug, bool& loaded) {
+
+	PROFILE_FUNCTION();
+
+	std::vector<char> initialData = read_cache_file(filename, physicalDevice.getProperties(), debug);
+	loaded = !initialData.empty();
+
+	vk::PipelineCacheCreateInfo cacheInfo = {};
+	cacheInfo.flags = vk::PipelineCacheCreateFlags();
+	cacheInfo.initialDataSize = initialData.size();
+	cacheInfo.pInitialData = initialData.data();
+
+	try {
+		vk::PipelineCache pipelineCache = device.createPipelineCache(cacheInfo);
+		if (debug) {
+			std::cout << "Made pipeline cache from " << initialData.size() << " bytes of saved data" << std::endl;
+		}
+		return pipelineCache;
+	}
+	catch (vk::SystemError err) {
+		if (debug) {
+			std::cout << "Failed to make pipeline cache from saved data, starting empty" << std::endl;
+		}
+	}
+
+	loaded = false;
+	cacheInfo.initialDataSize = 0;
+	cacheInfo.pInitialData = nullptr;
+	try {
+		return device.createPipelineCache(cacheInfo);
+	}
+	catch (vk::SystemError err) {
+		if (debug) {
+			std::cout << "Failed to make pipeline cache" << std::endl;
+		}
+		return nullptr;
+	}
+}
+
+void vkUtil::save_pipeline_cache(vk::Device device, vk::PhysicalDevice physicalDevice, vk::PipelineCache pipelineCache, const std::string& filename, bool debug) {
+
+	if (!pipelineCache) {
+		return;
+	}
+
+	std::vector<uint8_t> data = device.getPipelineCacheData(pipelineCache);
+	vk::PhysicalDeviceProperties properties = physicalDevice.getProperties();
+
+	PipelineCacheFileHeader header = {};
+	header.magic = cacheMagic;
+	header.version = cacheVersion;
+	header.vendorID = properties.vendorID;
+	header.deviceID = properties.deviceID;
+	header.driverVersion = properties.driverVersion;
+	memcpy(header.pipelineCacheUUID, properties.pipelineCacheUUID.data(), VK_UUID_SIZE);
+	header.dataSize = data.size();
+	header.dataChecksum = checksum(data.data(), data.size());
+	header.headerChecksum = header_checksum(header);
+
+	//write to a temporary file first so a crash mid-write can't leave a truncated cache behind
+	std::string temporaryFilename = filename + ".tmp";
+	{
+		std::ofstream file(temporaryFilename, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) {
+			if (debug) {
+				std::cout << "Failed to open \"" << temporaryFilename << "\" to save pipeline cache" << std::endl;
+			}
+			return;
+		}
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(data.data()), data.size());
+		file.flush();
+		if (!file) {
+			file.close();
+			std::remove(temporaryFilename.c_str());
+			if (debug) {
+				std::cout << "Failed to write pipeline cache to \"" << temporaryFilename << "\"" << std::endl;
+			}
+			return;
+		}
+	}
+	std::remove(filename.c_str());
+	if (std::rename(temporaryFilename.c_str(), filename.c_str()) != 0) {
+		if (debug) {
+			std::cout << "Failed to rename \"" << temporaryFilename << "\" to \"" << filename << "\"" << std::endl;
+		}
+		return;
+	}
+
+	if (debug) {
+		std::cout << "Saved " << data.size() << " bytes of pipeline cache to \"" << filename << "\"" << std::endl;
+	}
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+namespace vkInit
+{
+	/**
+		Make a pipeline cache, seeded from disk if a cache saved by the same
+		device and driver is found there.
+
+		\param device the logical device
+		\param physicalDevice the physical device, used to validate the saved cache
+		\param filename the path of the saved cache
+		\param debug whether the system is running in debug mode
+		\param loaded set to whether saved data was used
+		\returns the created pipeline cache
+	*/
+	vk::PipelineCache make_pipeline_cache(vk::Device device, vk::PhysicalDevice physicalDevice, const std::string& filename, bool debug, bool& loaded);
+}
+
+namespace vkUtil
+{
+	/**
+		Write a pipeline cache to disk, tagged with the device and driver which made it.
+
+		\param device the logical device
+		\param physicalDevice the physical device
+		\param pipelineCache the cache to save
+		\param filename the path to save to
+		\param debug whether the system is running in debug mode
+	*/
+	void save_pipeline_cache(vk::Device device, vk::PhysicalDevice physicalDevice, vk::PipelineCache pipelineCache, const std::string& filename, bool debug);
+}
@@ -11,27 +11,74 @@ vkUtil::QueueFamilyIndices vkUtil::findQueueFamilies(vk::PhysicalDevice device,
 		std::cout << "System can support " << queueFamilies.size() << " queue families" << std::endl;
 	}
 
+	//a family with transfer but neither graphics nor compute is usually a dedicated copy engine
+	std::optional<uint32_t> dedicatedTransfer, asyncTransfer;
+
 	int i = 0;
 	for (vk::QueueFamilyProperties queueFamily : queueFamilies)
 	{
-		if (queueFamily.queueFlags & vk::QueueFlagBits::eGraphics)
+		if ((queueFamily.queueFlags & vk::QueueFlagBits::eGraphics) && !indices.graphicsFamily.has_value())
 		{
 			indices.graphicsFamily = i;
 
 
 		}
-		if (device.getSurfaceSupportKHR(i, surface))
+		//headless rendering presents nothing, so the graphics queue stands in
+		if (!surface)
+		{
+			indices.presentFamily = indices.graphicsFamily;
+		}
+		else if (!indices.presentFamily.has_value() && device.getSurfaceSupportKHR(i, surface))
 		{
 			indices.presentFamily = i;
 
 		}
-		if (indices.isComplete())
+		//graphics and compute queues support transfers implicitly
+		if (!(queueFamily.queueFlags & vk::QueueFlagBits::eGraphics))
 		{
-			break;
+			if (!(queueFamily.queueFlags & vk::QueueFlagBits::eCompute) && (queueFamily.queueFlags & vk::QueueFlagBits::eTransfer))
+			{
+				if (!dedicatedTransfer.has_value())
+				{
+					dedicatedTransfer = i;
+				}
+			}
+			else if ((queueFamily.queueFlags & (vk::QueueFlagBits::eCompute | vk::QueueFlagBits::eTransfer)) && !asyncTransfer.has_value())
+			{
+				asyncTransfer = i;
+			}
+			if ((queueFamily.queueFlags & vk::QueueFlagBits::eCompute) && !indices.computeFamily.has_value())
+			{
+				indices.computeFamily = i;
+			}
 		}
 		i++;
 	}
 
+	if (dedicatedTransfer.has_value())
+	{
+		indices.transferFamily = dedicatedTransfer;
+	}
+	else if (asyncTransfer.has_value())
+	{
+		indices.transferFamily = asyncTransfer;
+	}
+	else
+	{
+		indices.transferFamily = indices.graphicsFamily;
+	}
+
+	if (!indices.computeFamily.has_value())
+	{
+		indices.computeFamily = indices.graphicsFamily;
+	}
+
+	if (debug && indices.graphicsFamily.has_value())
+	{
+		std::cout << "Queue family " << indices.transferFamily.value() << " is suitable for transfers" << std::endl;
+		std::cout << "Queue family " << indices.computeFamily.value() << " is suitable for async compute" << std::endl;
+	}
+
 	return indices;
 
 }
@@ -6,6 +6,11 @@ namespace vkUtil
 	{
 		std::optional<uint32_t> graphicsFamily;
 		std::optional<uint32_t> presentFamily;
+		//a family for uploads, preferably without graphics so copies run alongside rendering.
+		//falls back to the graphics family
+		std::optional<uint32_t> transferFamily;
+		//a family for async compute, preferably without graphics. Falls back to the graphics family
+		std::optional<uint32_t> computeFamily;
 
 		bool isComplete()
 		{
@@ -0,0 +1,799 @@
+#include "pch.h"
+#include "render_graph.h"
+#include "cpu_profiler.h"
+
+namespace {
+
+	void hash_combine(size_t& seed, size_t value) {
+		seed ^= value + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+	}
+
+	struct AccessInfo {
+		vk::PipelineStageFlags stages;
+		vk::AccessFlags access;
+		vk::ImageLayout layout;
+		bool write;
+		vk::ImageUsageFlags imageUsage;
+		vk::BufferUsageFlags bufferUsage;
+	};
+
+	AccessInfo get_access_info(vkUtil::RenderAccess access) {
+
+		using Access = vkUtil::RenderAccess;
+		using Stage = vk::PipelineStageFlagBits;
+		using Flag = vk::AccessFlagBits;
+
+		switch (access) {
+		case Access::ColorAttachment:
+			return { Stage::eColorAttachmentOutput, Flag::eColorAttachmentRead | Flag::eColorAttachmentWrite,
+				vk::ImageLayout::eColorAttachmentOptimal, true, vk::ImageUsageFlagBits::eColorAttachment, {} };
+		case Access::DepthAttachment:
+			return { Stage::eEarlyFragmentTests | Stage::eLateFragmentTests,
+				Flag::eDepthStencilAttachmentRead | Flag::eDepthStencilAttachmentWrite,
+				vk::ImageLayout::eDepthStencilAttachmentOptimal, true, vk::ImageUsageFlagBits::eDepthStencilAttachment, {} };
+		case Access::SampledRead:
+			return { Stage::eFragmentShader | Stage::eComputeShader, Flag::eShaderRead,
+				vk::ImageLayout::eShaderReadOnlyOptimal, false, vk::ImageUsageFlagBits::eSampled,
+				vk::BufferUsageFlagBits::eUniformBuffer };
+		case Access::StorageRead:
+			return { Stage::eComputeShader, Flag::eShaderRead, vk::ImageLayout::eGeneral, false,
+				vk::ImageUsageFlagBits::eStorage, vk::BufferUsageFlagBits::eStorageBuffer };
+		case Access::StorageWrite:
+			return { Stage::eComputeShader, Flag::eShaderRead | Flag::eShaderWrite, vk::ImageLayout::eGeneral, true,
+				vk::ImageUsageFlagBits::eStorage, vk::BufferUsageFlagBits::eStorageBuffer };
+		case Access::TransferRead:
+			return { Stage::eTransfer, Flag::eTransferRead, vk::ImageLayout::eTransferSrcOptimal, false,
+				vk::ImageUsageFlagBits::eTransferSrc, vk::BufferUsageFlagBits::eTransferSrc };
+		case Access::TransferWrite:
+			return { Stage::eTransfer, Flag::eTransferWrite, vk::ImageLayout::eTransferDstOptimal, true,
+				vk::ImageUsageFlagBits::eTransferDst, vk::BufferUsageFlagBits::eTransferDst };
+		case Access::IndirectRead:
+		default:
+			return { Stage::eDrawIndirect, Flag::eIndirectCommandRead, vk::ImageLayout::eUndefined, false,
+				{}, vk::BufferUsageFlagBits::eIndirectBuffer };
+		}
+	}
+
+	//only writes need making available, read bits in a source access mask do nothing
+	constexpr vk::AccessFlags writeAccessBits = vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eColorAttachmentWrite
+		| vk::AccessFlagBits::eDepthStencilAttachmentWrite | vk::AccessFlagBits::eTransferWrite;
+
+	bool is_depth_format(vk::Format format) {
+
+		return format == vk::Format::eD16Unorm || format == vk::Format::eD32Sfloat
+			|| format == vk::Format::eD24UnormS8Uint || format == vk::Format::eD32SfloatS8Uint;
+	}
+
+	bool has_stencil(vk::Format format) {
+
+		return format == vk::Format::eD24UnormS8Uint || format == vk::Format::eD32SfloatS8Uint;
+	}
+
+	//bytes per texel of the formats attachments tend to use, for estimating without a device
+	vk::DeviceSize texel_size(vk::Format format) {
+
+		switch (format) {
+		case vk::Format::eR8Unorm:
+			return 1;
+		case vk::Format::eR16G16B16A16Sfloat:
+		case vk::Format::eR32G32Sfloat:
+		case vk::Format::eD32SfloatS8Uint:
+			return 8;
+		case vk::Format::eR32G32B32A32Sfloat:
+			return 16;
+		default:
+			return 4;
+		}
+	}
+
+	vk::DeviceSize align_up(vk::DeviceSize value, vk::DeviceSize alignment) {
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	//where a resource's contents stand while the plan is being made
+	struct ResourceState {
+		vk::ImageLayout layout{ vk::ImageLayout::eUndefined };
+		//the last write, and whatever has read since
+		vk::PipelineStageFlags writeStages;
+		vk::AccessFlags writeAccess;
+		vk::PipelineStageFlags readStages;
+		//the stages and accesses the last write has been made visible to
+		vk::PipelineStageFlags visibleStages;
+		vk::AccessFlags visibleAccess;
+		bool used{ false };
+	};
+}
+
+vkUtil::RenderGraph::RenderGraph(vk::Device device, MemoryAllocator* allocator, bool debug)
+	: device(device), allocator(allocator), debugMode(debug) {
+}
+
+vkUtil::RenderGraph::~RenderGraph() {
+
+	destroy_transients();
+}
+
+void vkUtil::RenderGraph::begin() {
+
+	passes.clear();
+	resources.clear();
+}
+
+vkUtil::RenderResource vkUtil::RenderGraph::create_image(const char* name, vk::Extent2D extent, vk::Format format) {
+
+	Resource resource;
+	resource.name = name;
+	resource.imported = false;
+	resource.isImage = true;
+	resource.extent = extent;
+	resource.format = format;
+	resources.push_back(resource);
+	return static_cast<RenderResource>(resources.size() - 1);
+}
+
+vkUtil::RenderResource vkUtil::RenderGraph::create_buffer(const char* name, vk::DeviceSize size) {
+
+	Resource resource;
+	resource.name = name;
+	resource.imported = false;
+	resource.isImage = false;
+	resource.size = size;
+	resources.push_back(resource);
+	return static_cast<RenderResource>(resources.size() - 1);
+}
+
+vkUtil::RenderResource vkUtil::RenderGraph::import_image(const char* name, vk::Image image, vk::ImageView view,
+	vk::ImageLayout initialLayout, vk::ImageLayout finalLayout) {
+
+	Resource resource;
+	resource.name = name;
+	resource.imported = true;
+	resource.isImage = true;
+	resource.output = finalLayout != vk::ImageLayout::eUndefined;
+	resource.initialLayout = initialLayout;
+	resource.finalLayout = finalLayout;
+	resource.image = image;
+	resource.view = view;
+	resources.push_back(resource);
+	return static_cast<RenderResource>(resources.size() - 1);
+}
+
+vkUtil::RenderResource vkUtil::RenderGraph::import_buffer(const char* name, vk::Buffer buffer) {
+
+	Resource resource;
+	resource.name = name;
+	resource.imported = true;
+	resource.isImage = false;
+	resource.buffer = buffer;
+	resources.push_back(resource);
+	return static_cast<RenderResource>(resources.size() - 1);
+}
+
+void vkUtil::RenderGraph::mark_output(RenderResource resource) {
+
+	resources[resource].output = true;
+}
+
+uint32_t vkUtil::RenderGraph::add_pass(const char* name, PassCallback callback, bool sideEffects) {
+
+	Pass pass;
+	pass.name = name;
+	pass.callback = std::move(callback);
+	pass.sideEffects = sideEffects;
+	passes.push_back(std::move(pass));
+	return static_cast<uint32_t>(passes.size() - 1);
+}
+
+void vkUtil::RenderGraph::use(uint32_t pass, RenderResource resource, RenderAccess access) {
+
+	AccessInfo info = get_access_info(access);
+	if (!resources[resource].isImage) {
+		info.layout = vk::ImageLayout::eUndefined;
+	}
+	else if (access == RenderAccess::IndirectRead) {
+		if (debugMode) {
+			std::cout << "Pass " << passes[pass].name << " can't read image " << resources[resource].name
+				<< " as indirect commands" << std::endl;
+		}
+		return;
+	}
+
+	//several uses of one resource by a pass fold into one, in the general layout if they disagree
+	for (Use& existing : passes[pass].uses) {
+		if (existing.resource == resource) {
+			existing.stages |= info.stages;
+			existing.access |= info.access;
+			existing.write = existing.write || info.write;
+			existing.imageUsage |= info.imageUsage;
+			existing.bufferUsage |= info.bufferUsage;
+			if (existing.layout != info.layout) {
+				existing.layout = vk::ImageLayout::eGeneral;
+			}
+			return;
+		}
+	}
+
+	passes[pass].uses.push_back({ resource, info.stages, info.access, info.layout, info.write, info.imageUsage, info.bufferUsage });
+}
+
+size_t vkUtil::RenderGraph::hash_topology() const {
+
+	size_t seed = std::hash<size_t>()(passes.size());
+	for (const Pass& pass : passes) {
+		hash_combine(seed, pass.sideEffects);
+		hash_combine(seed, pass.uses.size());
+		for (const Use& use : pass.uses) {
+			hash_combine(seed, use.resource);
+			hash_combine(seed, static_cast<VkAccessFlags>(use.access));
+			hash_combine(seed, static_cast<size_t>(use.layout));
+			hash_combine(seed, static_cast<VkImageUsageFlags>(use.imageUsage));
+			hash_combine(seed, static_cast<VkBufferUsageFlags>(use.bufferUsage));
+		}
+	}
+
+	//handles are left out, they're allowed to change between frames
+	hash_combine(seed, resources.size());
+	for (const Resource& resource : resources) {
+		hash_combine(seed, resource.imported);
+		hash_combine(seed, resource.isImage);
+		hash_combine(seed, resource.output);
+		hash_combine(seed, resource.extent.width);
+		hash_combine(seed, resource.extent.height);
+		hash_combine(seed, static_cast<size_t>(resource.format));
+		hash_combine(seed, resource.size);
+		hash_combine(seed, static_cast<size_t>(resource.initialLayout));
+		hash_combine(seed, static_cast<size_t>(resource.finalLayout));
+	}
+	return seed;
+}
+
+void vkUtil::RenderGraph::cull(std::vector<bool>& kept) const {
+
+	kept.assign(passes.size(), false);
+
+	//walk back from the outputs, a pass is needed if it writes something which is needed.
+	//Everything a needed pass touches is needed in turn, since attachments and storage
+	//writes may keep what was already there.
+	std::vector<bool> needed(resources.size(), false);
+	for (size_t i = 0; i < resources.size(); ++i) {
+		needed[i] = resources[i].output;
+	}
+
+	for (size_t i = passes.size(); i-- > 0;) {
+		const Pass& pass = passes[i];
+		bool keep = pass.sideEffects;
+		for (const Use& use : pass.uses) {
+			keep = keep || (use.write && needed[use.resource]);
+		}
+		if (!keep) {
+			continue;
+		}
+		kept[i] = true;
+		for (const Use& use : pass.uses) {
+			needed[use.resource] = true;
+		}
+	}
+}
+
+bool vkUtil::RenderGraph::compile() {
+
+	size_t hash = hash_topology();
+	if (compiled && hash == compiledHash) {
+		bind_transients();
+		return false;
+	}
+
+	PROFILE_FUNCTION();
+
+	destroy_transients();
+	schedule.clear();
+	placements.clear();
+	heaps.clear();
+	size_t compileCount = stats.compileCount;
+	stats = RenderGraphStats();
+	stats.compileCount = compileCount;
+
+	std::vector<bool> kept;
+	cull(kept);
+	for (uint32_t i = 0; i < passes.size(); ++i) {
+		if (kept[i]) {
+			schedule.push_back({ i, BarrierBatch() });
+		}
+	}
+	stats.passCount = passes.size();
+	stats.culledPassCount = passes.size() - schedule.size();
+
+	//transient resources live from the first pass which uses them to the last
+	std::vector<int> placementOf(resources.size(), -1);
+	for (uint32_t step = 0; step < schedule.size(); ++step) {
+		for (const Use& use : passes[schedule[step].pass].uses) {
+			if (resources[use.resource].imported) {
+				continue;
+			}
+			if (placementOf[use.resource] < 0) {
+				placementOf[use.resource] = static_cast<int>(placements.size());
+				Placement placement;
+				placement.resource = use.resource;
+				placement.first = step;
+				placements.push_back(placement);
+			}
+			placements[placementOf[use.resource]].last = step;
+		}
+	}
+
+	make_transients();
+	place_transients();
+	bind_memory();
+	make_barriers();
+
+	compiledHash = hash;
+	compiled = true;
+	++stats.compileCount;
+	bind_transients();
+
+	if (debugMode) {
+		std::cout << describe();
+	}
+	return true;
+}
+
+void vkUtil::RenderGraph::make_transients() {
+
+	transientImages.assign(resources.size(), nullptr);
+	transientViews.assign(resources.size(), nullptr);
+	transientBuffers.assign(resources.size(), nullptr);
+
+	for (Placement& placement : placements) {
+
+		const Resource& resource = resources[placement.resource];
+		vk::ImageUsageFlags imageUsage;
+		vk::BufferUsageFlags bufferUsage;
+		for (const CompiledPass& step : schedule) {
+			for (const Use& use : passes[step.pass].uses) {
+				if (use.resource != placement.resource) {
+					continue;
+				}
+				imageUsage |= use.imageUsage;
+				bufferUsage |= use.bufferUsage;
+			}
+		}
+
+		placement.linear = !resource.isImage;
+
+		//without a device, estimate what a driver would ask for
+		if (!device) {
+			if (resource.isImage) {
+				placement.requirements.size = resource.extent.width * resource.extent.height * texel_size(resource.format);
+				placement.requirements.alignment = 65536;
+			}
+			else {
+				placement.requirements.size = resource.size;
+				placement.requirements.alignment = 256;
+			}
+			placement.requirements.memoryTypeBits = ~0u;
+			continue;
+		}
+
+		try {
+			if (resource.isImage) {
+				vk::ImageCreateInfo imageInfo;
+				imageInfo.imageType = vk::ImageType::e2D;
+				imageInfo.extent = vk::Extent3D(resource.extent.width, resource.extent.height, 1);
+				imageInfo.mipLevels = 1;
+				imageInfo.arrayLayers = 1;
+				imageInfo.format = resource.format;
+				imageInfo.tiling = vk::ImageTiling::eOptimal;
+				imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+				imageInfo.usage = imageUsage;
+				imageInfo.sharingMode = vk::SharingMode::eExclusive;
+				imageInfo.samples = vk::SampleCountFlagBits::e1;
+				transientImages[placement.resource] = device.createImage(imageInfo);
+				placement.requirements = device.getImageMemoryRequirements(transientImages[placement.resource]);
+			}
+			else {
+				vk::BufferCreateInfo bufferInfo;
+				bufferInfo.size = resource.size;
+				bufferInfo.usage = bufferUsage;
+				bufferInfo.sharingMode = vk::SharingMode::eExclusive;
+				transientBuffers[placement.resource] = device.createBuffer(bufferInfo);
+				placement.requirements = device.getBufferMemoryRequirements(transientBuffers[placement.resource]);
+			}
+		}
+		catch (vk::SystemError err) {
+			if (debugMode) {
+				std::cout << "Failed to make transient resource " << resource.name << std::endl;
+			}
+		}
+	}
+}
+
+void vkUtil::RenderGraph::place_transients() {
+
+	//biggest first, each at the lowest offset clear of everything alive at the same time
+	std::vector<size_t> order;
+	for (size_t i = 0; i < placements.size(); ++i) {
+		order.push_back(i);
+	}
+	std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+		return placements[a].requirements.size > placements[b].requirements.size;
+	});
+
+	std::vector<bool> placed(placements.size(), false);
+	for (size_t i : order) {
+
+		Placement& placement = placements[i];
+		stats.transientBytes += placement.requirements.size;
+
+		//resources only share with others of the same memory types and tiling
+		uint32_t heap = 0;
+		while (heap < heaps.size() && (heaps[heap].memoryTypeBits != placement.requirements.memoryTypeBits
+			|| heaps[heap].linear != placement.linear)) {
+			++heap;
+		}
+		if (heap == heaps.size()) {
+			Heap newHeap;
+			newHeap.memoryTypeBits = placement.requirements.memoryTypeBits;
+			newHeap.linear = placement.linear;
+			heaps.push_back(newHeap);
+		}
+
+		std::vector<std::pair<vk::DeviceSize, vk::DeviceSize>> taken;
+		for (size_t j = 0; j < placements.size(); ++j) {
+			const Placement& other = placements[j];
+			if (placed[j] && other.heap == heap && other.first <= placement.last && placement.first <= other.last) {
+				taken.push_back({ other.offset, other.offset + other.requirements.size });
+			}
+		}
+		std::sort(taken.begin(), taken.end());
+
+		vk::DeviceSize alignment = std::max(placement.requirements.alignment, vk::DeviceSize(1));
+		vk::DeviceSize offset = 0;
+		for (const auto& [start, end] : taken) {
+			if (align_up(offset, alignment) + placement.requirements.size <= start) {
+				break;
+			}
+			offset = std::max(offset, end);
+		}
+		offset = align_up(offset, alignment);
+
+		placement.heap = heap;
+		placement.offset = offset;
+		placed[i] = true;
+		heaps[heap].size = std::max(heaps[heap].size, offset + placement.requirements.size);
+		heaps[heap].alignment = std::max(heaps[heap].alignment, alignment);
+	}
+
+	for (const Heap& heap : heaps) {
+		stats.aliasedBytes += heap.size;
+	}
+}
+
+void vkUtil::RenderGraph::bind_memory() {
+
+	if (!device || !allocator) {
+		return;
+	}
+
+	for (Heap& heap : heaps) {
+		vk::MemoryRequirements requirements;
+		requirements.size = heap.size;
+		requirements.alignment = heap.alignment;
+		requirements.memoryTypeBits = heap.memoryTypeBits;
+		heap.allocation = allocator->allocate(requirements, vk::MemoryPropertyFlagBits::eDeviceLocal, heap.linear);
+		if (!heap.allocation.memory && debugMode) {
+			std::cout << "Failed to allocate " << heap.size << " bytes of transient memory" << std::endl;
+		}
+	}
+
+	for (const Placement& placement : placements) {
+
+		const Allocation& allocation = heaps[placement.heap].allocation;
+		const Resource& resource = resources[placement.resource];
+		if (!allocation.memory) {
+			continue;
+		}
+
+		if (transientBuffers[placement.resource]) {
+			device.bindBufferMemory(transientBuffers[placement.resource], allocation.memory, allocation.offset + placement.offset);
+			continue;
+		}
+		if (!transientImages[placement.resource]) {
+			continue;
+		}
+		device.bindImageMemory(transientImages[placement.resource], allocation.memory, allocation.offset + placement.offset);
+
+		vk::ImageAspectFlags aspect = vk::ImageAspectFlagBits::eColor;
+		if (is_depth_format(resource.format)) {
+			aspect = vk::ImageAspectFlagBits::eDepth;
+		}
+
+		vk::ImageViewCreateInfo viewInfo;
+		viewInfo.image = transientImages[placement.resource];
+		viewInfo.viewType = vk::ImageViewType::e2D;
+		viewInfo.format = resource.format;
+		viewInfo.subresourceRange = vk::ImageSubresourceRange(aspect, 0, 1, 0, 1);
+		try {
+			transientViews[placement.resource] = device.createImageView(viewInfo);
+		}
+		catch (vk::SystemError err) {
+			if (debugMode) {
+				std::cout << "Failed to make view of transient image " << resource.name << std::endl;
+			}
+		}
+	}
+}
+
+void vkUtil::RenderGraph::make_barriers() {
+
+	std::vector<ResourceState> states(resources.size());
+	for (size_t i = 0; i < resources.size(); ++i) {
+		states[i].layout = resources[i].initialLayout;
+	}
+
+	//resources whose memory was last used by something else, which must finish with it first
+	std::vector<std::vector<RenderResource>> aliased(resources.size());
+	for (const Placement& placement : placements) {
+		for (const Placement& other : placements) {
+			if (other.heap == placement.heap && other.last < placement.first
+				&& other.offset < placement.offset + placement.requirements.size
+				&& placement.offset < other.offset + other.requirements.size) {
+				aliased[placement.resource].push_back(other.resource);
+			}
+		}
+	}
+
+	for (CompiledPass& step : schedule) {
+
+		BarrierBatch& batch = step.barriers;
+		for (const Use& use : passes[step.pass].uses) {
+
+			ResourceState& state = states[use.resource];
+			const Resource& resource = resources[use.resource];
+			++stats.naiveBarrierCount;
+
+			vk::PipelineStageFlags srcStages;
+			vk::AccessFlags srcAccess;
+			bool hazard = false;
+
+			if (!state.used) {
+				for (RenderResource previous : aliased[use.resource]) {
+					srcStages |= states[previous].writeStages | states[previous].readStages;
+					srcAccess |= states[previous].writeAccess;
+				}
+				hazard = static_cast<bool>(srcStages);
+			}
+
+			//read after write, unless the write is already visible here, and write after write
+			if (state.writeStages && (use.write || (use.stages & ~state.visibleStages)
+				|| (use.access & ~state.visibleAccess))) {
+				hazard = true;
+				srcStages |= state.writeStages;
+				srcAccess |= state.writeAccess;
+			}
+			//write after read only needs the reads to have finished
+			if (use.write && state.readStages) {
+				hazard = true;
+				srcStages |= state.readStages;
+			}
+
+			if (resource.isImage && state.layout != use.layout) {
+				//nothing before it in the frame, so chain onto whatever the submission waited on
+				if (!srcStages) {
+					srcStages = use.stages;
+				}
+				ImageTransition transition;
+				transition.resource = use.resource;
+				transition.oldLayout = state.used || resource.imported ? state.layout : vk::ImageLayout::eUndefined;
+				transition.newLayout = use.layout;
+				transition.srcAccess = srcAccess;
+				transition.dstAccess = use.access;
+				batch.transitions.push_back(transition);
+				batch.srcStages |= srcStages;
+				batch.dstStages |= use.stages;
+				hazard = true;
+			}
+			else if (hazard) {
+				batch.memoryBarrier = true;
+				batch.srcStages |= srcStages;
+				batch.srcAccess |= srcAccess;
+				batch.dstStages |= use.stages;
+				if (srcAccess) {
+					batch.dstAccess |= use.access;
+				}
+			}
+
+			state.used = true;
+			state.layout = use.layout;
+			if (use.write) {
+				state.writeStages = use.stages;
+				state.writeAccess = use.access & writeAccessBits;
+				state.readStages = vk::PipelineStageFlags();
+				state.visibleStages = vk::PipelineStageFlags();
+				state.visibleAccess = vk::AccessFlags();
+			}
+			else {
+				state.readStages |= use.stages;
+				if (hazard) {
+					state.visibleStages |= use.stages;
+					state.visibleAccess |= use.access;
+				}
+			}
+		}
+
+		if (!batch.empty()) {
+			++stats.barrierBatchCount;
+			stats.barrierCount += batch.transitions.size() + (batch.memoryBarrier ? 1 : 0);
+		}
+	}
+
+	//leave imported images how the caller asked
+	epilogue = BarrierBatch();
+	for (RenderResource i = 0; i < resources.size(); ++i) {
+		const Resource& resource = resources[i];
+		const ResourceState& state = states[i];
+		if (!resource.imported || !resource.isImage || resource.finalLayout == vk::ImageLayout::eUndefined
+			|| state.layout == resource.finalLayout) {
+			continue;
+		}
+		vk::PipelineStageFlags srcStages = state.writeStages | state.readStages;
+		epilogue.srcStages |= srcStages ? srcStages : vk::PipelineStageFlags(vk::PipelineStageFlagBits::eTopOfPipe);
+		epilogue.dstStages |= vk::PipelineStageFlagBits::eBottomOfPipe;
+		epilogue.transitions.push_back({ i, state.layout, resource.finalLayout, state.writeAccess, vk::AccessFlags() });
+		++stats.naiveBarrierCount;
+	}
+	if (!epilogue.empty()) {
+		++stats.barrierBatchCount;
+		stats.barrierCount += epilogue.transitions.size();
+	}
+}
+
+void vkUtil::RenderGraph::bind_transients() {
+
+	for (RenderResource i = 0; i < resources.size() && i < transientImages.size(); ++i) {
+		Resource& resource = resources[i];
+		if (resource.imported) {
+			continue;
+		}
+		resource.image = transientImages[i];
+		resource.view = transientViews[i];
+		resource.buffer = transientBuffers[i];
+	}
+}
+
+void vkUtil::RenderGraph::destroy_transients() {
+
+	if (!device) {
+		return;
+	}
+
+	for (vk::ImageView view : transientViews) {
+		if (view) {
+			device.destroyImageView(view);
+		}
+	}
+	for (vk::Image image : transientImages) {
+		if (image) {
+			device.destroyImage(image);
+		}
+	}
+	for (vk::Buffer buffer : transientBuffers) {
+		if (buffer) {
+			device.destroyBuffer(buffer);
+		}
+	}
+	transientViews.clear();
+	transientImages.clear();
+	transientBuffers.clear();
+
+	if (allocator) {
+		for (Heap& heap : heaps) {
+			if (heap.allocation.memory) {
+				allocator->free(heap.allocation);
+			}
+		}
+	}
+	heaps.clear();
+}
+
+void vkUtil::RenderGraph::record_batch(vk::CommandBuffer commandBuffer, const BarrierBatch& batch) const {
+
+	if (batch.empty()) {
+		return;
+	}
+
+	std::vector<vk::ImageMemoryBarrier> imageBarriers;
+	imageBarriers.reserve(batch.transitions.size());
+	for (const ImageTransition& transition : batch.transitions) {
+
+		const Resource& resource = resources[transition.resource];
+		vk::ImageAspectFlags aspect = vk::ImageAspectFlagBits::eColor;
+		if (is_depth_format(resource.format) || transition.newLayout == vk::ImageLayout::eDepthStencilAttachmentOptimal
+			|| transition.oldLayout == vk::ImageLayout::eDepthStencilAttachmentOptimal) {
+			aspect = vk::ImageAspectFlagBits::eDepth;
+			if (has_stencil(resource.format)) {
+				aspect |= vk::ImageAspectFlagBits::eStencil;
+			}
+		}
+
+		vk::ImageMemoryBarrier barrier;
+		barrier.oldLayout = transition.oldLayout;
+		barrier.newLayout = transition.newLayout;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = resource.image;
+		barrier.subresourceRange = vk::ImageSubresourceRange(aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS);
+		barrier.srcAccessMask = transition.srcAccess;
+		barrier.dstAccessMask = transition.dstAccess;
+		imageBarriers.push_back(barrier);
+	}
+
+	vk::MemoryBarrier memoryBarrier(batch.srcAccess, batch.dstAccess);
+	commandBuffer.pipelineBarrier(
+		batch.srcStages, batch.dstStages, vk::DependencyFlags(),
+		batch.memoryBarrier ? 1 : 0, &memoryBarrier, 0, nullptr,
+		static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data()
+	);
+}
+
+void vkUtil::RenderGraph::execute(vk::CommandBuffer commandBuffer) const {
+
+	if (!compiled) {
+		if (debugMode) {
+			std::cout << "Render graph executed before it was compiled" << std::endl;
+		}
+		return;
+	}
+
+	for (const CompiledPass& step : schedule) {
+		record_batch(commandBuffer, step.barriers);
+		if (passes[step.pass].callback) {
+			passes[step.pass].callback(commandBuffer, *this);
+		}
+	}
+	record_batch(commandBuffer, epilogue);
+}
+
+std::optional<vkUtil::RenderGraph::TransientPlacement> vkUtil::RenderGraph::get_placement(RenderResource resource) const {
+
+	for (const Placement& placement : placements) {
+		if (placement.resource == resource) {
+			return TransientPlacement{ placement.heap, placement.offset, placement.requirements.size };
+		}
+	}
+	return std::nullopt;
+}
+
+std::string vkUtil::RenderGraph::describe() const {
+
+	std::ostringstream message;
+	message << "Render graph of " << stats.passCount << " passes, " << stats.culledPassCount << " culled" << std::endl;
+
+	for (const CompiledPass& step : schedule) {
+		const BarrierBatch& batch = step.barriers;
+		message << "\t" << passes[step.pass].name;
+		if (batch.memoryBarrier) {
+			message << ", memory barrier " << vk::to_string(batch.srcStages) << " -> " << vk::to_string(batch.dstStages);
+		}
+		message << std::endl;
+		for (const ImageTransition& transition : batch.transitions) {
+			message << "\t\t" << resources[transition.resource].name << " " << vk::to_string(transition.oldLayout)
+				<< " -> " << vk::to_string(transition.newLayout) << std::endl;
+		}
+	}
+	for (const ImageTransition& transition : epilogue.transitions) {
+		message << "\tfinally " << resources[transition.resource].name << " " << vk::to_string(transition.oldLayout)
+			<< " -> " << vk::to_string(transition.newLayout) << std::endl;
+	}
+
+	for (const Placement& placement : placements) {
+		message << "\t" << resources[placement.resource].name << " in heap " << placement.heap
+			<< " at " << placement.offset << ", " << placement.requirements.size << " bytes, passes "
+			<< placement.first << " to " << placement.last << std::endl;
+	}
+
+	message << "\t" << stats.barrierCount << " barriers in " << stats.barrierBatchCount << " calls, "
+		<< stats.naiveBarrierCount << " if every use had its own" << std::endl;
+	message << "\t" << stats.aliasedBytes << " bytes of transient memory, "
+		<< stats.transientBytes << " without aliasing" << std::endl;
+	return message.str();
+}
@@ -0,0 +1,300 @@
+#pragma once
+#include "vulkan/vulkan.hpp"
+#include "memory.h"
+
+namespace vkUtil
+{
+	/**
+		How a pass uses a resource, which decides its stages, access and image layout.
+	*/
+	enum class RenderAccess {
+		ColorAttachment,
+		DepthAttachment,
+		//sampled in fragment or compute shaders
+		SampledRead,
+		StorageRead,
+		StorageWrite,
+		TransferRead,
+		TransferWrite,
+		IndirectRead
+	};
+
+	//a resource declared in a render graph, valid until the graph is next begun
+	using RenderResource = uint32_t;
+
+	/**
+		What the last compile produced, and how it compares to the naive approach.
+	*/
+	struct RenderGraphStats {
+		size_t passCount{ 0 };
+		size_t culledPassCount{ 0 };
+		//pipelineBarrier calls recorded per execution
+		size_t barrierBatchCount{ 0 };
+		//memory and image barriers across those calls
+		size_t barrierCount{ 0 };
+		//a barrier call before every use of a resource, as hand written code tends to do
+		size_t naiveBarrierCount{ 0 };
+		//transient memory if every resource had its own, and with aliasing
+		vk::DeviceSize transientBytes{ 0 };
+		vk::DeviceSize aliasedBytes{ 0 };
+		//how many times the graph has been compiled, which only happens when its topology changes
+		size_t compileCount{ 0 };
+	};
+
+	/**
+		A frame described as passes and the resources they read and write.
+
+		The graph is declared every frame, between begin and compile. Passes run in the order
+		they're declared, and only if they have side effects or write something a later
+		pass or the graph's output needs. Compiling works out the barriers before each pass,
+		merging them into one call, and places transient resources whose lifetimes don't
+		overlap in the same memory. All of that is only redone when the declaration's
+		topology changes, so handles of imported resources can change every frame.
+
+		Without a device the graph only compiles, estimating memory from formats, which
+		is enough to analyse synthetic graphs.
+	*/
+	class RenderGraph
+	{
+	public:
+		using PassCallback = std::function<void(vk::CommandBuffer commandBuffer, const RenderGraph& graph)>;
+
+		//an image barrier is kept by resource, since imported handles change between frames
+		struct ImageTransition {
+			RenderResource resource;
+			vk::ImageLayout oldLayout;
+			vk::ImageLayout newLayout;
+			vk::AccessFlags srcAccess;
+			vk::AccessFlags dstAccess;
+		};
+
+		struct BarrierBatch {
+			vk::PipelineStageFlags srcStages;
+			vk::PipelineStageFlags dstStages;
+			vk::AccessFlags srcAccess;
+			vk::AccessFlags dstAccess;
+			bool memoryBarrier{ false };
+			std::vector<ImageTransition> transitions;
+
+			bool empty() const { return !memoryBarrier && transitions.empty(); }
+		};
+
+		struct CompiledPass {
+			uint32_t pass;
+			BarrierBatch barriers;
+		};
+
+		//where a transient resource was placed, resources sharing a heap and overlapping ranges alias
+		struct TransientPlacement {
+			uint32_t heap;
+			vk::DeviceSize offset;
+			vk::DeviceSize size;
+		};
+
+		/**
+			\param device the logical device, null to only compile
+			\param allocator the allocator transient memory comes from, null to only compile
+			\param debug whether to print the plan each time it's compiled
+		*/
+		RenderGraph(vk::Device device, MemoryAllocator* allocator, bool debug);
+		~RenderGraph();
+
+		RenderGraph(const RenderGraph&) = delete;
+		RenderGraph& operator=(const RenderGraph&) = delete;
+
+		//start declaring the frame, forgetting the last declaration but not its compiled plan
+		void begin();
+
+		/**
+			Declare an image which only lives during the frame, its contents start undefined.
+
+			\param name for debugging, must outlive the declaration
+			\param extent the image size
+			\param format the image format
+			\returns the image
+		*/
+		RenderResource create_image(const char* name, vk::Extent2D extent, vk::Format format);
+
+		/**
+			Declare a buffer which only lives during the frame.
+
+			\param name for debugging, must outlive the declaration
+			\param size the buffer size
+			\returns the buffer
+		*/
+		RenderResource create_buffer(const char* name, vk::DeviceSize size);
+
+		/**
+			Declare an image made outside the graph, whose work before the frame is already synchronized.
+
+			\param name for debugging, must outlive the declaration
+			\param image the image
+			\param view a view of the whole image, may be null
+			\param initialLayout the layout the image is in when the frame starts
+			\param finalLayout the layout to leave it in, which makes it an output of the graph.
+				Undefined leaves it as the last pass used it.
+			\returns the image
+		*/
+		RenderResource import_image(const char* name, vk::Image image, vk::ImageView view,
+			vk::ImageLayout initialLayout, vk::ImageLayout finalLayout);
+
+		/**
+			Declare a buffer made outside the graph, whose work before the frame is already synchronized.
+
+			\param name for debugging, must outlive the declaration
+			\param buffer the buffer
+			\returns the buffer
+		*/
+		RenderResource import_buffer(const char* name, vk::Buffer buffer);
+
+		//keep the passes which write a resource, even if no pass reads it
+		void mark_output(RenderResource resource);
+
+		/**
+			Declare a pass, in the order it should run.
+
+			\param name for debugging, must outlive the declaration
+			\param callback records the pass, outside any barriers the graph adds
+			\param sideEffects whether the pass does something the graph can't see, so it's never culled
+			\returns the pass, for use
+		*/
+		uint32_t add_pass(const char* name, PassCallback callback, bool sideEffects = false);
+
+		/**
+			Declare that a pass uses a resource. A resource used several ways by one pass
+			is waited on once for all of them.
+
+			\param pass the pass
+			\param resource the resource
+			\param access how the pass uses it
+		*/
+		void use(uint32_t pass, RenderResource resource, RenderAccess access);
+
+		/**
+			Compile the declaration if its topology differs from the last one compiled.
+			Transient resources are remade when it does, so the graph's last execution must be complete.
+
+			\returns whether the graph was compiled
+		*/
+		bool compile();
+
+		/**
+			Record every pass that wasn't culled, with the barriers between them.
+
+			\param commandBuffer the command buffer being recorded, outside a renderpass
+		*/
+		void execute(vk::CommandBuffer commandBuffer) const;
+
+		vk::Image get_image(RenderResource resource) const { return resources[resource].image; }
+		vk::ImageView get_view(RenderResource resource) const { return resources[resource].view; }
+		vk::Buffer get_buffer(RenderResource resource) const { return resources[resource].buffer; }
+
+		const RenderGraphStats& get_stats() const { return stats; }
+
+		//the passes which weren't culled, in execution order, each with the barriers recorded before it
+		const std::vector<CompiledPass>& get_schedule() const { return schedule; }
+		//the barriers after the last pass, which leave imported images in their final layouts
+		const BarrierBatch& get_epilogue() const { return epilogue; }
+
+		/**
+			Find where the last compile placed a transient resource.
+
+			\param resource the resource, as declared
+			\returns its placement, or nothing if it's imported or only used by culled passes
+		*/
+		std::optional<TransientPlacement> get_placement(RenderResource resource) const;
+
+		//the compiled plan: each pass with its barriers, then where each transient resource lives
+		std::string describe() const;
+
+	private:
+		struct Use {
+			RenderResource resource;
+			vk::PipelineStageFlags stages;
+			vk::AccessFlags access;
+			vk::ImageLayout layout;
+			bool write;
+			vk::ImageUsageFlags imageUsage;
+			vk::BufferUsageFlags bufferUsage;
+		};
+
+		struct Pass {
+			const char* name;
+			PassCallback callback;
+			bool sideEffects;
+			std::vector<Use> uses;
+		};
+
+		struct Resource {
+			const char* name;
+			bool imported;
+			bool isImage;
+			bool output{ false };
+			vk::Extent2D extent;
+			vk::Format format{ vk::Format::eUndefined };
+			vk::DeviceSize size{ 0 };
+			vk::ImageLayout initialLayout{ vk::ImageLayout::eUndefined };
+			vk::ImageLayout finalLayout{ vk::ImageLayout::eUndefined };
+			vk::Image image;
+			vk::ImageView view;
+			vk::Buffer buffer;
+		};
+
+		//a transient resource's slot in an aliased heap
+		struct Placement {
+			RenderResource resource;
+			vk::MemoryRequirements requirements;
+			bool linear;
+			uint32_t heap{ 0 };
+			vk::DeviceSize offset{ 0 };
+			//execution indices of the first and last passes using it
+			uint32_t first;
+			uint32_t last;
+		};
+
+		//memory shared by transient resources of one memory type and tiling
+		struct Heap {
+			uint32_t memoryTypeBits;
+			bool linear;
+			vk::DeviceSize size{ 0 };
+			vk::DeviceSize alignment{ 1 };
+			Allocation allocation;
+		};
+
+		vk::Device device;
+		MemoryAllocator* allocator;
+		bool debugMode;
+
+		//this frame's declaration
+		std::vector<Pass> passes;
+		std::vector<Resource> resources;
+
+		//the compiled plan, which outlives declarations of the same topology
+		size_t compiledHash{ 0 };
+		bool compiled{ false };
+		std::vector<CompiledPass> schedule;
+		BarrierBatch epilogue;
+		std::vector<Placement> placements;
+		std::vector<Heap> heaps;
+		//transient resources, indexed like the declaration's resources
+		std::vector<vk::Image> transientImages;
+		std::vector<vk::ImageView> transientViews;
+		std::vector<vk::Buffer> transientBuffers;
+
+		RenderGraphStats stats;
+
+		size_t hash_topology() const;
+		void cull(std::vector<bool>& kept) const;
+		//make the transient resources, without memory, and find how much each needs
+		void make_transients();
+		//offset transient resources within heaps, sharing memory where lifetimes don't overlap
+		void place_transients();
+		//allocate the heaps, bind the transient resources into them and make their views
+		void bind_memory();
+		void make_barriers();
+		void destroy_transients();
+		//point the declaration's transient resources at the ones made when it was compiled
+		void bind_transients();
+		void record_batch(vk::CommandBuffer commandBuffer, const BarrierBatch& batch) const;
+	};
+}
@@ -2,8 +2,73 @@
 
 namespace vkUtil
 {
+	/**
+		Per-draw uniform data, written to the frame's arena. Must match Shaders/shader.vert
+	*/
 	struct ObjectData
 	{
 		glm::mat4 model;
+		//index into the bindless table's materials
+		uint32_t material;
+		//std140 rounds the block up to a multiple of 16
+		uint32_t padding[3];
 	};
+
+	//a material's texture index when it has none
+	constexpr uint32_t noTexture = 0xFFFFFFFF;
+
+	/**
+		A surface's appearance, as stored in the bindless table. Must match Shaders/shader.frag
+	*/
+	struct Material
+	{
+		//multiplies the vertex colour
+		glm::vec4 baseColor{ 1.0f };
+		//index into the bindless table's textures
+		uint32_t baseColorTexture{ noTexture };
+		uint32_t padding[3]{};
+	};
+
+	/**
+		Push constants for the culling compute shader, must match Shaders/cull.comp
+	*/
+	struct CullData
+	{
+		glm::vec4 frustumPlanes[6];
+		uint32_t objectCount;
+		//the mesh every object is drawn with
+		uint32_t indexCount;
+		uint32_t firstIndex;
+		int32_t vertexOffset;
+		float boundingRadius;
+		//whether visible draws are packed to the front of the buffer and counted
+		uint32_t compact;
+	};
+
+	/**
+		Extract the six clip planes from a view projection matrix,
+		plane normals point inwards.
+
+		\param viewProjection the matrix taking world space to clip space
+		\param planes the planes to write to, in the order left, right, bottom, top, near, far
+	*/
+	inline void extract_frustum_planes(const glm::mat4& viewProjection, glm::vec4 planes[6])
+	{
+		glm::vec4 row0 = glm::vec4(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+		glm::vec4 row1 = glm::vec4(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+		glm::vec4 row2 = glm::vec4(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+		glm::vec4 row3 = glm::vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+		planes[0] = row3 + row0;
+		planes[1] = row3 - row0;
+		planes[2] = row3 + row1;
+		planes[3] = row3 - row1;
+		//vulkan clip space depth runs from 0 to w
+		planes[4] = row2;
+		planes[5] = row3 - row2;
+
+		for (int i = 0; i < 6; ++i) {
+			planes[i] /= glm::length(glm::vec3(planes[i]));
+		}
+	}
 }
\ No newline at end of file
@@ -2,6 +2,7 @@
 #include "swapchain.h"
 #include "queue_families.h"
 #include "frame.h"
+#include "cpu_profiler.h"
 
 
 vk::SurfaceFormatKHR vkInit::choose_swapchain_surface_format(std::vector<vk::SurfaceFormatKHR> formats)
@@ -51,8 +52,10 @@ vk::Extent2D vkInit::choose_swapchain_extent(uint32_t width, uint32_t height, vk
 	}
 }
 
-vkInit::SwapChainBundle vkInit::create_swapchain(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice, vk::SurfaceKHR surface, int width, int height, bool debug)
+vkInit::SwapChainBundle vkInit::create_swapchain(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice, vk::SurfaceKHR surface, int width, int height, vk::SwapchainKHR oldSwapchain, bool debug)
 {
+	PROFILE_FUNCTION();
+
 	SwapChainSupportDetails support = query_swapchain_support(physicalDevice, surface, debug);
 
 	vk::SurfaceFormatKHR format = choose_swapchain_surface_format(support.formats);
@@ -89,7 +92,8 @@ vkInit::SwapChainBundle vkInit::create_swapchain(vk::Device logicalDevice, vk::P
 	createInfo.presentMode = presentMode;
 	createInfo.clipped = VK_TRUE;
 
-	createInfo.oldSwapchain = vk::SwapchainKHR(nullptr);
+	//lets the driver hand resources over from the swapchain being replaced
+	createInfo.oldSwapchain = oldSwapchain;
 
 	SwapChainBundle bundle{};
 	try {
@@ -27,5 +27,17 @@ namespace vkInit
 
 	vk::Extent2D choose_swapchain_extent(uint32_t width, uint32_t height, vk::SurfaceCapabilitiesKHR capabilities);
 
-	SwapChainBundle create_swapchain(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice, vk::SurfaceKHR surface, int width, int height, bool debug);
+	/**
+		Make a swapchain.
+
+		\param logicalDevice the logical device
+		\param physicalDevice the physical device
+		\param surface the surface to present to
+		\param width the requested width
+		\param height the requested height
+		\param oldSwapchain the swapchain being replaced, if any. It is retired but not destroyed.
+		\param debug whether the system is running in debug mode
+		\returns the swapchain, its frames, format and extent
+	*/
+	SwapChainBundle create_swapchain(vk::Device logicalDevice, vk::PhysicalDevice physicalDevice, vk::SurfaceKHR surface, int width, int height, vk::SwapchainKHR oldSwapchain, bool debug);
 }
\ No newline at end of file
@@ -1,9 +1,12 @@
 #include "pch.h"
 #include "sync.h"
+#include "cpu_profiler.h"
 
 
 vk::Semaphore vkInit::make_semaphore(vk::Device device, bool debug)
 {
+	PROFILE_FUNCTION();
+
 	vk::SemaphoreCreateInfo semaphoreInfo = {};
 	semaphoreInfo.flags = vk::SemaphoreCreateFlags();
 
@@ -20,6 +23,8 @@ vk::Semaphore vkInit::make_semaphore(vk::Device device, bool debug)
 
 vk::Fence vkInit::make_fence(vk::Device device, bool debug)
 {
+	PROFILE_FUNCTION();
+
 	vk::FenceCreateInfo fenceInfo = {};
 	fenceInfo.flags = vk::FenceCreateFlags() | vk::FenceCreateFlagBits::eSignaled;
 
@@ -34,4 +39,25 @@ vk::Fence vkInit::make_fence(vk::Device device, bool debug)
 	}
 }
 
+vk::Semaphore vkInit::make_timeline_semaphore(vk::Device device, uint64_t initialValue, bool debug)
+{
+	PROFILE_FUNCTION();
+
+	vk::SemaphoreTypeCreateInfo typeInfo = {};
+	typeInfo.semaphoreType = vk::SemaphoreType::eTimeline;
+	typeInfo.initialValue = initialValue;
 
+	vk::SemaphoreCreateInfo semaphoreInfo = {};
+	semaphoreInfo.flags = vk::SemaphoreCreateFlags();
+	semaphoreInfo.pNext = &typeInfo;
+
+	try {
+		return device.createSemaphore(semaphoreInfo);
+	}
+	catch (vk::SystemError err) {
+		if (debug) {
+			std::cout << "Failed to create timeline semaphore " << std::endl;
+		}
+		return nullptr;
+	}
+}
@@ -22,4 +22,14 @@ namespace vkInit
 		\returns the created fence
 	*/
 	vk::Fence make_fence(vk::Device device, bool debug);
+
+	/**
+		Make a timeline semaphore.
+
+		\param device the logical device
+		\param initialValue the semaphore's starting value
+		\param debug whether the system is running in debug mode
+		\returns the created semaphore
+	*/
+	vk::Semaphore make_timeline_semaphore(vk::Device device, uint64_t initialValue, bool debug);
 }
\ No newline at end of file
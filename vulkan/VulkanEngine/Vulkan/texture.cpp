@@ -0,0 +1,297 @@
+#include "pch.h"
+#include "texture.h"
+#include "cooked_texture.h"
+#include "mapped_file.h"
+#include "cpu_profiler.h"
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image/stb_image.h"
+
+namespace {
+
+	//decoded images are gathered into staging buffers of about this size
+	constexpr vk::DeviceSize batchSize = 64 * 1024 * 1024;
+
+	struct PendingImage {
+		MappedFile file;
+		//cooked textures are mapped by this instead, and skip decoding
+		vkUtil::CookedTextureFile cookedFile;
+		bool cooked = false;
+		int width = 0;
+		int height = 0;
+		bool valid = false;
+		vk::DeviceSize stagingOffset = 0;
+
+		vk::DeviceSize size() const { return static_cast<vk::DeviceSize>(width) * height * 4; }
+	};
+}
+
+vkUtil::TextureLoader::TextureLoader(vk::Device device, MemoryAllocator& allocator, UploadManager& uploads, int threadCount,
+	MipMode mipMode, bool blockCompression, bool debug)
+	: device(device), allocator(allocator), uploads(uploads), mipMode(mipMode), blockCompression(blockCompression), debugMode(debug) {
+
+	if (threadCount > 1) {
+		pool = std::make_unique<ThreadPool>(threadCount);
+	}
+}
+
+void vkUtil::TextureLoader::parallel_for(size_t count, const std::function<void(size_t)>& job) {
+
+	if (!pool) {
+		for (size_t i = 0; i < count; ++i) {
+			job(i);
+		}
+		return;
+	}
+
+	for (size_t i = 0; i < count; ++i) {
+		pool->submit([&job, i]() { job(i); });
+	}
+	pool->wait();
+}
+
+std::vector<vkUtil::Texture> vkUtil::TextureLoader::load(const std::vector<std::string>& filenames) {
+
+	PROFILE_FUNCTION();
+
+	auto start = std::chrono::high_resolution_clock::now();
+	stats = TextureLoadStats();
+	stats.imageCount = filenames.size();
+
+	//only the headers are read up front, to lay out the staging buffers
+	std::vector<PendingImage> pending(filenames.size());
+	parallel_for(filenames.size(), [&](size_t i) {
+		PendingImage& image = pending[i];
+		if (CookedTextureFile::is_cooked(filenames[i])) {
+			image.cooked = true;
+			image.valid = blockCompression && image.cookedFile.open(filenames[i], debugMode);
+			return;
+		}
+		int channels;
+		image.valid = image.file.open(filenames[i])
+			&& image.file.size() <= static_cast<size_t>(std::numeric_limits<int>::max())
+			&& stbi_info_from_memory(image.file.data(), static_cast<int>(image.file.size()), &image.width, &image.height, &channels)
+			&& image.width > 0 && image.height > 0;
+	});
+
+	std::vector<Texture> textures(filenames.size());
+	size_t first = 0;
+	while (first < filenames.size()) {
+
+		//a batch always takes at least one image, however large
+		vk::DeviceSize batchBytes = 0;
+		size_t last = first;
+		for (; last < filenames.size(); ++last) {
+			PendingImage& image = pending[last];
+			if (!image.valid || image.cooked) {
+				continue;
+			}
+			if (batchBytes > 0 && batchBytes + image.size() > batchSize) {
+				break;
+			}
+			image.stagingOffset = batchBytes;
+			batchBytes += (image.size() + 15) & ~static_cast<vk::DeviceSize>(15);
+		}
+		if (batchBytes == 0) {
+			break;
+		}
+
+		BufferInputChunk input;
+		input.size = batchBytes;
+		input.usage = vk::BufferUsageFlagBits::eTransferSrc;
+		input.memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+		Buffer staging = allocator.create_buffer(input);
+		uint8_t* mapped = static_cast<uint8_t*>(staging.allocation.mapped);
+
+		//stb_image decodes into memory of its own, each worker copies its image into place while it's still in cache
+		parallel_for(last - first, [&](size_t j) {
+			PendingImage& image = pending[first + j];
+			if (!image.valid || image.cooked) {
+				return;
+			}
+			PROFILE_SCOPE("decode texture");
+			int width, height, channels;
+			stbi_uc* pixels = stbi_load_from_memory(
+				image.file.data(), static_cast<int>(image.file.size()), &width, &height, &channels, STBI_rgb_alpha
+			);
+			if (pixels && width == image.width && height == image.height) {
+				memcpy(mapped + image.stagingOffset, pixels, image.size());
+			}
+			else {
+				image.valid = false;
+			}
+			stbi_image_free(pixels);
+			image.file.close();
+		});
+
+		for (size_t i = first; i < last; ++i) {
+
+			PendingImage& image = pending[i];
+			if (!image.valid || image.cooked) {
+				continue;
+			}
+
+			Texture& texture = textures[i];
+			texture.extent = vk::Extent2D(static_cast<uint32_t>(image.width), static_cast<uint32_t>(image.height));
+			texture.format = vk::Format::eR8G8B8A8Srgb;
+			texture.mipLevels = mipMode == MipMode::None ? 1 : mip_level_count(texture.extent);
+			texture.mipsPending = texture.mipLevels > 1;
+
+			vk::ImageCreateInfo imageInfo;
+			imageInfo.imageType = vk::ImageType::e2D;
+			imageInfo.format = texture.format;
+			imageInfo.extent = vk::Extent3D(texture.extent, 1);
+			imageInfo.mipLevels = texture.mipLevels;
+			imageInfo.arrayLayers = 1;
+			imageInfo.samples = vk::SampleCountFlagBits::e1;
+			imageInfo.tiling = vk::ImageTiling::eOptimal;
+			imageInfo.usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+			if (mipMode != MipMode::None) {
+				//blitting is also the compute mode's fallback, for images too large for one dispatch
+				imageInfo.usage |= vk::ImageUsageFlagBits::eTransferSrc;
+			}
+			if (mipMode == MipMode::Compute) {
+				//sRGB formats can't be storage images, the compute pass writes through unorm views
+				imageInfo.flags = vk::ImageCreateFlagBits::eMutableFormat;
+				imageInfo.usage |= vk::ImageUsageFlagBits::eStorage;
+			}
+			imageInfo.sharingMode = vk::SharingMode::eExclusive;
+			imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+			texture.image = allocator.create_image(imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+			vk::ImageViewCreateInfo viewInfo;
+			viewInfo.image = texture.image.image;
+			viewInfo.viewType = vk::ImageViewType::e2D;
+			viewInfo.format = texture.format;
+			viewInfo.subresourceRange = vk::ImageSubresourceRange(vk::ImageAspectFlagBits::eColor, 0, texture.mipLevels, 0, 1);
+			texture.view = device.createImageView(viewInfo);
+
+			vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1);
+
+			vk::BufferImageCopy region;
+			region.bufferOffset = 0;
+			region.bufferRowLength = 0;
+			region.bufferImageHeight = 0;
+			region.imageSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, 0, 0, 1);
+			region.imageOffset = vk::Offset3D(0, 0, 0);
+			region.imageExtent = imageInfo.extent;
+
+			ImageUploadInput upload;
+			upload.image = texture.image.image;
+			upload.regions = { region };
+			upload.range = range;
+			upload.finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+			upload.dstStage = vk::PipelineStageFlagBits::eFragmentShader;
+			upload.dstAccess = vk::AccessFlagBits::eShaderRead;
+			texture.upload = uploads.upload_image(staging.buffer, image.stagingOffset, upload);
+
+			stats.decodedBytes += image.size();
+		}
+
+		//one submission per batch, the staging buffer is freed once it completes
+		uploads.adopt_staging(staging);
+		uploads.flush();
+		first = last;
+	}
+
+	//cooked chains go from the mapped file into the staging ring, every level in one copy
+	for (size_t i = 0; i < filenames.size(); ++i) {
+
+		PendingImage& image = pending[i];
+		if (!image.valid || !image.cooked) {
+			continue;
+		}
+
+		const CookedTextureHeader& header = image.cookedFile.get_header();
+		Texture& texture = textures[i];
+		texture.extent = vk::Extent2D(header.width, header.height);
+		texture.format = image.cookedFile.get_format();
+		texture.mipLevels = header.levelCount;
+
+		vk::ImageCreateInfo imageInfo;
+		imageInfo.imageType = vk::ImageType::e2D;
+		imageInfo.format = texture.format;
+		imageInfo.extent = vk::Extent3D(texture.extent, 1);
+		imageInfo.mipLevels = texture.mipLevels;
+		imageInfo.arrayLayers = 1;
+		imageInfo.samples = vk::SampleCountFlagBits::e1;
+		imageInfo.tiling = vk::ImageTiling::eOptimal;
+		imageInfo.usage = vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eSampled;
+		imageInfo.sharingMode = vk::SharingMode::eExclusive;
+		imageInfo.initialLayout = vk::ImageLayout::eUndefined;
+		texture.image = allocator.create_image(imageInfo, vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+		vk::ImageSubresourceRange range(vk::ImageAspectFlagBits::eColor, 0, texture.mipLevels, 0, 1);
+		vk::ImageViewCreateInfo viewInfo;
+		viewInfo.image = texture.image.image;
+		viewInfo.viewType = vk::ImageViewType::e2D;
+		viewInfo.format = texture.format;
+		viewInfo.subresourceRange = range;
+		texture.view = device.createImageView(viewInfo);
+
+		ImageUploadInput upload;
+		upload.image = texture.image.image;
+		for (uint32_t level = 0; level < header.levelCount; ++level) {
+			vk::BufferImageCopy region;
+			region.bufferOffset = header.levels[level].offset - header.levels[0].offset;
+			region.bufferRowLength = 0;
+			region.bufferImageHeight = 0;
+			region.imageSubresource = vk::ImageSubresourceLayers(vk::ImageAspectFlagBits::eColor, level, 0, 1);
+			region.imageOffset = vk::Offset3D(0, 0, 0);
+			region.imageExtent = vk::Extent3D(std::max(header.width >> level, 1u), std::max(header.height >> level, 1u), 1);
+			upload.regions.push_back(region);
+		}
+		upload.range = range;
+		upload.finalLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+		upload.dstStage = vk::PipelineStageFlagBits::eFragmentShader;
+		upload.dstAccess = vk::AccessFlagBits::eShaderRead;
+
+		const CookedBlob& lastLevel = header.levels[header.levelCount - 1];
+		vk::DeviceSize size = lastLevel.offset + lastLevel.size - header.levels[0].offset;
+		texture.upload = uploads.upload_image(image.cookedFile.get_blob(header.levels[0]), size, upload);
+
+		++stats.cookedCount;
+		stats.cookedBytes += size;
+	}
+	uploads.flush();
+
+	for (size_t i = 0; i < filenames.size(); ++i) {
+		//the copy never ran, so the image holds nothing
+		if (pending[i].valid && uploads.has_failed(textures[i].upload)) {
+			destroy(textures[i]);
+			++stats.failedCount;
+			if (debugMode) {
+				std::cout << "Failed to upload " << filenames[i] << std::endl;
+			}
+		}
+		else if (!pending[i].valid) {
+			++stats.failedCount;
+			if (debugMode) {
+				if (pending[i].cooked && !blockCompression) {
+					std::cout << "Block compressed textures are unsupported, can't load " << filenames[i] << std::endl;
+				}
+				else {
+					std::cout << "Failed to decode " << filenames[i] << std::endl;
+				}
+			}
+		}
+	}
+
+	auto end = std::chrono::high_resolution_clock::now();
+	stats.seconds = std::chrono::duration<double>(end - start).count();
+	if (debugMode) {
+		std::cout << "Loaded " << stats.imageCount - stats.failedCount << " textures on " << (pool ? pool->size() : 1)
+			<< " threads, " << stats.megabytes_per_second() << " MB/s, " << stats.images_per_second() << " images/s" << std::endl;
+	}
+
+	return textures;
+}
+
+void vkUtil::TextureLoader::destroy(Texture& texture) {
+
+	if (!texture.image.image) {
+		return;
+	}
+	device.destroyImageView(texture.view);
+	allocator.destroy_image(texture.image);
+	texture = Texture();
+}
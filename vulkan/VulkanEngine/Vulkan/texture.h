@@ -0,0 +1,108 @@
+#pragma once
+#include "vulkan/vulkan.hpp"
+#include "memory.h"
+#include "upload.h"
+#include "thread_pool.h"
+
+namespace vkUtil
+{
+	/**
+		How a texture's mip chain is filled in once its top level is uploaded.
+	*/
+	enum class MipMode {
+		//a single level
+		None,
+		//each level blitted from the one above it
+		Blit,
+		//every level written by one compute dispatch per texture
+		Compute
+	};
+
+	/**
+		A sampled image, along with its view.
+	*/
+	struct Texture {
+		Image image;
+		//covers every mip level
+		vk::ImageView view;
+		vk::Extent2D extent;
+		vk::Format format;
+		uint32_t mipLevels{ 1 };
+		//whether the levels past the first are left for a MipGenerator to fill
+		bool mipsPending{ false };
+		//the upload which fills the image
+		UploadToken upload{ 0 };
+	};
+
+	/**
+		Timings of the last call to TextureLoader::load.
+	*/
+	struct TextureLoadStats {
+		size_t imageCount{ 0 };
+		size_t failedCount{ 0 };
+		//size of the decoded pixels
+		size_t decodedBytes{ 0 };
+		//block compressed mip chains, uploaded as they were cooked
+		size_t cookedCount{ 0 };
+		size_t cookedBytes{ 0 };
+		//from the first file being opened until the last batch is submitted
+		double seconds{ 0.0 };
+
+		double megabytes_per_second() const { return seconds > 0.0 ? decodedBytes / (1024.0 * 1024.0) / seconds : 0.0; }
+		double images_per_second() const { return seconds > 0.0 ? (imageCount - failedCount) / seconds : 0.0; }
+	};
+
+	/**
+		Decodes images on worker threads straight into staging memory, then uploads
+		them in batches on the upload manager's queue.
+
+		Files are mapped rather than read, and each batch of images gets one staging
+		buffer which the workers decode into at their own offsets. Only the top level
+		is uploaded, and left in the shader read only layout for fragment shaders. With
+		a mip mode the rest of the chain is allocated, undefined until a MipGenerator fills it.
+
+		Cooked textures are copied from the mapped file into staging memory with every
+		level and no decoding, if the device supports block compression.
+	*/
+	class TextureLoader
+	{
+	public:
+		/**
+			\param device the logical device
+			\param allocator the device memory allocator
+			\param uploads uploads the decoded images
+			\param threadCount how many threads decode, 1 decodes on the calling thread
+			\param mipMode how the mip chains will be generated, which decides the images' usage
+			\param blockCompression whether the textureCompressionBC feature is enabled, cooked textures need it
+			\param debug whether to print extra information
+		*/
+		TextureLoader(vk::Device device, MemoryAllocator& allocator, UploadManager& uploads, int threadCount,
+			MipMode mipMode, bool blockCompression, bool debug);
+
+		/**
+			Decode and upload images, as 8 bit sRGB RGBA, and upload cooked textures as they are.
+
+			\param filenames the paths to the images, in any format stb_image reads, or cooked textures
+			\returns one texture per file, in order, with a null image if the file couldn't be decoded
+		*/
+		std::vector<Texture> load(const std::vector<std::string>& filenames);
+
+		const TextureLoadStats& get_stats() const { return stats; }
+
+		void destroy(Texture& texture);
+
+	private:
+		vk::Device device;
+		MemoryAllocator& allocator;
+		UploadManager& uploads;
+		std::unique_ptr<ThreadPool> pool;
+		MipMode mipMode;
+		bool blockCompression;
+		bool debugMode;
+
+		TextureLoadStats stats;
+
+		//run a job per index, on the pool if there is one
+		void parallel_for(size_t count, const std::function<void(size_t)>& job);
+	};
+}
@@ -0,0 +1,79 @@
+#include "pch.h"
+#include "timeline.h"
+#include "sync.h"
+
+vkUtil::Timeline::Timeline(vk::Device device, bool debug) : device(device) {
+
+	semaphore = vkInit::make_timeline_semaphore(device, 0, debug);
+}
+
+vkUtil::Timeline::~Timeline() {
+
+	device.destroySemaphore(semaphore);
+}
+
+uint64_t vkUtil::Timeline::completed_value() {
+
+	completed = device.getSemaphoreCounterValue(semaphore);
+	return completed;
+}
+
+bool vkUtil::Timeline::is_complete(uint64_t value) {
+
+	if (value <= completed) {
+		return true;
+	}
+	return completed_value() >= value;
+}
+
+void vkUtil::Timeline::wait(uint64_t value) {
+
+	if (is_complete(value)) {
+		return;
+	}
+
+	vk::SemaphoreWaitInfo waitInfo = {};
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &semaphore;
+	waitInfo.pValues = &value;
+	device.waitSemaphores(waitInfo, UINT64_MAX);
+
+	completed = std::max(completed, value);
+}
+
+void vkUtil::Timeline::signal(uint64_t value) {
+
+	vk::SemaphoreSignalInfo signalInfo = {};
+	signalInfo.semaphore = semaphore;
+	signalInfo.value = value;
+	device.signalSemaphore(signalInfo);
+
+	completed = std::max(completed, value);
+}
+
+void vkUtil::DeletionQueue::push(uint64_t value, std::function<void()> deletor) {
+
+	entries.emplace_back(value, std::move(deletor));
+}
+
+void vkUtil::DeletionQueue::flush(uint64_t completedValue) {
+
+	//values are usually pushed in order, but not always, so check every entry
+	for (auto entry = entries.begin(); entry != entries.end();) {
+		if (entry->first <= completedValue) {
+			entry->second();
+			entry = entries.erase(entry);
+		}
+		else {
+			++entry;
+		}
+	}
+}
+
+void vkUtil::DeletionQueue::flush_all() {
+
+	for (auto& entry : entries) {
+		entry.second();
+	}
+	entries.clear();
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "vulkan/vulkan.hpp"
+
+namespace vkUtil
+{
+	/**
+		Tracks gpu progress with a single timeline semaphore. Every submission signals
+		a new, larger value, so "is this work done" becomes a comparison against the
+		semaphore's counter rather than a fence per submission.
+	*/
+	class Timeline
+	{
+	public:
+		Timeline(vk::Device device, bool debug);
+		~Timeline();
+
+		Timeline(const Timeline&) = delete;
+		Timeline& operator=(const Timeline&) = delete;
+
+		/**
+			Reserve the value the next submission will signal.
+
+			\returns the value, larger than any handed out before
+		*/
+		uint64_t next_value() { return ++lastSubmitted; }
+
+		//the most recently reserved value
+		uint64_t last_submitted() const { return lastSubmitted; }
+
+		/**
+			Query the semaphore's counter.
+
+			\returns the largest value the gpu has signalled
+		*/
+		uint64_t completed_value();
+
+		/**
+			Check whether the gpu has reached a value, only querying the
+			semaphore if the last known value isn't enough.
+		*/
+		bool is_complete(uint64_t value);
+
+		/**
+			Block until the gpu reaches a value.
+		*/
+		void wait(uint64_t value);
+
+		/**
+			Set the counter from the cpu, for a reserved value whose submission never happened.
+			Everything submitted before it must be complete.
+		*/
+		void signal(uint64_t value);
+
+		vk::Semaphore get_semaphore() const { return semaphore; }
+
+	private:
+		vk::Device device;
+		vk::Semaphore semaphore;
+		uint64_t lastSubmitted{ 0 };
+		//last value read back from the semaphore
+		uint64_t completed{ 0 };
+	};
+
+	/**
+		Work deferred until the gpu reaches a timeline value, typically destroying
+		objects that submitted work may still be using.
+	*/
+	class DeletionQueue
+	{
+	public:
+		/**
+			\param value the timeline value after which the deletor may run
+			\param deletor the work to run
+		*/
+		void push(uint64_t value, std::function<void()> deletor);
+
+		/**
+			Run every deletor whose value has been reached, in the order they were pushed.
+
+			\param completedValue the timeline's completed value
+		*/
+		void flush(uint64_t completedValue);
+
+		//run everything, only once the device is idle
+		void flush_all();
+
+		bool empty() const { return entries.empty(); }
+
+	private:
+		std::deque<std::pair<uint64_t, std::function<void()>>> entries;
+	};
+}
@@ -0,0 +1,73 @@
+#include "pch.h"
+#include "trace.h"
+
+namespace {
+
+	std::string escape_json(const std::string& text) {
+
+		std::string escaped;
+		escaped.reserve(text.size());
+		for (char c : text) {
+			if (c == '"' || c == '\\') {
+				escaped.push_back('\\');
+			}
+			escaped.push_back(c);
+		}
+		return escaped;
+	}
+}
+
+double vkUtil::trace_now() {
+
+	static const auto epoch = std::chrono::steady_clock::now();
+	return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void vkUtil::write_trace_event(std::ostream& out, const TraceEvent& event) {
+
+	out << std::fixed << std::setprecision(3)
+		<< "{\"name\":\"" << escape_json(event.name) << "\",\"cat\":\"" << escape_json(event.category)
+		<< "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.threadId
+		<< ",\"ts\":" << event.start << ",\"dur\":" << event.duration;
+	if (!event.args.empty()) {
+		out << ",\"args\":{";
+		for (size_t i = 0; i < event.args.size(); ++i) {
+			out << (i ? "," : "") << '"' << escape_json(event.args[i].first) << "\":" << event.args[i].second;
+		}
+		out << '}';
+	}
+	out << '}';
+}
+
+void vkUtil::write_thread_name(std::ostream& out, uint32_t threadId, const std::string& name) {
+
+	out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << threadId
+		<< ",\"args\":{\"name\":\"" << escape_json(name) << "\"}}";
+}
+
+bool vkUtil::write_chrome_trace(const std::string& filename, const std::vector<TraceEvent>& events, const std::vector<std::string>& threadNames) {
+
+	std::ofstream file(filename);
+	if (!file) {
+		return false;
+	}
+
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+	bool first = true;
+	for (size_t i = 0; i < threadNames.size(); ++i) {
+		file << (first ? "" : ",\n");
+		write_thread_name(file, static_cast<uint32_t>(i), threadNames[i]);
+		first = false;
+	}
+
+	for (const TraceEvent& event : events) {
+		file << (first ? "" : ",\n");
+		write_trace_event(file, event);
+		first = false;
+	}
+
+	file << "\n]}\n";
+
+	return static_cast<bool>(file);
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+namespace vkUtil
+{
+	//the track gpu events are drawn on, cpu threads are numbered from 1 so they never share it
+	constexpr uint32_t gpuTraceThreadId = 0;
+
+	/**
+		One complete event in a Chrome trace, viewable in chrome://tracing or Perfetto.
+	*/
+	struct TraceEvent {
+		std::string name;
+		//groups events, eg. "cpu" or "gpu"
+		std::string category;
+		//the track the event is drawn on
+		uint32_t threadId;
+		//microseconds since trace_now's epoch
+		double start;
+		double duration;
+		//extra counters shown alongside the event
+		std::vector<std::pair<std::string, uint64_t>> args;
+	};
+
+	/**
+		\returns the cpu time in microseconds, measured from the first call
+	*/
+	double trace_now();
+
+	/**
+		Write a single event's JSON object, for writers which stream events out as they arrive.
+	*/
+	void write_trace_event(std::ostream& out, const TraceEvent& event);
+
+	/**
+		Write the metadata object which names a track.
+	*/
+	void write_thread_name(std::ostream& out, uint32_t threadId, const std::string& name);
+
+	/**
+		Write events to a Chrome trace JSON file.
+
+		\param filename the path to write to
+		\param events the events, in any order
+		\param threadNames names for the tracks, indexed by thread id
+		\returns whether the file was written
+	*/
+	bool write_chrome_trace(const std::string& filename, const std::vector<TraceEvent>& events, const std::vector<std::string>& threadNames);
+}
@@ -0,0 +1,328 @@
+#include "pch.h"
+#include "upload.h"
+#include "cpu_profiler.h"
+
+vkUtil::UploadManager::UploadManager(vk::Device device, MemoryAllocator& allocator, vk::Queue transferQueue,
+	uint32_t transferFamily, uint32_t graphicsFamily, vk::DeviceSize stagingSize, bool debug)
+	: device(device), allocator(allocator), queue(transferQueue), transferFamily(transferFamily),
+	graphicsFamily(graphicsFamily), debugMode(debug), timeline(device, debug), stagingSize(stagingSize) {
+
+	vk::CommandPoolCreateInfo poolInfo;
+	poolInfo.flags = vk::CommandPoolCreateFlags() | vk::CommandPoolCreateFlagBits::eResetCommandBuffer;
+	poolInfo.queueFamilyIndex = transferFamily;
+	commandPool = device.createCommandPool(poolInfo);
+
+	BufferInputChunk input;
+	input.size = stagingSize;
+	input.usage = vk::BufferUsageFlagBits::eTransferSrc;
+	input.memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+	staging = allocator.create_buffer(input);
+
+	if (debug) {
+		std::cout << "Uploading through a " << stagingSize / (1024 * 1024) << "MB staging ring on queue family "
+			<< transferFamily << (is_dedicated() ? ", separate from graphics\n" : ", shared with graphics\n");
+	}
+}
+
+vkUtil::UploadManager::~UploadManager() {
+
+	timeline.wait(timeline.last_submitted());
+	retire(false);
+
+	//recorded but never submitted, its command buffer goes with the pool
+	if (openBatch) {
+		for (Buffer& buffer : openBatch->dedicatedStaging) {
+			allocator.destroy_buffer(buffer);
+		}
+	}
+
+	device.destroyCommandPool(commandPool);
+	allocator.destroy_buffer(staging);
+}
+
+vkUtil::UploadManager::Batch& vkUtil::UploadManager::begin_batch() {
+
+	if (openBatch) {
+		return *openBatch;
+	}
+
+	Batch batch;
+	if (freeCommandBuffers.empty()) {
+		vk::CommandBufferAllocateInfo allocInfo = {};
+		allocInfo.commandPool = commandPool;
+		allocInfo.level = vk::CommandBufferLevel::ePrimary;
+		allocInfo.commandBufferCount = 1;
+		batch.commandBuffer = device.allocateCommandBuffers(allocInfo)[0];
+	}
+	else {
+		batch.commandBuffer = freeCommandBuffers.back();
+		freeCommandBuffers.pop_back();
+	}
+
+	vk::CommandBufferBeginInfo beginInfo = {};
+	beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+	batch.commandBuffer.begin(beginInfo);
+
+	openBatch = std::move(batch);
+	return *openBatch;
+}
+
+vkUtil::UploadManager::StagingSlice vkUtil::UploadManager::stage(const void* data, vk::DeviceSize size) {
+
+	//a multiple of every texel block size, so image copies can start anywhere we hand out
+	const uint64_t alignment = 16;
+
+	if (size > stagingSize) {
+		BufferInputChunk input;
+		input.size = size;
+		input.usage = vk::BufferUsageFlagBits::eTransferSrc;
+		input.memoryProperties = vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent;
+		Buffer buffer = allocator.create_buffer(input);
+		memcpy(buffer.allocation.mapped, data, size);
+
+		begin_batch().dedicatedStaging.push_back(buffer);
+		return { buffer.buffer, 0 };
+	}
+
+	while (true) {
+
+		//an empty ring can start over from the beginning, so nothing is lost to wrapping
+		if (readCursor == writeCursor) {
+			writeCursor = (writeCursor + stagingSize - 1) / stagingSize * stagingSize;
+			readCursor = writeCursor;
+		}
+
+		uint64_t start = (writeCursor + alignment - 1) & ~(alignment - 1);
+		if (start % stagingSize + size > stagingSize) {
+			start = (start / stagingSize + 1) * stagingSize;
+		}
+
+		if (start + size - readCursor <= stagingSize) {
+			writeCursor = start + size;
+			vk::DeviceSize offset = start % stagingSize;
+			memcpy(static_cast<char*>(staging.allocation.mapped) + offset, data, size);
+			return { staging.buffer, offset };
+		}
+
+		//full, the open batch has to be submitted before anything it staged can be reclaimed
+		PROFILE_SCOPE("wait for staging");
+		flush();
+		retire(true);
+	}
+}
+
+void vkUtil::UploadManager::retire(bool waitForOldest) {
+
+	if (waitForOldest && !submitted.empty()) {
+		if (debugMode) {
+			std::cout << "Staging ring full, waiting for an upload to finish\n";
+		}
+		timeline.wait(submitted.front().value);
+	}
+
+	uint64_t completed = timeline.completed_value();
+	while (!submitted.empty() && submitted.front().value <= completed) {
+		Batch& batch = submitted.front();
+		readCursor = batch.stagingEnd;
+		for (Buffer& buffer : batch.dedicatedStaging) {
+			allocator.destroy_buffer(buffer);
+		}
+		freeCommandBuffers.push_back(batch.commandBuffer);
+		submitted.pop_front();
+	}
+}
+
+vkUtil::UploadToken vkUtil::UploadManager::upload_buffer(const void* data, vk::DeviceSize size, vk::Buffer buffer,
+	vk::DeviceSize offset, vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess) {
+
+	StagingSlice slice = stage(data, size);
+	Batch& batch = begin_batch();
+	UploadToken token = timeline.last_submitted() + 1;
+
+	vk::BufferCopy copyRegion(slice.offset, offset, size);
+	batch.commandBuffer.copyBuffer(slice.buffer, buffer, copyRegion);
+
+	vk::BufferMemoryBarrier barrier = {};
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.buffer = buffer;
+	barrier.offset = offset;
+	barrier.size = size;
+
+	//a separate family has to release the buffer, and the graphics queue acquire it
+	if (is_dedicated()) {
+		barrier.srcQueueFamilyIndex = transferFamily;
+		barrier.dstQueueFamilyIndex = graphicsFamily;
+		barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+		batch.commandBuffer.pipelineBarrier(
+			vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe,
+			vk::DependencyFlags(), nullptr, barrier, nullptr
+		);
+	}
+
+	//the semaphore wait makes the copy available, the acquire makes it visible
+	barrier.srcAccessMask = vk::AccessFlags();
+	barrier.dstAccessMask = dstAccess;
+	Acquire acquire;
+	acquire.value = token;
+	acquire.dstStage = dstStage;
+	acquire.bufferBarrier = barrier;
+	acquires.push_back(acquire);
+
+	return token;
+}
+
+vkUtil::UploadToken vkUtil::UploadManager::upload_image(const void* data, vk::DeviceSize size, const ImageUploadInput& input) {
+
+	StagingSlice slice = stage(data, size);
+	return upload_image(slice.buffer, slice.offset, input);
+}
+
+void vkUtil::UploadManager::adopt_staging(Buffer staging) {
+
+	begin_batch().dedicatedStaging.push_back(staging);
+}
+
+vkUtil::UploadToken vkUtil::UploadManager::upload_image(vk::Buffer staging, vk::DeviceSize stagingOffset, const ImageUploadInput& input) {
+
+	Batch& batch = begin_batch();
+	UploadToken token = timeline.last_submitted() + 1;
+
+	vk::ImageMemoryBarrier barrier = {};
+	barrier.oldLayout = vk::ImageLayout::eUndefined;
+	barrier.newLayout = vk::ImageLayout::eTransferDstOptimal;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = input.image;
+	barrier.subresourceRange = input.range;
+	barrier.dstAccessMask = vk::AccessFlagBits::eTransferWrite;
+	batch.commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eTopOfPipe, vk::PipelineStageFlagBits::eTransfer,
+		vk::DependencyFlags(), nullptr, nullptr, barrier
+	);
+
+	std::vector<vk::BufferImageCopy> regions = input.regions;
+	for (vk::BufferImageCopy& region : regions) {
+		region.bufferOffset += stagingOffset;
+	}
+	batch.commandBuffer.copyBufferToImage(staging, input.image, vk::ImageLayout::eTransferDstOptimal, regions);
+
+	//the transfer queue moves the image into its final layout, releasing it at the same time if need be
+	barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+	barrier.newLayout = input.finalLayout;
+	barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+	barrier.dstAccessMask = vk::AccessFlags();
+	if (is_dedicated()) {
+		barrier.srcQueueFamilyIndex = transferFamily;
+		barrier.dstQueueFamilyIndex = graphicsFamily;
+	}
+	batch.commandBuffer.pipelineBarrier(
+		vk::PipelineStageFlagBits::eTransfer, vk::PipelineStageFlagBits::eBottomOfPipe,
+		vk::DependencyFlags(), nullptr, nullptr, barrier
+	);
+
+	//an acquire repeats the release's layout transition, otherwise the image is already there
+	if (!is_dedicated()) {
+		barrier.oldLayout = input.finalLayout;
+	}
+	barrier.srcAccessMask = vk::AccessFlags();
+	barrier.dstAccessMask = input.dstAccess;
+	Acquire acquire;
+	acquire.value = token;
+	acquire.dstStage = input.dstStage;
+	acquire.imageBarrier = barrier;
+	acquires.push_back(acquire);
+
+	return token;
+}
+
+vkUtil::UploadToken vkUtil::UploadManager::flush() {
+
+	if (!openBatch) {
+		return timeline.last_submitted();
+	}
+
+	Batch batch = std::move(*openBatch);
+	openBatch.reset();
+	batch.commandBuffer.end();
+	//the value the batch's uploads were handed as their token
+	batch.value = timeline.last_submitted() + 1;
+	batch.stagingEnd = writeCursor;
+
+	vk::Semaphore signalSemaphore = timeline.get_semaphore();
+	vk::TimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &batch.value;
+
+	vk::SubmitInfo submitInfo = {};
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &batch.commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &signalSemaphore;
+	submitInfo.pNext = &timelineInfo;
+
+	try {
+		queue.submit(submitInfo, nullptr);
+	}
+	catch (vk::SystemError err) {
+		if (debugMode) {
+			std::cout << "Failed to submit uploads!\n";
+		}
+
+		//the uploads are dropped, so is everything they staged and the acquires waiting on them
+		for (Buffer& buffer : batch.dedicatedStaging) {
+			allocator.destroy_buffer(buffer);
+		}
+		freeCommandBuffers.push_back(batch.commandBuffer);
+		writeCursor = submitted.empty() ? readCursor : submitted.back().stagingEnd;
+		acquires.erase(std::remove_if(acquires.begin(), acquires.end(),
+			[&batch](const Acquire& acquire) { return acquire.value == batch.value; }),
+			acquires.end());
+
+		//the value is used up, so the next batch's tokens can't be mistaken for these,
+		//and signalled once the batches before it finish, so waiting on it doesn't hang
+		timeline.next_value();
+		timeline.wait(batch.value - 1);
+		timeline.signal(batch.value);
+		failedTokens.insert(batch.value);
+		return batch.value;
+	}
+
+	timeline.next_value();
+	UploadToken value = batch.value;
+	submitted.push_back(std::move(batch));
+	return value;
+}
+
+vkUtil::UploadWait vkUtil::UploadManager::record_acquires(vk::CommandBuffer commandBuffer) {
+
+	flush();
+	retire(false);
+
+	UploadWait wait;
+	if (acquires.empty()) {
+		return wait;
+	}
+
+	std::vector<vk::BufferMemoryBarrier> bufferBarriers;
+	std::vector<vk::ImageMemoryBarrier> imageBarriers;
+	for (const Acquire& acquire : acquires) {
+		wait.value = std::max(wait.value, acquire.value);
+		wait.stages |= acquire.dstStage;
+		if (acquire.bufferBarrier) {
+			bufferBarriers.push_back(acquire.bufferBarrier.value());
+		}
+		else {
+			imageBarriers.push_back(acquire.imageBarrier.value());
+		}
+	}
+	acquires.clear();
+
+	//the source stages chain onto the submission's semaphore wait
+	commandBuffer.pipelineBarrier(
+		wait.stages, wait.stages,
+		vk::DependencyFlags(), nullptr, bufferBarriers, imageBarriers
+	);
+
+	return wait;
+}
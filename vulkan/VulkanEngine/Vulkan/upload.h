@@ -0,0 +1,191 @@
+#pragma once
+#include "vulkan/vulkan.hpp"
+#include "memory.h"
+#include "timeline.h"
+
+namespace vkUtil
+{
+	/**
+		Identifies the batch an upload was put in. The upload has finished on the
+		transfer queue once the upload manager's timeline reaches it, unless the
+		batch failed to submit, which the upload manager remembers.
+	*/
+	using UploadToken = uint64_t;
+
+	/**
+		What a graphics submission has to wait for before using newly uploaded resources.
+	*/
+	struct UploadWait {
+		//the upload timeline value, zero if there is nothing to wait for
+		uint64_t value{ 0 };
+		//the stages which use the resources
+		vk::PipelineStageFlags stages;
+	};
+
+	/**
+		Holds the data needed to upload to an image.
+	*/
+	struct ImageUploadInput {
+		vk::Image image;
+		//bufferOffset is relative to the start of the uploaded data
+		std::vector<vk::BufferImageCopy> regions;
+		//every subresource the regions write to
+		vk::ImageSubresourceRange range;
+		vk::ImageLayout finalLayout;
+		//how the graphics queue will use the image
+		vk::PipelineStageFlags dstStage;
+		vk::AccessFlags dstAccess;
+	};
+
+	/**
+		Copies data into device local resources on the transfer queue, through a
+		ring of host visible staging memory.
+
+		Uploads are gathered into a batch, which is submitted as a single command buffer
+		once per frame by record_acquires, or early if the staging ring fills. When the
+		transfer queue is from another family, each resource is released by the transfer
+		queue and acquired by the graphics queue. Not thread safe, use from the render thread.
+	*/
+	class UploadManager
+	{
+	public:
+		/**
+			\param device the logical device
+			\param allocator the device memory allocator
+			\param transferQueue the queue to copy on
+			\param transferFamily the transfer queue's family
+			\param graphicsFamily the family of the queue which uses the resources
+			\param stagingSize the size of the staging ring, must be a power of two
+			\param debug whether the system is running in debug mode
+		*/
+		UploadManager(vk::Device device, MemoryAllocator& allocator, vk::Queue transferQueue,
+			uint32_t transferFamily, uint32_t graphicsFamily, vk::DeviceSize stagingSize, bool debug);
+		~UploadManager();
+
+		UploadManager(const UploadManager&) = delete;
+		UploadManager& operator=(const UploadManager&) = delete;
+
+		/**
+			Copy data into a buffer. The buffer needs TransferDst usage.
+
+			\param data the data to copy, which is staged before this returns
+			\param size the number of bytes
+			\param buffer the destination
+			\param offset where in the destination to copy to
+			\param dstStage the stages the graphics queue will use the buffer in
+			\param dstAccess how the graphics queue will use the buffer
+			\returns the batch the copy is in
+		*/
+		UploadToken upload_buffer(const void* data, vk::DeviceSize size, vk::Buffer buffer, vk::DeviceSize offset,
+			vk::PipelineStageFlags dstStage, vk::AccessFlags dstAccess);
+
+		/**
+			Copy data into an image, moving it from an undefined layout into its final layout.
+			The image needs TransferDst usage.
+
+			\param data the data to copy, which is staged before this returns
+			\param size the number of bytes
+			\param input the destination and copy regions
+			\returns the batch the copy is in
+		*/
+		UploadToken upload_image(const void* data, vk::DeviceSize size, const ImageUploadInput& input);
+
+		/**
+			Copy into an image from host visible memory the caller has already filled,
+			so data can be written straight into staging memory. The buffer is read when
+			the batch runs, so it should be handed over with adopt_staging.
+
+			\param staging the buffer holding the data, which needs TransferSrc usage
+			\param stagingOffset where the data starts in the buffer
+			\param input the destination and copy regions
+			\returns the batch the copy is in
+		*/
+		UploadToken upload_image(vk::Buffer staging, vk::DeviceSize stagingOffset, const ImageUploadInput& input);
+
+		/**
+			Take ownership of a staging buffer, which is freed once the open batch completes.
+
+			\param staging a buffer made by the same allocator
+		*/
+		void adopt_staging(Buffer staging);
+
+		/**
+			Submit the open batch, if it has anything in it. If the submit fails the batch's
+			uploads are dropped and its token is marked as failed, it's never reused.
+
+			\returns the batch's token, or the last batch's if there was nothing to submit
+		*/
+		UploadToken flush();
+
+		/**
+			Submit the open batch, then record the graphics side of every submitted upload
+			into a command buffer, outside a renderpass. Resources may be used by the
+			commands recorded after this.
+
+			\param commandBuffer the graphics command buffer being recorded
+			\returns what the command buffer's submission must wait for
+		*/
+		UploadWait record_acquires(vk::CommandBuffer commandBuffer);
+
+		//whether the upload has finished, never true for one which failed
+		bool is_complete(UploadToken token) { return !has_failed(token) && timeline.is_complete(token); }
+		//whether the upload's batch failed to submit, so it will never happen
+		bool has_failed(UploadToken token) const { return failedTokens.count(token) > 0; }
+		//block until the upload has finished or failed
+		void wait(UploadToken token) { timeline.wait(token); }
+
+		vk::Semaphore get_semaphore() const { return timeline.get_semaphore(); }
+		//whether uploads run on a queue of their own family
+		bool is_dedicated() const { return transferFamily != graphicsFamily; }
+
+	private:
+		struct Batch {
+			vk::CommandBuffer commandBuffer;
+			UploadToken value{ 0 };
+			//the staging ring can be reclaimed up to here once the batch completes
+			uint64_t stagingEnd{ 0 };
+			//uploads too large for the ring get a staging buffer of their own
+			std::vector<Buffer> dedicatedStaging;
+		};
+
+		struct Acquire {
+			UploadToken value;
+			vk::PipelineStageFlags dstStage;
+			//exactly one of these is used
+			std::optional<vk::BufferMemoryBarrier> bufferBarrier;
+			std::optional<vk::ImageMemoryBarrier> imageBarrier;
+		};
+
+		struct StagingSlice {
+			vk::Buffer buffer;
+			vk::DeviceSize offset;
+		};
+
+		vk::Device device;
+		MemoryAllocator& allocator;
+		vk::Queue queue;
+		uint32_t transferFamily;
+		uint32_t graphicsFamily;
+		bool debugMode;
+
+		Timeline timeline;
+		vk::CommandPool commandPool;
+		std::vector<vk::CommandBuffer> freeCommandBuffers;
+
+		//the ring's cursors count bytes ever written and reclaimed, the position is modulo its size
+		Buffer staging;
+		vk::DeviceSize stagingSize;
+		uint64_t writeCursor{ 0 };
+		uint64_t readCursor{ 0 };
+
+		std::optional<Batch> openBatch;
+		std::deque<Batch> submitted;
+		std::vector<Acquire> acquires;
+		//batches which failed to submit, whose timeline values were signalled from the cpu
+		std::set<UploadToken> failedTokens;
+
+		Batch& begin_batch();
+		StagingSlice stage(const void* data, vk::DeviceSize size);
+		void retire(bool waitForOldest);
+	};
+}
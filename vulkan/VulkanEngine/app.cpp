@@ -1,27 +1,96 @@
 #include "pch.h"
 #include "app.h"
 #include "scene.h"
+#include "benchmark.h"
+#include "cpu_profiler.h"
 
-App::App(int width, int height, bool debug)
+App::App(int width, int height, bool debug, bool headless)
 {
-	build_glfw_window(width, height, debug);
+	//the engine renders offscreen when it isn't given a window
+	if (!headless) {
+		build_glfw_window(width, height, debug);
+	}
 
 	graphicsEngine = new Engine(width, height, window, debug);
 	scene = new Scene();
 }
 App::~App()
 {
+	if (!traceFilename.empty()) {
+		graphicsEngine->save_trace(traceFilename);
+	}
+	if (frameStats.get_frame_count() > 0) {
+		frameStats.write_csv("frame_stats.csv");
+	}
 	delete graphicsEngine;
 }
 
+void App::set_trace_output(const std::string& outputFilename)
+{
+	traceFilename = outputFilename;
+	graphicsEngine->set_profiling(true, true);
+}
+
+bool App::load_model(const std::string& filename)
+{
+	std::vector<uint32_t> meshes = graphicsEngine->load_model(filename);
+	if (meshes.empty()) {
+		return false;
+	}
+	scene->set_mesh(meshes[0]);
+	modelFilename = filename;
+	return true;
+}
+
 void App::run()
 {
+	PROFILE_FUNCTION();
+
 	while (Running && !glfwWindowShouldClose(window))
 	{
+		PROFILE_SCOPE("frame");
 		glfwPollEvents();
+		auto start = std::chrono::high_resolution_clock::now();
+		graphicsEngine->render(scene);
+		record_frame_stats(start, std::chrono::high_resolution_clock::now());
+		update_title();
+	}
+
+	std::cout << frameStats.report();
+}
+
+void App::run_benchmark()
+{
+	//run twice to compare, the first run after deleting pipeline_cache.bin is cold
+	std::cout << "Startup pipeline creation: " << graphicsEngine->get_pipeline_creation_time() << " ms ("
+		<< (graphicsEngine->is_pipeline_cache_warm() ? "warm" : "cold") << " pipeline cache)\n";
+
+	benchmark::draw_submission(graphicsEngine, window);
+	benchmark::recording_threads(graphicsEngine, window);
+	benchmark::frames_in_flight(graphicsEngine, window);
+	benchmark::resize_hitch(graphicsEngine, window);
+	benchmark::material_switching(graphicsEngine, window);
+	benchmark::render_graph(graphicsEngine, window);
+	benchmark::texture_decoding(graphicsEngine);
+	benchmark::mip_generation(graphicsEngine);
+	benchmark::texture_cooking(graphicsEngine);
+	if (!modelFilename.empty()) {
+		benchmark::mesh_loading(modelFilename);
+	}
+}
+
+void App::run_headless(int frameCount, const std::string& outputFilename)
+{
+	for (int i = 0; i < frameCount; ++i) {
+
+		auto start = std::chrono::high_resolution_clock::now();
 		graphicsEngine->render(scene);
-		calculateFrameRate();
+		record_frame_stats(start, std::chrono::high_resolution_clock::now());
 	}
+
+	graphicsEngine->save_frame(outputFilename);
+
+	std::cout << frameStats.report();
 }
 
 void App::build_glfw_window(int width, int height, bool debugMode)
@@ -32,8 +101,8 @@ void App::build_glfw_window(int width, int height, bool debugMode)
 	//no default rendering client, we'll hook vulkan up
 	//to the window later
 	glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-	//resizing breaks the swapchain, we'll disable it for now
-	glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+	//viewport and scissor are dynamic, so a resize only recreates the swapchain and framebuffers
+	glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
 
 	//GLFWwindow* glfwCreateWindow (int width, int height, const char *title, GLFWmonitor *monitor, GLFWwindow *share)
 	if (window = glfwCreateWindow(width, height, "ID Tech 12", nullptr, nullptr)) {
@@ -48,21 +117,44 @@ void App::build_glfw_window(int width, int height, bool debugMode)
 	}
 }
 
-void App::calculateFrameRate()
+/**
+* Record the frame just rendered, if the engine submitted one, along with
+* any gpu time which has arrived since the last frame.
+*/
+void App::record_frame_stats(std::chrono::high_resolution_clock::time_point start, std::chrono::high_resolution_clock::time_point end)
 {
-	currentTime = glfwGetTime();
-	double delta = currentTime - lastTime;
-
-	if (delta >= 1) {
-		int framerate{ std::max(1, int(numFrames / delta)) };
-		std::stringstream title;
-		title << "Running at " << framerate << " fps.";
-		glfwSetWindowTitle(window, title.str().c_str());
-		lastTime = currentTime;
-		numFrames = -1;
-		frameTime = float(1000.0 / framerate);
+	unsubmittedTime += std::chrono::duration<double, std::milli>(end - start).count();
+
+	uint64_t frameIndex = graphicsEngine->get_frame_index();
+	if (frameIndex == 0) {
+		return;
 	}
+	if (firstFrameIndex == 0) {
+		firstFrameIndex = frameIndex;
+	}
+
+	if (frameIndex >= firstFrameIndex + frameStats.get_frame_count()) {
+		double interval = std::chrono::duration<double, std::milli>(end - lastFrameEnd).count();
+		frameStats.record_frame(unsubmittedTime, interval);
+		lastFrameEnd = end;
+		unsubmittedTime = 0.0;
+	}
+
+	//gpu timings arrive once a frame context comes round again, a few frames late
+	uint64_t gpuFrame = graphicsEngine->get_gpu_frame_index();
+	if (gpuFrame >= firstFrameIndex) {
+		frameStats.record_gpu(gpuFrame - firstFrameIndex + 1, graphicsEngine->get_gpu_frame_time());
+	}
+}
 
-	++numFrames;
+void App::update_title()
+{
+	double currentTime = glfwGetTime();
+	if (currentTime - lastTitleUpdate < 1.0) {
+		return;
+	}
 
+	std::string title = frameStats.take_summary();
+	glfwSetWindowTitle(window, title.c_str());
+	lastTitleUpdate = currentTime;
 }
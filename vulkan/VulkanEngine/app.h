@@ -1,22 +1,59 @@
 #pragma once
 #include "Vulkan/engine.h"
+#include "frame_stats.h"
 
 class App
 {
 public:
-	App(int width, int height, bool debug);
+	App(int width, int height, bool debug, bool headless);
 	~App();
 	void run();
+	void run_benchmark();
+
+	/**
+		Render a number of frames without a window, printing each frame's timings,
+		then save the last frame.
+
+		\param frameCount the number of frames to render
+		\param outputFilename where to write the last frame, as a PPM
+	*/
+	void run_headless(int frameCount, const std::string& outputFilename);
+
+	/**
+		Capture cpu and gpu scopes for every frame rendered from now on,
+		and write them out as a Chrome trace when the app closes.
+
+		\param outputFilename where to write the trace, viewable in chrome://tracing or Perfetto
+	*/
+	void set_trace_output(const std::string& outputFilename);
+
+	/**
+		Draw the scene's objects with the first mesh of a model instead of the triangle.
+
+		\param filename the path to the model
+		\returns whether the model had any meshes
+	*/
+	bool load_model(const std::string& filename);
 
 private:
 	Engine* graphicsEngine;
-	GLFWwindow* window;
+	GLFWwindow* window{ nullptr };
 	Scene* scene;
 
-	double lastTime, currentTime;
-	int numFrames;
-	float frameTime;
 	bool Running = true;
+	std::string traceFilename;
+	//the model passed to load_model, also used by the mesh loading benchmark
+	std::string modelFilename;
+
+	//a frame presented later than this has missed 30fps, which reads as a stutter
+	FrameStats frameStats{ 1000.0 / 30.0 };
+	std::chrono::high_resolution_clock::time_point lastFrameEnd;
+	//engine frames before this one weren't recorded, and cpu time of calls which didn't submit
+	uint64_t firstFrameIndex = 0;
+	double unsubmittedTime = 0.0;
+	double lastTitleUpdate = 0.0;
+
 	void build_glfw_window(int width, int height, bool debugMode);
-	void calculateFrameRate();
+	void record_frame_stats(std::chrono::high_resolution_clock::time_point start, std::chrono::high_resolution_clock::time_point end);
+	void update_title();
 };
\ No newline at end of file
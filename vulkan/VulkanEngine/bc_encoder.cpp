@@ -0,0 +1,746 @@
+#include "pch.h"
+#include "bc_encoder.h"
+#include "thread_pool.h"
+#include "cpu_profiler.h"
+
+#if defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#define BC_ENCODER_SSE2
+#endif
+
+namespace
+{
+	using Texels = float[16][4];
+
+	//BC7's 4 bit interpolation weights, out of 64
+	constexpr int bc7Weights[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+	//where each BC1 index sits between the first endpoint and the second
+	constexpr float bc1Fractions[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+
+	/**
+		The colours a block's indices pick from. They're stored a channel at a time so
+		four entries can be compared at once, padded to a multiple of four by repeating the last.
+	*/
+	struct Palette
+	{
+		alignas(16) float channels[4][16] = {};
+		int size = 0;
+
+		void add(float r, float g, float b, float a)
+		{
+			channels[0][size] = r;
+			channels[1][size] = g;
+			channels[2][size] = b;
+			channels[3][size] = a;
+			++size;
+		}
+
+		void pad()
+		{
+			while (size % 4 != 0)
+			{
+				add(channels[0][size - 1], channels[1][size - 1], channels[2][size - 1], channels[3][size - 1]);
+			}
+		}
+	};
+
+	/**
+		Pick the closest palette entry to each texel, the lowest index on a tie.
+
+		\param weights how much each channel's error counts
+		\returns the total weighted squared error
+	*/
+	float fit_indices(const Texels& texels, const Palette& palette, const float weights[4], uint8_t indices[16])
+	{
+		float total = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+#ifdef BC_ENCODER_SSE2
+			//each lane keeps the best of every fourth entry
+			__m128 bestDistance = _mm_set1_ps(std::numeric_limits<float>::max());
+			__m128i bestIndex = _mm_setzero_si128();
+			for (int group = 0; group < palette.size; group += 4)
+			{
+				__m128 distance = _mm_setzero_ps();
+				for (int c = 0; c < 4; ++c)
+				{
+					__m128 difference = _mm_sub_ps(_mm_load_ps(&palette.channels[c][group]), _mm_set1_ps(texels[i][c]));
+					distance = _mm_add_ps(distance, _mm_mul_ps(_mm_mul_ps(difference, difference), _mm_set1_ps(weights[c])));
+				}
+				__m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, bestDistance));
+				__m128i index = _mm_add_epi32(_mm_set1_epi32(group), _mm_set_epi32(3, 2, 1, 0));
+				bestIndex = _mm_or_si128(_mm_and_si128(closer, index), _mm_andnot_si128(closer, bestIndex));
+				bestDistance = _mm_min_ps(distance, bestDistance);
+			}
+
+			alignas(16) float distances[4];
+			alignas(16) int32_t candidates[4];
+			_mm_store_ps(distances, bestDistance);
+			_mm_store_si128(reinterpret_cast<__m128i*>(candidates), bestIndex);
+			int best = 0;
+			for (int lane = 1; lane < 4; ++lane)
+			{
+				if (distances[lane] < distances[best]
+					|| (distances[lane] == distances[best] && candidates[lane] < candidates[best]))
+				{
+					best = lane;
+				}
+			}
+			indices[i] = static_cast<uint8_t>(candidates[best]);
+			total += distances[best];
+#else
+			float bestDistance = std::numeric_limits<float>::max();
+			for (int entry = 0; entry < palette.size; ++entry)
+			{
+				float distance = 0.0f;
+				for (int c = 0; c < 4; ++c)
+				{
+					float difference = palette.channels[c][entry] - texels[i][c];
+					distance += difference * difference * weights[c];
+				}
+				if (distance < bestDistance)
+				{
+					bestDistance = distance;
+					indices[i] = static_cast<uint8_t>(entry);
+				}
+			}
+			total += bestDistance;
+#endif
+		}
+		return total;
+	}
+
+	/**
+		Find the endpoints of a line through the texels, along their principal axis.
+	*/
+	void principal_endpoints(const Texels& texels, int channelCount, float low[4], float high[4])
+	{
+		float mean[4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int c = 0; c < channelCount; ++c)
+			{
+				mean[c] += texels[i][c] / 16.0f;
+			}
+		}
+
+		float covariance[4][4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int a = 0; a < channelCount; ++a)
+			{
+				for (int b = 0; b < channelCount; ++b)
+				{
+					covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+				}
+			}
+		}
+
+		//power iteration, starting from the spread along each channel
+		float axis[4] = {};
+		for (int c = 0; c < channelCount; ++c)
+		{
+			axis[c] = std::sqrt(covariance[c][c]);
+		}
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float next[4] = {};
+			float length = 0.0f;
+			for (int a = 0; a < channelCount; ++a)
+			{
+				for (int b = 0; b < channelCount; ++b)
+				{
+					next[a] += covariance[a][b] * axis[b];
+				}
+				length = std::max(length, std::abs(next[a]));
+			}
+			if (length < 1e-6f)
+			{
+				break;
+			}
+			for (int c = 0; c < channelCount; ++c)
+			{
+				axis[c] = next[c] / length;
+			}
+		}
+
+		float length = 0.0f;
+		for (int c = 0; c < channelCount; ++c)
+		{
+			length += axis[c] * axis[c];
+		}
+		length = std::sqrt(length);
+
+		float lowest = 0.0f;
+		float highest = 0.0f;
+		if (length > 1e-6f)
+		{
+			for (int c = 0; c < channelCount; ++c)
+			{
+				axis[c] /= length;
+			}
+			lowest = std::numeric_limits<float>::max();
+			highest = -lowest;
+			for (int i = 0; i < 16; ++i)
+			{
+				float projection = 0.0f;
+				for (int c = 0; c < channelCount; ++c)
+				{
+					projection += (texels[i][c] - mean[c]) * axis[c];
+				}
+				lowest = std::min(lowest, projection);
+				highest = std::max(highest, projection);
+			}
+		}
+
+		for (int c = 0; c < 4; ++c)
+		{
+			low[c] = c < channelCount ? std::clamp(mean[c] + lowest * axis[c], 0.0f, 255.0f) : 255.0f;
+			high[c] = c < channelCount ? std::clamp(mean[c] + highest * axis[c], 0.0f, 255.0f) : 255.0f;
+		}
+	}
+
+	/**
+		Move the endpoints to the least squares fit of the texels, keeping the indices.
+
+		\param fractions where each index sits between the first endpoint and the second
+		\returns whether the fit was solvable
+	*/
+	bool refine_endpoints(const Texels& texels, const uint8_t indices[16], const float* fractions, int channelCount,
+		float first[4], float second[4])
+	{
+		float aa = 0.0f;
+		float ab = 0.0f;
+		float bb = 0.0f;
+		float aTexel[4] = {};
+		float bTexel[4] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			float b = fractions[indices[i]];
+			float a = 1.0f - b;
+			aa += a * a;
+			ab += a * b;
+			bb += b * b;
+			for (int c = 0; c < channelCount; ++c)
+			{
+				aTexel[c] += a * texels[i][c];
+				bTexel[c] += b * texels[i][c];
+			}
+		}
+
+		float determinant = aa * bb - ab * ab;
+		if (std::abs(determinant) < 1e-6f)
+		{
+			return false;
+		}
+		for (int c = 0; c < channelCount; ++c)
+		{
+			first[c] = std::clamp((bb * aTexel[c] - ab * bTexel[c]) / determinant, 0.0f, 255.0f);
+			second[c] = std::clamp((aa * bTexel[c] - ab * aTexel[c]) / determinant, 0.0f, 255.0f);
+		}
+		return true;
+	}
+
+	uint16_t to_565(const float color[4])
+	{
+		int r = std::clamp(static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f), 0, 31);
+		int g = std::clamp(static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f), 0, 63);
+		int b = std::clamp(static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f), 0, 31);
+		return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+	}
+
+	void from_565(uint16_t value, int color[3])
+	{
+		int r = (value >> 11) & 31;
+		int g = (value >> 5) & 63;
+		int b = value & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	//the four colour palette, BC1 in its opaque mode and BC3's colour block
+	void bc1_palette(uint16_t first, uint16_t second, int colors[4][3])
+	{
+		from_565(first, colors[0]);
+		from_565(second, colors[1]);
+		for (int c = 0; c < 3; ++c)
+		{
+			colors[2][c] = (2 * colors[0][c] + colors[1][c]) / 3;
+			colors[3][c] = (colors[0][c] + 2 * colors[1][c]) / 3;
+		}
+	}
+
+	void encode_color(const Texels& texels, uint8_t* block)
+	{
+		const float weights[4] = { 1.0f, 1.0f, 1.0f, 0.0f };
+		float first[4];
+		float second[4];
+		principal_endpoints(texels, 3, second, first);
+
+		uint16_t bestFirst = 0;
+		uint16_t bestSecond = 0;
+		uint8_t bestIndices[16] = {};
+		float bestError = std::numeric_limits<float>::max();
+		for (int iteration = 0; iteration < 3; ++iteration)
+		{
+			//the first endpoint must be the larger, or the block is read as three colours and black
+			uint16_t quantizedFirst = to_565(first);
+			uint16_t quantizedSecond = to_565(second);
+			if (quantizedFirst < quantizedSecond)
+			{
+				std::swap(quantizedFirst, quantizedSecond);
+				std::swap(first, second);
+			}
+
+			int colors[4][3];
+			bc1_palette(quantizedFirst, quantizedSecond, colors);
+			Palette palette;
+			for (const int* color : colors)
+			{
+				palette.add(static_cast<float>(color[0]), static_cast<float>(color[1]), static_cast<float>(color[2]), 255.0f);
+			}
+
+			uint8_t indices[16];
+			float error = fit_indices(texels, palette, weights, indices);
+			if (error < bestError)
+			{
+				bestError = error;
+				bestFirst = quantizedFirst;
+				bestSecond = quantizedSecond;
+				memcpy(bestIndices, indices, sizeof(indices));
+			}
+			if (quantizedFirst == quantizedSecond || !refine_endpoints(texels, indices, bc1Fractions, 3, first, second))
+			{
+				break;
+			}
+		}
+
+		//equal endpoints switch to three colours, where only index 0 is still the endpoint
+		uint32_t bits = 0;
+		if (bestFirst != bestSecond)
+		{
+			for (int i = 0; i < 16; ++i)
+			{
+				bits |= static_cast<uint32_t>(bestIndices[i]) << (2 * i);
+			}
+		}
+		block[0] = static_cast<uint8_t>(bestFirst);
+		block[1] = static_cast<uint8_t>(bestFirst >> 8);
+		block[2] = static_cast<uint8_t>(bestSecond);
+		block[3] = static_cast<uint8_t>(bestSecond >> 8);
+		memcpy(block + 4, &bits, sizeof(bits));
+	}
+
+	void decode_color(const uint8_t* block, uint8_t* pixels)
+	{
+		uint16_t first = static_cast<uint16_t>(block[0] | (block[1] << 8));
+		uint16_t second = static_cast<uint16_t>(block[2] | (block[3] << 8));
+		uint32_t bits;
+		memcpy(&bits, block + 4, sizeof(bits));
+
+		int colors[4][3];
+		bc1_palette(first, second, colors);
+		if (first <= second)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				colors[2][c] = (colors[0][c] + colors[1][c]) / 2;
+				colors[3][c] = 0;
+			}
+		}
+
+		for (int i = 0; i < 16; ++i)
+		{
+			const int* color = colors[(bits >> (2 * i)) & 3];
+			pixels[4 * i] = static_cast<uint8_t>(color[0]);
+			pixels[4 * i + 1] = static_cast<uint8_t>(color[1]);
+			pixels[4 * i + 2] = static_cast<uint8_t>(color[2]);
+			pixels[4 * i + 3] = 255;
+		}
+	}
+
+	//the eight alpha palette, which needs the first endpoint to be the larger
+	void bc4_palette(int first, int second, int alphas[8])
+	{
+		alphas[0] = first;
+		alphas[1] = second;
+		for (int i = 1; i < 7; ++i)
+		{
+			alphas[i + 1] = ((7 - i) * first + i * second) / 7;
+		}
+	}
+
+	void encode_alpha(const Texels& texels, uint8_t* block)
+	{
+		float lowest = 255.0f;
+		float highest = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			lowest = std::min(lowest, texels[i][3]);
+			highest = std::max(highest, texels[i][3]);
+		}
+		int first = static_cast<int>(highest + 0.5f);
+		int second = static_cast<int>(lowest + 0.5f);
+
+		uint64_t bits = 0;
+		if (first > second)
+		{
+			const float weights[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+			int alphas[8];
+			bc4_palette(first, second, alphas);
+			Palette palette;
+			for (int alpha : alphas)
+			{
+				palette.add(0.0f, 0.0f, 0.0f, static_cast<float>(alpha));
+			}
+
+			uint8_t indices[16];
+			fit_indices(texels, palette, weights, indices);
+			for (int i = 0; i < 16; ++i)
+			{
+				bits |= static_cast<uint64_t>(indices[i]) << (3 * i);
+			}
+		}
+
+		block[0] = static_cast<uint8_t>(first);
+		block[1] = static_cast<uint8_t>(second);
+		for (int i = 0; i < 6; ++i)
+		{
+			block[2 + i] = static_cast<uint8_t>(bits >> (8 * i));
+		}
+	}
+
+	void decode_alpha(const uint8_t* block, uint8_t* pixels)
+	{
+		int alphas[8];
+		bc4_palette(block[0], block[1], alphas);
+		if (block[0] <= block[1])
+		{
+			for (int i = 1; i < 5; ++i)
+			{
+				alphas[i + 1] = ((5 - i) * block[0] + i * block[1]) / 5;
+			}
+			alphas[6] = 0;
+			alphas[7] = 255;
+		}
+
+		uint64_t bits = 0;
+		for (int i = 0; i < 6; ++i)
+		{
+			bits |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+		}
+		for (int i = 0; i < 16; ++i)
+		{
+			pixels[4 * i + 3] = static_cast<uint8_t>(alphas[(bits >> (3 * i)) & 7]);
+		}
+	}
+
+	/**
+		Reads and writes a block's fields, least significant bit first.
+	*/
+	struct BitStream
+	{
+		uint8_t* block;
+		int position = 0;
+
+		void write(uint32_t value, int count)
+		{
+			for (int i = 0; i < count; ++i, ++position)
+			{
+				block[position / 8] |= static_cast<uint8_t>(((value >> i) & 1) << (position % 8));
+			}
+		}
+
+		uint32_t read(int count)
+		{
+			uint32_t value = 0;
+			for (int i = 0; i < count; ++i, ++position)
+			{
+				value |= static_cast<uint32_t>((block[position / 8] >> (position % 8)) & 1) << i;
+			}
+			return value;
+		}
+	};
+
+	/**
+		Round an endpoint to 7 bits per channel, with the shared lowest bit which fits best.
+	*/
+	void quantize_bc7(const float endpoint[4], uint32_t quantized[4], uint32_t& pBit)
+	{
+		float bestError = std::numeric_limits<float>::max();
+		for (uint32_t p = 0; p < 2; ++p)
+		{
+			uint32_t candidate[4];
+			float error = 0.0f;
+			for (int c = 0; c < 4; ++c)
+			{
+				candidate[c] = static_cast<uint32_t>(std::clamp(static_cast<int>((endpoint[c] - p) / 2.0f + 0.5f), 0, 127));
+				float difference = static_cast<float>(candidate[c] * 2 + p) - endpoint[c];
+				error += difference * difference;
+			}
+			if (error < bestError)
+			{
+				bestError = error;
+				pBit = p;
+				memcpy(quantized, candidate, sizeof(candidate));
+			}
+		}
+	}
+
+	void bc7_palette(const uint32_t first[4], uint32_t firstP, const uint32_t second[4], uint32_t secondP, int colors[16][4])
+	{
+		for (int i = 0; i < 16; ++i)
+		{
+			for (int c = 0; c < 4; ++c)
+			{
+				int low = static_cast<int>(first[c] << 1 | firstP);
+				int high = static_cast<int>(second[c] << 1 | secondP);
+				colors[i][c] = ((64 - bc7Weights[i]) * low + bc7Weights[i] * high + 32) >> 6;
+			}
+		}
+	}
+
+	//mode 6: one subset, 7 bit RGBA endpoints with a bit each shared by their channels, 4 bit indices
+	void encode_bc7(const Texels& texels, uint8_t* block)
+	{
+		const float weights[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+		float fractions[16];
+		for (int i = 0; i < 16; ++i)
+		{
+			fractions[i] = bc7Weights[i] / 64.0f;
+		}
+
+		float first[4];
+		float second[4];
+		principal_endpoints(texels, 4, first, second);
+
+		uint32_t bestEndpoints[2][4] = {};
+		uint32_t bestP[2] = {};
+		uint8_t bestIndices[16] = {};
+		float bestError = std::numeric_limits<float>::max();
+		for (int iteration = 0; iteration < 3; ++iteration)
+		{
+			uint32_t endpoints[2][4];
+			uint32_t p[2];
+			quantize_bc7(first, endpoints[0], p[0]);
+			quantize_bc7(second, endpoints[1], p[1]);
+
+			int colors[16][4];
+			bc7_palette(endpoints[0], p[0], endpoints[1], p[1], colors);
+			Palette palette;
+			for (const int* color : colors)
+			{
+				palette.add(static_cast<float>(color[0]), static_cast<float>(color[1]), static_cast<float>(color[2]), static_cast<float>(color[3]));
+			}
+
+			uint8_t indices[16];
+			float error = fit_indices(texels, palette, weights, indices);
+			if (error < bestError)
+			{
+				bestError = error;
+				memcpy(bestEndpoints, endpoints, sizeof(endpoints));
+				memcpy(bestP, p, sizeof(p));
+				memcpy(bestIndices, indices, sizeof(indices));
+			}
+			if (!refine_endpoints(texels, indices, fractions, 4, first, second))
+			{
+				break;
+			}
+		}
+
+		//the first texel's index has no top bit, flip the line if it would need one
+		if (bestIndices[0] >= 8)
+		{
+			std::swap(bestEndpoints[0], bestEndpoints[1]);
+			std::swap(bestP[0], bestP[1]);
+			for (uint8_t& index : bestIndices)
+			{
+				index = static_cast<uint8_t>(15 - index);
+			}
+		}
+
+		memset(block, 0, 16);
+		BitStream stream{ block };
+		stream.write(1 << 6, 7);
+		for (int c = 0; c < 4; ++c)
+		{
+			stream.write(bestEndpoints[0][c], 7);
+			stream.write(bestEndpoints[1][c], 7);
+		}
+		stream.write(bestP[0], 1);
+		stream.write(bestP[1], 1);
+		stream.write(bestIndices[0], 3);
+		for (int i = 1; i < 16; ++i)
+		{
+			stream.write(bestIndices[i], 4);
+		}
+	}
+
+	void decode_bc7(const uint8_t* block, uint8_t* pixels)
+	{
+		if ((block[0] & 0x7f) != 1 << 6)
+		{
+			memset(pixels, 0, 64);
+			return;
+		}
+
+		BitStream stream{ const_cast<uint8_t*>(block), 7 };
+		uint32_t endpoints[2][4];
+		for (int c = 0; c < 4; ++c)
+		{
+			endpoints[0][c] = stream.read(7);
+			endpoints[1][c] = stream.read(7);
+		}
+		uint32_t firstP = stream.read(1);
+		uint32_t secondP = stream.read(1);
+
+		int colors[16][4];
+		bc7_palette(endpoints[0], firstP, endpoints[1], secondP, colors);
+		for (int i = 0; i < 16; ++i)
+		{
+			const int* color = colors[stream.read(i == 0 ? 3 : 4)];
+			for (int c = 0; c < 4; ++c)
+			{
+				pixels[4 * i + c] = static_cast<uint8_t>(color[c]);
+			}
+		}
+	}
+}
+
+size_t block_bytes(BlockFormat format)
+{
+	return format == BlockFormat::BC1 ? 8 : 16;
+}
+
+void encode_block(BlockFormat format, const uint8_t* pixels, uint8_t* block)
+{
+	Texels texels;
+	for (int i = 0; i < 16; ++i)
+	{
+		for (int c = 0; c < 4; ++c)
+		{
+			texels[i][c] = pixels[4 * i + c];
+		}
+	}
+
+	switch (format)
+	{
+	case BlockFormat::BC1:
+		encode_color(texels, block);
+		break;
+	case BlockFormat::BC3:
+		encode_alpha(texels, block);
+		encode_color(texels, block + 8);
+		break;
+	case BlockFormat::BC7:
+		encode_bc7(texels, block);
+		break;
+	}
+}
+
+void decode_block(BlockFormat format, const uint8_t* block, uint8_t* pixels)
+{
+	switch (format)
+	{
+	case BlockFormat::BC1:
+		decode_color(block, pixels);
+		break;
+	case BlockFormat::BC3:
+		decode_color(block + 8, pixels);
+		decode_alpha(block, pixels);
+		break;
+	case BlockFormat::BC7:
+		decode_bc7(block, pixels);
+		break;
+	}
+}
+
+std::vector<uint8_t> encode_image(BlockFormat format, const uint8_t* pixels, int width, int height, ThreadPool* pool)
+{
+	PROFILE_FUNCTION();
+
+	int blocksX = (width + 3) / 4;
+	int blocksY = (height + 3) / 4;
+	size_t bytes = block_bytes(format);
+	std::vector<uint8_t> blocks(static_cast<size_t>(blocksX) * blocksY * bytes);
+
+	auto encodeRow = [&](int row)
+	{
+		uint8_t texels[64];
+		for (int x = 0; x < blocksX; ++x)
+		{
+			for (int i = 0; i < 16; ++i)
+			{
+				int pixelX = std::min(4 * x + i % 4, width - 1);
+				int pixelY = std::min(4 * row + i / 4, height - 1);
+				memcpy(texels + 4 * i, pixels + 4 * (static_cast<size_t>(pixelY) * width + pixelX), 4);
+			}
+			encode_block(format, texels, blocks.data() + (static_cast<size_t>(row) * blocksX + x) * bytes);
+		}
+	};
+
+	if (!pool)
+	{
+		for (int row = 0; row < blocksY; ++row)
+		{
+			encodeRow(row);
+		}
+		return blocks;
+	}
+
+	for (int row = 0; row < blocksY; ++row)
+	{
+		pool->submit([&encodeRow, row]() { encodeRow(row); });
+	}
+	pool->wait();
+	return blocks;
+}
+
+std::vector<uint8_t> decode_image(BlockFormat format, const uint8_t* blocks, int width, int height)
+{
+	int blocksX = (width + 3) / 4;
+	int blocksY = (height + 3) / 4;
+	size_t bytes = block_bytes(format);
+	std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+
+	uint8_t texels[64];
+	for (int y = 0; y < blocksY; ++y)
+	{
+		for (int x = 0; x < blocksX; ++x)
+		{
+			decode_block(format, blocks + (static_cast<size_t>(y) * blocksX + x) * bytes, texels);
+			for (int i = 0; i < 16; ++i)
+			{
+				int pixelX = 4 * x + i % 4;
+				int pixelY = 4 * y + i / 4;
+				if (pixelX < width && pixelY < height)
+				{
+					memcpy(pixels.data() + 4 * (static_cast<size_t>(pixelY) * width + pixelX), texels + 4 * i, 4);
+				}
+			}
+		}
+	}
+	return pixels;
+}
+
+double compute_psnr(const uint8_t* reference, const uint8_t* test, size_t pixelCount, bool alpha)
+{
+	int channelCount = alpha ? 4 : 3;
+	double squaredError = 0.0;
+	for (size_t i = 0; i < pixelCount; ++i)
+	{
+		for (int c = 0; c < channelCount; ++c)
+		{
+			double difference = static_cast<double>(reference[4 * i + c]) - test[4 * i + c];
+			squaredError += difference * difference;
+		}
+	}
+
+	if (squaredError == 0.0)
+	{
+		return std::numeric_limits<double>::infinity();
+	}
+	double meanSquaredError = squaredError / (static_cast<double>(pixelCount) * channelCount);
+	return 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+}
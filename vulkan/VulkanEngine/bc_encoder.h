@@ -0,0 +1,71 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+class ThreadPool;
+
+/**
+	The block compressed formats the texture cooker writes, each made of 4x4 texel blocks.
+*/
+enum class BlockFormat
+{
+	//RGB at 4 bits per texel, no alpha
+	BC1,
+	//BC1's colour with interpolated alpha, 8 bits per texel
+	BC3,
+	//RGBA at 8 bits per texel with finer endpoints and indices than BC3. Only mode 6 is written
+	BC7
+};
+
+/**
+	\returns the size of one 4x4 block
+*/
+size_t block_bytes(BlockFormat format);
+
+/**
+	Encode one block.
+
+	\param format the format to encode to
+	\param pixels 16 RGBA8 texels, row by row
+	\param block where to write block_bytes(format) bytes
+*/
+void encode_block(BlockFormat format, const uint8_t* pixels, uint8_t* block);
+
+/**
+	Decode one block, as written by encode_block. BC7 blocks in any mode but 6 decode to zero.
+
+	\param format the block's format
+	\param block the encoded block
+	\param pixels where to write 16 RGBA8 texels, row by row
+*/
+void decode_block(BlockFormat format, const uint8_t* block, uint8_t* pixels);
+
+/**
+	Encode a whole image, a row of blocks at a time. Blocks which hang over
+	the edges repeat the last row and column.
+
+	\param format the format to encode to
+	\param pixels the RGBA8 image, row by row
+	\param width the image's width in texels
+	\param height the image's height in texels
+	\param pool the workers to encode on, or null to encode on the calling thread
+	\returns the blocks, row by row
+*/
+std::vector<uint8_t> encode_image(BlockFormat format, const uint8_t* pixels, int width, int height, ThreadPool* pool);
+
+/**
+	Decode a whole image written by encode_image.
+
+	\returns the RGBA8 image, row by row
+*/
+std::vector<uint8_t> decode_image(BlockFormat format, const uint8_t* blocks, int width, int height);
+
+/**
+	\param reference the original RGBA8 pixels
+	\param test the pixels to compare with them
+	\param pixelCount the number of pixels in each
+	\param alpha whether to include the alpha channel
+	\returns the peak signal to noise ratio in dB, infinite if the images match
+*/
+double compute_psnr(const uint8_t* reference, const uint8_t* test, size_t pixelCount, bool alpha);
@@ -0,0 +1,606 @@
+#include "pch.h"
+#include "benchmark.h"
+#include "Vulkan/mesh_loader.h"
+#include "Vulkan/cooked_mesh.h"
+#include "Vulkan/cooked_texture.h"
+
+namespace {
+
+	constexpr int warmupFrames = 16;
+	constexpr int measuredFrames = 128;
+
+	struct RunResult {
+		double recordTime = 0.0;
+		double frameTime = 0.0;
+		double latency = 0.0;
+	};
+
+	/**
+		Render a scene for a number of frames and average the timings.
+	*/
+	RunResult run_frames(Engine* engine, GLFWwindow* window, Scene* scene) {
+
+		RunResult result;
+
+		for (int i = 0; i < warmupFrames + measuredFrames && !glfwWindowShouldClose(window); ++i) {
+
+			glfwPollEvents();
+
+			auto start = std::chrono::high_resolution_clock::now();
+			engine->render(scene);
+			auto end = std::chrono::high_resolution_clock::now();
+
+			if (i >= warmupFrames) {
+				result.recordTime += engine->get_record_time();
+				result.frameTime += std::chrono::duration<double, std::milli>(end - start).count();
+				result.latency += engine->get_frame_latency();
+			}
+		}
+
+		result.recordTime /= measuredFrames;
+		result.frameTime /= measuredFrames;
+		result.latency /= measuredFrames;
+		return result;
+	}
+
+	const char* mode_name(RenderMode mode) {
+
+		switch (mode) {
+		case RenderMode::PerObject:
+			return "per-object";
+		case RenderMode::Instanced:
+			return "instanced";
+		case RenderMode::GpuDriven:
+			return "gpu driven";
+		}
+		return "unknown";
+	}
+}
+
+void benchmark::draw_submission(Engine* engine, GLFWwindow* window) {
+
+	const int objectCounts[] = { 1000, 10000, 100000 };
+	const RenderMode modes[] = { RenderMode::PerObject, RenderMode::Instanced, RenderMode::GpuDriven };
+
+	RenderMode originalMode = engine->get_render_mode();
+
+	std::cout << "objects\tmode\t\trecord (ms)\tframe (ms)\n";
+
+	for (int objectCount : objectCounts) {
+
+		Scene scene(objectCount);
+
+		for (RenderMode mode : modes) {
+
+			engine->set_render_mode(mode);
+			if (engine->get_render_mode() != mode) {
+				continue;
+			}
+			RunResult result = run_frames(engine, window, &scene);
+
+			std::cout << objectCount << '\t' << mode_name(mode) << "\t"
+				<< std::fixed << std::setprecision(3)
+				<< result.recordTime << "\t\t" << result.frameTime << '\n';
+		}
+	}
+
+	std::cout << std::defaultfloat;
+	engine->set_render_mode(originalMode);
+}
+
+void benchmark::recording_threads(Engine* engine, GLFWwindow* window) {
+
+	RenderMode originalMode = engine->get_render_mode();
+	int originalThreads = engine->get_recording_threads();
+	int maxThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+	Scene scene(100000);
+	engine->set_render_mode(RenderMode::PerObject);
+
+	std::cout << "threads\trecord (ms)\tspeedup\tframe (ms)\n";
+
+	double baseline = 0.0;
+	for (int threads = 1; threads <= maxThreads; threads *= 2) {
+
+		engine->set_recording_threads(threads);
+		RunResult result = run_frames(engine, window, &scene);
+		if (threads == 1) {
+			baseline = result.recordTime;
+		}
+
+		std::cout << threads << '\t' << std::fixed << std::setprecision(3)
+			<< result.recordTime << "\t\t" << baseline / result.recordTime << "x\t"
+			<< result.frameTime << '\n';
+	}
+
+	std::cout << std::defaultfloat;
+	engine->set_recording_threads(originalThreads);
+	engine->set_render_mode(originalMode);
+}
+
+void benchmark::frames_in_flight(Engine* engine, GLFWwindow* window) {
+
+	RenderMode originalMode = engine->get_render_mode();
+	int originalFrames = engine->get_frames_in_flight();
+
+	Scene scene(100000);
+	engine->set_render_mode(RenderMode::Instanced);
+
+	std::cout << "frames in flight\tframe (ms)\tfps\tlatency (ms)\n";
+
+	for (int framesInFlight = 1; framesInFlight <= 3; ++framesInFlight) {
+
+		engine->set_frames_in_flight(framesInFlight);
+		RunResult result = run_frames(engine, window, &scene);
+
+		std::cout << framesInFlight << "\t\t\t" << std::fixed << std::setprecision(3)
+			<< result.frameTime << "\t\t" << std::setprecision(1) << 1000.0 / result.frameTime
+			<< '\t' << std::setprecision(3) << result.latency << '\n';
+	}
+
+	std::cout << std::defaultfloat;
+	engine->set_frames_in_flight(originalFrames);
+	engine->set_render_mode(originalMode);
+}
+
+void benchmark::resize_hitch(Engine* engine, GLFWwindow* window) {
+
+	constexpr int resizeCount = 32;
+	//how long to wait for the window system to report the new size
+	constexpr int maxFramesPerResize = 60;
+
+	int originalWidth, originalHeight;
+	glfwGetWindowSize(window, &originalWidth, &originalHeight);
+	const int widths[] = { originalWidth + 160, originalWidth };
+	const int heights[] = { originalHeight + 120, originalHeight };
+
+	Scene scene(10000);
+	RenderMode originalMode = engine->get_render_mode();
+	engine->set_render_mode(RenderMode::Instanced);
+
+	RunResult steady = run_frames(engine, window, &scene);
+	std::cout << "steady frame: " << std::fixed << std::setprecision(3) << steady.frameTime << " ms\n";
+	std::cout << "backend\t\trecreation\tavg hitch (ms)\tworst hitch (ms)\trecreate (ms)\n";
+
+	//the renderpass backend remakes a framebuffer per image on each resize, dynamic rendering has none
+	bool originalDynamic = engine->is_dynamic_rendering();
+	for (bool dynamic : { false, true }) {
+
+		engine->set_dynamic_rendering(dynamic);
+		const char* backend = dynamic ? "dynamic" : "renderpass";
+		if (engine->is_dynamic_rendering() != dynamic) {
+			std::cout << backend << "\t\tnot supported by the device\n";
+			continue;
+		}
+
+		for (bool blocking : { true, false }) {
+
+			engine->set_blocking_swapchain_recreation(blocking);
+
+			double totalHitch = 0.0, worstHitch = 0.0, totalRecreate = 0.0;
+			int resizes = 0;
+
+			for (int i = 0; i < resizeCount && !glfwWindowShouldClose(window); ++i) {
+
+				glfwSetWindowSize(window, widths[i % 2], heights[i % 2]);
+				int recreations = engine->get_swapchain_recreate_count();
+
+				//the frame that notices the resize recreates and returns, the next one draws.
+				//the hitch runs from the start of the first to the end of the second.
+				bool recreated = false;
+				for (int frame = 0; frame < maxFramesPerResize && !recreated; ++frame) {
+
+					glfwPollEvents();
+
+					auto start = std::chrono::high_resolution_clock::now();
+					engine->render(&scene);
+					recreated = engine->get_swapchain_recreate_count() != recreations;
+					if (recreated) {
+						engine->render(&scene);
+						auto end = std::chrono::high_resolution_clock::now();
+
+						double hitch = std::chrono::duration<double, std::milli>(end - start).count();
+						totalHitch += hitch;
+						worstHitch = std::max(worstHitch, hitch);
+						totalRecreate += engine->get_swapchain_recreate_time();
+						++resizes;
+					}
+				}
+			}
+
+			const char* name = blocking ? "blocking" : "handoff";
+			if (resizes == 0) {
+				std::cout << backend << "\t" << name << "\tno resizes reported by the window system\n";
+				continue;
+			}
+
+			std::cout << backend << "\t" << name << "\t" << totalHitch / resizes << "\t\t" << worstHitch
+				<< "\t\t" << totalRecreate / resizes << '\n';
+		}
+	}
+
+	std::cout << std::defaultfloat;
+	glfwSetWindowSize(window, originalWidth, originalHeight);
+	engine->set_blocking_swapchain_recreation(false);
+	engine->set_dynamic_rendering(originalDynamic);
+	engine->set_render_mode(originalMode);
+}
+
+void benchmark::mesh_loading(const std::string& modelFilename) {
+
+	const int runs = 5;
+	std::string cookedFilename = modelFilename + ".vmsh";
+
+	std::vector<vkUtil::MeshData> meshes = vkUtil::load_model(modelFilename, false);
+	if (meshes.empty() || !vkUtil::cook_meshes(meshes, cookedFilename, false)) {
+		std::cout << "Couldn't cook " << modelFilename << ", skipping the mesh loading benchmark\n";
+		return;
+	}
+
+	//stands in for the staging ring, both paths end with their geometry copied into it
+	std::vector<uint8_t> staging;
+	auto stage = [&staging](const void* data, size_t size) {
+		staging.resize(std::max(staging.size(), size));
+		memcpy(staging.data(), data, size);
+	};
+
+	double importTime = 0.0;
+	double mappedTime = 0.0;
+	for (int run = 0; run < runs; ++run) {
+
+		auto start = std::chrono::high_resolution_clock::now();
+		meshes = vkUtil::load_model(modelFilename, false);
+		for (const vkUtil::MeshData& mesh : meshes) {
+			stage(mesh.vertices.data(), mesh.vertices.size() * sizeof(vkUtil::Vertex));
+			stage(mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+		}
+		auto end = std::chrono::high_resolution_clock::now();
+		importTime += std::chrono::duration<double, std::milli>(end - start).count();
+
+		start = std::chrono::high_resolution_clock::now();
+		vkUtil::CookedMeshFile file;
+		if (!file.open(cookedFilename, false)) {
+			std::cout << "Couldn't map " << cookedFilename << '\n';
+			return;
+		}
+		const vkUtil::CookedMeshHeader& header = file.get_header();
+		stage(file.get_blob(header.vertices), header.vertices.size);
+		stage(file.get_blob(header.indices), header.indices.size);
+		end = std::chrono::high_resolution_clock::now();
+		mappedTime += std::chrono::duration<double, std::milli>(end - start).count();
+	}
+
+	//the cooked file also holds every lod, so it stages more than the import does
+	std::cout << "mesh loading\t\tms\n" << std::fixed << std::setprecision(3)
+		<< "assimp import\t\t" << importTime / runs << '\n'
+		<< "mapped cooked file\t" << mappedTime / runs << '\n'
+		<< "speedup\t\t\t" << importTime / std::max(mappedTime, 1e-6) << "x\n";
+	std::cout << std::defaultfloat;
+}
+
+void benchmark::texture_decoding(Engine* engine) {
+
+	//the one test image, decoded as if it were a set of different ones
+	const std::vector<std::string> filenames(64, "textures/test.jpg");
+	int hardwareThreads = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+
+	std::cout << "threads\tMB/s\t\timages/s\n" << std::fixed << std::setprecision(1);
+
+	double baseline = 0.0;
+	for (int threadCount : { 1, hardwareThreads }) {
+
+		engine->load_textures(filenames, threadCount);
+		vkUtil::TextureLoadStats stats = engine->get_texture_load_stats();
+		engine->unload_textures();
+
+		if (stats.failedCount == stats.imageCount) {
+			std::cout << "Couldn't decode " << filenames[0] << ", skipping the texture benchmark\n";
+			break;
+		}
+
+		std::cout << threadCount << '\t' << stats.megabytes_per_second() << "\t\t" << stats.images_per_second();
+		if (threadCount == 1) {
+			baseline = stats.megabytes_per_second();
+		}
+		else if (baseline > 0.0) {
+			std::cout << "\t(" << stats.megabytes_per_second() / baseline << "x)";
+		}
+		std::cout << '\n';
+	}
+
+	std::cout << std::defaultfloat;
+}
+
+void benchmark::mip_generation(Engine* engine) {
+
+	const std::vector<std::string> filenames(64, "textures/test.jpg");
+	int hardwareThreads = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+	vkUtil::MipMode originalMode = engine->get_mip_mode();
+
+	std::cout << "mips\t\tlevels\tgpu ms\n" << std::fixed << std::setprecision(3);
+
+	double baseline = 0.0;
+	for (vkUtil::MipMode mode : { vkUtil::MipMode::Blit, vkUtil::MipMode::Compute }) {
+
+		engine->set_mip_mode(mode);
+		if (engine->get_mip_mode() != mode) {
+			std::cout << "compute\t\tunsupported\n";
+			continue;
+		}
+
+		engine->load_textures(filenames, hardwareThreads);
+		vkUtil::MipStats stats = engine->get_mip_stats();
+		engine->unload_textures();
+
+		if (stats.textureCount == 0) {
+			std::cout << "Couldn't decode " << filenames[0] << ", skipping the mip benchmark\n";
+			break;
+		}
+
+		std::cout << (mode == vkUtil::MipMode::Blit ? "blit" : "compute") << "\t\t" << stats.levelCount << '\t' << stats.milliseconds;
+		if (mode == vkUtil::MipMode::Blit) {
+			baseline = stats.milliseconds;
+		}
+		else if (stats.milliseconds > 0.0) {
+			std::cout << "\t(" << baseline / stats.milliseconds << "x)";
+		}
+		std::cout << '\n';
+	}
+
+	engine->set_mip_mode(originalMode);
+	std::cout << std::defaultfloat;
+}
+
+void benchmark::texture_cooking(Engine* engine) {
+
+	const std::string source = "textures/test.jpg";
+	int hardwareThreads = std::max(2, static_cast<int>(std::thread::hardware_concurrency()));
+
+	struct CookedFormat {
+		BlockFormat format;
+		const char* name;
+		std::string filename;
+	};
+	const CookedFormat formats[] = {
+		{ BlockFormat::BC1, "bc1", "textures/test.bc1.vtex" },
+		{ BlockFormat::BC3, "bc3", "textures/test.bc3.vtex" },
+		{ BlockFormat::BC7, "bc7", "textures/test.bc7.vtex" }
+	};
+
+	std::cout << "format\tthreads\tPSNR dB\tMP/s\tsize vs RGBA8\n" << std::fixed << std::setprecision(1);
+
+	for (const CookedFormat& cooked : formats) {
+		for (int threadCount : { 1, hardwareThreads }) {
+
+			vkUtil::TextureCookStats stats;
+			if (!vkUtil::cook_texture(source, cooked.filename, cooked.format, threadCount, false, &stats)) {
+				std::cout << "Couldn't cook " << source << ", skipping the cooking benchmark\n" << std::defaultfloat;
+				return;
+			}
+			std::cout << cooked.name << '\t' << threadCount << '\t' << stats.psnr << '\t' << stats.megapixels_per_second()
+				<< '\t' << 100.0 * stats.cookedBytes / stats.sourceBytes << "%\n";
+		}
+	}
+
+	//the same set of textures, decoded from the source and uploaded as cooked
+	const std::vector<std::string> decodedFiles(64, source);
+	engine->load_textures(decodedFiles, hardwareThreads);
+	vkUtil::TextureLoadStats decodedStats = engine->get_texture_load_stats();
+	engine->unload_textures();
+
+	const std::vector<std::string> cookedFiles(64, formats[2].filename);
+	engine->load_textures(cookedFiles, hardwareThreads);
+	vkUtil::TextureLoadStats cookedStats = engine->get_texture_load_stats();
+	engine->unload_textures();
+
+	std::cout << "load\tms\tuploaded MB\n";
+	std::cout << "jpg\t" << decodedStats.seconds * 1000.0 << '\t' << decodedStats.decodedBytes / (1024.0 * 1024.0) << " (top levels only)\n";
+	if (cookedStats.cookedCount == 0) {
+		std::cout << "bc7\tunsupported by the device\n";
+	}
+	else {
+		std::cout << "bc7\t" << cookedStats.seconds * 1000.0 << '\t' << cookedStats.cookedBytes / (1024.0 * 1024.0) << " (every level)\n";
+	}
+
+	std::cout << std::defaultfloat;
+}
+
+void benchmark::material_switching(Engine* engine, GLFWwindow* window) {
+
+	const int materialCounts[] = { 1, 16, 256 };
+	const RenderMode modes[] = { RenderMode::PerObject, RenderMode::Instanced, RenderMode::GpuDriven };
+
+	RenderMode originalMode = engine->get_render_mode();
+
+	uint32_t texture = engine->load_textures({ "textures/test.jpg" }, 1)[0];
+
+	std::cout << "materials\tmode\t\trecord (ms)\tframe (ms)\n";
+
+	for (int materialCount : materialCounts) {
+
+		std::vector<uint32_t> materials;
+		for (int j = 0; j < materialCount; ++j) {
+			vkUtil::Material material;
+			float hue = static_cast<float>(j) / materialCount;
+			material.baseColor = glm::vec4(0.5f + 0.5f * glm::cos(6.2832f * (hue + glm::vec3(0.0f, 0.33f, 0.67f))), 1.0f);
+			material.baseColorTexture = texture;
+			materials.push_back(engine->add_material(material));
+		}
+
+		Scene scene(10000);
+		for (size_t object = 0; object < scene.get_object_count(); ++object) {
+			scene.set_material(object, materials[object % materials.size()]);
+		}
+
+		//the draw count doesn't depend on the number of materials, nor should the timings
+		for (RenderMode mode : modes) {
+
+			engine->set_render_mode(mode);
+			if (engine->get_render_mode() != mode) {
+				continue;
+			}
+			RunResult result = run_frames(engine, window, &scene);
+
+			std::cout << materialCount << "\t\t" << mode_name(mode) << "\t"
+				<< std::fixed << std::setprecision(3)
+				<< result.recordTime << "\t\t" << result.frameTime << '\n';
+		}
+	}
+
+	std::cout << std::defaultfloat;
+	engine->set_render_mode(originalMode);
+	engine->unload_textures();
+}
+
+namespace {
+
+	using vkUtil::RenderAccess;
+	using vkUtil::RenderResource;
+
+	//a g-buffer, lighting, bloom and tonemap frame, with a debug view nothing reads
+	void declare_deferred(vkUtil::RenderGraph& graph, vk::Extent2D extent) {
+
+		vk::Extent2D half(extent.width / 2, extent.height / 2);
+		RenderResource albedo = graph.create_image("albedo", extent, vk::Format::eR8G8B8A8Unorm);
+		RenderResource normal = graph.create_image("normal", extent, vk::Format::eR16G16B16A16Sfloat);
+		RenderResource depth = graph.create_image("depth", extent, vk::Format::eD32Sfloat);
+		RenderResource occlusion = graph.create_image("occlusion", extent, vk::Format::eR8Unorm);
+		RenderResource hdr = graph.create_image("hdr", extent, vk::Format::eR16G16B16A16Sfloat);
+		RenderResource bloomHalf = graph.create_image("bloom half", half, vk::Format::eR16G16B16A16Sfloat);
+		RenderResource bloom = graph.create_image("bloom", extent, vk::Format::eR16G16B16A16Sfloat);
+		RenderResource debugView = graph.create_image("debug view", extent, vk::Format::eR8G8B8A8Unorm);
+		RenderResource backbuffer = graph.import_image("backbuffer", nullptr, nullptr,
+			vk::ImageLayout::eUndefined, vk::ImageLayout::ePresentSrcKHR);
+
+		uint32_t pass = graph.add_pass("gbuffer", nullptr);
+		graph.use(pass, albedo, RenderAccess::ColorAttachment);
+		graph.use(pass, normal, RenderAccess::ColorAttachment);
+		graph.use(pass, depth, RenderAccess::DepthAttachment);
+
+		pass = graph.add_pass("occlusion", nullptr);
+		graph.use(pass, depth, RenderAccess::SampledRead);
+		graph.use(pass, normal, RenderAccess::SampledRead);
+		graph.use(pass, occlusion, RenderAccess::ColorAttachment);
+
+		pass = graph.add_pass("debug view", nullptr);
+		graph.use(pass, normal, RenderAccess::SampledRead);
+		graph.use(pass, debugView, RenderAccess::ColorAttachment);
+
+		pass = graph.add_pass("lighting", nullptr);
+		for (RenderResource input : { albedo, normal, depth, occlusion }) {
+			graph.use(pass, input, RenderAccess::SampledRead);
+		}
+		graph.use(pass, hdr, RenderAccess::ColorAttachment);
+
+		pass = graph.add_pass("bloom down", nullptr);
+		graph.use(pass, hdr, RenderAccess::SampledRead);
+		graph.use(pass, bloomHalf, RenderAccess::ColorAttachment);
+
+		pass = graph.add_pass("bloom up", nullptr);
+		graph.use(pass, bloomHalf, RenderAccess::SampledRead);
+		graph.use(pass, bloom, RenderAccess::ColorAttachment);
+
+		pass = graph.add_pass("tonemap", nullptr);
+		graph.use(pass, hdr, RenderAccess::SampledRead);
+		graph.use(pass, bloom, RenderAccess::SampledRead);
+		graph.use(pass, backbuffer, RenderAccess::ColorAttachment);
+	}
+
+	//compute passes each reading the last one's buffer, then a copy out
+	void declare_chain(vkUtil::RenderGraph& graph, vk::Extent2D extent) {
+
+		vk::DeviceSize size = vk::DeviceSize(extent.width) * extent.height * 4;
+		RenderResource readback = graph.import_buffer("readback", nullptr);
+		graph.mark_output(readback);
+
+		RenderResource previous = graph.create_buffer("step", size);
+		uint32_t pass = graph.add_pass("first step", nullptr);
+		graph.use(pass, previous, RenderAccess::StorageWrite);
+		for (int i = 1; i < 8; ++i) {
+			RenderResource next = graph.create_buffer("step", size);
+			pass = graph.add_pass("step", nullptr);
+			graph.use(pass, previous, RenderAccess::StorageRead);
+			graph.use(pass, next, RenderAccess::StorageWrite);
+			previous = next;
+		}
+
+		pass = graph.add_pass("copy out", nullptr);
+		graph.use(pass, previous, RenderAccess::TransferRead);
+		graph.use(pass, readback, RenderAccess::TransferWrite);
+	}
+
+	//one image sampled by several compute passes, which only the first has to wait for
+	void declare_fan_out(vkUtil::RenderGraph& graph, vk::Extent2D extent) {
+
+		RenderResource shadows = graph.create_image("shadows", extent, vk::Format::eD32Sfloat);
+		uint32_t pass = graph.add_pass("shadow map", nullptr);
+		graph.use(pass, shadows, RenderAccess::DepthAttachment);
+
+		for (int i = 0; i < 4; ++i) {
+			RenderResource result = graph.import_buffer("result", nullptr);
+			graph.mark_output(result);
+			pass = graph.add_pass("filter", nullptr);
+			graph.use(pass, shadows, RenderAccess::SampledRead);
+			graph.use(pass, result, RenderAccess::StorageWrite);
+		}
+
+		RenderResource unused = graph.create_buffer("unused", 1024);
+		pass = graph.add_pass("unused filter", nullptr);
+		graph.use(pass, shadows, RenderAccess::SampledRead);
+		graph.use(pass, unused, RenderAccess::StorageWrite);
+	}
+}
+
+void benchmark::render_graph(Engine* engine, GLFWwindow* window) {
+
+	struct SyntheticGraph {
+		const char* name;
+		std::function<void(vkUtil::RenderGraph&, vk::Extent2D)> declare;
+	};
+
+	const SyntheticGraph graphs[] = {
+		{ "deferred", declare_deferred },
+		{ "chain", declare_chain },
+		{ "fan out", declare_fan_out }
+	};
+
+	//compiled without a device, so memory is estimated from the formats
+	std::cout << "graph\t\tpasses\tculled\tbarriers\tcalls\tnaive\ttransient (MB)\taliased (MB)\n";
+
+	for (const SyntheticGraph& synthetic : graphs) {
+
+		vkUtil::RenderGraph graph(nullptr, nullptr, false);
+		graph.begin();
+		synthetic.declare(graph, vk::Extent2D(1920, 1080));
+		graph.compile();
+		const vkUtil::RenderGraphStats& stats = graph.get_stats();
+
+		std::cout << synthetic.name << "\t" << (std::strlen(synthetic.name) < 8 ? "\t" : "")
+			<< stats.passCount << '\t' << stats.culledPassCount << '\t'
+			<< stats.barrierCount << "\t\t" << stats.barrierBatchCount << '\t' << stats.naiveBarrierCount << '\t'
+			<< std::fixed << std::setprecision(1)
+			<< stats.transientBytes / (1024.0 * 1024.0) << "\t\t" << stats.aliasedBytes / (1024.0 * 1024.0) << '\n';
+	}
+
+	//the engine's own graph is declared every frame, but should only compile when the mode changes
+	RenderMode originalMode = engine->get_render_mode();
+	Scene scene(10000);
+
+	std::cout << "mode\t\tframes\tgraph compiles\n";
+
+	for (RenderMode mode : { RenderMode::PerObject, RenderMode::Instanced, RenderMode::GpuDriven }) {
+
+		engine->set_render_mode(mode);
+		if (engine->get_render_mode() != mode) {
+			continue;
+		}
+		size_t compiles = engine->get_render_graph_compile_count();
+		run_frames(engine, window, &scene);
+
+		std::cout << mode_name(mode) << '\t' << warmupFrames + measuredFrames << '\t'
+			<< engine->get_render_graph_compile_count() - compiles << '\n';
+	}
+
+	std::cout << std::defaultfloat;
+	engine->set_render_mode(originalMode);
+}
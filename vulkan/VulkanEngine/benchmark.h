@@ -0,0 +1,96 @@
+#pragma once
+#include "Vulkan/engine.h"
+
+namespace benchmark
+{
+	/**
+		Compare per-object, instanced and gpu driven submission at 1k, 10k and 100k objects,
+		printing the average command recording time and frame time of each.
+
+		\param engine the graphics engine to render with
+		\param window the window being rendered to
+	*/
+	void draw_submission(Engine* engine, GLFWwindow* window);
+
+	/**
+		Record 100k per-object draws with an increasing number of worker threads,
+		printing the average recording time and speedup over a single thread.
+
+		\param engine the graphics engine to render with
+		\param window the window being rendered to
+	*/
+	void recording_threads(Engine* engine, GLFWwindow* window);
+
+	/**
+		Render a heavy scene with one, two and three frames in flight, printing
+		the throughput and the latency from starting a frame to its completion.
+
+		\param engine the graphics engine to render with
+		\param window the window being rendered to
+	*/
+	void frames_in_flight(Engine* engine, GLFWwindow* window);
+
+	/**
+		Repeatedly resize the window, comparing the hitch caused by blocking swapchain
+		recreation against handing the old swapchain over, with a renderpass and
+		framebuffers and with dynamic rendering.
+
+		\param engine the graphics engine to render with
+		\param window the window being rendered to
+	*/
+	void resize_hitch(Engine* engine, GLFWwindow* window);
+
+	/**
+		Cook a model, then compare importing it with assimp against mapping the cooked
+		file, each up to the point its geometry is copied into staging memory.
+
+		\param modelFilename the model to import, cooked alongside it as a .vmsh file
+	*/
+	void mesh_loading(const std::string& modelFilename);
+
+	/**
+		Decode and upload a set of images on one thread and then on every hardware thread,
+		printing the throughput of each in MB/s of decoded pixels and images per second.
+
+		\param engine the graphics engine to upload with
+	*/
+	void texture_decoding(Engine* engine);
+
+	/**
+		Load a set of images with each mip mode, printing the gpu time taken
+		to generate their chains by blitting and by compute.
+
+		\param engine the graphics engine to upload with
+	*/
+	void mip_generation(Engine* engine);
+
+	/**
+		Cook an image into each block format on one thread and then on every hardware thread,
+		printing the quality and encoding speed of each, then compare loading a set of
+		cooked textures against decoding the source.
+
+		\param engine the graphics engine to upload with
+	*/
+	void texture_cooking(Engine* engine);
+
+	/**
+		Render a scene whose objects cycle through 1, 16 and 256 textured materials
+		in each submission mode. Materials come from the bindless table, so the
+		draws are batched the same however many there are.
+
+		\param engine the graphics engine to render with
+		\param window the window being rendered to
+	*/
+	void material_switching(Engine* engine, GLFWwindow* window);
+
+	/**
+		Compile synthetic render graphs without a device, printing the barriers they need
+		against one per resource use and their transient memory with and without aliasing.
+		Then render each submission mode, printing how often the engine's own graph was compiled.
+		Whether the plans are right is checked by --self-test.
+
+		\param engine the graphics engine to render with
+		\param window the window being rendered to
+	*/
+	void render_graph(Engine* engine, GLFWwindow* window);
+}
@@ -0,0 +1,217 @@
+#include "pch.h"
+#include "cpu_profiler.h"
+
+thread_local CpuEventRing* CpuProfiler::threadRing = nullptr;
+
+CpuProfiler::~CpuProfiler()
+{
+	end_session();
+}
+
+void CpuProfiler::begin_session(const std::string& outputFilename)
+{
+	if (active.load())
+	{
+		return;
+	}
+
+	//anything left over from a previous session would land before this one started
+	{
+		std::lock_guard<std::mutex> lock(ringMutex);
+		for (std::unique_ptr<CpuEventRing>& ring : rings)
+		{
+			ring->clear();
+		}
+	}
+
+	filename = outputFilename;
+	dropped.store(0);
+	stopping = false;
+	flushRequests = 0;
+	flushesDone = 0;
+	startTime = vkUtil::trace_now();
+	startTicks = profiler_ticks();
+	ticksPerMicrosecond = 0.0;
+
+	active.store(true);
+	flusher = std::thread(&CpuProfiler::flush_loop, this);
+}
+
+void CpuProfiler::end_session()
+{
+	if (!active.exchange(false))
+	{
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(flushMutex);
+		stopping = true;
+	}
+	flushWake.notify_one();
+	flushDone.notify_all();
+	flusher.join();
+
+	if (dropped.load() > 0)
+	{
+		std::cout << "Profiler dropped " << dropped.load() << " events, the rings were full\n";
+	}
+}
+
+void CpuProfiler::set_thread_name(const char* name)
+{
+	if (!threadRing)
+	{
+		threadRing = register_thread();
+	}
+	std::lock_guard<std::mutex> lock(ringMutex);
+	threadRing->threadName = name;
+}
+
+CpuEventRing* CpuProfiler::register_thread()
+{
+	std::lock_guard<std::mutex> lock(ringMutex);
+	//counting from 1, the gpu's track is 0
+	rings.push_back(std::make_unique<CpuEventRing>(static_cast<uint32_t>(rings.size() + 1)));
+	return rings.back().get();
+}
+
+void CpuProfiler::flush_loop()
+{
+	std::ofstream file(filename);
+	if (!file)
+	{
+		std::cout << "Profiler failed to open " << filename << '\n';
+	}
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	bool first = true;
+
+	std::vector<CpuEventRing*> drained;
+	//events popped before the tick rate is known, so the rings don't fill during startup
+	std::vector<std::pair<uint32_t, CpuEvent>> pending;
+	vkUtil::TraceEvent traceEvent;
+	traceEvent.category = "cpu";
+
+	auto write_event = [&](uint32_t threadId, const CpuEvent& event) {
+		traceEvent.threadId = threadId;
+		traceEvent.name = event.name;
+		traceEvent.start = startTime + static_cast<int64_t>(event.start - startTicks) / ticksPerMicrosecond;
+		traceEvent.duration = (event.end - event.start) / ticksPerMicrosecond;
+		file << (first ? "" : ",\n");
+		vkUtil::write_trace_event(file, traceEvent);
+		first = false;
+		if (capturing.load(std::memory_order_relaxed))
+		{
+			std::lock_guard<std::mutex> lock(captureMutex);
+			captured.push_back(traceEvent);
+		}
+	};
+
+	while (true)
+	{
+		bool stop;
+		uint64_t request;
+		{
+			std::unique_lock<std::mutex> lock(flushMutex);
+			flushWake.wait_for(lock, std::chrono::milliseconds(10), [this] { return stopping || flushRequests != flushesDone; });
+			stop = stopping;
+			request = flushRequests;
+		}
+		bool requested = request != flushesDone;
+
+		//measure the tick rate over at least the first 50ms, or however long there's been if the events are wanted now
+		if (ticksPerMicrosecond == 0.0)
+		{
+			double elapsed = vkUtil::trace_now() - startTime;
+			if (elapsed >= 50000.0 || stop || requested)
+			{
+				ticksPerMicrosecond = elapsed > 0.0 ? (profiler_ticks() - startTicks) / elapsed : 1.0;
+				for (const std::pair<uint32_t, CpuEvent>& event : pending)
+				{
+					write_event(event.first, event.second);
+				}
+				pending.clear();
+			}
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(ringMutex);
+			drained.clear();
+			for (std::unique_ptr<CpuEventRing>& ring : rings)
+			{
+				drained.push_back(ring.get());
+			}
+		}
+
+		CpuEvent event;
+		for (CpuEventRing* ring : drained)
+		{
+			while (ring->pop(event))
+			{
+				if (ticksPerMicrosecond == 0.0)
+				{
+					pending.emplace_back(ring->threadId, event);
+				}
+				else
+				{
+					write_event(ring->threadId, event);
+				}
+			}
+		}
+
+		if (requested)
+		{
+			{
+				std::lock_guard<std::mutex> lock(flushMutex);
+				flushesDone = request;
+			}
+			flushDone.notify_all();
+		}
+
+		if (stop)
+		{
+			break;
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(ringMutex);
+		for (std::unique_ptr<CpuEventRing>& ring : rings)
+		{
+			std::string name = ring->threadName.empty() ? "thread " + std::to_string(ring->threadId) : ring->threadName;
+			file << (first ? "" : ",\n");
+			vkUtil::write_thread_name(file, ring->threadId, name);
+			first = false;
+		}
+	}
+
+	file << "\n]}\n";
+}
+
+std::vector<vkUtil::TraceEvent> CpuProfiler::take_captured_events()
+{
+	//whatever was recorded before this call is already in the rings, one more pass of the flusher writes it out
+	if (active.load())
+	{
+		std::unique_lock<std::mutex> lock(flushMutex);
+		uint64_t request = ++flushRequests;
+		flushWake.notify_one();
+		flushDone.wait(lock, [this, request] { return flushesDone >= request || stopping; });
+	}
+
+	std::lock_guard<std::mutex> lock(captureMutex);
+	std::vector<vkUtil::TraceEvent> events = std::move(captured);
+	captured.clear();
+	return events;
+}
+
+std::vector<std::pair<uint32_t, std::string>> CpuProfiler::get_thread_names()
+{
+	std::lock_guard<std::mutex> lock(ringMutex);
+	std::vector<std::pair<uint32_t, std::string>> names;
+	for (std::unique_ptr<CpuEventRing>& ring : rings)
+	{
+		names.emplace_back(ring->threadId, ring->threadName.empty() ? "thread " + std::to_string(ring->threadId) : ring->threadName);
+	}
+	return names;
+}
@@ -0,0 +1,214 @@
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <memory>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include "Vulkan/trace.h"
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define PROFILER_HAS_RDTSC
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define PROFILER_HAS_RDTSC
+#endif
+
+/*
+	Scoped cpu instrumentation. Define ENABLE_PROFILING (eg. in the project's preprocessor
+	definitions) to compile it in, otherwise every macro expands to nothing.
+
+	PROFILE_SCOPE(name)				time the enclosing block, name must be a string literal
+	PROFILE_FUNCTION()				time the enclosing function
+	PROFILE_THREAD(name)			name the calling thread's track in the trace
+	PROFILE_BEGIN_SESSION(file)		start writing events to a Chrome trace JSON file
+	PROFILE_END_SESSION()			flush the remaining events and close the file
+*/
+#ifdef ENABLE_PROFILING
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) CpuProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION() PROFILE_SCOPE(__FUNCTION__)
+#define PROFILE_THREAD(name) CpuProfiler::get().set_thread_name(name)
+#define PROFILE_BEGIN_SESSION(filename) CpuProfiler::get().begin_session(filename)
+#define PROFILE_END_SESSION() CpuProfiler::get().end_session()
+#else
+#define PROFILE_SCOPE(name)
+#define PROFILE_FUNCTION()
+#define PROFILE_THREAD(name)
+#define PROFILE_BEGIN_SESSION(filename)
+#define PROFILE_END_SESSION()
+#endif
+
+/**
+	\returns a cheap, monotonic tick count. The time stamp counter where there is one.
+*/
+inline uint64_t profiler_ticks() {
+#ifdef PROFILER_HAS_RDTSC
+	return __rdtsc();
+#else
+	return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+struct CpuEvent {
+	//must outlive the session, so literals or __FUNCTION__
+	const char* name;
+	uint64_t start;
+	uint64_t end;
+};
+
+/**
+	A single producer, single consumer queue of events. The thread which owns it pushes,
+	the flusher pops, and neither ever waits on the other.
+*/
+class CpuEventRing
+{
+public:
+	static constexpr uint32_t capacity = 1 << 14;
+
+	CpuEventRing(uint32_t threadId) : threadId(threadId) {}
+
+	/**
+		\returns false if the ring is full and the event was dropped
+	*/
+	bool push(const CpuEvent& event) {
+		uint32_t write = head.load(std::memory_order_relaxed);
+		if (write - tail.load(std::memory_order_acquire) == capacity) {
+			return false;
+		}
+		events[write & (capacity - 1)] = event;
+		head.store(write + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(CpuEvent& event) {
+		uint32_t read = tail.load(std::memory_order_relaxed);
+		if (read == head.load(std::memory_order_acquire)) {
+			return false;
+		}
+		event = events[read & (capacity - 1)];
+		tail.store(read + 1, std::memory_order_release);
+		return true;
+	}
+
+	//discard everything pushed so far, consumer side only
+	void clear() { tail.store(head.load(std::memory_order_acquire), std::memory_order_release); }
+
+	const uint32_t threadId;
+	std::string threadName;
+
+private:
+	CpuEvent events[capacity];
+	//written by the producer and the consumer respectively, kept on separate cache lines
+	alignas(64) std::atomic<uint32_t> head{ 0 };
+	alignas(64) std::atomic<uint32_t> tail{ 0 };
+};
+
+/**
+	Collects scope events from every thread and streams them to a Chrome trace file
+	on a background thread. Recording an event is a relaxed load, a thread local
+	lookup and a ring push, no locks or allocations.
+*/
+class CpuProfiler
+{
+public:
+	static CpuProfiler& get() {
+		static CpuProfiler profiler;
+		return profiler;
+	}
+
+	~CpuProfiler();
+
+	/**
+		Start a session. Events from before calibration completes are kept and
+		converted once the tick rate is known.
+
+		\param filename the Chrome trace JSON file to write
+	*/
+	void begin_session(const std::string& filename);
+	void end_session();
+
+	void set_thread_name(const char* name);
+
+	/**
+		Start or stop keeping the session's events in memory as well as writing them to its file.
+	*/
+	void set_capture(bool capture) { capturing.store(capture); }
+
+	/**
+		Wait for the events recorded so far to be flushed, then hand over those captured.
+
+		\returns the events captured since capture was enabled, emptying the capture
+	*/
+	std::vector<vkUtil::TraceEvent> take_captured_events();
+
+	//the id and name of every thread which has recorded an event or been named
+	std::vector<std::pair<uint32_t, std::string>> get_thread_names();
+
+	void record(const char* name, uint64_t start, uint64_t end) {
+		if (!active.load(std::memory_order_relaxed)) {
+			return;
+		}
+		if (!threadRing) {
+			threadRing = register_thread();
+		}
+		if (!threadRing->push({ name, start, end })) {
+			dropped.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+private:
+	CpuProfiler() = default;
+
+	static thread_local CpuEventRing* threadRing;
+
+	std::atomic<bool> active{ false };
+	std::atomic<uint64_t> dropped{ 0 };
+
+	//rings outlive their threads, the flusher drains whatever is left
+	std::mutex ringMutex;
+	std::vector<std::unique_ptr<CpuEventRing>> rings;
+
+	std::thread flusher;
+	std::mutex flushMutex;
+	std::condition_variable flushWake;
+	std::condition_variable flushDone;
+	bool stopping = false;
+	//flushes asked for by take_captured_events, and how many of those the flusher has finished
+	uint64_t flushRequests = 0;
+	uint64_t flushesDone = 0;
+
+	std::atomic<bool> capturing{ false };
+	std::mutex captureMutex;
+	std::vector<vkUtil::TraceEvent> captured;
+
+	std::string filename;
+	//ticks and trace time at the start of the session, and the measured tick rate
+	uint64_t startTicks = 0;
+	double startTime = 0.0;
+	double ticksPerMicrosecond = 0.0;
+
+	CpuEventRing* register_thread();
+	void flush_loop();
+};
+
+/**
+	Records an event covering its own lifetime.
+*/
+class CpuProfileScope
+{
+public:
+	CpuProfileScope(const char* name) : name(name), start(profiler_ticks()) {}
+	~CpuProfileScope() { CpuProfiler::get().record(name, start, profiler_ticks()); }
+
+	CpuProfileScope(const CpuProfileScope&) = delete;
+	CpuProfileScope& operator=(const CpuProfileScope&) = delete;
+
+private:
+	const char* name;
+	uint64_t start;
+};
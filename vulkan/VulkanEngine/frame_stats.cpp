@@ -0,0 +1,219 @@
+#include "pch.h"
+#include "frame_stats.h"
+
+int FrameTimeHistogram::bucket_index(uint64_t microseconds)
+{
+	//the first 32 values get a bucket each, then every doubling is split 32 ways
+	if (microseconds < subBucketCount)
+	{
+		return static_cast<int>(microseconds);
+	}
+
+	int highestBit = 0;
+	while ((microseconds >> (highestBit + 1)) != 0)
+	{
+		++highestBit;
+	}
+	int shift = highestBit - subBucketBits;
+	return (shift + 1) * subBucketCount + static_cast<int>((microseconds >> shift) - subBucketCount);
+}
+
+double FrameTimeHistogram::bucket_midpoint(int index)
+{
+	int block = index / subBucketCount;
+	int offset = index % subBucketCount;
+	if (block == 0)
+	{
+		return offset / 1000.0;
+	}
+
+	uint64_t lowest = static_cast<uint64_t>(subBucketCount + offset) << (block - 1);
+	uint64_t width = 1ull << (block - 1);
+	return (lowest + 0.5 * width) / 1000.0;
+}
+
+void FrameTimeHistogram::record(double milliseconds)
+{
+	double microseconds = std::clamp(milliseconds * 1000.0, 0.0, static_cast<double>(maxMicroseconds));
+	++buckets[bucket_index(static_cast<uint64_t>(microseconds))];
+	++total;
+	sum += milliseconds;
+	largest = std::max(largest, milliseconds);
+}
+
+double FrameTimeHistogram::percentile(double percentile) const
+{
+	if (total == 0)
+	{
+		return 0.0;
+	}
+
+	uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(percentile / 100.0 * total)));
+	uint64_t seen = 0;
+	for (int i = 0; i < bucketCount; ++i)
+	{
+		seen += buckets[i];
+		if (seen >= rank)
+		{
+			//the top bucket's midpoint can overshoot the real maximum
+			return std::min(bucket_midpoint(i), largest);
+		}
+	}
+	return largest;
+}
+
+void FrameTimeHistogram::reset()
+{
+	buckets.fill(0);
+	total = 0;
+	sum = 0.0;
+	largest = 0.0;
+}
+
+FrameStats::FrameStats(double hitchThreshold)
+	: hitchThreshold(hitchThreshold)
+{
+	history.reserve(historySize);
+}
+
+void FrameStats::record_frame(double cpuTime, double presentInterval)
+{
+	++frameCount;
+
+	Sample sample = { cpuTime, -1.0, presentInterval };
+	if (history.size() < historySize)
+	{
+		history.push_back(sample);
+	}
+	else
+	{
+		history[(frameCount - 1) % historySize] = sample;
+	}
+
+	cpu.record(cpuTime);
+	recentCpu.record(cpuTime);
+
+	//the first frame has nothing to be presented after
+	if (frameCount == 1)
+	{
+		return;
+	}
+	present.record(presentInterval);
+	recentPresent.record(presentInterval);
+
+	if (presentInterval > hitchThreshold)
+	{
+		++hitchCount;
+		++recentHitches;
+		if (hitches.size() < maxHitchReports)
+		{
+			hitches.push_back(frameCount);
+		}
+	}
+}
+
+void FrameStats::record_gpu(uint64_t frameIndex, double gpuTime)
+{
+	if (frameIndex == 0 || frameIndex > frameCount || frameCount - frameIndex >= history.size())
+	{
+		return;
+	}
+
+	Sample& sample = history[(frameIndex - 1) % historySize];
+	if (sample.gpuTime >= 0.0)
+	{
+		return;
+	}
+	sample.gpuTime = gpuTime;
+	gpu.record(gpuTime);
+	recentGpu.record(gpuTime);
+}
+
+std::string FrameStats::take_summary()
+{
+	std::stringstream summary;
+	summary << std::fixed << std::setprecision(1);
+
+	double fps = recentPresent.mean() > 0.0 ? 1000.0 / recentPresent.mean() : 0.0;
+	summary << std::setprecision(0) << fps << " fps" << std::setprecision(1)
+		<< " | frame p50 " << recentPresent.percentile(50) << " p99 " << recentPresent.percentile(99)
+		<< " max " << recentPresent.maximum() << " ms"
+		<< " | cpu p99 " << recentCpu.percentile(99) << " ms";
+	if (recentGpu.count() > 0)
+	{
+		summary << " | gpu p99 " << recentGpu.percentile(99) << " ms";
+	}
+	summary << " | " << recentHitches << " hitches";
+
+	recentCpu.reset();
+	recentGpu.reset();
+	recentPresent.reset();
+	recentHitches = 0;
+
+	return summary.str();
+}
+
+std::string FrameStats::report() const
+{
+	std::stringstream report;
+	report << std::fixed << std::setprecision(3);
+
+	report << frameCount << " frames, " << hitchCount << " over " << hitchThreshold << " ms\n";
+	report << "\t\tp50\t\tp95\t\tp99\t\tmax\n";
+	auto row = [&report](const char* name, const FrameTimeHistogram& histogram) {
+		if (histogram.count() == 0)
+		{
+			return;
+		}
+		report << name << "\t\t" << histogram.percentile(50) << "\t\t" << histogram.percentile(95)
+			<< "\t\t" << histogram.percentile(99) << "\t\t" << histogram.maximum() << '\n';
+	};
+	row("cpu", cpu);
+	row("gpu", gpu);
+	row("frame", present);
+
+	for (uint64_t frame : hitches)
+	{
+		if (frameCount - frame < history.size())
+		{
+			const Sample& sample = history[(frame - 1) % historySize];
+			report << "hitch at frame " << frame << ": " << sample.presentInterval << " ms, cpu " << sample.cpuTime << " ms\n";
+		}
+	}
+	if (hitchCount > hitches.size())
+	{
+		report << "and " << hitchCount - hitches.size() << " more hitches\n";
+	}
+
+	return report.str();
+}
+
+bool FrameStats::write_csv(const std::string& filename) const
+{
+	std::ofstream file(filename);
+	if (!file)
+	{
+		return false;
+	}
+
+	file << "frame,cpu_ms,gpu_ms,present_interval_ms,hitch\n" << std::fixed << std::setprecision(3);
+
+	uint64_t first = frameCount - history.size() + 1;
+	for (uint64_t frame = first; frame <= frameCount; ++frame)
+	{
+		const Sample& sample = history[(frame - 1) % historySize];
+		file << frame << ',' << sample.cpuTime << ',';
+		if (sample.gpuTime >= 0.0)
+		{
+			file << sample.gpuTime;
+		}
+		file << ',';
+		if (frame > 1)
+		{
+			file << sample.presentInterval;
+		}
+		file << ',' << (frame > 1 && sample.presentInterval > hitchThreshold ? 1 : 0) << '\n';
+	}
+
+	return static_cast<bool>(file);
+}
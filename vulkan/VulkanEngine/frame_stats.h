@@ -0,0 +1,127 @@
+#pragma once
+#include <array>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+/**
+	Records durations into a fixed set of log-linear buckets, so percentiles can be
+	read at any time without keeping or sorting the samples. Each doubling of the
+	value is split into 32 buckets, keeping values to within about 3%, from 1us to 10s.
+*/
+class FrameTimeHistogram
+{
+public:
+	/**
+		\param milliseconds the duration to add, clamped to the histogram's range
+	*/
+	void record(double milliseconds);
+
+	/**
+		\param percentile between 0 and 100
+		\returns the smallest duration which at least that percentage of samples don't exceed,
+			in milliseconds, or zero if there are no samples
+	*/
+	double percentile(double percentile) const;
+
+	uint64_t count() const { return total; }
+	double mean() const { return total ? sum / total : 0.0; }
+	double maximum() const { return largest; }
+
+	void reset();
+
+private:
+	static constexpr int subBucketBits = 5;
+	static constexpr int subBucketCount = 1 << subBucketBits;
+	//10s in microseconds is below 2^24
+	static constexpr int bucketCount = (24 - subBucketBits + 1) * subBucketCount;
+	static constexpr uint64_t maxMicroseconds = 10000000;
+
+	std::array<uint32_t, bucketCount> buckets{};
+	uint64_t total = 0;
+	double sum = 0.0;
+	double largest = 0.0;
+
+	static int bucket_index(uint64_t microseconds);
+	static double bucket_midpoint(int index);
+};
+
+/**
+	Per-frame cpu time, gpu time and present-to-present interval, kept as histograms
+	for percentiles and as a bounded per-frame history for hitch reports and CSV dumps.
+*/
+class FrameStats
+{
+public:
+	/**
+		\param hitchThreshold a frame whose present interval exceeds this many milliseconds is a hitch
+	*/
+	FrameStats(double hitchThreshold);
+
+	void set_hitch_threshold(double milliseconds) { hitchThreshold = milliseconds; }
+
+	/**
+		Record a frame as it finishes on the cpu.
+
+		\param cpuTime time spent producing the frame, in milliseconds
+		\param presentInterval time since the previous frame finished, in milliseconds
+	*/
+	void record_frame(double cpuTime, double presentInterval);
+
+	/**
+		Record a frame's gpu time, which only arrives a few frames after the frame itself.
+
+		\param frameIndex the frame, counting from 1 in the order record_frame was called
+		\param gpuTime the frame's gpu time, in milliseconds
+	*/
+	void record_gpu(uint64_t frameIndex, double gpuTime);
+
+	uint64_t get_frame_count() const { return frameCount; }
+	uint64_t get_hitch_count() const { return hitchCount; }
+	const FrameTimeHistogram& get_cpu_times() const { return cpu; }
+	const FrameTimeHistogram& get_gpu_times() const { return gpu; }
+	const FrameTimeHistogram& get_present_intervals() const { return present; }
+
+	/**
+		Summarise the frames since the last call in a line short enough for a window title.
+	*/
+	std::string take_summary();
+
+	/**
+		\returns percentiles of the whole session, one line per measurement, and its hitches
+	*/
+	std::string report() const;
+
+	/**
+		Write the retained per-frame history as CSV.
+
+		\param filename the path to write to
+		\returns whether the file was written
+	*/
+	bool write_csv(const std::string& filename) const;
+
+private:
+	struct Sample {
+		double cpuTime;
+		//negative until the gpu time arrives
+		double gpuTime;
+		double presentInterval;
+	};
+
+	//the most recent frames kept for the CSV, older ones only live on in the histograms
+	static constexpr size_t historySize = 1 << 16;
+	static constexpr size_t maxHitchReports = 16;
+
+	double hitchThreshold;
+	uint64_t frameCount = 0;
+	uint64_t hitchCount = 0;
+	std::vector<Sample> history;
+	//the first few hitches, as frame indices
+	std::vector<uint64_t> hitches;
+
+	//the whole session
+	FrameTimeHistogram cpu, gpu, present;
+	//since the last summary
+	FrameTimeHistogram recentCpu, recentGpu, recentPresent;
+	uint64_t recentHitches = 0;
+};
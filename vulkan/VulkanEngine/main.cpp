@@ -1,11 +1,62 @@
 #include "pch.h"
 #include "app.h"
+#include "cpu_profiler.h"
+#include "self_test.h"
+#include "Vulkan/mesh_loader.h"
+#include "Vulkan/cooked_mesh.h"
 
-int main() {
+int main(int argc, char** argv) {
 
-	App* myApp = new App(640, 480, true);
-	myApp->run();
+	//only does anything in builds with ENABLE_PROFILING, covers startup through shutdown
+	PROFILE_BEGIN_SESSION("cpu_profile.json");
+	PROFILE_THREAD("main");
+
+	//--cook input output, imports a model and writes it out in the cooked mesh format
+	if (argc > 3 && strcmp(argv[1], "--cook") == 0) {
+		std::vector<vkUtil::MeshData> meshes = vkUtil::load_model(argv[2], true);
+		bool cooked = !meshes.empty() && vkUtil::cook_meshes(meshes, argv[3], true);
+		PROFILE_END_SESSION();
+		return cooked ? 0 : 1;
+	}
+
+	//--self-test, runs the checks which need no device and exits nonzero on the first failure
+	if (argc > 1 && strcmp(argv[1], "--self-test") == 0) {
+		int result = selfTest::run();
+		PROFILE_END_SESSION();
+		return result;
+	}
+
+	bool benchmarkMode = argc > 1 && strcmp(argv[1], "--benchmark") == 0;
+	//--headless [frames] [output.ppm], renders without a window, eg. on a build machine with no gpu
+	bool headlessMode = argc > 1 && strcmp(argv[1], "--headless") == 0;
+	//--trace [output.json], runs normally and writes a Chrome trace on exit
+	bool traceMode = argc > 1 && strcmp(argv[1], "--trace") == 0;
+
+	//validation layers would skew the timings
+	App* myApp = new App(640, 480, !(benchmarkMode || headlessMode || traceMode), headlessMode);
+	if (traceMode) {
+		myApp->set_trace_output(argc > 2 ? argv[2] : "trace.json");
+	}
+	//--model path, after the mode and its arguments, draws every object with the model's first mesh
+	for (int i = 1; i + 1 < argc; ++i) {
+		if (strcmp(argv[i], "--model") == 0 && !myApp->load_model(argv[i + 1])) {
+			std::cout << "Couldn't load a mesh from " << argv[i + 1] << ", drawing triangles\n";
+		}
+	}
+	if (benchmarkMode) {
+		myApp->run_benchmark();
+	}
+	else if (headlessMode) {
+		int frameCount = argc > 2 ? std::max(1, atoi(argv[2])) : 100;
+		std::string output = argc > 3 ? argv[3] : "headless.ppm";
+		myApp->run_headless(frameCount, output);
+	}
+	else {
+		myApp->run();
+	}
 	delete myApp;
 
+	PROFILE_END_SESSION();
+
 	return 0;
 }
\ No newline at end of file
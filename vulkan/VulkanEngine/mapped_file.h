@@ -0,0 +1,38 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+/**
+	A read only view of a whole file, mapped into memory. Pages are only read
+	from disk as they're touched, and the data is valid until the file is closed.
+*/
+class MappedFile
+{
+public:
+	MappedFile() = default;
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	/**
+		\param filename the path to the file
+		\returns whether the file was mapped, empty files can't be
+	*/
+	bool open(const std::string& filename);
+
+	void close();
+
+	const uint8_t* data() const { return view; }
+	size_t size() const { return length; }
+
+private:
+	const uint8_t* view = nullptr;
+	size_t length = 0;
+#ifdef _WIN32
+	void* file = nullptr;
+	void* mapping = nullptr;
+#else
+	int descriptor = -1;
+#endif
+};
@@ -25,5 +25,10 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <cassert>
+#include <functional>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+#include <deque>
 #include <array>
 
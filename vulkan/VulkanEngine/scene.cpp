@@ -1,8 +1,17 @@
 #include "pch.h"
 #include "scene.h"
+#include <atomic>
+
+namespace {
+
+	//shared by every scene, so no two scenes ever hand out the same generation
+	std::atomic<uint64_t> nextGeneration{ 1 };
+}
 
 Scene::Scene()
 {
+	bump_generation();
+
 	for (float x = -1.0f; x < 1.0f; x += 0.2f)
 	{
 		for (float y = -1.0f; y < 1.0f; y += 0.2f)
@@ -10,4 +19,47 @@ Scene::Scene()
 			trianglePositions.push_back(glm::vec3(x, y, 0.0f));
 		}
 	}
-}
\ No newline at end of file
+}
+
+Scene::Scene(int objectCount)
+{
+	bump_generation();
+
+	int side = std::max(1, static_cast<int>(std::ceil(std::sqrt(static_cast<float>(objectCount)))));
+	float step = 2.0f / side;
+
+	trianglePositions.reserve(objectCount);
+	for (int i = 0; i < objectCount; ++i)
+	{
+		float x = -1.0f + step * (i % side + 0.5f);
+		float y = -1.0f + step * (i / side + 0.5f);
+		trianglePositions.push_back(glm::vec3(x, y, 0.0f));
+	}
+}
+
+void Scene::bump_generation()
+{
+	generation = nextGeneration.fetch_add(1, std::memory_order_relaxed);
+}
+
+void Scene::set_position(size_t object, const glm::vec3& position)
+{
+	trianglePositions[object] = position;
+	bump_generation();
+}
+
+void Scene::set_mesh(uint32_t mesh)
+{
+	this->mesh = mesh;
+	bump_generation();
+}
+
+void Scene::set_material(size_t object, uint32_t material)
+{
+	if (object >= materials.size())
+	{
+		materials.resize(trianglePositions.size(), 0);
+	}
+	materials[object] = material;
+	bump_generation();
+}
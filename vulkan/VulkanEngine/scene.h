@@ -4,5 +4,44 @@ class Scene
 {
 public:
 	Scene();
+
+	/**
+		Make a scene with the given number of triangles, laid out on a grid
+		covering the screen.
+	*/
+	Scene(int objectCount);
+
+	const std::vector<glm::vec3>& get_positions() const { return trianglePositions; }
+	size_t get_object_count() const { return trianglePositions.size(); }
+	void set_position(size_t object, const glm::vec3& position);
+
+	uint32_t get_mesh() const { return mesh; }
+	void set_mesh(uint32_t mesh);
+
+	uint32_t get_material(size_t object) const { return object < materials.size() ? materials[object] : 0; }
+
+	/**
+		Give an object a material.
+
+		\param object the object's index
+		\param material the material, from Engine::add_material
+	*/
+	void set_material(size_t object, uint32_t material);
+
+	/**
+		Changes on every edit, and is never shared by two scenes which differ,
+		so the engine can tell whether data it uploaded from a scene is stale.
+	*/
+	uint64_t get_generation() const { return generation; }
+
+private:
 	std::vector<glm::vec3> trianglePositions;
-};
\ No newline at end of file
+	//the engine's mesh every object is drawn with, mesh 0 is a triangle
+	uint32_t mesh = 0;
+	//each object's material. Objects without one use material 0, plain white
+	std::vector<uint32_t> materials;
+
+	uint64_t generation;
+
+	void bump_generation();
+};
@@ -0,0 +1,465 @@
+#include "pch.h"
+#include "self_test.h"
+#include "Vulkan/buddy_allocator.h"
+#include "Vulkan/render_graph.h"
+#include <random>
+
+namespace {
+
+	//thrown by SELF_CHECK, which ends the run
+	struct CheckFailure {
+		std::string message;
+	};
+}
+
+#define SELF_CHECK(condition) \
+	do { \
+		if (!(condition)) { \
+			throw CheckFailure{ std::string(__FILE__) + "(" + std::to_string(__LINE__) + "): " + #condition }; \
+		} \
+	} while (false)
+
+namespace {
+
+	using vkUtil::BuddyAllocator;
+
+	constexpr uint64_t buddySize = 1 << 20;
+	constexpr uint64_t buddyMinBlockSize = 256;
+
+	uint64_t next_power_of_two(uint64_t value) {
+
+		uint64_t result = 1;
+		while (result < value) {
+			result <<= 1;
+		}
+		return result;
+	}
+
+	/**
+		Check the allocator's own view of its live allocations against what was handed out,
+		and that none of them overlap once padded to their block size.
+	*/
+	void check_consistent(const BuddyAllocator& allocator, const std::unordered_map<uint64_t, uint64_t>& live) {
+
+		std::vector<std::pair<uint64_t, uint64_t>> allocations = allocator.allocations();
+		SELF_CHECK(allocations.size() == live.size());
+		SELF_CHECK(allocator.allocation_count() == live.size());
+
+		uint64_t requested = 0;
+		uint64_t reserved = 0;
+		for (const auto& [offset, size] : allocations) {
+			auto expected = live.find(offset);
+			SELF_CHECK(expected != live.end() && expected->second == size);
+			requested += size;
+			reserved += std::max(next_power_of_two(size), buddyMinBlockSize);
+		}
+		SELF_CHECK(requested == allocator.requested_bytes());
+		//blocks are also padded out to the alignment asked for, so that's only a lower bound
+		SELF_CHECK(reserved <= allocator.reserved_bytes());
+
+		std::sort(allocations.begin(), allocations.end());
+		for (size_t i = 0; i < allocations.size(); ++i) {
+			uint64_t end = allocations[i].first + std::max(next_power_of_two(allocations[i].second), buddyMinBlockSize);
+			uint64_t limit = i + 1 < allocations.size() ? allocations[i + 1].first : allocator.get_size();
+			SELF_CHECK(end <= limit);
+		}
+	}
+
+	//fill the range with the smallest blocks, then free them out of order, which should merge back into one block
+	void buddy_split_merge() {
+
+		BuddyAllocator allocator(buddySize, buddyMinBlockSize);
+		std::unordered_map<uint64_t, uint64_t> live;
+
+		for (uint64_t i = 0; i < buddySize / buddyMinBlockSize; ++i) {
+			uint64_t offset = allocator.allocate(1, 1);
+			SELF_CHECK(offset != BuddyAllocator::invalidOffset);
+			SELF_CHECK(live.count(offset) == 0);
+			live[offset] = 1;
+		}
+		check_consistent(allocator, live);
+		SELF_CHECK(allocator.free_bytes() == 0);
+		SELF_CHECK(allocator.largest_free_block() == 0);
+
+		std::vector<uint64_t> offsets;
+		for (const auto& [offset, size] : live) {
+			offsets.push_back(offset);
+		}
+		std::shuffle(offsets.begin(), offsets.end(), std::mt19937(1));
+		for (uint64_t offset : offsets) {
+			allocator.free(offset);
+			live.erase(offset);
+		}
+
+		SELF_CHECK(allocator.empty());
+		check_consistent(allocator, live);
+		SELF_CHECK(allocator.largest_free_block() == buddySize);
+		SELF_CHECK(allocator.fragmentation() == 0.0f);
+		SELF_CHECK(allocator.allocate(buddySize, 1) == 0);
+	}
+
+	//mixed sizes and alignments, every offset must honour both
+	void buddy_alignment() {
+
+		BuddyAllocator allocator(buddySize, buddyMinBlockSize);
+		std::unordered_map<uint64_t, uint64_t> live;
+		std::mt19937 random(2);
+
+		for (int i = 0; i < 256; ++i) {
+			uint64_t size = 1 + random() % 8192;
+			uint64_t alignment = uint64_t(1) << (random() % 15);
+			uint64_t offset = allocator.allocate(size, alignment);
+			if (offset == BuddyAllocator::invalidOffset) {
+				continue;
+			}
+			SELF_CHECK(offset % alignment == 0);
+			SELF_CHECK(offset % std::min(next_power_of_two(size), buddySize) == 0);
+			live[offset] = size;
+		}
+
+		SELF_CHECK(!live.empty());
+		check_consistent(allocator, live);
+	}
+
+	//running out must fail cleanly and leave the allocator usable
+	void buddy_exhaustion() {
+
+		BuddyAllocator allocator(buddySize, buddyMinBlockSize);
+
+		SELF_CHECK(allocator.allocate(buddySize + 1, 1) == BuddyAllocator::invalidOffset);
+		SELF_CHECK(allocator.allocate(1, buddySize * 2) == BuddyAllocator::invalidOffset);
+
+		uint64_t whole = allocator.allocate(buddySize, 1);
+		SELF_CHECK(whole == 0);
+		SELF_CHECK(allocator.allocate(1, 1) == BuddyAllocator::invalidOffset);
+		allocator.free(whole);
+
+		//half the range taken leaves exactly one half free
+		uint64_t half = allocator.allocate(buddySize / 2, 1);
+		uint64_t other = allocator.allocate(buddySize / 2, 1);
+		SELF_CHECK(half != BuddyAllocator::invalidOffset && other != BuddyAllocator::invalidOffset);
+		SELF_CHECK(half != other);
+		SELF_CHECK(allocator.allocate(1, 1) == BuddyAllocator::invalidOffset);
+		allocator.free(half);
+		SELF_CHECK(allocator.allocate(buddySize / 2 + 1, 1) == BuddyAllocator::invalidOffset);
+		SELF_CHECK(allocator.allocate(buddySize / 2, 1) == half);
+
+		//freeing an offset which was never handed out changes nothing
+		allocator.free(buddyMinBlockSize);
+		SELF_CHECK(allocator.allocation_count() == 2);
+		SELF_CHECK(allocator.free_bytes() == 0);
+	}
+
+	//freeing every other small block leaves half the range free but none of it merged
+	void buddy_fragmentation() {
+
+		BuddyAllocator allocator(buddySize, buddyMinBlockSize);
+
+		std::vector<uint64_t> offsets;
+		for (uint64_t i = 0; i < buddySize / buddyMinBlockSize; ++i) {
+			offsets.push_back(allocator.allocate(buddyMinBlockSize, 1));
+		}
+		std::sort(offsets.begin(), offsets.end());
+		for (size_t i = 0; i < offsets.size(); i += 2) {
+			allocator.free(offsets[i]);
+		}
+
+		//the same measure MemoryAllocator::get_stats reports, from the same counters
+		float expected = 1.0f - static_cast<float>(buddyMinBlockSize) / static_cast<float>(buddySize / 2);
+		float reported = 1.0f - static_cast<float>(allocator.largest_free_block()) / static_cast<float>(allocator.free_bytes());
+		SELF_CHECK(allocator.free_bytes() == buddySize / 2);
+		SELF_CHECK(allocator.largest_free_block() == buddyMinBlockSize);
+		SELF_CHECK(std::abs(allocator.fragmentation() - expected) < 1e-6f);
+		SELF_CHECK(std::abs(reported - expected) < 1e-6f);
+
+		//freeing the rest merges it all back
+		for (size_t i = 1; i < offsets.size(); i += 2) {
+			allocator.free(offsets[i]);
+		}
+		SELF_CHECK(allocator.fragmentation() == 0.0f);
+		SELF_CHECK(allocator.largest_free_block() == buddySize);
+	}
+
+	//random allocations and frees, checked against a shadow copy as they go
+	void buddy_churn() {
+
+		BuddyAllocator allocator(buddySize, buddyMinBlockSize);
+		std::unordered_map<uint64_t, uint64_t> live;
+		std::vector<uint64_t> offsets;
+		std::mt19937 random(3);
+
+		for (int i = 0; i < 20000; ++i) {
+			if (offsets.empty() || random() % 3 != 0) {
+				uint64_t size = 1 + random() % 16384;
+				uint64_t offset = allocator.allocate(size, uint64_t(1) << (random() % 10));
+				if (offset != BuddyAllocator::invalidOffset) {
+					SELF_CHECK(live.count(offset) == 0);
+					live[offset] = size;
+					offsets.push_back(offset);
+				}
+			}
+			else {
+				size_t index = random() % offsets.size();
+				allocator.free(offsets[index]);
+				live.erase(offsets[index]);
+				offsets[index] = offsets.back();
+				offsets.pop_back();
+			}
+
+			if (i % 1000 == 0) {
+				check_consistent(allocator, live);
+			}
+		}
+
+		for (uint64_t offset : offsets) {
+			allocator.free(offset);
+		}
+		SELF_CHECK(allocator.empty());
+		SELF_CHECK(allocator.largest_free_block() == buddySize);
+	}
+
+	using vkUtil::RenderAccess;
+	using vkUtil::RenderGraph;
+	using vkUtil::RenderResource;
+	using Stage = vk::PipelineStageFlagBits;
+	using Access = vk::AccessFlagBits;
+
+	bool is_transition(const RenderGraph::ImageTransition& transition, RenderResource resource,
+		vk::ImageLayout oldLayout, vk::ImageLayout newLayout, vk::AccessFlags srcAccess, vk::AccessFlags dstAccess) {
+
+		return transition.resource == resource && transition.oldLayout == oldLayout && transition.newLayout == newLayout
+			&& transition.srcAccess == srcAccess && transition.dstAccess == dstAccess;
+	}
+
+	bool is_memory_barrier(const RenderGraph::BarrierBatch& batch, vk::PipelineStageFlags srcStages,
+		vk::PipelineStageFlags dstStages, vk::AccessFlags srcAccess, vk::AccessFlags dstAccess) {
+
+		return batch.memoryBarrier && batch.transitions.empty() && batch.srcStages == srcStages
+			&& batch.dstStages == dstStages && batch.srcAccess == srcAccess && batch.dstAccess == dstAccess;
+	}
+
+	/**
+		Three compute passes handing buffers down a chain, a pass nothing needs, and a copy out.
+		The last buffer's lifetime starts after the first's ends, so they should share memory.
+
+		\returns the buffers, in the order they're written
+	*/
+	std::array<RenderResource, 3> declare_buffer_chain(RenderGraph& graph, vk::DeviceSize size) {
+
+		RenderResource readback = graph.import_buffer("readback", nullptr);
+		graph.mark_output(readback);
+		RenderResource first = graph.create_buffer("first", size);
+		RenderResource second = graph.create_buffer("second", size);
+		RenderResource third = graph.create_buffer("third", size);
+		RenderResource unused = graph.create_buffer("unused", size);
+
+		uint32_t pass = graph.add_pass("first", nullptr);
+		graph.use(pass, first, RenderAccess::StorageWrite);
+
+		pass = graph.add_pass("second", nullptr);
+		graph.use(pass, first, RenderAccess::StorageRead);
+		graph.use(pass, second, RenderAccess::StorageWrite);
+
+		pass = graph.add_pass("unused", nullptr);
+		graph.use(pass, second, RenderAccess::StorageRead);
+		graph.use(pass, unused, RenderAccess::StorageWrite);
+
+		pass = graph.add_pass("third", nullptr);
+		graph.use(pass, second, RenderAccess::StorageRead);
+		graph.use(pass, third, RenderAccess::StorageWrite);
+
+		pass = graph.add_pass("copy out", nullptr);
+		graph.use(pass, third, RenderAccess::TransferRead);
+		graph.use(pass, readback, RenderAccess::TransferWrite);
+
+		return { first, second, third };
+	}
+
+	//each read waits on the write before it, and the aliased buffer also waits on what used its memory last
+	void render_graph_buffer_chain() {
+
+		constexpr vk::DeviceSize size = 4096;
+		RenderGraph graph(nullptr, nullptr, false);
+		graph.begin();
+		auto [first, second, third] = declare_buffer_chain(graph, size);
+		SELF_CHECK(graph.compile());
+
+		const std::vector<RenderGraph::CompiledPass>& schedule = graph.get_schedule();
+		SELF_CHECK(schedule.size() == 4);
+		SELF_CHECK(schedule[0].pass == 0 && schedule[1].pass == 1 && schedule[2].pass == 3 && schedule[3].pass == 4);
+
+		SELF_CHECK(schedule[0].barriers.empty());
+		SELF_CHECK(is_memory_barrier(schedule[1].barriers, Stage::eComputeShader, Stage::eComputeShader,
+			Access::eShaderWrite, Access::eShaderRead));
+		SELF_CHECK(is_memory_barrier(schedule[2].barriers, Stage::eComputeShader, Stage::eComputeShader,
+			Access::eShaderWrite, Access::eShaderRead | Access::eShaderWrite));
+		SELF_CHECK(is_memory_barrier(schedule[3].barriers, Stage::eComputeShader, Stage::eTransfer,
+			Access::eShaderWrite, Access::eTransferRead));
+		SELF_CHECK(graph.get_epilogue().empty());
+
+		std::optional<RenderGraph::TransientPlacement> placements[] = {
+			graph.get_placement(first), graph.get_placement(second), graph.get_placement(third)
+		};
+		for (const auto& placement : placements) {
+			SELF_CHECK(placement && placement->heap == 0 && placement->size == size);
+		}
+		SELF_CHECK(placements[0]->offset == 0);
+		SELF_CHECK(placements[1]->offset == size);
+		SELF_CHECK(placements[2]->offset == 0);
+		//the culled pass's buffer and the imported one get no memory
+		SELF_CHECK(!graph.get_placement(0));
+		SELF_CHECK(!graph.get_placement(4));
+
+		const vkUtil::RenderGraphStats& stats = graph.get_stats();
+		SELF_CHECK(stats.passCount == 5 && stats.culledPassCount == 1);
+		SELF_CHECK(stats.barrierBatchCount == 3 && stats.barrierCount == 3);
+		SELF_CHECK(stats.transientBytes == 3 * size && stats.aliasedBytes == 2 * size);
+	}
+
+	//attachments move into the layouts each pass needs, and the imported backbuffer ends up ready to present
+	void render_graph_image_layouts() {
+
+		RenderGraph graph(nullptr, nullptr, false);
+		graph.begin();
+		vk::Extent2D extent(64, 64);
+		RenderResource albedo = graph.create_image("albedo", extent, vk::Format::eR8G8B8A8Unorm);
+		RenderResource depth = graph.create_image("depth", extent, vk::Format::eD32Sfloat);
+		RenderResource debugView = graph.create_image("debug view", extent, vk::Format::eR8G8B8A8Unorm);
+		RenderResource backbuffer = graph.import_image("backbuffer", nullptr, nullptr,
+			vk::ImageLayout::eUndefined, vk::ImageLayout::ePresentSrcKHR);
+
+		uint32_t pass = graph.add_pass("gbuffer", nullptr);
+		graph.use(pass, albedo, RenderAccess::ColorAttachment);
+		graph.use(pass, depth, RenderAccess::DepthAttachment);
+
+		pass = graph.add_pass("debug view", nullptr);
+		graph.use(pass, albedo, RenderAccess::SampledRead);
+		graph.use(pass, debugView, RenderAccess::ColorAttachment);
+
+		pass = graph.add_pass("lighting", nullptr);
+		graph.use(pass, albedo, RenderAccess::SampledRead);
+		graph.use(pass, depth, RenderAccess::SampledRead);
+		graph.use(pass, backbuffer, RenderAccess::ColorAttachment);
+
+		SELF_CHECK(graph.compile());
+		const std::vector<RenderGraph::CompiledPass>& schedule = graph.get_schedule();
+		SELF_CHECK(schedule.size() == 2);
+		SELF_CHECK(schedule[0].pass == 0 && schedule[1].pass == 2);
+
+		//nothing to wait for, the attachments just leave the undefined layout
+		const RenderGraph::BarrierBatch& gbuffer = schedule[0].barriers;
+		SELF_CHECK(!gbuffer.memoryBarrier);
+		SELF_CHECK(gbuffer.transitions.size() == 2);
+		SELF_CHECK(is_transition(gbuffer.transitions[0], albedo, vk::ImageLayout::eUndefined,
+			vk::ImageLayout::eColorAttachmentOptimal, {}, Access::eColorAttachmentRead | Access::eColorAttachmentWrite));
+		SELF_CHECK(is_transition(gbuffer.transitions[1], depth, vk::ImageLayout::eUndefined,
+			vk::ImageLayout::eDepthStencilAttachmentOptimal, {},
+			Access::eDepthStencilAttachmentRead | Access::eDepthStencilAttachmentWrite));
+		SELF_CHECK(gbuffer.srcStages == gbuffer.dstStages);
+		SELF_CHECK(gbuffer.srcStages == (Stage::eColorAttachmentOutput | Stage::eEarlyFragmentTests | Stage::eLateFragmentTests));
+
+		//both g-buffer images and the backbuffer in one call
+		const RenderGraph::BarrierBatch& lighting = schedule[1].barriers;
+		SELF_CHECK(!lighting.memoryBarrier);
+		SELF_CHECK(lighting.transitions.size() == 3);
+		SELF_CHECK(is_transition(lighting.transitions[0], albedo, vk::ImageLayout::eColorAttachmentOptimal,
+			vk::ImageLayout::eShaderReadOnlyOptimal, Access::eColorAttachmentWrite, Access::eShaderRead));
+		SELF_CHECK(is_transition(lighting.transitions[1], depth, vk::ImageLayout::eDepthStencilAttachmentOptimal,
+			vk::ImageLayout::eShaderReadOnlyOptimal, Access::eDepthStencilAttachmentWrite, Access::eShaderRead));
+		SELF_CHECK(is_transition(lighting.transitions[2], backbuffer, vk::ImageLayout::eUndefined,
+			vk::ImageLayout::eColorAttachmentOptimal, {}, Access::eColorAttachmentRead | Access::eColorAttachmentWrite));
+		SELF_CHECK(lighting.srcStages == (Stage::eColorAttachmentOutput | Stage::eEarlyFragmentTests | Stage::eLateFragmentTests));
+		SELF_CHECK(lighting.dstStages == (Stage::eFragmentShader | Stage::eComputeShader | Stage::eColorAttachmentOutput));
+
+		const RenderGraph::BarrierBatch& epilogue = graph.get_epilogue();
+		SELF_CHECK(!epilogue.memoryBarrier);
+		SELF_CHECK(epilogue.transitions.size() == 1);
+		SELF_CHECK(is_transition(epilogue.transitions[0], backbuffer, vk::ImageLayout::eColorAttachmentOptimal,
+			vk::ImageLayout::ePresentSrcKHR, Access::eColorAttachmentWrite, {}));
+		SELF_CHECK(epilogue.srcStages == Stage::eColorAttachmentOutput);
+		SELF_CHECK(epilogue.dstStages == Stage::eBottomOfPipe);
+
+		//both live through both passes, so they can't share, each estimated at 64x64x4 with 64KiB alignment
+		std::optional<RenderGraph::TransientPlacement> albedoPlacement = graph.get_placement(albedo);
+		std::optional<RenderGraph::TransientPlacement> depthPlacement = graph.get_placement(depth);
+		SELF_CHECK(albedoPlacement && albedoPlacement->heap == 0 && albedoPlacement->offset == 0);
+		SELF_CHECK(depthPlacement && depthPlacement->heap == 0 && depthPlacement->offset == 65536);
+		SELF_CHECK(albedoPlacement->size == 64 * 64 * 4 && depthPlacement->size == 64 * 64 * 4);
+		SELF_CHECK(!graph.get_placement(debugView));
+		SELF_CHECK(!graph.get_placement(backbuffer));
+	}
+
+	//overwriting something only read so far waits for the reads, with nothing to make visible
+	void render_graph_write_after_read() {
+
+		RenderGraph graph(nullptr, nullptr, false);
+		graph.begin();
+		RenderResource buffer = graph.import_buffer("buffer", nullptr);
+
+		uint32_t pass = graph.add_pass("read", nullptr, true);
+		graph.use(pass, buffer, RenderAccess::StorageRead);
+		pass = graph.add_pass("write", nullptr, true);
+		graph.use(pass, buffer, RenderAccess::TransferWrite);
+
+		SELF_CHECK(graph.compile());
+		const std::vector<RenderGraph::CompiledPass>& schedule = graph.get_schedule();
+		SELF_CHECK(schedule.size() == 2);
+		SELF_CHECK(schedule[0].barriers.empty());
+		SELF_CHECK(is_memory_barrier(schedule[1].barriers, Stage::eComputeShader, Stage::eTransfer, {}, {}));
+		SELF_CHECK(!graph.get_placement(buffer));
+	}
+
+	//declaring the same graph again reuses the plan, changing a size doesn't
+	void render_graph_recompile() {
+
+		RenderGraph graph(nullptr, nullptr, false);
+		graph.begin();
+		declare_buffer_chain(graph, 4096);
+		SELF_CHECK(graph.compile());
+
+		graph.begin();
+		declare_buffer_chain(graph, 4096);
+		SELF_CHECK(!graph.compile());
+		SELF_CHECK(graph.get_stats().compileCount == 1);
+
+		graph.begin();
+		auto [first, second, third] = declare_buffer_chain(graph, 8192);
+		SELF_CHECK(graph.compile());
+		SELF_CHECK(graph.get_stats().compileCount == 2);
+		SELF_CHECK(graph.get_placement(second) && graph.get_placement(second)->offset == 8192);
+	}
+
+	struct SelfTest {
+		const char* name;
+		void (*run)();
+	};
+
+	const SelfTest tests[] = {
+		{ "buddy split/merge", buddy_split_merge },
+		{ "buddy alignment", buddy_alignment },
+		{ "buddy exhaustion", buddy_exhaustion },
+		{ "buddy fragmentation", buddy_fragmentation },
+		{ "buddy churn", buddy_churn },
+		{ "render graph buffer chain", render_graph_buffer_chain },
+		{ "render graph image layouts", render_graph_image_layouts },
+		{ "render graph write after read", render_graph_write_after_read },
+		{ "render graph recompile", render_graph_recompile }
+	};
+}
+
+int selfTest::run() {
+
+	for (const SelfTest& test : tests) {
+		try {
+			test.run();
+		}
+		catch (const CheckFailure& failure) {
+			std::cout << test.name << ": FAILED\n\t" << failure.message << std::endl;
+			return 1;
+		}
+		std::cout << test.name << ": ok\n";
+	}
+
+	std::cout << "All " << std::size(tests) << " self tests passed" << std::endl;
+	return 0;
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+namespace selfTest
+{
+	/**
+		Run the checks which need neither a device nor a window, stopping at
+		the first one which fails and printing where it failed.
+
+		\returns zero if every check passed, for use as the exit code
+	*/
+	int run();
+}
@@ -0,0 +1,69 @@
+#include "pch.h"
+#include "thread_pool.h"
+#include "cpu_profiler.h"
+
+ThreadPool::ThreadPool(int threadCount)
+{
+	for (int i = 0; i < threadCount; ++i)
+	{
+		workers.emplace_back(&ThreadPool::work, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	jobAvailable.notify_all();
+
+	for (std::thread& worker : workers)
+	{
+		worker.join();
+	}
+}
+
+void ThreadPool::submit(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push(std::move(job));
+		++pendingJobs;
+	}
+	jobAvailable.notify_one();
+}
+
+void ThreadPool::wait()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	jobsFinished.wait(lock, [this] { return pendingJobs == 0; });
+}
+
+void ThreadPool::work()
+{
+	PROFILE_THREAD("worker");
+
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobAvailable.wait(lock, [this] { return stopping || !jobs.empty(); });
+			if (stopping && jobs.empty())
+			{
+				return;
+			}
+			job = std::move(jobs.front());
+			jobs.pop();
+		}
+
+		job();
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			--pendingJobs;
+		}
+		jobsFinished.notify_all();
+	}
+}
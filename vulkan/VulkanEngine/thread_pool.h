@@ -0,0 +1,39 @@
+#pragma once
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <queue>
+
+/**
+	A fixed set of worker threads pulling jobs from a shared queue.
+*/
+class ThreadPool
+{
+public:
+	ThreadPool(int threadCount);
+	~ThreadPool();
+
+	/**
+		Queue a job to be run on one of the workers.
+	*/
+	void submit(std::function<void()> job);
+
+	/**
+		Block until every submitted job has finished.
+	*/
+	void wait();
+
+	int size() const { return static_cast<int>(workers.size()); }
+
+private:
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	std::condition_variable jobsFinished;
+	int pendingJobs = 0;
+	bool stopping = false;
+
+	void work();
+};